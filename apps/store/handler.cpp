@@ -46,9 +46,9 @@ StoreHandler::~StoreHandler() {
 void StoreHandler::start() {
     auto sub = [&](uint32_t msg_type, auto method) {
         sub_ids_.push_back(core_.subscribe(msg_type, "store",
-            [this, method](std::string_view name, std::shared_ptr<header_t> hdr,
-                           const endpoint_t* ep, PacketData data) {
-                return (this->*method)(name, std::move(hdr), ep, std::move(data));
+            [this, method](std::string_view name, const header_t& hdr,
+                           const endpoint_t* ep, const PacketData& data) {
+                return (this->*method)(name, hdr, ep, data);
             }));
     };
 
@@ -73,8 +73,8 @@ void StoreHandler::on_disconnect(conn_id_t id) {
 // ── PUT ──────────────────────────────────────────────────────────────────────
 
 propagation_t StoreHandler::on_put(
-        std::string_view, std::shared_ptr<header_t> hdr,
-        const endpoint_t* ep, PacketData data) {
+        std::string_view, const header_t& hdr,
+        const endpoint_t* ep, const PacketData& data) {
 
     const auto& raw = *data;
     if (raw.size() < sizeof(StorePutPayload))
@@ -115,8 +115,8 @@ propagation_t StoreHandler::on_put(
 // ── GET ──────────────────────────────────────────────────────────────────────
 
 propagation_t StoreHandler::on_get(
-        std::string_view, std::shared_ptr<header_t> hdr,
-        const endpoint_t* ep, PacketData data) {
+        std::string_view, const header_t& hdr,
+        const endpoint_t* ep, const PacketData& data) {
 
     const auto& raw = *data;
     if (raw.size() < sizeof(StoreGetPayload))
@@ -161,8 +161,8 @@ propagation_t StoreHandler::on_get(
 // ── DELETE ───────────────────────────────────────────────────────────────────
 
 propagation_t StoreHandler::on_delete(
-        std::string_view, std::shared_ptr<header_t> hdr,
-        const endpoint_t* ep, PacketData data) {
+        std::string_view, const header_t& hdr,
+        const endpoint_t* ep, const PacketData& data) {
 
     const auto& raw = *data;
     if (raw.size() < sizeof(StoreDeletePayload))
@@ -200,8 +200,8 @@ propagation_t StoreHandler::on_delete(
 // ── SUBSCRIBE ────────────────────────────────────────────────────────────────
 
 propagation_t StoreHandler::on_subscribe(
-        std::string_view, std::shared_ptr<header_t> hdr,
-        const endpoint_t* ep, PacketData data) {
+        std::string_view, const header_t& hdr,
+        const endpoint_t* ep, const PacketData& data) {
 
     const auto& raw = *data;
     if (raw.size() < sizeof(StoreSubscribePayload))
@@ -238,8 +238,8 @@ propagation_t StoreHandler::on_subscribe(
 // ── SYNC ─────────────────────────────────────────────────────────────────────
 
 propagation_t StoreHandler::on_sync(
-        std::string_view, std::shared_ptr<header_t> hdr,
-        const endpoint_t* ep, PacketData data) {
+        std::string_view, const header_t& hdr,
+        const endpoint_t* ep, const PacketData& data) {
 
     const auto& raw = *data;
     if (raw.size() < sizeof(StoreSyncPayload))
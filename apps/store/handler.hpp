@@ -37,20 +37,20 @@ private:
 
     // ── Wire handlers ────────────────────────────────────────────────────────
 
-    propagation_t on_put(std::string_view name, std::shared_ptr<header_t> hdr,
-                         const endpoint_t* ep, PacketData data);
+    propagation_t on_put(std::string_view name, const header_t& hdr,
+                         const endpoint_t* ep, const PacketData& data);
 
-    propagation_t on_get(std::string_view name, std::shared_ptr<header_t> hdr,
-                         const endpoint_t* ep, PacketData data);
+    propagation_t on_get(std::string_view name, const header_t& hdr,
+                         const endpoint_t* ep, const PacketData& data);
 
-    propagation_t on_delete(std::string_view name, std::shared_ptr<header_t> hdr,
-                            const endpoint_t* ep, PacketData data);
+    propagation_t on_delete(std::string_view name, const header_t& hdr,
+                            const endpoint_t* ep, const PacketData& data);
 
-    propagation_t on_subscribe(std::string_view name, std::shared_ptr<header_t> hdr,
-                               const endpoint_t* ep, PacketData data);
+    propagation_t on_subscribe(std::string_view name, const header_t& hdr,
+                               const endpoint_t* ep, const PacketData& data);
 
-    propagation_t on_sync(std::string_view name, std::shared_ptr<header_t> hdr,
-                          const endpoint_t* ep, PacketData data);
+    propagation_t on_sync(std::string_view name, const header_t& hdr,
+                          const endpoint_t* ep, const PacketData& data);
 
     // ── Subscriptions ────────────────────────────────────────────────────────
 
@@ -3,7 +3,9 @@
 
 #include "bench.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <vector>
 
@@ -11,6 +13,7 @@
 
 #include "cm/connectionManager.hpp"
 #include "pm/pluginManager.hpp"
+#include "types/connection.hpp"
 #include "util.hpp"
 
 using Clock     = std::chrono::steady_clock;
@@ -58,6 +61,79 @@ static conn_id_t try_ice_upgrade(gn::Core& core, conn_id_t primary,
     return primary;
 }
 
+// ─── Codec benchmark ────────────────────────────────────────────────────────
+
+int run_codec_benchmark(const CodecBenchConfig& cfg) {
+    const size_t size = std::max<size_t>(cfg.pkt_size_kb, 1) * 1024;
+
+    // text: JSON-подобные строки; mixed: половина — случайные блоки; random: шум
+    std::vector<uint8_t> text, mixed(size), noise(size);
+    for (uint32_t i = 0; text.size() < size; ++i) {
+        char line[160];
+        const int n = std::snprintf(line, sizeof(line),
+            "{\"id\":%u,\"type\":\"store.update\",\"key\":\"users/%u/profile\","
+            "\"ts\":%u,\"ok\":true}\n", i, i * 7919 % 100000, 1700000000 + i * 13);
+        text.insert(text.end(), line, line + n);
+    }
+    text.resize(size);
+    randombytes_buf(noise.data(), noise.size());
+    randombytes_buf(mixed.data(), mixed.size());
+    for (size_t off = 0; off < size; off += 256)
+        std::memset(mixed.data() + off, 0x20, std::min<size_t>(128, size - off));
+
+    struct Case { const char* name; gn::Codec codec; int level; };
+    const Case codecs[] = {
+        {"zstd-1", gn::Codec::Zstd, 1},
+        {"zstd-3", gn::Codec::Zstd, 3},
+        {"lz4",    gn::Codec::Lz4,  1},
+    };
+    const std::pair<const char*, const std::vector<uint8_t>*> payloads[] = {
+        {"text", &text}, {"mixed", &mixed}, {"random", &noise},
+    };
+
+    std::printf(">>> Codec benchmark: %zu KB payloads, %.2fs per measurement\n\n",
+                cfg.pkt_size_kb, cfg.seconds);
+    std::printf("  %-8s %-7s %12s %12s %8s\n",
+                "payload", "codec", "compress", "decompress", "ratio");
+
+    gn::NoiseSession session;   // decode_body() без AEAD
+    std::vector<uint8_t> body(gn::NoiseSession::max_wire_size(size, true, 0));
+    int status = 0;
+    for (const auto& [pname, data] : payloads) {
+        for (const auto& c : codecs) {
+            size_t body_len = 0;
+            uint64_t iters = 0;
+            auto t0 = Clock::now();
+            double dt = 0;
+            do {
+                body_len = gn::NoiseSession::encode_body(body.data(), body.size(),
+                                                         data->data(), data->size(),
+                                                         true, 0, c.level, nullptr, c.codec);
+                ++iters;
+                dt = Seconds(Clock::now() - t0).count();
+            } while (dt < cfg.seconds);
+            const double comp_mbps = iters * size / dt / 1e6;
+
+            iters = 0;
+            t0 = Clock::now();
+            bool ok = true;
+            do {
+                ok = session.decode_body(body.data(), body_len) == *data;
+                ++iters;
+                dt = Seconds(Clock::now() - t0).count();
+            } while (ok && dt < cfg.seconds);
+            const double dec_mbps = iters * size / dt / 1e6;
+
+            if (!ok) status = 2;
+            std::printf("  %-8s %-7s %8.0f MB/s %8.0f MB/s %8.2f%s\n",
+                        pname, c.name, comp_mbps, dec_mbps,
+                        static_cast<double>(size) / static_cast<double>(body_len),
+                        ok ? "" : "  !!! round trip mismatch");
+        }
+    }
+    return status;
+}
+
 // ─── Benchmark ──────────────────────────────────────────────────────────────
 
 BenchResult run_benchmark(gn::Core& core, const BenchConfig& cfg,
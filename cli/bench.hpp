@@ -1,6 +1,7 @@
 #pragma once
 /// @file cli/bench.hpp
-/// @brief Benchmark engine: multi-threaded sender with live monitoring.
+/// @brief Benchmark engine: multi-threaded sender with live monitoring,
+///        offline codec throughput.
 
 #include <atomic>
 #include <cstdint>
@@ -31,6 +32,17 @@ struct BenchResult {
     int       exit_status  = 0;         ///< 0=ok, 1=timeout, 2=crypto error
 };
 
+struct CodecBenchConfig {
+    size_t      pkt_size_kb  = 64;
+    double      seconds      = 0.25;    ///< Per codec × payload × direction
+};
+
+/// Offline codec benchmark: compress / decompress throughput and ratio of
+/// zstd (levels 1, 3) and LZ4 on text-like, mixed and random payloads —
+/// the same encode_body() / decode_body() the send and receive paths use.
+/// @return 0 on success, 2 if a round trip does not reproduce the payload.
+int run_codec_benchmark(const CodecBenchConfig& cfg);
+
 /// Run the benchmark: connect, optional ICE upgrade, fire workers, monitor.
 /// Blocks until done or keep_running becomes false.
 BenchResult run_benchmark(gn::Core& core, const BenchConfig& cfg,
@@ -269,6 +269,21 @@ inline void print_summary(const Samples& thr_samples,
     print_row("Decrypt failures", fmt_num(df), df > 0 ? c_red : c_none);
     print_row("Backpressure drops", fmt_num(st.backpressure));
 
+    std::snprintf(buf, sizeof(buf), "%llu / %llu",
+                  (unsigned long long)st.pool_hits,
+                  (unsigned long long)st.pool_misses);
+    print_row("Buffer pool (hit/miss)", buf);
+
+    std::snprintf(buf, sizeof(buf), "%.1f", st.frames_per_flush());
+    print_row("Frames per flush", buf);
+
+    std::snprintf(buf, sizeof(buf), "%llu / %llu / %llu / %llu",
+                  (unsigned long long)st.queue_depth[0],
+                  (unsigned long long)st.queue_depth[1],
+                  (unsigned long long)st.queue_depth[2],
+                  (unsigned long long)st.queue_depth[3]);
+    print_row("Queue ctl/int/bulk/rly", buf);
+
     // ── Histogram ────────────────────────────────────────────────────────────
     if (thr_samples.count >= 4) {
         sep();
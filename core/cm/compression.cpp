@@ -0,0 +1,432 @@
+/// @file core/cm/compression.cpp
+/// Thread-local zstd / LZ4 contexts, the adaptive policy, per-session streaming
+/// contexts and the per-message-type dictionary registry.
+
+#include "types/compression.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <lz4.h>
+#include <zstd.h>
+#include <zdict.h>
+
+namespace gn {
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Thread-local contexts
+// ═══════════════════════════════════════════════════════════════════════════════
+
+ZSTD_CCtx* zstd_thread_cctx() {
+    struct Free { void operator()(ZSTD_CCtx* c) const noexcept { ZSTD_freeCCtx(c); } };
+    thread_local std::unique_ptr<ZSTD_CCtx, Free> ctx{ZSTD_createCCtx()};
+    return ctx.get();
+}
+
+ZSTD_DCtx* zstd_thread_dctx() {
+    struct Free { void operator()(ZSTD_DCtx* d) const noexcept { ZSTD_freeDCtx(d); } };
+    thread_local std::unique_ptr<ZSTD_DCtx, Free> ctx{ZSTD_createDCtx()};
+    return ctx.get();
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Adaptive policy
+// ═══════════════════════════════════════════════════════════════════════════════
+
+double AdaptiveCompression::entropy_bits(std::span<const uint8_t> payload) noexcept {
+    if (payload.empty()) return 0.0;
+
+    // 4 полосы по PROBE_BYTES/4 равномерно по payload — заголовок отдельно
+    // не характеризует тело (PNG, zip local header и т.п.)
+    std::array<uint32_t, 256> hist{};
+    size_t n = 0;
+    if (payload.size() <= PROBE_BYTES) {
+        for (uint8_t b : payload) ++hist[b];
+        n = payload.size();
+    } else {
+        constexpr size_t STRIPES = 4, STRIPE = PROBE_BYTES / STRIPES;
+        const size_t step = (payload.size() - STRIPE) / (STRIPES - 1);
+        for (size_t s = 0; s < STRIPES; ++s) {
+            const uint8_t* p = payload.data() + s * step;
+            for (size_t i = 0; i < STRIPE; ++i) ++hist[p[i]];
+        }
+        n = STRIPES * STRIPE;
+    }
+
+    double h = 0.0;
+    const double inv = 1.0 / static_cast<double>(n);
+    for (uint32_t c : hist) {
+        if (!c) continue;
+        const double p = c * inv;
+        h -= p * std::log2(p);
+    }
+    return h;
+}
+
+bool AdaptiveCompression::looks_compressible(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() < PROBE_MIN_BYTES) return true;
+    return entropy_bits(payload) <= SKIP_ENTROPY_BITS;
+}
+
+bool AdaptiveCompression::probe(std::span<const uint8_t> payload) noexcept {
+    if (looks_compressible(payload)) return true;
+    skipped.fetch_add(1, std::memory_order_relaxed);
+    skipped_bytes.fetch_add(payload.size(), std::memory_order_relaxed);
+    return false;
+}
+
+void AdaptiveCompression::record(size_t raw, uint64_t ns) noexcept {
+    compressed.fetch_add(1, std::memory_order_relaxed);
+    compressed_bytes.fetch_add(raw, std::memory_order_relaxed);
+    compress_ns.fetch_add(ns, std::memory_order_relaxed);
+
+    if (!ns || raw < PROBE_MIN_BYTES) return;   // мелкие кадры — шум таймера
+    const uint64_t bps  = raw * 1'000'000'000ULL / ns;
+    const uint64_t prev = zstd_bps.load(std::memory_order_relaxed);
+    zstd_bps.store(prev ? (prev * 7 + bps) / 8 : bps, std::memory_order_relaxed);
+}
+
+int AdaptiveCompression::adapt(int base, int max_level, size_t backlog,
+                               uint64_t tx_bytes, int64_t now_ns) noexcept {
+    int lv = level.load(std::memory_order_relaxed);
+    if (!lv) lv = base;
+
+    int64_t due = next_adapt_ns.load(std::memory_order_relaxed);
+    if (now_ns < due) return lv;
+    if (!next_adapt_ns.compare_exchange_strong(due, now_ns + ADAPT_INTERVAL_NS,
+                                               std::memory_order_relaxed))
+        return lv;
+
+    // Скорость линка — по приросту tx_bytes путей за интервал
+    const int64_t  prev_ts = last_adapt_ns.exchange(now_ns, std::memory_order_relaxed);
+    const uint64_t prev_tx = last_tx_bytes.exchange(tx_bytes, std::memory_order_relaxed);
+    if (prev_ts && now_ns > prev_ts && tx_bytes >= prev_tx) {
+        const uint64_t bps = (tx_bytes - prev_tx) * 1'000'000'000ULL
+                           / static_cast<uint64_t>(now_ns - prev_ts);
+        const uint64_t old = link_bps.load(std::memory_order_relaxed);
+        link_bps.store(old ? (old * 3 + bps) / 4 : bps, std::memory_order_relaxed);
+    }
+
+    const uint64_t link = link_bps.load(std::memory_order_relaxed);
+    const uint64_t zbps = zstd_bps.load(std::memory_order_relaxed);
+    const bool cpu_bound = link && zbps && zbps < link;
+
+    int next = lv;
+    if (cpu_bound) {
+        next = std::max(lv - 1, MIN_LEVEL);
+    } else if (backlog > BACKLOG_HIGH && (!link || !zbps || zbps > 2 * link)) {
+        next = std::min(lv + 1, std::max(max_level, base));
+    } else if (backlog < BACKLOG_LOW && lv > base) {
+        next = lv - 1;
+    }
+
+    if (next != lv) {
+        (next > lv ? level_ups : level_downs).fetch_add(1, std::memory_order_relaxed);
+        zstd_bps.store(0, std::memory_order_relaxed);   // скорость нового уровня — заново
+    }
+    level.store(next, std::memory_order_relaxed);
+    return next;
+}
+
+uint64_t AdaptiveCompression::cpu_saved_ns() const noexcept {
+    const uint64_t bytes = skipped_bytes.load(std::memory_order_relaxed);
+    const uint64_t raw   = compressed_bytes.load(std::memory_order_relaxed);
+    const uint64_t ns    = compress_ns.load(std::memory_order_relaxed);
+    if (raw >= 64 * 1024 && ns)
+        return static_cast<uint64_t>(static_cast<double>(bytes) * ns / raw);
+    return bytes * DEFAULT_NS_PER_KB / 1024;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Streaming context
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void ZstdStream::CCtxFree::operator()(ZSTD_CCtx* c) const noexcept { ZSTD_freeCCtx(c); }
+void ZstdStream::DCtxFree::operator()(ZSTD_DCtx* d) const noexcept { ZSTD_freeDCtx(d); }
+
+ZstdStream::~ZstdStream() = default;
+
+ZstdStream::Block ZstdStream::compress(uint8_t* out, size_t out_cap,
+                                       const void* plain, size_t len, int level) {
+    Block b;
+    if (!cctx_) {
+        cctx_.reset(ZSTD_createCCtx());
+        if (!cctx_) return b;
+        ZSTD_CCtx_setParameter(cctx_.get(), ZSTD_c_windowLog, WINDOW_LOG);
+        tx_restart_.store(true, std::memory_order_relaxed);
+    }
+    bool restart = tx_restart_.exchange(false, std::memory_order_relaxed);
+    // Уровень меняется только на границе эпохи — внутри кадра zstd его не примет
+    if (tx_epoch_ >= RESYNC_EVERY || level != tx_level_) restart = true;
+    if (tx_paused_.exchange(false, std::memory_order_relaxed)) restart = true;
+
+    if (restart) {
+        ZSTD_CCtx_reset(cctx_.get(), ZSTD_reset_session_only);
+        ZSTD_CCtx_setParameter(cctx_.get(), ZSTD_c_compressionLevel, level);
+        tx_level_ = level;
+        tx_epoch_ = 0;
+        b.reset   = true;
+    }
+
+    ZSTD_inBuffer  in {plain, len, 0};
+    ZSTD_outBuffer dst{out, out_cap, 0};
+    size_t rc;
+    do {
+        rc = ZSTD_compressStream2(cctx_.get(), &dst, &in, ZSTD_e_flush);
+    } while (!ZSTD_isError(rc) && rc != 0 && dst.pos < dst.size);
+    if (ZSTD_isError(rc) || rc != 0) {
+        // История кодера разошлась с тем, что увидит приёмник
+        LOG_WARN("zstd stream: compress failed: {}",
+                 ZSTD_isError(rc) ? ZSTD_getErrorName(rc) : "output overflow");
+        tx_restart_.store(true, std::memory_order_relaxed);
+        return b;
+    }
+
+    b.seq  = tx_seq_++;
+    b.size = dst.pos;
+    ++tx_epoch_;
+    tx_blocks_.fetch_add(1, std::memory_order_relaxed);
+    return b;
+}
+
+std::vector<uint8_t> ZstdStream::decompress(uint32_t seq, bool reset,
+                                            const uint8_t* data, size_t len,
+                                            size_t orig_size) {
+    std::lock_guard lk(rx_mu_);
+    if (!dctx_) {
+        dctx_.reset(ZSTD_createDCtx());
+        if (!dctx_) return {};
+    }
+    if (reset) {
+        ZSTD_DCtx_reset(dctx_.get(), ZSTD_reset_session_only);
+        rx_synced_ = true;
+        rx_expect_ = seq;
+    }
+    if (!rx_synced_ || seq != rx_expect_) {
+        LOG_WARN("zstd stream: block seq={} out of sync (expect {}{})",
+                 seq, rx_expect_, rx_synced_ ? "" : ", awaiting reset");
+        rx_synced_ = false;
+        rx_rejected_.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    std::vector<uint8_t> plain(orig_size);
+    ZSTD_inBuffer  in {data, len, 0};
+    ZSTD_outBuffer dst{plain.data(), plain.size(), 0};
+    size_t rc = 0;
+    while (in.pos < in.size) {
+        rc = ZSTD_decompressStream(dctx_.get(), &dst, &in);
+        if (ZSTD_isError(rc) || (dst.pos == dst.size && in.pos < in.size)) break;
+    }
+    if (ZSTD_isError(rc) || in.pos != in.size || dst.pos != orig_size) {
+        LOG_WARN("zstd stream: block seq={} corrupt: {}", seq,
+                 ZSTD_isError(rc) ? ZSTD_getErrorName(rc) : "size mismatch");
+        rx_synced_ = false;
+        rx_rejected_.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+    ++rx_expect_;
+    rx_blocks_.fetch_add(1, std::memory_order_relaxed);
+    return plain;
+}
+
+void ZstdStream::reset() noexcept {
+    tx_restart_.store(true, std::memory_order_relaxed);
+    std::lock_guard lk(rx_mu_);
+    rx_synced_ = false;
+}
+
+void* lz4_thread_state() {
+    // LZ4 требует выравнивания state по 8 — uint64_t его даёт
+    thread_local std::vector<uint64_t> state(
+        (static_cast<size_t>(LZ4_sizeofState()) + 7) / 8);
+    return state.data();
+}
+
+const char* codec_name(Codec c) noexcept {
+    return c == Codec::Lz4 ? "lz4" : "zstd";
+}
+
+void ZstdDict::CDictFree::operator()(ZSTD_CDict* d) const noexcept { ZSTD_freeCDict(d); }
+void ZstdDict::DDictFree::operator()(ZSTD_DDict* d) const noexcept { ZSTD_freeDDict(d); }
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Registry
+// ═══════════════════════════════════════════════════════════════════════════════
+
+ZstdDictionaries::ZstdDictionaries(int level)
+    : level_(level)
+    , table_(std::make_shared<const Table>()) {}
+
+ZstdDictionaries::~ZstdDictionaries() = default;
+
+uint32_t ZstdDictionaries::add(uint32_t msg_type, std::span<const uint8_t> content) {
+    const uint32_t id = ZDICT_getDictID(content.data(), content.size());
+    if (!id) {
+        LOG_WARN("zstd dict: type={} — {} bytes are not a zstd dictionary",
+                 msg_type, content.size());
+        return 0;
+    }
+
+    auto d = std::make_shared<ZstdDict>();
+    d->id       = id;
+    d->msg_type = msg_type;
+    d->content.assign(content.begin(), content.end());
+    d->cdict.reset(ZSTD_createCDict(d->content.data(), d->content.size(), level_));
+    d->ddict.reset(ZSTD_createDDict(d->content.data(), d->content.size()));
+    if (!d->cdict || !d->ddict) {
+        LOG_WARN("zstd dict: type={} id={} — digest failed", msg_type, id);
+        return 0;
+    }
+
+    std::lock_guard lk(write_mu_);
+    auto old = table_.load(std::memory_order_acquire);
+    if (!old->by_id.contains(id) && old->by_id.size() >= MAX_DICTS) {
+        LOG_WARN("zstd dict: type={} id={} — registry full ({})", msg_type, id, MAX_DICTS);
+        return 0;
+    }
+    auto next = std::make_shared<Table>(*old);
+    next->by_id[id]         = d;
+    next->by_type[msg_type] = d;
+    table_.store(std::move(next), std::memory_order_release);
+
+    LOG_INFO("zstd dict: type={} id={} ({} bytes)", msg_type, id, d->content.size());
+    return id;
+}
+
+std::shared_ptr<const ZstdDict> ZstdDictionaries::find(uint32_t id) const {
+    auto t = table_.load(std::memory_order_acquire);
+    auto it = t->by_id.find(id);
+    return it != t->by_id.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const ZstdDict> ZstdDictionaries::for_type(uint32_t msg_type) const {
+    auto t = table_.load(std::memory_order_acquire);
+    if (t->by_type.empty()) return nullptr;
+    auto it = t->by_type.find(msg_type);
+    return it != t->by_type.end() ? it->second : nullptr;
+}
+
+std::vector<uint32_t> ZstdDictionaries::ids() const {
+    auto t = table_.load(std::memory_order_acquire);
+    std::vector<uint32_t> out;
+    out.reserve(t->by_id.size());
+    for (auto& [id, d] : t->by_id) out.push_back(id);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Sampling / training
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void ZstdDictionaries::sample(uint32_t msg_type, std::span<const uint8_t> payload) {
+    if (payload.size() < SAMPLE_MIN_BYTES || payload.size() > SAMPLE_MAX_BYTES) return;
+    if (sample_tick_.fetch_add(1, std::memory_order_relaxed) % SAMPLE_EVERY) return;
+    if (for_type(msg_type)) return;   // уже обучен — переобучение только явным train()
+
+    std::lock_guard lk(sample_mu_);
+    if (samples_.size() >= MAX_DICTS * 4 && !samples_.contains(msg_type)) return;
+    auto& s = samples_[msg_type];
+    if (s.sizes.size() >= TRAIN_SAMPLES) return;
+    s.data.insert(s.data.end(), payload.begin(), payload.end());
+    s.sizes.push_back(payload.size());
+}
+
+size_t ZstdDictionaries::train_ready() {
+    std::vector<std::pair<uint32_t, Samples>> ready;
+    {
+        std::lock_guard lk(sample_mu_);
+        for (auto it = samples_.begin(); it != samples_.end();) {
+            if (it->second.sizes.size() >= TRAIN_SAMPLES) {
+                ready.emplace_back(it->first, std::move(it->second));
+                it = samples_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    size_t added = 0;
+    for (auto& [type, s] : ready)
+        if (train_samples(type, std::move(s))) ++added;
+    return added;
+}
+
+uint32_t ZstdDictionaries::train(uint32_t msg_type) {
+    Samples s;
+    {
+        std::lock_guard lk(sample_mu_);
+        auto it = samples_.find(msg_type);
+        if (it == samples_.end() || it->second.sizes.size() < TRAIN_MIN_SAMPLES)
+            return 0;
+        s = std::move(it->second);
+        samples_.erase(it);
+    }
+    return train_samples(msg_type, std::move(s));
+}
+
+uint32_t ZstdDictionaries::train_samples(uint32_t msg_type, Samples s) {
+    // ZDICT хочет ~10x данных на размер словаря; меньше — режем словарь
+    const size_t capacity = std::clamp<size_t>(s.data.size() / 10, 1024, DICT_CAPACITY);
+    std::vector<uint8_t> dict(capacity);
+    const size_t n = ZDICT_trainFromBuffer(dict.data(), dict.size(), s.data.data(),
+                                           s.sizes.data(),
+                                           static_cast<unsigned>(s.sizes.size()));
+    if (ZDICT_isError(n)) {
+        LOG_WARN("zstd dict: type={} training on {} samples failed: {}",
+                 msg_type, s.sizes.size(), ZDICT_getErrorName(n));
+        return 0;
+    }
+    dict.resize(n);
+    return add(msg_type, dict);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Persistence
+// ═══════════════════════════════════════════════════════════════════════════════
+
+size_t ZstdDictionaries::load_dir(const std::filesystem::path& dir) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)) return 0;
+
+    size_t loaded = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.path().extension() != ".zdict") continue;
+        const std::string stem = entry.path().stem().string();
+        uint32_t msg_type = 0;
+        auto [p, err] = std::from_chars(stem.data(), stem.data() + stem.size(), msg_type);
+        if (err != std::errc{} || p != stem.data() + stem.size()) {
+            LOG_WARN("zstd dict: {} — file name is not a msg_type", entry.path().string());
+            continue;
+        }
+        std::ifstream f(entry.path(), std::ios::binary);
+        std::vector<uint8_t> content{std::istreambuf_iterator<char>(f), {}};
+        if (add(msg_type, content)) ++loaded;
+    }
+    return loaded;
+}
+
+bool ZstdDictionaries::save_dir(const std::filesystem::path& dir) const {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    auto t = table_.load(std::memory_order_acquire);
+    bool ok = true;
+    for (auto& [type, d] : t->by_type) {
+        std::ofstream f(dir / (std::to_string(type) + ".zdict"),
+                        std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(d->content.data()),
+                static_cast<std::streamsize>(d->content.size()));
+        if (!f) {
+            LOG_WARN("zstd dict: cannot write {}/{}.zdict", dir.string(), type);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+} // namespace gn
@@ -29,6 +29,7 @@
 #include <string_view>
 #include <vector>
 
+#include "signals.hpp"
 #include "types/identify.hpp"
 #include "data/messages.hpp"
 
@@ -39,9 +40,11 @@ class CMTest;
 class Config;
 class HeartbeatTest;
 
+namespace boost::asio { class io_context; }
+
 namespace gn {
 
-class SignalBus;
+class PathScheduler;   // types/path_scheduler.hpp
 
 class ConnectionManager {
 public:
@@ -69,6 +72,19 @@ public:
 
     /// @brief Fill a host_api_t vtable with all CM callbacks for plugin use.
     void fill_host_api(host_api_t* api);
+
+    /// @brief Run connector writes on @p ioc instead of the sender's thread.
+    /// @details Не более одной flush-задачи на соединение; всё, что накопилось
+    ///          в очереди к её запуску, уходит одним send_gather.
+    ///          nullptr (по умолчанию) = flush inline в send().
+    void set_flush_executor(boost::asio::io_context* ioc);
+
+    /// @brief Run Noise handshake crypto on @p threads dedicated workers.
+    /// @details DH и Ed25519 уходят с IO-потоков коннекторов: кадры handshake
+    ///          (и данные, пришедшие следом до ESTABLISHED) исполняются
+    ///          последовательно в lane соединения. Соединения, открытые до
+    ///          вызова, и 0 потоков (по умолчанию) — handshake inline.
+    void start_handshake_pool(size_t threads);
     /// @}
 
     /// @name Send / Broadcast
@@ -77,15 +93,64 @@ public:
     /// @brief Send to a peer by URI. Auto-connects if needed, queues if not ESTABLISHED.
     /// @return false on backpressure or invalid URI.
     bool send(std::string_view uri, uint32_t msg_type,
-              std::span<const uint8_t> payload);
+              std::span<const uint8_t> payload,
+              SendClass cls = SendClass::Auto);
 
     /// @brief Send on an existing connection by ID.
-    /// @return false if connection not found or not ESTABLISHED.
+    /// @details Не блокирует: фрагменты большого сообщения, не вместившиеся
+    ///          в окно, ждут в PerConnQueue::parked и уходят по мере кредита.
+    /// @return false if connection not found, the send window is exhausted
+    ///         or PerConnQueue::MAX_PARKED_BYTES of large messages wait.
     bool send(conn_id_t id, uint32_t msg_type,
-              std::span<const uint8_t> payload);
+              std::span<const uint8_t> payload,
+              SendClass cls = SendClass::Auto);
 
     /// @brief Broadcast to all ESTABLISHED peers.
-    void broadcast(uint32_t msg_type, std::span<const uint8_t> payload);
+    /// @details С flush executor'ом и >= 32 пирами шифрование и постановка в
+    ///          очередь идут параллельно на IO-потоках; payload сжимается один раз.
+    /// @return Handle with per-peer sent/failed counts.
+    BroadcastHandle broadcast(uint32_t msg_type, std::span<const uint8_t> payload,
+                              SendClass cls = SendClass::Auto);
+
+    /// @brief Override the QoS class used for @p msg_type when a send passes
+    ///        SendClass::Auto (SendClass::Auto here restores the default).
+    /// @details По умолчанию: handshake/heartbeat/ICE/ping → Control,
+    ///          RELAY → Relay, FILE/STORE_SYNC и чанкованные payload → Bulk,
+    ///          остальное → Interactive.
+    void set_send_class(uint32_t msg_type, SendClass cls);
+
+    /// @brief Effective QoS class for @p msg_type (override or default).
+    [[nodiscard]] SendClass send_class_of(uint32_t msg_type) const noexcept;
+
+    /// @brief Deliver fragmented @p msg_type messages fragment by fragment.
+    /// @details Без streaming ядро собирает сообщение целиком (до 64 MB на
+    ///          соединение) и отдаёт хэндлерам один пакет. В streaming-режиме
+    ///          каждый фрагмент уходит хэндлерам сразу: header_t::flags содержит
+    ///          GNET_FLAG_FRAGMENT, данные = frag_hdr_t + chunk.
+    void set_fragment_streaming(uint32_t msg_type, bool on);
+
+    /// @brief Register a zstd dictionary for @p msg_type payloads.
+    /// @details Используется только с пирами, объявившими его ID в handshake
+    ///          (соединения, установленные после регистрации).
+    /// @return Dictionary ID, 0 if @p content is not a zstd dictionary.
+    uint32_t add_compression_dictionary(uint32_t msg_type, std::span<const uint8_t> content);
+
+    /// @brief Train dictionaries for types with enough sampled payloads
+    ///        (compression.dictionaries) and save them to compression.dict_dir.
+    /// @details Вызывается и периодически из cleanup_stale_pending().
+    /// @return Number of dictionaries trained.
+    size_t train_compression_dictionaries();
+
+    /// @brief Replace the transport path scheduler (nullptr → adaptive).
+    /// @details По умолчанию — из core.path_scheduler: "adaptive" выбирает
+    ///          путь по сглаженному RTT, потерям и очереди, "priority" —
+    ///          статический порядок set_scheme_priority().
+    void set_path_scheduler(std::shared_ptr<PathScheduler> scheduler);
+
+    /// @brief Stripe bulk frames across all active paths of a peer.
+    /// @details Только для пиров с CORE_CAP_STRIPE и ≥ 2 активными путями;
+    ///          приёмник восстанавливает порядок (GNET_FLAG_STRIPED).
+    void set_multipath_striping(bool on);
     /// @}
 
     /// @name Connection control
@@ -118,7 +183,7 @@ public:
     /// @name Heartbeat / maintenance
     /// @{
     void check_heartbeat_timeouts();  ///< Disconnect peers with 3+ missed heartbeats.
-    void cleanup_stale_pending();     ///< Drop pending messages older than handshake timeout.
+    void cleanup_stale_pending();     ///< Drop stale pending messages, timed-out partial fragments and handshakes.
     /// @}
 
     /// @name Queries
@@ -134,6 +199,13 @@ public:
     [[nodiscard]] conn_id_t find_conn_by_pubkey(const char* pubkey_hex)        const;
     [[nodiscard]] size_t get_pending_bytes(conn_id_t id = CONN_ID_INVALID)    const noexcept;
 
+    /// @brief Bytes that can be sent on @p id right now without hitting
+    ///        backpressure (0 if the connection is unknown).
+    /// @details Окно = лимит очереди − (байты в очереди ядра + байты у
+    ///          коннектора, ещё не подтверждённые on_sent()). Когда окно
+    ///          снова открывается после отказа, SignalBus::on_writable(id).
+    [[nodiscard]] size_t send_window(conn_id_t id)                            const noexcept;
+
     /// @brief JSON diagnostic dump of all active connections (id, state, peer, scheme).
     [[nodiscard]] std::string dump_connections() const;
 
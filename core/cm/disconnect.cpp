@@ -91,7 +91,13 @@ void ConnectionManager::Impl::handle_disconnect(conn_id_t id, int error) {
 
     {
         std::lock_guard wlk(records_write_mu_);
-        rcu_update([&](RecordMap& m) { m.erase(id); });
+        rcu_update([&](RecordMap& m) {
+            auto it = m.find(id);
+            if (it == m.end()) return;
+            if (it->second->handshake)
+                handshakes_active_.fetch_sub(1, std::memory_order_relaxed);
+            m.erase(it);
+        });
     }
     { std::unique_lock lk(queues_mu_); send_queues_.erase(id); }
 
@@ -109,7 +115,13 @@ void ConnectionManager::Impl::handle_disconnect(conn_id_t id, int error) {
             }
         }
     }
-    if (!pk_key.empty()) { std::unique_lock lk(pk_mu_); pk_index_.erase(pk_key); }
+    // Только если индекс указывает на это соединение: у того же пира может быть
+    // другое, живое (дубликат, переигранный RESUME)
+    if (!pk_key.empty()) {
+        std::unique_lock lk(pk_mu_);
+        if (auto it = pk_index_.find(pk_key); it != pk_index_.end() && it->second == id)
+            pk_index_.erase(it);
+    }
 
     {
         std::shared_lock lk(handlers_mu_);
@@ -127,12 +139,7 @@ void ConnectionManager::Impl::handle_disconnect(conn_id_t id, int error) {
 
 void ConnectionManager::Impl::disconnect(conn_id_t id) {
     LOG_TRACE("disconnect #{}: draining queue", id);
-    auto q = [&]() -> std::shared_ptr<PerConnQueue> {
-        std::shared_lock lk(queues_mu_);
-        auto it = send_queues_.find(id);
-        return it != send_queues_.end() ? it->second : nullptr;
-    }();
-    if (q) q->draining.store(true, std::memory_order_release);
+    if (auto q = find_queue(id)) flush_queue(id, *q);
 
     auto rec = rcu_find(id);
     if (!rec) return;
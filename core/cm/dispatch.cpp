@@ -4,13 +4,107 @@
 #include "impl.hpp"
 #include "logger.hpp"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstring>
 
 namespace gn {
 
 // ═══════════════════════════════════════════════════════════════════════════════
-// handle_data — reassembly + fast-path
+// StreamReassembler
+// ═══════════════════════════════════════════════════════════════════════════════
+
+StreamReassembler::Status StreamReassembler::next(std::span<const uint8_t>& in,
+                                                  size_t max_frame, View& out) {
+    if (delivered_) {
+        // Кадр из stash отдан прошлым вызовом — теперь его можно выбросить
+        delivered_ = false;
+        stash_len_ = 0;
+        if (stash_cap_ > KEEP_CAPACITY) {
+            stash_.reset();
+            stash_cap_ = 0;
+        }
+    }
+    if (stash_len_) return fill(in, max_frame, out);
+
+    if (in.size() >= sizeof(header_t)) {
+        if (auto st = check(in.data(), max_frame); st != Status::Ready) return st;
+        const auto*  hdr   = reinterpret_cast<const header_t*>(in.data());
+        const size_t total = sizeof(header_t) + hdr->payload_len;
+        if (in.size() >= total) {
+            out = {hdr, in.subspan(sizeof(header_t), hdr->payload_len)};
+            in  = in.subspan(total);
+            return Status::Ready;
+        }
+        // Начало кадра, заголовок уже проверен — сразу под весь кадр
+        reserve(total);
+    }
+    take(in, in.size());
+    return Status::NeedMore;
+}
+
+StreamReassembler::Status StreamReassembler::fill(std::span<const uint8_t>& in,
+                                                  size_t max_frame, View& out) {
+    // Дозаполняем кадр, разрезанный границей чанка
+    if (stash_len_ < sizeof(header_t)) {
+        take(in, sizeof(header_t) - stash_len_);
+        if (stash_len_ < sizeof(header_t)) return Status::NeedMore;
+        if (auto st = check(stash_.get(), max_frame); st != Status::Ready) return st;
+    }
+    const auto*  hdr   = reinterpret_cast<const header_t*>(stash_.get());
+    const size_t total = sizeof(header_t) + hdr->payload_len;
+    take(in, total - stash_len_);
+    if (stash_len_ < total) return Status::NeedMore;
+
+    out = {hdr, {stash_.get() + sizeof(header_t), hdr->payload_len}};
+    delivered_ = true;
+    return Status::Ready;
+}
+
+void StreamReassembler::reset() noexcept {
+    stash_.reset();
+    stash_len_ = stash_cap_ = 0;
+    delivered_ = false;
+}
+
+StreamReassembler::Status StreamReassembler::check(const uint8_t* p, size_t max_frame) noexcept {
+    const auto* hdr = reinterpret_cast<const header_t*>(p);
+    Status st = Status::Ready;
+    if (hdr->magic != GNET_MAGIC)                                st = Status::BadMagic;
+    else if (hdr->proto_ver != GNET_PROTO_VER)                   st = Status::BadProtoVer;
+    else if (sizeof(header_t) + hdr->payload_len > max_frame)    st = Status::TooLarge;
+    if (st != Status::Ready) {
+        rejected_ = *hdr;
+        reset();
+    } else if (p == stash_.get()) {
+        reserve(sizeof(header_t) + hdr->payload_len);
+    }
+    return st;
+}
+
+void StreamReassembler::take(std::span<const uint8_t>& in, size_t n) {
+    n = std::min(n, in.size());
+    if (!n) return;
+    if (!stash_cap_) reserve(sizeof(header_t));   // хвост короче заголовка
+    std::memcpy(stash_.get() + stash_len_, in.data(), n);
+    stash_len_ += n;
+    in = in.subspan(n);
+}
+
+void StreamReassembler::reserve(size_t n) {
+    if (n <= stash_cap_) return;
+    // Не меньше заголовка и не меньше вдвое — кадры растущей длины не
+    // перевыделяют буфер на каждом
+    const size_t cap = std::max({n, sizeof(header_t), std::min(stash_cap_ * 2, KEEP_CAPACITY)});
+    auto buf = std::make_unique_for_overwrite<uint8_t[]>(cap);
+    if (stash_len_) std::memcpy(buf.get(), stash_.get(), stash_len_);
+    stash_     = std::move(buf);
+    stash_cap_ = cap;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// handle_data — stream framing, zero-copy where the frame is contiguous
 // ═══════════════════════════════════════════════════════════════════════════════
 
 void ConnectionManager::Impl::handle_data(conn_id_t id, const void* raw, size_t size) {
@@ -26,97 +120,70 @@ void ConnectionManager::Impl::handle_data(conn_id_t id, const void* raw, size_t
         if (it != transport_index_.end()) peer_id = it->second;
     }
 
-    std::shared_ptr<ConnectionRecord> rec;
-    {
-        auto map = rcu_read();
-        auto it  = map->find(peer_id);
-        if (it == map->end()) return;
-        rec = it->second;
-    }
-
-    // Fast path: complete frame, no buffered residue — zero-copy dispatch.
-    if (rec->recv_buf.empty() && size >= sizeof(header_t)) {
-        const auto* hdr = reinterpret_cast<const header_t*>(raw);
-        const size_t total = sizeof(header_t) + hdr->payload_len;
+    auto rec = rcu_find(peer_id);
+    if (!rec) return;
 
-        if (size == total
-            && hdr->magic == GNET_MAGIC
-            && hdr->proto_ver == GNET_PROTO_VER)
-        {
-            LOG_TRACE("handle_data #{}: fast-path type={}", peer_id, hdr->payload_type);
-            const std::span<const uint8_t> payload(
-                static_cast<const uint8_t*>(raw) + sizeof(header_t),
-                hdr->payload_len);
-            dispatch_packet(peer_id, hdr, payload, recv_ts);
-            return;
-        }
+    // Вторичный путь собирает свой поток отдельно: при multipath чанки TCP
+    // и ICE приходят вперемешку и не должны склеиваться в одном буфере.
+    std::shared_ptr<PathState> path_state;
+    if (auto* tp = rec->find_path_by_transport_id(id)) {
+        path_state = tp->state;
+        path_state->rx_bytes.fetch_add(size, std::memory_order_relaxed);
     }
+    auto& stream = (path_state && id != peer_id) ? path_state->rx_stream : rec->rx_stream;
 
+    // Кадры одного чтения уходят хэндлерам пачками (handler_t::handle_batch)
+    RxBatch batch;
+    batch.owner = this;
+    batch.id    = peer_id;
     {
-        auto& buf = rec->recv_buf;
-        const auto* bytes = static_cast<const uint8_t*>(raw);
-        buf.insert(buf.end(), bytes, bytes + size);
-        LOG_TRACE("handle_data #{}: reassembly, buf={} bytes", peer_id, buf.size());
-
-        // M2 fix: recv_buf unbounded growth protection
-        if (buf.size() > MAX_RECV_BUF) {
-            LOG_WARN("handle_data #{}: recv_buf overflow ({} bytes) — closing",
-                     peer_id, buf.size());
-            bus_.emit_drop(peer_id, DropReason::RecvBufOverflow);
-            close_now(peer_id);
-            return;
-        }
+        RxBatchScope scope(batch);
+        frame_stream(peer_id, stream, {static_cast<const uint8_t*>(raw), size}, recv_ts);
     }
+    if (batch.count) flush_rx_batch(batch);
+}
 
-    thread_local std::vector<uint8_t> pkt_buf;
-
-    size_t consumed = 0;
-    while (true) {
-        auto& buf   = rec->recv_buf;
-        const size_t avail = buf.size() - consumed;
-
-        if (avail < sizeof(header_t)) break;
-
-        const auto* hdr = reinterpret_cast<const header_t*>(buf.data() + consumed);
-
-        if (hdr->magic != GNET_MAGIC) {
+void ConnectionManager::Impl::frame_stream(conn_id_t peer_id, StreamReassembler& stream,
+                                           std::span<const uint8_t> in, uint64_t recv_ts) {
+    // Целые кадры отдаются view прямо в чанк; копируется только кадр,
+    // разрезанный границей чтения. Вызывающий держит rec (и stream) живым.
+    StreamReassembler::View frame;
+    for (;;) {
+        switch (stream.next(in, MAX_RECV_BUF, frame)) {
+        case StreamReassembler::Status::Ready:
+            break;
+        case StreamReassembler::Status::NeedMore:
+            if (stream.buffered())
+                LOG_TRACE("handle_data #{}: partial frame, {} bytes staged",
+                          peer_id, stream.buffered());
+            return;
+        case StreamReassembler::Status::BadMagic:
             LOG_WARN("handle_data #{}: bad magic 0x{:08X} — closing",
-                     peer_id, hdr->magic);
+                     peer_id, stream.rejected().magic);
             bus_.emit_drop(peer_id, DropReason::BadMagic);
             close_now(peer_id);
             return;
-        }
-        if (hdr->proto_ver != GNET_PROTO_VER) {
+        case StreamReassembler::Status::BadProtoVer:
             LOG_WARN("handle_data #{}: bad proto_ver {} — closing",
-                     peer_id, hdr->proto_ver);
+                     peer_id, stream.rejected().proto_ver);
             bus_.emit_drop(peer_id, DropReason::BadProtoVer);
             close_now(peer_id);
             return;
+        case StreamReassembler::Status::TooLarge:
+            // M2 fix: кадр больше MAX_RECV_BUF не буферизуем вовсе
+            LOG_WARN("handle_data #{}: frame of {} bytes exceeds recv limit — closing",
+                     peer_id, sizeof(header_t) + stream.rejected().payload_len);
+            bus_.emit_drop(peer_id, DropReason::RecvBufOverflow);
+            close_now(peer_id);
+            return;
         }
 
-        const size_t total = sizeof(header_t) + hdr->payload_len;
-        if (avail < total) break;
-
-        pkt_buf.assign(buf.data() + consumed, buf.data() + consumed + total);
-        consumed += total;
-
-        const auto* phdr    = reinterpret_cast<const header_t*>(pkt_buf.data());
-        const std::span<const uint8_t> payload(
-            pkt_buf.data() + sizeof(header_t), phdr->payload_len);
+        LOG_TRACE("handle_data #{}: frame type={} len={}",
+                  peer_id, frame.hdr->payload_type, frame.payload.size());
+        dispatch_packet(peer_id, frame.hdr, frame.payload, recv_ts);
 
-        dispatch_packet(peer_id, phdr, payload, recv_ts);
-
-        // Re-acquire after potential state changes inside dispatch
-        auto map = rcu_read();
-        auto it  = map->find(peer_id);
-        if (it == map->end()) return;
-        rec = it->second;
-    }
-
-    if (consumed > 0) {
-        auto& buf = rec->recv_buf;
-        if (consumed == buf.size()) buf.clear();
-        else buf.erase(buf.begin(), buf.begin() + static_cast<ptrdiff_t>(consumed));
+        // Соединение могло закрыться внутри dispatch — остаток чанка не нужен
+        if (!in.empty() && !rcu_find(peer_id)) return;
     }
 }
 
@@ -135,6 +202,12 @@ void ConnectionManager::Impl::dispatch_packet(conn_id_t id, const header_t* hdr,
     } guard{in_flight_dispatches_};
     LOG_TRACE("dispatch #{}: type={} payload={}", id, hdr->payload_type, payload.size());
 
+    auto rec = rcu_find(id);
+
+    // ── Handshake pool: DH / Ed25519 не занимают IO-поток ────────────────────
+    if (rec && rec->hs_lane && offload_handshake(*rec, id, hdr, payload, recv_ts_ns))
+        return;
+
     // ── Noise handshake messages ─────────────────────────────────────────────
     if (hdr->payload_type == MSG_TYPE_NOISE_INIT) {
         handle_noise_init(id, payload);
@@ -148,16 +221,28 @@ void ConnectionManager::Impl::dispatch_packet(conn_id_t id, const header_t* hdr,
         handle_noise_fin(id, payload);
         return;
     }
+    if (hdr->payload_type == MSG_TYPE_NOISE_RESUME) {
+        handle_noise_resume(id, payload);
+        return;
+    }
+    if (hdr->payload_type == MSG_TYPE_NOISE_RESUME_RESP) {
+        handle_noise_resume_resp(id, payload);
+        return;
+    }
 
     // ── Normal dispatch ──────────────────────────────────────────────────────
 
-    auto rec = rcu_find(id);
     if (!rec) { bus_.emit_drop(id, DropReason::ConnNotFound); return; }
 
+    // IK-ответчик ждёт первый кадр под новыми ключами (handle_noise_resume)
+    NoiseSession* resume = nullptr;
     if (rec->state != STATE_ESTABLISHED) {
-        LOG_WARN("dispatch #{}: type={} before ESTABLISHED", id, hdr->payload_type);
-        bus_.emit_drop(id, DropReason::StateNotEstablished);
-        return;
+        resume = rec->resume ? rec->resume->session.get() : nullptr;
+        if (!resume) {
+            LOG_WARN("dispatch #{}: type={} before ESTABLISHED", id, hdr->payload_type);
+            bus_.emit_drop(id, DropReason::StateNotEstablished);
+            return;
+        }
     }
 
     // ── Localhost fast-path: без decrypt/decompress ──────────────────────────
@@ -174,40 +259,28 @@ void ConnectionManager::Impl::dispatch_packet(conn_id_t id, const header_t* hdr,
             return;
         }
 
-        auto hdr_ptr  = std::make_shared<header_t>(*hdr);
-        auto data_ptr = std::make_shared<sdk::RawBuffer>(
-            std::vector<uint8_t>(payload.begin(), payload.end()));
-
-        endpoint_t remote  = rec->remote;
-        remote.peer_id     = id;
-        const auto affinity = rec->affinity_plugin;
-
-        const auto result = bus_.dispatch_packet(
-            hdr->payload_type, hdr_ptr, &remote, data_ptr);
-
-        const uint64_t lat_ns = monotonic_ns() - recv_ts_ns;
-        bus_.emit_latency(id, lat_ns);
-
-        if (result.result == PROPAGATION_CONSUMED && affinity.empty()) {
-            std::lock_guard wlk(records_write_mu_);
-            rcu_update([&](RecordMap& m) {
-                if (auto it = m.find(id); it != m.end())
-                    it->second->affinity_plugin = result.consumed_by;
-            });
-            LOG_DEBUG("dispatch #{}: affinity → '{}'", id, result.consumed_by);
-            bus_.emit_stat({StatsEvent::Kind::Consumed, 1, id});
-        } else if (result.result == PROPAGATION_REJECT) {
-            LOG_WARN("dispatch #{}: REJECTED by '{}' (type={})",
-                     id, result.consumed_by, hdr->payload_type);
-            bus_.emit_drop(id, DropReason::RejectedByHandler);
-            bus_.emit_stat({StatsEvent::Kind::Rejected, 1, id});
+        if (hdr->flags & GNET_FLAG_STRIPED) {
+            handle_striped(id, *rec, *hdr,
+                           std::vector<uint8_t>(payload.begin(), payload.end()),
+                           recv_ts_ns);
+            return;
+        }
+        if (hdr->flags & GNET_FLAG_FRAGMENT) {
+            handle_fragment(id, *rec, *hdr, payload, recv_ts_ns);
+            return;
         }
+
+        deliver_to_handlers(id, *rec, PacketData::copy_of(*hdr, payload), recv_ts_ns);
         return;
     }
 
     // ── Standard path ────────────────────────────────────────────────────────
 
-    std::vector<uint8_t> plaintext;
+    // Расшифровка сразу в пакет, который получат хэндлеры: ни промежуточного
+    // тела, ни копии plaintext'а (payload — view в чанк коннектора или stash)
+    auto data = PacketData::acquire();
+    data.header()   = *hdr;
+    auto& plaintext = *data;
     if (hdr->flags & GNET_FLAG_TRUSTED) {
         if (!rec->is_localhost) {
             LOG_WARN("dispatch #{}: TRUSTED flag from non-localhost — dropping", id);
@@ -215,17 +288,42 @@ void ConnectionManager::Impl::dispatch_packet(conn_id_t id, const header_t* hdr,
             return;
         }
         plaintext.assign(payload.begin(), payload.end());
-    } else if (rec->is_localhost || !rec->session) {
+    } else if (!resume && (rec->is_localhost || !rec->session)) {
         plaintext.assign(payload.begin(), payload.end());
     } else {
-        plaintext = rec->session->decrypt(payload.data(), payload.size(),
-                                           hdr->packet_id);
-        LOG_TRACE("dispatch #{}: decrypted {} → {} bytes",
-                  id, payload.size(), plaintext.size());
-        if (plaintext.empty()) {
+        auto& session = resume ? *resume : *rec->session;
+        const uint32_t epoch = session.rx_epoch();
+        if (!session.decrypt_into(plaintext, payload.data(), payload.size(),
+                                  hdr->packet_id, &dicts_,
+                                  hdr->flags & GNET_FLAG_KEY_PHASE)) {
             bus_.emit_drop(id, DropReason::DecryptFail);
             return;
         }
+        // Кадр открыл следующий ключ пира — фиксируем смену эпохи
+        if (session.rx_epoch() != epoch)
+            bus_.emit_stat({StatsEvent::Kind::RekeyRx,
+                            session.last_rx_rekey_cost_ns(), id});
+        LOG_TRACE("dispatch #{}: decrypted {} → {} bytes",
+                  id, payload.size(), plaintext.size());
+    }
+
+    // Инициатор доказал владение ключами IK-сессии — привязываем identity,
+    // теперь ESTABLISHED
+    if (resume) {
+        std::unique_ptr<NoiseSession> confirmed;
+        {
+            std::lock_guard wlk(records_write_mu_);
+            rcu_update([&](RecordMap& m) {
+                auto it = m.find(id);
+                if (it == m.end() || !it->second->resume) return;
+                auto pending = std::move(it->second->resume);
+                bind_peer(*it->second, std::move(pending->peer));
+                confirmed = std::move(pending->session);
+            });
+        }
+        if (confirmed) finalize_handshake(id, std::move(confirmed));
+        rec = rcu_find(id);
+        if (!rec || rec->state != STATE_ESTABLISHED) return;   // дубликат — закрыто
     }
 
     bus_.emit_stat({StatsEvent::Kind::RxBytes,  payload.size(), id});
@@ -241,32 +339,110 @@ void ConnectionManager::Impl::dispatch_packet(conn_id_t id, const header_t* hdr,
         return;
     }
 
-    auto hdr_ptr  = std::make_shared<header_t>(*hdr);
-    auto data_ptr = std::make_shared<sdk::RawBuffer>(std::move(plaintext));
-
-    endpoint_t remote  = rec->remote;
-    remote.peer_id     = id;
-    const auto affinity = rec->affinity_plugin;
-
-    const auto result = bus_.dispatch_packet(
-        hdr->payload_type, hdr_ptr, &remote, data_ptr);
-
-    const uint64_t lat_ns = monotonic_ns() - recv_ts_ns;
-    bus_.emit_latency(id, lat_ns);
-
-    if (result.result == PROPAGATION_CONSUMED && affinity.empty()) {
-        std::lock_guard wlk(records_write_mu_);
-        rcu_update([&](RecordMap& m) {
-            if (auto it = m.find(id); it != m.end())
-                it->second->affinity_plugin = result.consumed_by;
-        });
-        LOG_DEBUG("dispatch #{}: affinity → '{}'", id, result.consumed_by);
-        bus_.emit_stat({StatsEvent::Kind::Consumed, 1, id});
-    } else if (result.result == PROPAGATION_REJECT) {
-        LOG_WARN("dispatch #{}: REJECTED by '{}' (type={})",
-                 id, result.consumed_by, hdr->payload_type);
-        bus_.emit_drop(id, DropReason::RejectedByHandler);
-        bus_.emit_stat({StatsEvent::Kind::Rejected, 1, id});
+    if (hdr->flags & GNET_FLAG_STRIPED) {
+        handle_striped(id, *rec, *hdr, std::move(plaintext), recv_ts_ns);
+        return;
+    }
+
+    if (hdr->flags & GNET_FLAG_FRAGMENT) {
+        handle_fragment(id, *rec, *hdr, std::span<const uint8_t>(plaintext), recv_ts_ns);
+        return;
+    }
+
+    deliver_to_handlers(id, *rec, std::move(data), recv_ts_ns);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// deliver_to_handlers — batching per handle_data() call
+// ═══════════════════════════════════════════════════════════════════════════════
+
+namespace {
+/// Пачка текущего handle_data() этого потока (вложенные вызовы — свой стек).
+thread_local ConnectionManager::Impl::RxBatch* tl_rx_batch = nullptr;
+} // namespace
+
+ConnectionManager::Impl::RxBatchScope::RxBatchScope(RxBatch& b)
+    : prev_(std::exchange(tl_rx_batch, &b)) {}
+
+ConnectionManager::Impl::RxBatchScope::~RxBatchScope() { tl_rx_batch = prev_; }
+
+void ConnectionManager::Impl::deliver_to_handlers(conn_id_t id, const ConnectionRecord& rec,
+                                                  const header_t& hdr,
+                                                  std::vector<uint8_t> data,
+                                                  uint64_t recv_ts_ns) {
+    auto pkt = PacketData::acquire();
+    pkt.header() = hdr;
+    pkt->swap(data);
+    deliver_to_handlers(id, rec, std::move(pkt), recv_ts_ns);
+}
+
+void ConnectionManager::Impl::deliver_to_handlers(conn_id_t id, const ConnectionRecord& rec,
+                                                  PacketData pkt,
+                                                  uint64_t recv_ts_ns) {
+    const uint32_t type = pkt.header().payload_type;
+
+    // Внутри handle_data() пакеты копятся: пачка — подряд идущие кадры
+    // одного типа, порядок доставки между типами сохраняется
+    if (auto* b = tl_rx_batch; b && b->owner == this && b->id == id) {
+        if (b->count && (b->msg_type != type || b->count == RxBatch::MAX))
+            flush_rx_batch(*b);
+        if (!b->count) {
+            b->msg_type       = type;
+            b->remote         = rec.remote;
+            b->remote.peer_id = id;
+            b->affinity       = rec.affinity_handler.load(std::memory_order_relaxed) != HANDLER_ID_NONE;
+        }
+        b->recv_ts[b->count] = recv_ts_ns;
+        b->pkts[b->count++]  = std::move(pkt);
+        return;
+    }
+
+    endpoint_t remote = rec.remote;
+    remote.peer_id    = id;
+    dispatch_to_handlers(id, remote,
+                         rec.affinity_handler.load(std::memory_order_relaxed) != HANDLER_ID_NONE, type,
+                         std::span<const PacketData>(&pkt, 1),
+                         std::span<const uint64_t>(&recv_ts_ns, 1));
+}
+
+void ConnectionManager::Impl::flush_rx_batch(RxBatch& b) {
+    // Хэндлер может снова войти в deliver_to_handlers() — пачку освобождаем до вызова
+    const size_t n = std::exchange(b.count, 0);
+    std::array<PacketData, RxBatch::MAX> pkts;
+    std::move(b.pkts.begin(), b.pkts.begin() + static_cast<ptrdiff_t>(n), pkts.begin());
+    const auto recv_ts = b.recv_ts;
+    const auto remote  = b.remote;
+    dispatch_to_handlers(b.id, remote, b.affinity, b.msg_type,
+                         std::span<const PacketData>(pkts.data(), n),
+                         std::span<const uint64_t>(recv_ts.data(), n));
+}
+
+void ConnectionManager::Impl::dispatch_to_handlers(conn_id_t id, const endpoint_t& remote,
+                                                   bool affinity, uint32_t msg_type,
+                                                   std::span<const PacketData> pkts,
+                                                   std::span<const uint64_t> recv_ts) {
+    const auto result = bus_.dispatch_batch(msg_type, &remote, pkts);
+
+    const uint64_t now = monotonic_ns();
+    for (uint64_t ts : recv_ts) bus_.emit_latency(id, now - ts);
+
+    if (result.consumed && !affinity) {
+        // Пин на месте: первый CONSUMED выигрывает, карта записей не копируется
+        handler_id_t none = HANDLER_ID_NONE;
+        if (auto rec = rcu_find(id);
+            rec && rec->affinity_handler.compare_exchange_strong(none, result.consumed_by,
+                                                                 std::memory_order_relaxed)) {
+            LOG_DEBUG("dispatch #{}: affinity → '{}'", id, handler_name(result.consumed_by));
+            bus_.emit_stat({StatsEvent::Kind::Consumed, 1, id});
+        }
+    }
+    if (result.rejected) {
+        LOG_WARN("dispatch #{}: {} REJECTED by '{}' (type={})",
+                 id, result.rejected, handler_name(result.rejected_by), msg_type);
+        for (size_t i = 0; i < result.rejected; ++i) {
+            bus_.emit_drop(id, DropReason::RejectedByHandler);
+            bus_.emit_stat({StatsEvent::Kind::Rejected, 1, id});
+        }
     }
 }
 
@@ -312,6 +488,40 @@ void ConnectionManager::Impl::send_heartbeat(conn_id_t id) {
             std::min(tp.last_rtt_us / 10, uint64_t(65535)));
     }
 
+    // Несколько активных путей: PING по каждому, чтобы планировщик видел RTT
+    // каждого пути, а не только текущего лучшего. Probe идёт через
+    // Control-кольцо с привязкой к пути: drain остаётся единственным писателем
+    // в коннектор, а обгон packet_id — в пределах MAX_REORDER.
+    std::vector<TransportPath*> active;
+    for (auto& tp : rec->transport_paths)
+        if (tp.active) active.push_back(&tp);
+    if (active.size() > 1 && !shutting_down_.load(std::memory_order_relaxed)) {
+        auto q = get_or_create_queue(id);
+        for (size_t i = 0; i < active.size(); ++i) {
+            if (i > 0) hb.seq = rec->heartbeat_seq.fetch_add(1, std::memory_order_relaxed);
+            std::memcpy(buf.data(), &hb, sizeof(hb));
+            active[i]->state->probe_seq.store(hb.seq + 1, std::memory_order_relaxed);
+
+            auto frame = build_frame(id, MSG_TYPE_HEARTBEAT, std::span<const uint8_t>(buf));
+            if (frame.empty()) break;
+            const uint64_t pid = PerConnQueue::packet_id_of(frame);
+            {
+                std::lock_guard lk(rec->probe_mu);
+                rec->probe_routes.emplace_back(pid, active[i]->transport_conn_id);
+            }
+            rec->probe_pending.fetch_add(1, std::memory_order_release);
+            LOG_TRACE("send_heartbeat #{}: seq={} probe via '{}'",
+                      id, hb.seq, active[i]->scheme);
+            if (!q->try_push(std::move(frame), SendClass::Control)) {
+                take_probe_path(*rec, pid);
+                bus_.emit_drop(id, DropReason::PerConnLimitExceeded);
+                break;
+            }
+        }
+        schedule_flush(id, std::move(q));
+        return;
+    }
+
     LOG_TRACE("send_heartbeat #{}: seq={} paths={}", id, hb.seq, path_count);
     send_frame(id, MSG_TYPE_HEARTBEAT, std::span<const uint8_t>(buf));
 }
@@ -378,8 +588,18 @@ void ConnectionManager::Impl::handle_heartbeat(conn_id_t id,
         if (now_us > hb->timestamp_us) {
             const uint64_t rtt_us = now_us - hb->timestamp_us;
             LOG_TRACE("heartbeat #{}: PONG seq={} rtt={}us", id, hb->seq, rtt_us);
-            auto* path = rec->best_path();
-            if (path) path->last_rtt_us = rtt_us;
+            // PONG на per-path probe относим к его пути, иначе — к лучшему
+            TransportPath* path = nullptr;
+            for (auto& tp : rec->transport_paths)
+                if (tp.state->probe_seq.load(std::memory_order_relaxed) == hb->seq + 1) {
+                    path = &tp;
+                    break;
+                }
+            if (!path) path = rec->best_path();
+            if (path) {
+                path->last_rtt_us = rtt_us;
+                path->state->add_rtt_sample(rtt_us);
+            }
         }
     }
 }
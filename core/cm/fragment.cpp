@@ -0,0 +1,371 @@
+/// @file core/cm/fragment.cpp
+/// Fragmentation of large messages (frag_hdr_t) and bounded reassembly.
+
+#include "impl.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <sodium/crypto_aead_chacha20poly1305.h>
+
+#include <boost/asio/post.hpp>
+
+namespace gn {
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// FragmentReassembler
+// ═══════════════════════════════════════════════════════════════════════════════
+
+FragmentReassembler::Result FragmentReassembler::add(uint32_t msg_type,
+                                                     const frag_hdr_t& fh,
+                                                     std::span<const uint8_t> chunk,
+                                                     size_t budget,
+                                                     std::vector<uint8_t>& out) {
+    std::lock_guard lk(mu_);
+
+    // Хвост уже отклонённого сообщения — не резервируем под него память заново
+    if (recently_dropped(fh.msg_id)) return Result::Rejected;
+
+    const bool in_bounds = fh.offset <= fh.total_len
+                        && chunk.size() <= fh.total_len - fh.offset;
+    const bool last_ok   = !(fh.flags & FRAG_FLAG_LAST)
+                        || fh.offset + chunk.size() == fh.total_len;
+    if (!in_bounds || !last_ok || fh.total_len == 0) {
+        drop_locked(fh.msg_id);
+        return Result::Rejected;
+    }
+
+    auto it = partial_.find(fh.msg_id);
+    if (it == partial_.end()) {
+        if (partial_.size() >= MAX_PARTIAL
+            || fh.total_len > budget || reserved_ > budget - fh.total_len) {
+            drop_locked(fh.msg_id);
+            return Result::Rejected;
+        }
+        Partial p;
+        p.msg_type = msg_type;
+        p.data.resize(fh.total_len);
+        p.started  = std::chrono::steady_clock::now();
+        reserved_ += fh.total_len;
+        it = partial_.emplace(fh.msg_id, std::move(p)).first;
+    } else if (it->second.msg_type != msg_type
+               || it->second.data.size() != fh.total_len) {
+        drop_locked(fh.msg_id);
+        return Result::Rejected;
+    }
+
+    auto& p = it->second;
+    if (!chunk.empty()) {
+        // Пересечение с уже принятым диапазоном — повтор или подделка смещений
+        const uint64_t lo = fh.offset, hi = lo + chunk.size();
+        auto next = p.covered.lower_bound(lo);
+        auto prev = next == p.covered.begin() ? p.covered.end() : std::prev(next);
+        if ((next != p.covered.end() && next->first < hi)
+            || (prev != p.covered.end() && prev->second > lo)) {
+            drop_locked(fh.msg_id);
+            return Result::Rejected;
+        }
+        // Соседние диапазоны сливаются: при обычной отправке — одна запись
+        uint64_t begin = lo, end = hi;
+        if (prev != p.covered.end() && prev->second == lo) {
+            begin = prev->first;
+            p.covered.erase(prev);
+        }
+        if (next != p.covered.end() && next->first == hi) {
+            end = next->second;
+            p.covered.erase(next);
+        }
+        p.covered[begin] = end;
+
+        std::memcpy(p.data.data() + fh.offset, chunk.data(), chunk.size());
+    }
+    p.received += chunk.size();
+    if (p.received < p.data.size()) return Result::Partial;
+
+    out = std::move(p.data);
+    reserved_ -= out.size();
+    partial_.erase(it);
+    return Result::Complete;
+}
+
+size_t FragmentReassembler::expire(std::chrono::steady_clock::time_point deadline) {
+    std::lock_guard lk(mu_);
+    std::vector<uint32_t> stale;
+    for (auto& [id, p] : partial_)
+        if (p.started < deadline) stale.push_back(id);
+    for (uint32_t id : stale) drop_locked(id);
+    return stale.size();
+}
+
+size_t FragmentReassembler::reserved_bytes() const {
+    std::lock_guard lk(mu_);
+    return reserved_;
+}
+
+void FragmentReassembler::drop_locked(uint32_t msg_id) {
+    if (auto it = partial_.find(msg_id); it != partial_.end()) {
+        reserved_ -= it->second.data.size();
+        partial_.erase(it);
+    }
+    dropped_[dropped_pos_++ % RECENT_DROPS] = uint64_t{msg_id} + 1;
+}
+
+bool FragmentReassembler::recently_dropped(uint32_t msg_id) const {
+    return std::find(dropped_.begin(), dropped_.end(), uint64_t{msg_id} + 1)
+        != dropped_.end();
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Send side
+// ═══════════════════════════════════════════════════════════════════════════════
+
+bool ConnectionManager::Impl::send_message(conn_id_t id, uint32_t msg_type,
+                                           std::span<const uint8_t> payload,
+                                           SendClass cls) {
+    if (payload.size() > FRAGMENT_THRESHOLD)
+        return send_fragmented(id, msg_type, payload, cls);
+    return send_frame(id, msg_type, payload, cls);
+}
+
+namespace {
+
+/// Окно для кадра с @p payload_len байт тела: заголовок + тело + MAC
+/// (сжатие несжимаемого тела не уменьшит).
+bool fits_window(const PerConnQueue& q, SendClass cls, size_t payload_len) {
+    return cls == SendClass::Control   // Control окном не ограничен
+        || q.window() >= sizeof(header_t) + payload_len
+                         + crypto_aead_chacha20poly1305_IETF_ABYTES;
+}
+
+size_t chunk_payload(const PerConnQueue::ParkedMessage& m, size_t n) {
+    return m.raw ? n : sizeof(frag_hdr_t) + n;
+}
+
+} // namespace
+
+bool ConnectionManager::Impl::send_fragmented(conn_id_t id, uint32_t msg_type,
+                                              std::span<const uint8_t> payload,
+                                              SendClass cls) {
+    auto rec = rcu_find(id);
+    if (!rec) return false;
+
+    PerConnQueue::ParkedMessage m;
+    m.msg_type = msg_type;
+    // Фрагменты без явного класса — bulk, чтобы не занимать
+    // interactive-очередь мегабайтами
+    m.cls = cls == SendClass::Auto ? send_class_of(msg_type) : cls;
+    if (m.cls == SendClass::Interactive && cls == SendClass::Auto) m.cls = SendClass::Bulk;
+
+    // Пир без CORE_CAP_FRAGMENT: старое поведение — независимые кадры
+    m.raw = !(rec->peer_core_meta.caps_mask & CORE_CAP_FRAGMENT);
+    if (m.raw) {
+        LOG_DEBUG("send #{}: peer lacks CORE_CAP_FRAGMENT, raw {} byte chunks",
+                  id, CHUNK_SIZE);
+    } else {
+        m.fh.msg_id    = rec->send_msg_id.fetch_add(1, std::memory_order_relaxed);
+        m.fh.total_len = payload.size();
+        LOG_TRACE("send #{}: fragmenting msg_id={} type={} len={}",
+                  id, m.fh.msg_id, msg_type, payload.size());
+    }
+
+    auto q = get_or_create_queue(id);
+    {
+        // Лимит проверяется до первого фрагмента: отказ посреди сообщения
+        // оставил бы приёмнику резерв total_len до REASSEMBLY_TIMEOUT
+        std::lock_guard lk(q->parked_mu);
+        if (q->parked_bytes + payload.size() > PerConnQueue::MAX_PARKED_BYTES) {
+            bus_.emit_drop(id, DropReason::PerConnLimitExceeded);
+            LOG_WARN("send #{}: {} bytes of large messages already waiting", id,
+                     q->parked_bytes);
+            return false;
+        }
+    }
+
+    // Пока окно открыто и никто не ждёт — фрагменты уходят сразу
+    size_t off = 0;
+    if (!q->has_parked.load(std::memory_order_acquire)) {
+        for (; off < payload.size(); off += CHUNK_SIZE) {
+            const size_t n = std::min(CHUNK_SIZE, payload.size() - off);
+            if (!fits_window(*q, m.cls, chunk_payload(m, n))) break;
+            if (send_parked_chunk(id, m, off, payload.subspan(off, n))) continue;
+            // Окно заняли параллельно между проверкой и push — остаток паркуем
+            if (!rcu_find(id) || fits_window(*q, m.cls, chunk_payload(m, n))) return false;
+            break;
+        }
+        if (off == payload.size()) return true;
+    }
+
+    // Остаток ждёт окна в очереди соединения: отправитель (в том числе
+    // io-поток или воркер рукопожатий) не блокируется
+    m.base = off;
+    m.rest.assign(payload.begin() + static_cast<std::ptrdiff_t>(off), payload.end());
+    {
+        std::lock_guard lk(q->parked_mu);
+        q->parked_bytes += m.rest.size();
+        q->parked.push_back(std::move(m));
+        q->has_parked.store(true, std::memory_order_release);
+    }
+    LOG_DEBUG("send #{}: window closed, {} of {} bytes parked",
+              id, payload.size() - off, payload.size());
+    kick_parked(id, *q);
+    return true;
+}
+
+bool ConnectionManager::Impl::send_parked_chunk(conn_id_t id,
+                                                const PerConnQueue::ParkedMessage& m,
+                                                uint64_t off,
+                                                std::span<const uint8_t> chunk) {
+    if (m.raw) return send_frame(id, m.msg_type, chunk, m.cls);
+
+    frag_hdr_t fh = m.fh;
+    fh.offset = off;
+    fh.flags  = (off + chunk.size() == fh.total_len) ? FRAG_FLAG_LAST : 0;
+
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize(sizeof(frag_hdr_t) + chunk.size());
+    std::memcpy(scratch.data(), &fh, sizeof(fh));
+    std::memcpy(scratch.data() + sizeof(fh), chunk.data(), chunk.size());
+    return send_frame(id, m.msg_type, scratch, m.cls, GNET_FLAG_FRAGMENT);
+}
+
+void ConnectionManager::Impl::kick_parked(conn_id_t id, PerConnQueue& q) {
+    if (!q.has_parked.load(std::memory_order_acquire)) return;
+    if (q.parked_running.exchange(true, std::memory_order_acq_rel)) return;
+
+    // Не в потоке, вернувшем кредит (коннектор) и не в дренере: отправка
+    // мегабайтного фрагмента — работа flush-исполнителя
+    auto* ioc = flush_ioc_.load(std::memory_order_acquire);
+    auto  sp  = ioc ? find_queue(id) : nullptr;
+    if (!sp || sp.get() != &q) { resume_parked(id, q); return; }
+    boost::asio::post(*ioc, [this, id, sp = std::move(sp)] { resume_parked(id, *sp); });
+}
+
+void ConnectionManager::Impl::resume_parked(conn_id_t id, PerConnQueue& q) {
+    // Вызывающий владеет parked_running. Фронт deque стабилен без блокировки:
+    // отправители только добавляют в конец, извлекает только этот поток
+    for (;;) {
+        for (;;) {
+            PerConnQueue::ParkedMessage* m = nullptr;
+            {
+                std::lock_guard lk(q.parked_mu);
+                if (q.parked.empty()) {
+                    q.has_parked.store(false, std::memory_order_release);
+                    break;
+                }
+                m = &q.parked.front();
+            }
+
+            const size_t n = std::min(CHUNK_SIZE, m->rest.size() - m->pos);
+            if (!fits_window(q, m->cls, chunk_payload(*m, n))) break;
+
+            const bool ok = !shutting_down_.load(std::memory_order_relaxed)
+                && send_parked_chunk(id, *m, m->base + m->pos,
+                                     std::span<const uint8_t>(m->rest).subspan(m->pos, n));
+            // Окно заняли параллельно между проверкой и push — ждём следующего кредита
+            if (!ok && rcu_find(id) && !shutting_down_.load(std::memory_order_relaxed)
+                && !fits_window(q, m->cls, chunk_payload(*m, n)))
+                break;
+
+            std::lock_guard lk(q.parked_mu);
+            if (ok && (m->pos += n) < m->rest.size()) continue;
+            if (!ok)
+                LOG_WARN("send #{}: parked message type={} dropped at offset {}",
+                         id, m->msg_type, m->base + m->pos);
+            q.parked_bytes -= m->rest.size();
+            q.parked.pop_front();
+        }
+
+        q.parked_running.store(false, std::memory_order_seq_cst);
+        // Кредит или новое сообщение, пришедшие после последней проверки,
+        // звали kick_parked() при поднятом флаге — перепроверяем сами.
+        // Закрытое окно = есть байты в очереди / у коннектора: их drain или
+        // on_sent() снова вызовут kick_parked()
+        if (!q.has_parked.load(std::memory_order_acquire)) return;
+        {
+            std::lock_guard lk(q.parked_mu);
+            if (q.parked.empty()) return;
+            const auto& m = q.parked.front();
+            const size_t n = std::min(CHUNK_SIZE, m.rest.size() - m.pos);
+            if (!fits_window(q, m.cls, chunk_payload(m, n))) return;
+        }
+        if (q.parked_running.exchange(true, std::memory_order_acq_rel)) return;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Receive side
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void ConnectionManager::Impl::handle_fragment(conn_id_t id, ConnectionRecord& rec,
+                                              const header_t& hdr,
+                                              std::span<const uint8_t> plaintext,
+                                              uint64_t recv_ts_ns) {
+    if (plaintext.size() < sizeof(frag_hdr_t)) {
+        LOG_WARN("fragment #{}: {} bytes, shorter than frag_hdr_t", id, plaintext.size());
+        bus_.emit_drop(id, DropReason::ReassemblyFailed);
+        return;
+    }
+
+    // Streaming: хэндлер получает каждый фрагмент как есть (frag_hdr_t + chunk)
+    if (is_fragment_streaming(hdr.payload_type)) {
+        deliver_to_handlers(id, rec, hdr,
+                            std::vector<uint8_t>(plaintext.begin(), plaintext.end()),
+                            recv_ts_ns);
+        return;
+    }
+
+    frag_hdr_t fh;
+    std::memcpy(&fh, plaintext.data(), sizeof(fh));
+    const auto chunk = plaintext.subspan(sizeof(frag_hdr_t));
+
+    std::vector<uint8_t> message;
+    switch (rec.reassembly.add(hdr.payload_type, fh, chunk, MAX_REASSEMBLY_BYTES, message)) {
+    case FragmentReassembler::Result::Partial:
+        return;
+    case FragmentReassembler::Result::Rejected:
+        LOG_WARN("fragment #{}: msg_id={} type={} offset={} total={} rejected",
+                 id, fh.msg_id, hdr.payload_type, fh.offset, fh.total_len);
+        bus_.emit_drop(id, DropReason::ReassemblyFailed);
+        return;
+    case FragmentReassembler::Result::Complete:
+        break;
+    }
+
+    LOG_TRACE("fragment #{}: msg_id={} reassembled {} bytes", id, fh.msg_id, message.size());
+    header_t whole = hdr;
+    whole.flags       &= ~GNET_FLAG_FRAGMENT;
+    whole.payload_len  = static_cast<uint32_t>(message.size());
+    deliver_to_handlers(id, rec, whole, std::move(message), recv_ts_ns);
+}
+
+void ConnectionManager::Impl::expire_reassembly() {
+    const auto deadline = std::chrono::steady_clock::now() - REASSEMBLY_TIMEOUT;
+    auto map = rcu_read();
+    for (auto& [id, rec] : *map) {
+        // Запасной путь для striped-пробелов, если нет flush executor'а
+        std::vector<StripeReorderBuffer::Frame> ready;
+        rec->reorder.release_expired(std::chrono::steady_clock::now() - REORDER_TIMEOUT,
+                                     ready);
+        deliver_reordered(id, *rec, ready);
+
+        const size_t n = rec->reassembly.expire(deadline);
+        if (!n) continue;
+        LOG_WARN("fragment #{}: {} partial message(s) timed out", id, n);
+        for (size_t i = 0; i < n; ++i)
+            bus_.emit_drop(id, DropReason::ReassemblyFailed);
+    }
+}
+
+void ConnectionManager::Impl::set_fragment_streaming(uint32_t msg_type, bool on) {
+    std::unique_lock lk(frag_stream_mu_);
+    if (on) frag_stream_types_.insert(msg_type);
+    else    frag_stream_types_.erase(msg_type);
+}
+
+bool ConnectionManager::Impl::is_fragment_streaming(uint32_t msg_type) const {
+    std::shared_lock lk(frag_stream_mu_);
+    return frag_stream_types_.contains(msg_type);
+}
+
+} // namespace gn
@@ -1,9 +1,12 @@
 /// @file core/cm/handshake.cpp
-/// Noise_XX handshake + key rotation + rekey.
+/// Noise_XX handshake + Noise_IK resumption + handshake pool / admission
+/// control + key rotation + rekey.
 
 #include "impl.hpp"
 #include "logger.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #include <sodium/crypto_sign.h>
@@ -24,16 +27,109 @@ void ConnectionManager::Impl::rotate_identity_keys(const Config::Identity& cfg)
     NodeIdentity next = NodeIdentity::load_or_generate(cfg);
     std::unique_lock lk(identity_mu_);
     identity_ = std::move(next);
+    derive_local_static();
     LOG_INFO("Identity rotated — user={}...", bytes_to_hex(identity_.user_pubkey, 4));
 }
 
+void ConnectionManager::Impl::derive_local_static() {
+    auto& ls = local_static_;
+    [[maybe_unused]] int r1 = crypto_sign_ed25519_pk_to_curve25519(ls.x25519_pk, identity_.device_pubkey);
+    [[maybe_unused]] int r2 = crypto_sign_ed25519_sk_to_curve25519(ls.x25519_sk, identity_.device_seckey);
+
+    // Ed25519 детерминирован: подпись (user_pk || device_pk) одна на identity
+    uint8_t to_sign[GN_SIGN_PUBLICKEYBYTES * 2];
+    std::memcpy(to_sign,                          identity_.user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
+    std::memcpy(to_sign + GN_SIGN_PUBLICKEYBYTES, identity_.device_pubkey, GN_SIGN_PUBLICKEYBYTES);
+    crypto_sign_ed25519_detached(ls.signature, nullptr, to_sign, sizeof(to_sign),
+                                 identity_.user_seckey);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Peer identity cache (resumption)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+bool ConnectionManager::Impl::resumption_enabled() const noexcept {
+    return !config_ || (config_->security.resumption && config_->security.peer_cache_size > 0);
+}
+
+bool ConnectionManager::Impl::peer_identity_cached(const msg::HandshakePayload& hp,
+                                                   const uint8_t rs[noise::DHLEN]) const {
+    const std::string key = bytes_to_hex(hp.user_pubkey, GN_SIGN_PUBLICKEYBYTES);
+    std::shared_lock lk(peer_cache_mu_);
+    auto it = peer_cache_.find(key);
+    return it != peer_cache_.end()
+        && std::memcmp(it->second.device_pubkey, hp.device_pubkey, GN_SIGN_PUBLICKEYBYTES) == 0
+        && sodium_memcmp(it->second.static_x25519, rs, noise::DHLEN) == 0;
+}
+
+void ConnectionManager::Impl::remember_peer(const ConnectionRecord& rec,
+                                            const uint8_t rs[noise::DHLEN]) {
+    const size_t cap = config_
+        ? static_cast<size_t>(std::max(config_->security.peer_cache_size, 0)) : 4096;
+    if (!cap) return;
+
+    const std::string key = bytes_to_hex(rec.peer_user_pubkey, GN_SIGN_PUBLICKEYBYTES);
+    std::unique_lock lk(peer_cache_mu_);
+    auto& e = peer_cache_[key];
+    std::memcpy(e.device_pubkey, rec.peer_device_pubkey, GN_SIGN_PUBLICKEYBYTES);
+    std::memcpy(e.static_x25519, rs, noise::DHLEN);
+    e.caps = rec.peer_core_meta.caps_mask;
+    e.seen = std::chrono::steady_clock::now();
+
+    // Адрес запоминаем только для исходящих: у входящих порт эфемерный
+    if (rec.is_initiator)
+        peer_addr_cache_[std::string(rec.remote.address) + ":"
+                         + std::to_string(rec.remote.port)] = key;
+
+    // Переполнение — вытесняем самую старую identity вместе с её адресами
+    if (peer_cache_.size() > cap) {
+        auto oldest = peer_cache_.begin();
+        for (auto it = peer_cache_.begin(); it != peer_cache_.end(); ++it)
+            if (it->second.seen < oldest->second.seen) oldest = it;
+        std::erase_if(peer_addr_cache_, [&](const auto& kv) { return kv.second == oldest->first; });
+        peer_cache_.erase(oldest);
+    }
+}
+
+void ConnectionManager::Impl::forget_peer_address(const std::string& addr_key) {
+    std::unique_lock lk(peer_cache_mu_);
+    peer_addr_cache_.erase(addr_key);
+}
+
+std::optional<ConnectionManager::Impl::PeerCacheEntry>
+ConnectionManager::Impl::resume_target(const std::string& addr_key) const {
+    if (!resumption_enabled()) return std::nullopt;
+    std::shared_lock lk(peer_cache_mu_);
+    auto a = peer_addr_cache_.find(addr_key);
+    if (a == peer_addr_cache_.end()) return std::nullopt;
+    auto it = peer_cache_.find(a->second);
+    if (it == peer_cache_.end() || !(it->second.caps & CORE_CAP_RESUME)) return std::nullopt;
+    return it->second;
+}
+
 bool ConnectionManager::Impl::rekey_session(conn_id_t id) {
     LOG_SCOPE_DEBUG();
 
     auto rec = rcu_find(id);
     if (!rec || !rec->session || rec->state != STATE_ESTABLISHED) return false;
 
-    // Noise native rekey — no messages needed, just update keys locally.
+    // Key epochs: меняем только свой ключ отправки, пир следует по
+    // GNET_FLAG_KEY_PHASE. Счётчики и окно не сбрасываются; поток сжатия
+    // начинает новую эпоху (rotate_tx), приёмник синхронизируется по reset
+    if (rec->peer_core_meta.caps_mask & CORE_CAP_KEY_EPOCH) {
+        const uint64_t ns = rec->session->rotate_tx(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count()));
+        if (!ns) {
+            LOG_DEBUG("rekey_session #{}: rotation skipped (too soon or idle)", id);
+            return false;
+        }
+        bus_.emit_stat({StatsEvent::Kind::RekeyTx, ns, id});
+        LOG_INFO("rekey_session #{}: send key epoch {}", id, rec->session->tx_epoch());
+        return true;
+    }
+
+    // Legacy peer: Noise native rekey — no messages needed, just update keys locally.
     // Обе стороны должны вызвать rekey синхронно (по таймеру или счётчику).
     uint8_t new_send[noise::KEYLEN], new_recv[noise::KEYLEN];
     noise::hkdf2(rec->session->send_key, nullptr, 0, new_send, new_recv);
@@ -45,13 +141,145 @@ bool ConnectionManager::Impl::rekey_session(conn_id_t id) {
     sodium_memzero(new_recv, sizeof(new_recv));
     sodium_memzero(new_send, sizeof(new_send));
 
+    rec->session->set_cipher(rec->session->cipher()); // пересчёт AES key schedule
     rec->session->recv_window.reset();
+    rec->session->stream.reset();
     rec->send_packet_id.store(1, std::memory_order_release);
 
     LOG_INFO("rekey_session #{}: Noise native rekey done", id);
     return true;
 }
 
+void ConnectionManager::Impl::maybe_rekey(conn_id_t id, ConnectionRecord& rec) {
+    if (!(rec.peer_core_meta.caps_mask & CORE_CAP_KEY_EPOCH)) return;
+
+    const uint64_t max_pkts = static_cast<uint64_t>(std::max(0,
+        config_ ? config_->security.rekey_after_packets : 1 << 24));
+    const uint64_t max_mb   = static_cast<uint64_t>(std::max(0,
+        config_ ? config_->security.rekey_after_mb : 65536));
+    if (!rec.session->rekey_due(max_pkts, max_mb << 20)) return;
+
+    const uint64_t ns = rec.session->rotate_tx(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count()));
+    if (!ns) return;
+    bus_.emit_stat({StatsEvent::Kind::RekeyTx, ns, id});
+    LOG_DEBUG("maybe_rekey #{}: send key epoch {}", id, rec.session->tx_epoch());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Handshake offload + admission control
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void ConnectionManager::Impl::start_handshake_pool(size_t threads) {
+    if (threads == 0 || hs_pool_.load(std::memory_order_acquire)) return;
+    hs_pool_owner_ = std::make_unique<WorkerPool>(threads, HANDSHAKE_QUEUE_MAX);
+    hs_pool_.store(hs_pool_owner_.get(), std::memory_order_release);
+    LOG_DEBUG("handshake pool: {} workers, queue {}", threads, HANDSHAKE_QUEUE_MAX);
+}
+
+bool ConnectionManager::Impl::admit_connection(const endpoint_t& ep) {
+    if (!config_) return true;
+    const auto& c = config_->core;
+    const bool inbound = !(ep.flags & EP_FLAG_OUTBOUND);
+
+    const char* why = nullptr;
+    if (c.max_connections > 0
+        && rcu_read()->size() >= static_cast<size_t>(c.max_connections)) {
+        why = "max_connections";
+    } else if (inbound && c.max_handshakes > 0
+               && handshakes_active_.load(std::memory_order_relaxed)
+                      >= static_cast<uint32_t>(c.max_handshakes)) {
+        why = "max_handshakes";
+    } else if (auto* pool = hs_pool_.load(std::memory_order_acquire);
+               inbound && pool && pool->queued() >= pool->capacity() / 2) {
+        // Вторая половина очереди — запас для уже начатых handshake
+        why = "handshake pool saturated";
+    } else if (inbound && !(ep.flags & EP_FLAG_TRUSTED) && c.handshake_rate_per_ip > 0) {
+        const double rate = c.handshake_rate_per_ip;
+        const auto   now  = std::chrono::steady_clock::now();
+        std::lock_guard lk(admission_mu_);
+        auto [it, fresh] = admission_buckets_.try_emplace(ep.address, AdmissionBucket{rate, now});
+        auto& b = it->second;
+        b.tokens = std::min(rate, b.tokens
+                 + rate * std::chrono::duration<double>(now - b.last).count());
+        b.last   = now;
+        if (b.tokens < 1.0) why = "handshake_rate_per_ip";
+        else                b.tokens -= 1.0;
+    }
+    if (!why) return true;
+
+    LOG_DEBUG("handle_connect {}:{}: refused ({})", ep.address, ep.port, why);
+    bus_.emit_drop(CONN_ID_INVALID, DropReason::AdmissionDenied);
+    return false;
+}
+
+void ConnectionManager::Impl::expire_admission_buckets() {
+    // burst == rate: через секунду простоя bucket снова полон — хранить незачем
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lk(admission_mu_);
+    std::erase_if(admission_buckets_, [&](const auto& kv) {
+        return now - kv.second.last >= std::chrono::seconds(1);
+    });
+}
+
+void ConnectionManager::Impl::expire_handshakes() {
+    // Молчащий пир иначе держит слот max_handshakes вечно — heartbeat
+    // до ESTABLISHED не ходит, а коннектор может не заметить обрыв
+    const auto deadline = std::chrono::steady_clock::now() - HANDSHAKE_TIMEOUT;
+    std::vector<conn_id_t> stale;
+    {
+        auto map = rcu_read();
+        for (auto& [id, rec] : *map)
+            if (rec->handshake && rec->handshake_started < deadline)
+                stale.push_back(id);
+    }
+    for (const conn_id_t id : stale) {
+        LOG_WARN("handshake #{}: timed out after {}s, closing",
+                 id, HANDSHAKE_TIMEOUT.count());
+        close_now(id);
+        handle_disconnect(id, 0);   // запись, индексы и handshakes_active_
+    }
+}
+
+void ConnectionManager::Impl::run_handshake_step(const ConnectionRecord& rec,
+                                                 WorkerPool::Task step) {
+    auto* pool = hs_pool_.load(std::memory_order_acquire);
+    if (pool && rec.hs_lane && pool->try_post(rec.hs_lane, step)) return;
+    step();
+}
+
+bool ConnectionManager::Impl::offload_handshake(const ConnectionRecord& rec, conn_id_t id,
+                                                const header_t* hdr,
+                                                std::span<const uint8_t> payload,
+                                                uint64_t recv_ts_ns) {
+    auto* pool = hs_pool_.load(std::memory_order_acquire);
+    if (!pool || rec.hs_lane->running_in_this_thread()) return false;
+
+    // Кадр за handshake-кадром ждёт в той же lane: иначе обгонит finalize_handshake
+    if (!is_handshake_msg(hdr->payload_type)
+        && rec.hs_lane->pending.load(std::memory_order_acquire) == 0)
+        return false;
+
+    // Копия: буфер handle_data переиспользуется сразу после возврата
+    std::vector<uint8_t> frame(sizeof(header_t) + payload.size());
+    std::memcpy(frame.data(), hdr, sizeof(header_t));
+    std::memcpy(frame.data() + sizeof(header_t), payload.data(), payload.size());
+
+    auto job = [this, id, recv_ts_ns, frame = std::move(frame)] {
+        const auto* h = reinterpret_cast<const header_t*>(frame.data());
+        dispatch_packet(id, h, std::span<const uint8_t>(frame).subspan(sizeof(header_t)),
+                        recv_ts_ns);
+    };
+    if (pool->try_post(rec.hs_lane, std::move(job))) return true;
+
+    LOG_WARN("dispatch #{}: handshake pool saturated ({} queued) — closing",
+             id, pool->queued());
+    bus_.emit_drop(id, DropReason::AdmissionDenied);
+    close_now(id);
+    return true;
+}
+
 // ═══════════════════════════════════════════════════════════════════════════════
 // Noise_XX handshake
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -76,6 +304,29 @@ void ConnectionManager::Impl::send_noise_init(conn_id_t id) {
     LOG_DEBUG("send_noise_init #{}: sent {} bytes", id, out_len);
 }
 
+void ConnectionManager::Impl::send_noise_resume(conn_id_t id) {
+    LOG_SCOPE_TRACE();
+
+    auto rec = rcu_find(id);
+    if (!rec || !rec->handshake) return;
+
+    // IK msg1: → e, es, s, ss with HandshakePayload (зашифрован уже под es)
+    auto hp_bytes = build_handshake_payload();
+
+    std::vector<uint8_t> msg1(noise::DHLEN * 2 + noise::MACLEN * 2 + hp_bytes.size());
+    size_t msg1_len = 0;
+    if (!rec->handshake->write_message(hp_bytes.data(), hp_bytes.size(),
+                                        msg1.data(), &msg1_len)) {
+        LOG_ERROR("send_noise_resume #{}: write_message failed", id);
+        close_now(id);
+        return;
+    }
+    msg1.resize(msg1_len);
+
+    send_frame(id, MSG_TYPE_NOISE_RESUME, std::span<const uint8_t>(msg1));
+    LOG_DEBUG("send_noise_resume #{}: sent {} bytes", id, msg1_len);
+}
+
 std::vector<uint8_t> ConnectionManager::Impl::build_handshake_payload() {
     std::shared_lock lk(identity_mu_);
 
@@ -83,91 +334,145 @@ std::vector<uint8_t> ConnectionManager::Impl::build_handshake_payload() {
     std::memcpy(hp.user_pubkey,   identity_.user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
     std::memcpy(hp.device_pubkey, identity_.device_pubkey, GN_SIGN_PUBLICKEYBYTES);
 
-    // Подпись: sig = Ed25519(user_sk, user_pk || device_pk)
-    uint8_t to_sign[GN_SIGN_PUBLICKEYBYTES * 2];
-    std::memcpy(to_sign,                          hp.user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
-    std::memcpy(to_sign + GN_SIGN_PUBLICKEYBYTES, hp.device_pubkey, GN_SIGN_PUBLICKEYBYTES);
-    crypto_sign_ed25519_detached(hp.signature, nullptr,
-                                  to_sign, sizeof(to_sign),
-                                  identity_.user_seckey);
+    // Подпись: sig = Ed25519(user_sk, user_pk || device_pk) — см. derive_local_static()
+    std::memcpy(hp.signature, local_static_.signature, GN_SIGN_BYTES);
 
     hp.set_schemes(local_schemes());
     hp.core_meta = local_core_meta();
 
-    return std::vector<uint8_t>(
+    std::vector<uint8_t> out(
         reinterpret_cast<const uint8_t*>(&hp),
         reinterpret_cast<const uint8_t*>(&hp) + sizeof(hp));
+
+    // Хвост HandshakeDictExt: какие zstd-словари мы умеем распаковывать
+    const auto dict_ids = dicts_.ids();
+    if (!dict_ids.empty()) {
+        const auto n = static_cast<uint8_t>(
+            std::min<size_t>(dict_ids.size(), msg::HANDSHAKE_MAX_DICTS));
+        out.push_back(n);
+        const size_t at = out.size();
+        out.resize(at + n * sizeof(uint32_t));
+        std::memcpy(out.data() + at, dict_ids.data(), n * sizeof(uint32_t));
+    }
+    return out;
 }
 
-bool ConnectionManager::Impl::process_handshake_payload(conn_id_t id,
-                                                         const uint8_t* data,
-                                                         size_t len) {
+std::optional<PeerHello> ConnectionManager::Impl::verify_handshake_payload(
+        conn_id_t id, const uint8_t* data, size_t len) {
     if (len < sizeof(msg::HandshakePayload)) {
-        LOG_WARN("process_handshake_payload #{}: too short ({} < {})",
+        LOG_WARN("verify_handshake_payload #{}: too short ({} < {})",
                  id, len, sizeof(msg::HandshakePayload));
         bus_.emit_drop(id, DropReason::AuthFail);
-        return false;
+        return std::nullopt;
     }
 
     const auto* hp = reinterpret_cast<const msg::HandshakePayload*>(data);
 
-    // Проверка подписи: user_pk || device_pk
-    uint8_t to_verify[GN_SIGN_PUBLICKEYBYTES * 2];
-    std::memcpy(to_verify,                          hp->user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
-    std::memcpy(to_verify + GN_SIGN_PUBLICKEYBYTES, hp->device_pubkey, GN_SIGN_PUBLICKEYBYTES);
-    if (crypto_sign_ed25519_verify_detached(hp->signature, to_verify,
-                                             sizeof(to_verify),
-                                             hp->user_pubkey) != 0) {
-        LOG_WARN("process_handshake_payload #{}: invalid signature", id);
-        bus_.emit_drop(id, DropReason::AuthFail);
-        return false;
-    }
-
-    // Верификация: device_pubkey Ed25519 → X25519 должен совпадать с rs из Noise
     auto rec = rcu_find(id);
-    if (!rec || !rec->handshake) return false;
+    if (!rec || !rec->handshake) return std::nullopt;
+
+    // Та же (user_pk, device_pk, rs) уже проверялась — Ed25519 и конверсию пропускаем
+    if (!peer_identity_cached(*hp, rec->handshake->rs)) {
+        // Проверка подписи: user_pk || device_pk
+        uint8_t to_verify[GN_SIGN_PUBLICKEYBYTES * 2];
+        std::memcpy(to_verify,                          hp->user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
+        std::memcpy(to_verify + GN_SIGN_PUBLICKEYBYTES, hp->device_pubkey, GN_SIGN_PUBLICKEYBYTES);
+        if (crypto_sign_ed25519_verify_detached(hp->signature, to_verify,
+                                                 sizeof(to_verify),
+                                                 hp->user_pubkey) != 0) {
+            LOG_WARN("verify_handshake_payload #{}: invalid signature", id);
+            bus_.emit_drop(id, DropReason::AuthFail);
+            return std::nullopt;
+        }
 
-    uint8_t expected_x25519[32];
-    if (crypto_sign_ed25519_pk_to_curve25519(expected_x25519, hp->device_pubkey) != 0) {
-        LOG_WARN("process_handshake_payload #{}: Ed25519→X25519 conversion failed", id);
-        bus_.emit_drop(id, DropReason::AuthFail);
-        return false;
-    }
-    if (std::memcmp(expected_x25519, rec->handshake->rs, noise::DHLEN) != 0) {
-        LOG_WARN("process_handshake_payload #{}: device_pubkey ≠ Noise static key", id);
-        bus_.emit_drop(id, DropReason::AuthFail);
-        return false;
+        // Верификация: device_pubkey Ed25519 → X25519 должен совпадать с rs из Noise
+        uint8_t expected_x25519[32];
+        if (crypto_sign_ed25519_pk_to_curve25519(expected_x25519, hp->device_pubkey) != 0) {
+            LOG_WARN("verify_handshake_payload #{}: Ed25519→X25519 conversion failed", id);
+            bus_.emit_drop(id, DropReason::AuthFail);
+            return std::nullopt;
+        }
+        if (std::memcmp(expected_x25519, rec->handshake->rs, noise::DHLEN) != 0) {
+            LOG_WARN("verify_handshake_payload #{}: device_pubkey ≠ Noise static key", id);
+            bus_.emit_drop(id, DropReason::AuthFail);
+            return std::nullopt;
+        }
     }
 
-    const auto peer_schemes = hp->get_schemes();
-    const auto peer_meta    = hp->core_meta;
+    PeerHello hello;
+    std::memcpy(hello.user_pubkey,   hp->user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
+    std::memcpy(hello.device_pubkey, hp->device_pubkey, GN_SIGN_PUBLICKEYBYTES);
+    hello.schemes   = hp->get_schemes();
+    hello.core_meta = hp->core_meta;
+
+    if ((hello.core_meta.caps_mask & CORE_CAP_ZSTD_DICT) && len > sizeof(msg::HandshakePayload)) {
+        const uint8_t* ext   = data + sizeof(msg::HandshakePayload);
+        const size_t   avail = (len - sizeof(msg::HandshakePayload) - 1) / sizeof(uint32_t);
+        const size_t   n     = std::min<size_t>({ext[0], avail, msg::HANDSHAKE_MAX_DICTS});
+        hello.dict_ids.resize(n);
+        std::memcpy(hello.dict_ids.data(), ext + 1, n * sizeof(uint32_t));
+    }
+    return hello;
+}
 
-    {
-        std::lock_guard wlk(records_write_mu_);
-        rcu_update([&](RecordMap& m) {
-            auto it = m.find(id);
-            if (it == m.end()) return;
-            auto& r = *it->second;
-            std::memcpy(r.peer_user_pubkey,   hp->user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
-            std::memcpy(r.peer_device_pubkey, hp->device_pubkey, GN_SIGN_PUBLICKEYBYTES);
-            r.peer_authenticated = true;
-            r.peer_schemes       = peer_schemes;
-            r.peer_core_meta     = peer_meta;
-            r.negotiated_scheme  = negotiate_scheme(r);
-
-            // Обновляем первичный TransportPath после negotiate
-            if (!r.transport_paths.empty()) {
-                auto& tp = r.transport_paths[0];
-                tp.scheme   = r.negotiated_scheme.empty() ? "tcp" : r.negotiated_scheme;
-                tp.priority = scheme_priority_index(tp.scheme);
-            }
-        });
+void ConnectionManager::Impl::bind_peer(ConnectionRecord& r, PeerHello&& hello) {
+    std::memcpy(r.peer_user_pubkey,   hello.user_pubkey,   GN_SIGN_PUBLICKEYBYTES);
+    std::memcpy(r.peer_device_pubkey, hello.device_pubkey, GN_SIGN_PUBLICKEYBYTES);
+    r.peer_authenticated = true;
+    r.peer_schemes       = std::move(hello.schemes);
+    r.peer_core_meta     = hello.core_meta;
+    r.peer_dict_ids      = std::move(hello.dict_ids);
+    r.negotiated_scheme  = negotiate_scheme(r);
+
+    // Обновляем первичный TransportPath после negotiate
+    if (!r.transport_paths.empty()) {
+        auto& tp = r.transport_paths[0];
+        tp.scheme   = r.negotiated_scheme.empty() ? "tcp" : r.negotiated_scheme;
+        tp.priority = scheme_priority_index(tp.scheme);
     }
+}
 
+bool ConnectionManager::Impl::process_handshake_payload(conn_id_t id,
+                                                         const uint8_t* data,
+                                                         size_t len) {
+    auto hello = verify_handshake_payload(id, data, len);
+    if (!hello) return false;
+
+    std::lock_guard wlk(records_write_mu_);
+    rcu_update([&](RecordMap& m) {
+        if (auto it = m.find(id); it != m.end())
+            bind_peer(*it->second, std::move(*hello));
+    });
     return true;
 }
 
-void ConnectionManager::Impl::finalize_handshake(conn_id_t id) {
+std::unique_ptr<NoiseSession> ConnectionManager::Impl::derive_session(
+        ConnectionRecord& rec, const msg::CoreMeta& peer_meta) {
+    noise::CipherState c_send, c_recv;
+    rec.handshake->split(c_send, c_recv);
+
+    auto session = std::make_unique<NoiseSession>();
+    std::memcpy(session->send_key, c_send.key, noise::KEYLEN);
+    std::memcpy(session->recv_key, c_recv.key, noise::KEYLEN);
+    rec.handshake->get_handshake_hash(session->handshake_hash);
+    if (config_)
+        session->recv_window.configure(std::max(
+            static_cast<size_t>(std::max(config_->security.replay_window, 0)),
+            NonceWindow::MIN_CONFIG_WINDOW));
+
+    // Cipher suite: AES-256-GCM только если обе стороны объявили его в CoreMeta —
+    // правило симметрично, обе стороны выбирают одно и то же без лишнего обмена
+    const uint32_t common = local_core_meta().caps_mask & peer_meta.caps_mask;
+    if (common & CORE_CAP_AES256GCM)
+        session->set_cipher(AeadCipher::Aes256Gcm);
+
+    c_send.clear();
+    c_recv.clear();
+    return session;
+}
+
+void ConnectionManager::Impl::finalize_handshake(conn_id_t id,
+                                                 std::unique_ptr<NoiseSession> session) {
     auto rec = rcu_find(id);
     if (!rec || !rec->handshake) return;
 
@@ -186,7 +491,10 @@ void ConnectionManager::Impl::finalize_handshake(conn_id_t id) {
             close_now(id);
             {
                 std::lock_guard wlk(records_write_mu_);
-                rcu_update([&](RecordMap& m) { m.erase(id); });
+                rcu_update([&](RecordMap& m) {
+                    if (m.erase(id))
+                        handshakes_active_.fetch_sub(1, std::memory_order_relaxed);
+                });
             }
             { std::unique_lock lk2(queues_mu_); send_queues_.erase(id); }
             {
@@ -200,16 +508,11 @@ void ConnectionManager::Impl::finalize_handshake(conn_id_t id) {
     }
 
     // Split → transport keys
-    noise::CipherState c_send, c_recv;
-    rec->handshake->split(c_send, c_recv);
+    if (!session) session = derive_session(*rec, rec->peer_core_meta);
 
-    auto session = std::make_unique<NoiseSession>();
-    std::memcpy(session->send_key, c_send.key, noise::KEYLEN);
-    std::memcpy(session->recv_key, c_recv.key, noise::KEYLEN);
-    rec->handshake->get_handshake_hash(session->handshake_hash);
-
-    c_send.clear();
-    c_recv.clear();
+    // Identity проверена (или уже была в кэше) — следующий handshake её не проверяет
+    remember_peer(*rec, rec->handshake->rs);
+    const bool resumed = rec->handshake->pattern == noise::Pattern::IK;
 
     {
         std::lock_guard wlk(records_write_mu_);
@@ -218,6 +521,9 @@ void ConnectionManager::Impl::finalize_handshake(conn_id_t id) {
             if (it == m.end()) return;
             auto& r = *it->second;
             r.session = std::move(session);
+            r.resumed = resumed;
+            if (r.handshake)
+                handshakes_active_.fetch_sub(1, std::memory_order_relaxed);
             r.handshake.reset();
             r.state = STATE_ESTABLISHED;
             if (r.is_localhost)
@@ -227,9 +533,10 @@ void ConnectionManager::Impl::finalize_handshake(conn_id_t id) {
         pk_index_[bytes_to_hex(rec->peer_user_pubkey, crypto_sign_PUBLICKEYBYTES)] = id;
     }
 
-    LOG_INFO("Noise_XX #{}: peer={}... scheme='{}' → ESTABLISHED",
-             id, bytes_to_hex(rec->peer_user_pubkey, 4),
-             rec->negotiated_scheme.empty() ? "?" : rec->negotiated_scheme);
+    LOG_INFO("Noise_{} #{}: peer={}... scheme='{}' cipher={} → ESTABLISHED",
+             resumed ? "IK" : "XX", id, bytes_to_hex(rec->peer_user_pubkey, 4),
+             rec->negotiated_scheme.empty() ? "?" : rec->negotiated_scheme,
+             rec->session ? aead_name(rec->session->cipher()) : "?");
 
     // Flush pending messages для этого URI
     const std::string uri_key = std::string(rec->remote.address) + ":"
@@ -429,4 +736,145 @@ void ConnectionManager::Impl::handle_noise_fin(conn_id_t id,
     finalize_handshake(id);
 }
 
+// ═══════════════════════════════════════════════════════════════════════════════
+// handle_noise_resume / resume_resp (Noise_IK, 1-RTT)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void ConnectionManager::Impl::handle_noise_resume(conn_id_t id,
+                                                    std::span<const uint8_t> payload) {
+    LOG_SCOPE_DEBUG();
+
+    auto rec = rcu_find(id);
+    if (!rec || !rec->handshake) {
+        LOG_WARN("handle_noise_resume #{}: no handshake state", id);
+        return;
+    }
+    if (rec->handshake->initiator || rec->handshake->step != 0) {
+        LOG_WARN("handle_noise_resume #{}: unexpected RESUME", id);
+        return;
+    }
+
+    // Responder переключается на IK: pre-message — собственный static key
+    auto reinit = [&](noise::Pattern p) {
+        std::shared_lock lk(identity_mu_);
+        rec->handshake->init(false, local_static_.x25519_pk, local_static_.x25519_sk, p);
+    };
+
+    // Отказ (resumption выключен, static key сменился после ротации identity):
+    // пустой RESUME_RESP — инициатор повторяет с полного Noise_XX
+    auto refuse = [&]([[maybe_unused]] const char* why) {
+        LOG_DEBUG("handle_noise_resume #{}: refused ({}) — falling back to XX", id, why);
+        reinit(noise::Pattern::XX);
+        send_frame(id, MSG_TYPE_NOISE_RESUME_RESP, {});
+    };
+    if (!resumption_enabled()) { refuse("disabled"); return; }
+
+    // Responder reads msg1 (→ e, es, s, ss)
+    reinit(noise::Pattern::IK);
+    std::vector<uint8_t> payload_out(payload.size());
+    size_t payload_len = 0;
+    if (!rec->handshake->read_message(payload.data(), payload.size(),
+                                       payload_out.data(), &payload_len)) {
+        refuse("read_message");
+        return;
+    }
+
+    // msg1 можно переиграть с чужого соединения: он читается без ключей
+    // инициатора. Payload проверяем сейчас, а identity привязываем только
+    // после первого кадра, который расшифруется новыми ключами (dispatch_packet) —
+    // его может прислать лишь владелец ephemeral-ключа
+    auto hello = verify_handshake_payload(id, payload_out.data(), payload_len);
+    if (!hello) {
+        close_now(id);
+        return;
+    }
+
+    // Responder writes msg2 (← e, ee, se) with HandshakePayload
+    auto hp_bytes = build_handshake_payload();
+
+    std::vector<uint8_t> msg2(noise::DHLEN + noise::MACLEN + hp_bytes.size());
+    size_t msg2_len = 0;
+    if (!rec->handshake->write_message(hp_bytes.data(), hp_bytes.size(),
+                                        msg2.data(), &msg2_len)) {
+        LOG_WARN("handle_noise_resume #{}: write_message msg2 failed", id);
+        close_now(id);
+        return;
+    }
+    msg2.resize(msg2_len);
+
+    send_frame(id, MSG_TYPE_NOISE_RESUME_RESP, std::span<const uint8_t>(msg2));
+    LOG_DEBUG("handle_noise_resume #{}: sent RESUME_RESP ({} bytes)", id, msg2_len);
+
+    // Localhost без шифрования — сразу
+    if (rec->is_localhost) {
+        {
+            std::lock_guard wlk(records_write_mu_);
+            rcu_update([&](RecordMap& m) {
+                if (auto it = m.find(id); it != m.end())
+                    bind_peer(*it->second, std::move(*hello));
+            });
+        }
+        finalize_handshake(id);
+        return;
+    }
+    auto pending = std::make_unique<ConnectionRecord::PendingResume>();
+    pending->session = derive_session(*rec, hello->core_meta);
+    pending->peer    = std::move(*hello);
+    std::lock_guard wlk(records_write_mu_);
+    rcu_update([&](RecordMap& m) {
+        if (auto it = m.find(id); it != m.end())
+            it->second->resume = std::move(pending);
+    });
+}
+
+void ConnectionManager::Impl::handle_noise_resume_resp(conn_id_t id,
+                                                         std::span<const uint8_t> payload) {
+    LOG_SCOPE_DEBUG();
+
+    auto rec = rcu_find(id);
+    if (!rec || !rec->handshake) {
+        LOG_WARN("handle_noise_resume_resp #{}: no handshake state", id);
+        return;
+    }
+    if (!rec->handshake->initiator || rec->handshake->pattern != noise::Pattern::IK
+        || rec->handshake->step != 1) {
+        LOG_WARN("handle_noise_resume_resp #{}: unexpected RESUME_RESP", id);
+        return;
+    }
+
+    // Пир отказал — забываем адрес и повторяем полным Noise_XX по тому же соединению
+    if (payload.empty()) {
+        forget_peer_address(std::string(rec->remote.address) + ":"
+                            + std::to_string(rec->remote.port));
+        {
+            std::shared_lock lk(identity_mu_);
+            rec->handshake->init(true, local_static_.x25519_pk, local_static_.x25519_sk);
+        }
+        LOG_INFO("handle_noise_resume_resp #{}: resumption refused — full handshake", id);
+        send_noise_init(id);
+        return;
+    }
+
+    // Initiator reads msg2 (← e, ee, se)
+    std::vector<uint8_t> payload_out(payload.size());
+    size_t payload_len = 0;
+    if (!rec->handshake->read_message(payload.data(), payload.size(),
+                                       payload_out.data(), &payload_len)) {
+        LOG_WARN("handle_noise_resume_resp #{}: read_message failed", id);
+        bus_.emit_drop(id, DropReason::AuthFail);
+        close_now(id);
+        return;
+    }
+
+    if (!process_handshake_payload(id, payload_out.data(), payload_len)) {
+        close_now(id);
+        return;
+    }
+
+    // Initiator done → finalize; heartbeat сразу подтверждает ключи ответчику
+    finalize_handshake(id);
+    if (auto r = rcu_find(id); r && r->state == STATE_ESTABLISHED && !r->is_localhost)
+        send_heartbeat(id);
+}
+
 } // namespace gn
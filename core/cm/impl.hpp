@@ -7,10 +7,18 @@
 #include "signals.hpp"
 #include "types/connection.hpp"
 #include "types/pending.hpp"
+#include "types/mpsc_ring.hpp"
+#include "types/path_scheduler.hpp"
+#include "../sdk/cpp/buffer_pool.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -21,41 +29,244 @@ namespace gn {
 // ── PerConnQueue ──────────────────────────────────────────────────────────────
 
 /// Per-connection outbound frame queue with independent backpressure limit.
+/// Frames are pooled buffers (sdk::FrameBuffer) — no malloc per frame after warmup.
+///
+/// Producers (any sender thread) push lock-free into a bounded MPSC ring per
+/// SendClass; the byte budget is reserved up-front in `pending_bytes`, so
+/// MAX_BYTES holds even under concurrent pushes.  `draining` is the
+/// single-consumer token: only the thread that wins try_begin_drain() pops frames.
+/// `flush_scheduled` guards the async path: at most one flush task per
+/// connection is pending on the core io_context.
+///
+/// Credit-based flow control: the send window covers both `pending_bytes`
+/// and `in_flight` — bytes handed to a CONNECTOR_FLAG_REPORTS_SENT connector
+/// that it has not yet confirmed via host_api_t::on_sent().  A rejected push
+/// arms `want_writable`; the core fires SignalBus::on_writable once the
+/// window reopens past WRITABLE_LOW_WATER.  A fragmented message that does
+/// not fit is parked here (`parked`) and resumed by the core as the window
+/// reopens — the sender never blocks and a message is never cut off mid-way.
+///
+/// QoS: pop_batch() drains SendClass::Control with strict priority (and
+/// Control is exempt from the byte window, so heartbeats never wait behind
+/// bulk data), the other classes by weighted round-robin (DRAIN_WEIGHT).
+/// packet_id (the AEAD nonce) is assigned when a frame is built, before it
+/// is queued, so the drain order is the order the peer sees nonces in: a
+/// frame never leaves after one MAX_REORDER packet_ids newer than it, so
+/// it stays inside the peer's replay window whatever security.replay_window
+/// the peer runs with (never below NonceWindow::MIN_CONFIG_WINDOW).
+/// Queued frames per class are mirrored into SignalBus::add_queue_depth().
 struct PerConnQueue {
     static constexpr size_t MAX_BYTES = 8 * 1024 * 1024;  // 8 MB per-conn
+    static constexpr size_t MAX_FRAMES = 1024;            // ring slots per class
+    static constexpr size_t WRITABLE_LOW_WATER = MAX_BYTES / 2; ///< Hysteresis for on_writable
+    static constexpr size_t MAX_PARKED_BYTES = 64 * 1024 * 1024;  ///< Parked message bytes per conn
+    static constexpr size_t NUM_CLASSES = static_cast<size_t>(SendClass::_Count);
 
-    std::mutex               mu;
-    std::vector<std::vector<uint8_t>> frames;
+    /// Frames per weighted round for Interactive / Bulk / Relay (Control — strict).
+    static constexpr uint32_t DRAIN_WEIGHT[NUM_CLASSES] = {0, 8, 2, 4};
+    /// Max packet_id distance a frame may be overtaken by (half the smallest
+    /// replay window a peer may configure).
+    static constexpr uint64_t MAX_REORDER = NonceWindow::MIN_CONFIG_WINDOW / 2;
+
+    using Ring = MpscRing<sdk::FrameBuffer, MAX_FRAMES>;
+
+    Ring                     rings[NUM_CLASSES];
+    SignalBus*               bus = nullptr;       ///< queue_depth gauge (nullable)
     std::atomic<size_t>      pending_bytes{0};
+    std::atomic<size_t>      in_flight{0};
     std::atomic<bool>        draining{false};
+    std::atomic<bool>        flush_scheduled{false};
+    std::atomic<bool>        want_writable{false};
+
+    /// Unsent tail of a fragmented message (send_fragmented), in send order.
+    struct ParkedMessage {
+        std::vector<uint8_t> rest;                 ///< Bytes from `base` on
+        uint64_t             base     = 0;         ///< Message offset of rest[0]
+        size_t               pos      = 0;         ///< Sent bytes of `rest`
+        uint32_t             msg_type = 0;
+        SendClass            cls      = SendClass::Bulk;
+        bool                 raw      = false;     ///< Peer lacks CORE_CAP_FRAGMENT
+        frag_hdr_t           fh{};                 ///< msg_id / total_len
+    };
+    std::mutex                parked_mu;
+    std::deque<ParkedMessage> parked;              ///< parked_mu; only resume_parked() pops
+    size_t                    parked_bytes = 0;    ///< parked_mu
+    std::atomic<bool>         has_parked{false};
+    std::atomic<bool>         parked_running{false}; ///< One resume_parked() at a time
+
+    PerConnQueue() = default;
+    explicit PerConnQueue(SignalBus* b) : bus(b) {}
+    PerConnQueue(const PerConnQueue&)            = delete;
+    PerConnQueue& operator=(const PerConnQueue&) = delete;
+
+    /// Кадры, не ушедшие до закрытия соединения, снимаем с gauge здесь:
+    /// flush-задача может держать shared_ptr дольше, чем send_queues_.
+    ~PerConnQueue() {
+        if (!bus) return;
+        for (size_t c = 0; c < NUM_CLASSES; ++c)
+            if (const size_t n = rings[c].size_approx())
+                bus->add_queue_depth(static_cast<SendClass>(c), -static_cast<int64_t>(n));
+    }
 
-    /// @brief Atomically reserve space and enqueue a frame.
-    /// @return false if backpressure limit would be exceeded.
-    bool try_push(std::vector<uint8_t> frame) {
+    /// @brief Bytes that can still be queued.
+    size_t window() const noexcept {
+        const size_t used = pending_bytes.load(std::memory_order_relaxed)
+                          + in_flight.load(std::memory_order_relaxed);
+        return used >= MAX_BYTES ? 0 : MAX_BYTES - used;
+    }
+
+    /// @brief Atomically reserve space and enqueue a frame into class @p cls.
+    /// @return false if the window or the slot count would be exceeded
+    ///         (arms want_writable).
+    bool try_push(sdk::FrameBuffer frame, SendClass cls = SendClass::Interactive) {
         const size_t sz = frame.size();
         const size_t prev = pending_bytes.fetch_add(sz, std::memory_order_relaxed);
-        if (prev + sz > MAX_BYTES) {
+        const bool over = cls != SendClass::Control
+            && prev + sz + in_flight.load(std::memory_order_relaxed) > MAX_BYTES;
+        if (over || !rings[static_cast<size_t>(cls)].push(std::move(frame))) {
             pending_bytes.fetch_sub(sz, std::memory_order_relaxed);
+            want_writable.store(true, std::memory_order_release);
             return false;
         }
-        std::lock_guard lock(mu);
-        frames.push_back(std::move(frame));
+        if (bus) bus->add_queue_depth(cls, 1);
         return true;
     }
 
-    /// @brief Dequeue up to @p max_frames frames, decrementing pending_bytes.
-    std::vector<std::vector<uint8_t>> drain_batch(size_t max_frames = 64) {
-        std::lock_guard lock(mu);
-        size_t n = std::min(frames.size(), max_frames);
-        std::vector<std::vector<uint8_t>> batch(
-            std::make_move_iterator(frames.begin()),
-            std::make_move_iterator(frames.begin() + static_cast<ptrdiff_t>(n)));
-        frames.erase(frames.begin(), frames.begin() + static_cast<ptrdiff_t>(n));
+    /// @brief Enqueue a copy of raw frame bytes (pooled).
+    bool try_push(std::span<const uint8_t> bytes, SendClass cls = SendClass::Interactive) {
+        if (cls != SendClass::Control && bytes.size() > window()) {
+            want_writable.store(true, std::memory_order_release);
+            return false;
+        }
+        return try_push(sdk::FrameBuffer::copy_of(bytes), cls);
+    }
+
+    /// @brief Return @p bytes of connector credit (clamped at zero).
+    void credit(size_t bytes) noexcept {
+        size_t cur = in_flight.load(std::memory_order_relaxed);
+        while (!in_flight.compare_exchange_weak(cur, cur > bytes ? cur - bytes : 0,
+                                                std::memory_order_relaxed)) {}
+    }
+
+    /// @brief true once per rejected push when the window has reopened.
+    bool take_writable() noexcept {
+        return window() >= WRITABLE_LOW_WATER
+            && want_writable.load(std::memory_order_relaxed)
+            && want_writable.exchange(false, std::memory_order_acq_rel);
+    }
+
+    /// @brief Claim the consumer role. @return false if another thread drains.
+    bool try_begin_drain() {
+        // Пара к fence в end_drain(): публикация кадра продюсером либо видна
+        // уходящему дренеру, либо продюсер сам получает draining.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool expected = false;
+        return draining.compare_exchange_strong(expected, true,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed);
+    }
+
+    /// @brief Release the consumer role.
+    /// @return true if frames were published meanwhile — caller should retry.
+    bool end_drain() {
+        draining.store(false, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return ready();
+    }
+
+    /// @brief true if any class has a published frame.
+    bool ready() const {
+        for (auto& r : rings)
+            if (r.ready()) return true;
+        return false;
+    }
+
+    /// @brief Frames currently queued in class @p cls (approximate).
+    size_t depth(SendClass cls) const {
+        return rings[static_cast<size_t>(cls)].size_approx();
+    }
+
+    /// @brief Pop up to @p max_frames frames. Caller must hold the drain token.
+    /// @details Control уходит первым и перепроверяется каждый раунд —
+    ///          heartbeat, опубликованный посреди большого drain, не ждёт bulk.
+    std::vector<sdk::FrameBuffer> pop_batch(size_t max_frames = 64) {
+        std::vector<sdk::FrameBuffer> batch;
+        size_t queued = 0;
+        for (auto& r : rings) queued += r.size_approx();
+        batch.reserve(std::min(max_frames, queued));
+
         size_t bytes = 0;
-        for (auto& f : batch) bytes += f.size();
+        size_t popped[NUM_CLASSES]{};
+        sdk::FrameBuffer f;
+        auto pop_one = [&](size_t cls) {
+            if (!rings[cls].pop(f)) return false;
+            bytes += f.size();
+            batch.push_back(std::move(f));
+            ++popped[cls];
+            return true;
+        };
+        // Голова другого класса, старше этого кадра на MAX_REORDER packet_id,
+        // уходит раньше него — иначе приёмник отбросит её как replay
+        auto pop_ordered = [&](size_t cls) {
+            const auto* head = rings[cls].peek();
+            if (!head) return false;
+            const uint64_t id = packet_id_of(*head);
+            while (id != NO_PACKET_ID) {
+                size_t   oldest    = NUM_CLASSES;
+                uint64_t oldest_id = id;
+                for (size_t c = 0; c < NUM_CLASSES; ++c) {
+                    const auto*    h   = c == cls ? nullptr : rings[c].peek();
+                    const uint64_t hid = h ? packet_id_of(*h) : NO_PACKET_ID;
+                    if (hid != NO_PACKET_ID && hid + MAX_REORDER <= id && hid < oldest_id) {
+                        oldest    = c;
+                        oldest_id = hid;
+                    }
+                }
+                if (oldest == NUM_CLASSES) break;
+                pop_one(oldest);
+                if (batch.size() >= max_frames) return false;
+            }
+            return pop_one(cls);
+        };
+        auto take = [&](size_t cls, size_t limit) {
+            size_t n = 0;
+            while (n < limit && batch.size() < max_frames && pop_ordered(cls)) ++n;
+        };
+
+        for (;;) {
+            const size_t before = batch.size();
+            take(static_cast<size_t>(SendClass::Control), max_frames);
+            for (size_t c = 0; c < NUM_CLASSES; ++c)
+                if (DRAIN_WEIGHT[c]) take(c, DRAIN_WEIGHT[c]);
+            if (batch.size() == before || batch.size() >= max_frames) break;
+        }
+        if (bus)
+            for (size_t c = 0; c < NUM_CLASSES; ++c)
+                if (popped[c])
+                    bus->add_queue_depth(static_cast<SendClass>(c),
+                                         -static_cast<int64_t>(popped[c]));
         pending_bytes.fetch_sub(bytes, std::memory_order_relaxed);
         return batch;
     }
+
+    static constexpr uint64_t NO_PACKET_ID = ~uint64_t{0};
+
+    /// @brief packet_id from the frame's header_t, NO_PACKET_ID if it has none.
+    static uint64_t packet_id_of(const sdk::FrameBuffer& f) noexcept {
+        if (f.size() < sizeof(header_t)) return NO_PACKET_ID;
+        header_t hdr;
+        std::memcpy(&hdr, f.data(), sizeof(hdr));
+        return hdr.magic == GNET_MAGIC ? hdr.packet_id : NO_PACKET_ID;
+    }
+
+    /// @brief Dequeue up to @p max_frames frames, decrementing pending_bytes.
+    /// @return Empty if another thread currently holds the drain token.
+    std::vector<sdk::FrameBuffer> drain_batch(size_t max_frames = 64) {
+        if (!try_begin_drain()) return {};
+        auto batch = pop_batch(max_frames);
+        end_drain();
+        return batch;
+    }
 };
 
 // ── ConnectionManager::Impl ──────────────────────────────────────────────────
@@ -96,7 +307,14 @@ struct ConnectionManager::Impl {
     std::unordered_map<conn_id_t, std::shared_ptr<PerConnQueue>> send_queues_;
 
     std::shared_ptr<PerConnQueue> get_or_create_queue(conn_id_t id);
+    std::shared_ptr<PerConnQueue> find_queue(conn_id_t id) const;
+    void schedule_flush(conn_id_t id, std::shared_ptr<PerConnQueue> q);
     void flush_queue(conn_id_t id, PerConnQueue& q);
+    /// flush_queue() without the shutdown check — shutdown() drains through it.
+    void drain_queue(conn_id_t id, PerConnQueue& q);
+
+    /// Executor for async flushes (Core's io_context); nullptr = inline flush.
+    std::atomic<boost::asio::io_context*> flush_ioc_{nullptr};
 
     // ── Relay dedup ─────────────────────────────────────────────────────────
 
@@ -129,6 +347,17 @@ struct ConnectionManager::Impl {
     mutable std::shared_mutex identity_mu_;
     NodeIdentity              identity_;
 
+    /// Ключевой материал handshake, производный от identity_ (под identity_mu_):
+    /// Ed25519→X25519 и подпись HandshakePayload считаются один раз, а не на
+    /// каждое соединение. Пересчитывается в rotate_identity_keys().
+    struct LocalStatic {
+        uint8_t x25519_pk[noise::DHLEN]{};
+        uint8_t x25519_sk[noise::DHLEN]{};
+        uint8_t signature[GN_SIGN_BYTES]{};  ///< Ed25519(user_sk, user_pk || device_pk)
+    };
+    LocalStatic local_static_;
+    void derive_local_static();              ///< Caller holds identity_mu_ exclusively
+
     std::atomic<bool>      shutting_down_{false};
     std::atomic<conn_id_t> next_id_{1};
     std::atomic<uint32_t>  in_flight_dispatches_{0}; ///< Shutdown barrier counter
@@ -151,6 +380,28 @@ struct ConnectionManager::Impl {
     mutable std::shared_mutex pk_mu_;
     std::unordered_map<std::string, conn_id_t> pk_index_;
 
+    // ── Peer identity cache (resumption) ────────────────────────────────────
+
+    /// Identity пира, прошедшая полную проверку (подпись + Ed25519→X25519 == rs).
+    /// Повторный handshake с тем же (user_pk, device_pk, rs) проверку пропускает;
+    /// исходящее соединение на запомненный адрес идёт 1-RTT Noise_IK.
+    struct PeerCacheEntry {
+        uint8_t  device_pubkey[GN_SIGN_PUBLICKEYBYTES]{};
+        uint8_t  static_x25519[noise::DHLEN]{};   ///< Noise static key пира
+        uint32_t caps = 0;                         ///< CoreMeta последнего handshake
+        std::chrono::steady_clock::time_point seen;
+    };
+
+    mutable std::shared_mutex peer_cache_mu_;
+    std::unordered_map<std::string, PeerCacheEntry> peer_cache_;      ///< user_pubkey hex → identity
+    std::unordered_map<std::string, std::string>    peer_addr_cache_; ///< "addr:port" (исходящие) → user_pubkey hex
+
+    bool peer_identity_cached(const msg::HandshakePayload& hp, const uint8_t rs[noise::DHLEN]) const;
+    void remember_peer(const ConnectionRecord& rec, const uint8_t rs[noise::DHLEN]);
+    void forget_peer_address(const std::string& addr_key);
+    std::optional<PeerCacheEntry> resume_target(const std::string& addr_key) const;
+    bool resumption_enabled() const noexcept;
+
     /// transport_conn_id → peer conn_id (для вторичных транспортов).
     /// Для первичного пути transport_conn_id == ConnectionRecord::id.
     mutable std::shared_mutex transport_mu_;
@@ -163,11 +414,61 @@ struct ConnectionManager::Impl {
         return 255;
     }
 
+    // ── QoS class overrides (RCU: читается на каждом send_frame) ─────────────
+
+    using SendClassMap = std::unordered_map<uint32_t, SendClass>;
+    std::atomic<std::shared_ptr<const SendClassMap>> send_class_overrides_;
+    std::mutex                                       send_class_mu_;  ///< writers only
+
+    // ── Multipath (RCU: планировщик читается на каждом flush) ─────────────────
+
+    std::atomic<std::shared_ptr<PathScheduler>> path_scheduler_;
+    std::atomic<bool>                           multipath_stripe_{false};
+
+    // ── zstd dictionaries (снапшот читается на каждом build_frame / decrypt) ──
+
+    ZstdDictionaries dicts_;                   ///< Уровень — compression.level
+    bool             dict_sampling_ = false;   ///< compression.dictionaries
+
+    // ── Fragment streaming (msg types delivered per fragment) ────────────────
+
+    mutable std::shared_mutex    frag_stream_mu_;
+    std::unordered_set<uint32_t> frag_stream_types_;
+
     // ── Pending messages ────────────────────────────────────────────────────
 
     mutable std::shared_mutex pending_mu_;
     std::unordered_map<std::string, std::vector<PendingMessage>> pending_messages_;
 
+    // ── Handshake offload + admission control ───────────────────────────────
+
+    std::atomic<uint32_t> handshakes_active_{0};  ///< Records still holding a HandshakeState
+
+    /// Token bucket входящих handshake одного адреса (core.handshake_rate_per_ip).
+    struct AdmissionBucket {
+        double tokens = 0;
+        std::chrono::steady_clock::time_point last;
+    };
+    std::mutex                                       admission_mu_;
+    std::unordered_map<std::string, AdmissionBucket> admission_buckets_;  ///< remote address → bucket
+
+    /// Пул Noise handshake (start_handshake_pool); nullptr = handshake inline
+    /// на IO-потоке. Последний член Impl: при разрушении воркеры
+    /// останавливаются раньше, чем умирают данные, которые трогают их задачи.
+    std::unique_ptr<WorkerPool> hs_pool_owner_;
+    std::atomic<WorkerPool*>    hs_pool_{nullptr};
+
+    void start_handshake_pool(size_t threads);
+    bool admit_connection(const endpoint_t& ep);
+    void expire_admission_buckets();
+    /// Close connections stuck in the handshake past HANDSHAKE_TIMEOUT.
+    void expire_handshakes();
+    /// Run @p step (send_noise_init / _resume) in the connection's lane, or inline.
+    void run_handshake_step(const ConnectionRecord& rec, WorkerPool::Task step);
+    /// @return true if the frame was queued on the lane (or the connection was shed).
+    bool offload_handshake(const ConnectionRecord& rec, conn_id_t id, const header_t* hdr,
+                           std::span<const uint8_t> payload, uint64_t recv_ts_ns);
+
     // ── Constants ───────────────────────────────────────────────────────────
 
     static constexpr auto     PENDING_TTL           = std::chrono::seconds(30);
@@ -177,6 +478,15 @@ struct ConnectionManager::Impl {
     static constexpr size_t   GLOBAL_MAX_IN_FLIGHT  = 512UL * 1024 * 1024;
     static constexpr size_t   CHUNK_SIZE            = 1UL   * 1024 * 1024;
     static constexpr size_t   MAX_RECV_BUF          = 16UL  * 1024 * 1024; ///< 16 MB per-connection
+    static constexpr size_t   FLUSH_MAX_FRAMES      = 1024; ///< Frames per send_gather (IOV_MAX на Linux)
+    static constexpr size_t   FRAGMENT_THRESHOLD    = CHUNK_SIZE * 2;       ///< Larger payloads are fragmented
+    static constexpr size_t   MAX_REASSEMBLY_BYTES  = 64UL  * 1024 * 1024;  ///< Partial messages per connection
+    static constexpr auto     REASSEMBLY_TIMEOUT    = std::chrono::seconds(30);
+    static constexpr auto     REORDER_TIMEOUT       = std::chrono::milliseconds(100); ///< Striped gap wait
+    static constexpr size_t   BROADCAST_PARALLEL_MIN = 32;  ///< Peers below this fan out inline
+    static constexpr size_t   BROADCAST_CHUNK        = 64;  ///< Peers per fan-out task
+    static constexpr size_t   HANDSHAKE_QUEUE_MAX    = 4096; ///< Frames waiting for handshake workers
+    static constexpr auto     HANDSHAKE_TIMEOUT      = std::chrono::seconds(10); ///< Unfinished handshake lifetime
 
     // ── Public API implementation ───────────────────────────────────────────
 
@@ -188,9 +498,35 @@ struct ConnectionManager::Impl {
     void set_scheme_priority(std::vector<std::string> priority);
     void fill_host_api(host_api_t* api);
 
-    bool send(std::string_view uri, uint32_t msg_type, std::span<const uint8_t> payload);
-    bool send(conn_id_t id, uint32_t msg_type, std::span<const uint8_t> payload);
-    void broadcast(uint32_t msg_type, std::span<const uint8_t> payload);
+    bool send(std::string_view uri, uint32_t msg_type, std::span<const uint8_t> payload,
+              SendClass cls = SendClass::Auto);
+    bool send(conn_id_t id, uint32_t msg_type, std::span<const uint8_t> payload,
+              SendClass cls = SendClass::Auto);
+    BroadcastHandle broadcast(uint32_t msg_type, std::span<const uint8_t> payload,
+                              SendClass cls = SendClass::Auto);
+
+    // QoS classes
+    void             set_send_class(uint32_t msg_type, SendClass cls);
+    SendClass        send_class_of(uint32_t msg_type) const noexcept;
+    static SendClass default_send_class(uint32_t msg_type) noexcept;
+
+    // Fragmentation
+    void set_fragment_streaming(uint32_t msg_type, bool on);
+    bool is_fragment_streaming(uint32_t msg_type) const;
+
+    // Compression dictionaries
+    uint32_t add_compression_dictionary(uint32_t msg_type, std::span<const uint8_t> content);
+    size_t   train_compression_dictionaries();
+    Codec codec_for_peer(const ConnectionRecord& rec) const noexcept;
+    std::shared_ptr<const ZstdDict> dict_for_peer(const ConnectionRecord& rec,
+                                                  uint32_t msg_type) const;
+
+    // Multipath
+    void set_path_scheduler(std::shared_ptr<PathScheduler> s);
+    void set_multipath_striping(bool on) noexcept;
+    bool should_stripe(const ConnectionRecord& rec) const noexcept;
+    bool ordered_delivery(const ConnectionRecord& rec) const noexcept;
+    bool stream_compression(const ConnectionRecord& rec) const noexcept;
 
     void connect(std::string_view uri);
     void disconnect(conn_id_t id);
@@ -199,6 +535,9 @@ struct ConnectionManager::Impl {
 
     void rotate_identity_keys(const Config::Identity& cfg);
     bool rekey_session(conn_id_t id);
+    /// Rotate the send key once security.rekey_after_* is reached (peer with
+    /// CORE_CAP_KEY_EPOCH only). Called by build_frame after sealing.
+    void maybe_rekey(conn_id_t id, ConnectionRecord& rec);
 
     void relay(conn_id_t exclude_conn, uint8_t ttl,
                const uint8_t dest_pubkey[GN_SIGN_PUBLICKEYBYTES],
@@ -206,6 +545,7 @@ struct ConnectionManager::Impl {
 
     void check_heartbeat_timeouts();
     void cleanup_stale_pending();
+    void expire_reassembly();
 
     size_t                      connection_count() const;
     std::vector<std::string>    get_active_uris() const;
@@ -217,6 +557,7 @@ struct ConnectionManager::Impl {
     std::optional<endpoint_t>   get_peer_endpoint(conn_id_t id) const;
     conn_id_t                   find_conn_by_pubkey(const char* pubkey_hex) const;
     size_t                      get_pending_bytes(conn_id_t id = CONN_ID_INVALID) const noexcept;
+    size_t                      send_window(conn_id_t id) const noexcept;
     std::string                 dump_connections() const;
 
     msg::CoreMeta local_core_meta() const;
@@ -235,27 +576,119 @@ struct ConnectionManager::Impl {
     conn_id_t handle_add_transport(const char* pubkey_hex,
                                     const endpoint_t* ep, const char* scheme);
     void      handle_disconnect(conn_id_t id, int error);
+    void      handle_sent(conn_id_t id, size_t bytes);
     void      handle_data(conn_id_t id, const void* raw, size_t size);
     void      dispatch_packet(conn_id_t id, const header_t* hdr,
                               std::span<const uint8_t> payload, uint64_t recv_ts_ns);
+    void      deliver_to_handlers(conn_id_t id, const ConnectionRecord& rec,
+                                  const header_t& hdr, std::vector<uint8_t> data,
+                                  uint64_t recv_ts_ns);
+    void      deliver_to_handlers(conn_id_t id, const ConnectionRecord& rec,
+                                  PacketData pkt, uint64_t recv_ts_ns);
+    void      frame_stream(conn_id_t peer_id, StreamReassembler& stream,
+                           std::span<const uint8_t> in, uint64_t recv_ts);
+
+    /// Пакеты для хэндлеров, собранные за один handle_data(): уходят в
+    /// SignalBus::dispatch_batch() пачкой подряд идущих кадров одного типа.
+    struct RxBatch {
+        static constexpr size_t MAX = PipelineSignal::MAX_BATCH;
+        const Impl*                 owner    = nullptr;
+        conn_id_t                   id       = CONN_ID_INVALID;
+        uint32_t                    msg_type = 0;
+        bool                        affinity = false;
+        endpoint_t                  remote{};
+        size_t                      count    = 0;
+        std::array<PacketData, MAX> pkts;
+        std::array<uint64_t, MAX>   recv_ts{};
+    };
+    /// Делает @p b текущей пачкой потока; вложенный handle_data() ставит свою.
+    class RxBatchScope {
+    public:
+        explicit RxBatchScope(RxBatch& b);
+        ~RxBatchScope();
+        RxBatchScope(const RxBatchScope&)            = delete;
+        RxBatchScope& operator=(const RxBatchScope&) = delete;
+    private:
+        RxBatch* prev_;
+    };
+    void      flush_rx_batch(RxBatch& b);
+    void      dispatch_to_handlers(conn_id_t id, const endpoint_t& remote, bool affinity,
+                                   uint32_t msg_type, std::span<const PacketData> pkts,
+                                   std::span<const uint64_t> recv_ts);
+    void      handle_fragment(conn_id_t id, ConnectionRecord& rec, const header_t& hdr,
+                              std::span<const uint8_t> plaintext, uint64_t recv_ts_ns);
+    void      handle_striped(conn_id_t id, ConnectionRecord& rec, const header_t& hdr,
+                             std::vector<uint8_t> plaintext, uint64_t recv_ts_ns);
+    void      deliver_reordered(conn_id_t id, ConnectionRecord& rec,
+                                std::vector<StripeReorderBuffer::Frame>& ready);
+    void      arm_reorder_timer(conn_id_t id, ConnectionRecord& rec);
 
     // Noise handshake
+    static constexpr bool is_handshake_msg(uint32_t t) noexcept {
+        return t == MSG_TYPE_NOISE_INIT || t == MSG_TYPE_NOISE_RESP || t == MSG_TYPE_NOISE_FIN
+            || t == MSG_TYPE_NOISE_RESUME || t == MSG_TYPE_NOISE_RESUME_RESP;
+    }
     void send_noise_init(conn_id_t id);
+    void send_noise_resume(conn_id_t id);
     void handle_noise_init(conn_id_t id, std::span<const uint8_t> payload);
     void handle_noise_resp(conn_id_t id, std::span<const uint8_t> payload);
     void handle_noise_fin (conn_id_t id, std::span<const uint8_t> payload);
+    void handle_noise_resume     (conn_id_t id, std::span<const uint8_t> payload);
+    void handle_noise_resume_resp(conn_id_t id, std::span<const uint8_t> payload);
 
     std::vector<uint8_t> build_handshake_payload();
+    /// Verify the peer's HandshakePayload (signature, static key); nullopt = rejected.
+    std::optional<PeerHello> verify_handshake_payload(conn_id_t id, const uint8_t* data,
+                                                      size_t len);
+    /// Bind a verified payload to @p r (peer_*, negotiated scheme).  Under records_write_mu_.
+    void bind_peer(ConnectionRecord& r, PeerHello&& hello);
     bool process_handshake_payload(conn_id_t id, const uint8_t* data, size_t len);
-    void finalize_handshake(conn_id_t id);
+    /// Transport session from the completed handshake state (split()).
+    std::unique_ptr<NoiseSession> derive_session(ConnectionRecord& rec,
+                                                 const msg::CoreMeta& peer_meta);
+    /// @p session — already derived keys (IK responder); nullptr = split() here.
+    void finalize_handshake(conn_id_t id, std::unique_ptr<NoiseSession> session = nullptr);
     void schedule_transport_upgrade(conn_id_t id);
 
     // Transport
-    std::vector<uint8_t> build_frame(conn_id_t id, uint32_t msg_type,
-                                      std::span<const uint8_t> payload);
-    void send_frame(conn_id_t id, uint32_t msg_type, std::span<const uint8_t> payload);
-    bool flush_frames_to_connector(conn_id_t id, connector_ops_t* ops,
-                                    std::vector<std::vector<uint8_t>>& frames);
+    /// @p encoded — тело, заранее подготовленное NoiseSession::encode_body()
+    /// из @p payload (broadcast); при шифровании заменяет сжатие на месте.
+    /// @p stream — сжать блоком потока сессии; вызывающий держит stream.tx_mu
+    /// до постановки кадра в очередь.
+    sdk::FrameBuffer build_frame(conn_id_t id, uint32_t msg_type,
+                                 std::span<const uint8_t> payload, uint8_t flags = 0,
+                                 std::span<const uint8_t> encoded = {},
+                                 bool stream = false);
+    bool send_frame(conn_id_t id, uint32_t msg_type, std::span<const uint8_t> payload,
+                    SendClass cls = SendClass::Auto, uint8_t flags = 0,
+                    std::span<const uint8_t> encoded = {});
+    bool send_message(conn_id_t id, uint32_t msg_type, std::span<const uint8_t> payload,
+                      SendClass cls);
+    bool send_fragmented(conn_id_t id, uint32_t msg_type, std::span<const uint8_t> payload,
+                         SendClass cls);
+    /// One fragment (or raw chunk) of @p m at message offset @p off.
+    bool send_parked_chunk(conn_id_t id, const PerConnQueue::ParkedMessage& m,
+                           uint64_t off, std::span<const uint8_t> chunk);
+    /// Start resume_parked() (flush executor, or inline) unless one is running.
+    void kick_parked(conn_id_t id, PerConnQueue& q);
+    /// Send parked fragments while the window has room.
+    void resume_parked(conn_id_t id, PerConnQueue& q);
+    void flush_batch(conn_id_t id, ConnectionRecord& rec, PerConnQueue& q,
+                     std::vector<sdk::FrameBuffer>& batch);
+    bool flush_frames_to_connector(conn_id_t id, connector_ops_t* ops, PerConnQueue& q,
+                                    std::vector<sdk::FrameBuffer>& frames);
+    bool send_via_paths(conn_id_t id, PerConnQueue& q,
+                        const std::vector<TransportPath*>& paths, size_t first,
+                        std::vector<sdk::FrameBuffer>& frames);
+    bool transmit_on_path(conn_id_t id, TransportPath& path, PerConnQueue& q,
+                          std::vector<sdk::FrameBuffer>& frames);
+    /// Remove the probe route of @p packet_id (send_heartbeat).
+    /// @return its target path, nullptr if none or the path is gone / inactive.
+    TransportPath* take_probe_path(ConnectionRecord& rec, uint64_t packet_id);
+    void stripe_batch(conn_id_t id, PerConnQueue& q, const PathScheduler& sched,
+                      const std::vector<TransportPath*>& paths,
+                      std::vector<sdk::FrameBuffer>& batch);
+    void notify_if_writable(conn_id_t id, PerConnQueue& q);
 
     // Helpers
     std::string              negotiate_scheme(const ConnectionRecord& rec) const;
@@ -272,6 +705,7 @@ struct ConnectionManager::Impl {
     static conn_id_t s_on_connect      (void*, const endpoint_t*);
     static void      s_on_data         (void*, conn_id_t, const void*, size_t);
     static void      s_on_disconnect   (void*, conn_id_t, int);
+    static void      s_on_sent         (void*, conn_id_t, size_t);
     static void      s_send            (void*, const char*, uint32_t, const void*, size_t);
     static void      s_send_response   (void*, conn_id_t, uint32_t, const void*, size_t);
     static void      s_broadcast       (void*, uint32_t, const void*, size_t);
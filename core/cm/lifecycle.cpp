@@ -5,6 +5,7 @@
 #include "impl.hpp"
 #include "config.hpp"
 #include "logger.hpp"
+#include "util.hpp"
 
 #include <chrono>
 #include <cstring>
@@ -23,9 +24,30 @@ namespace gn {
 
 ConnectionManager::Impl::Impl(SignalBus& bus, NodeIdentity identity, Config* config)
     : bus_(bus), config_(config), identity_(std::move(identity))
+    , dicts_(config ? config->compression.level : 1)
 {
     records_rcu_.store(std::make_shared<const RecordMap>(),
                        std::memory_order_relaxed);
+    derive_local_static();
+
+    std::shared_ptr<PathScheduler> sched;
+    if (config_) {
+        sched = make_path_scheduler(config_->core.path_scheduler);
+        if (!sched)
+            LOG_WARN("core.path_scheduler '{}' unknown — using adaptive",
+                     config_->core.path_scheduler);
+        multipath_stripe_.store(config_->core.multipath_stripe, std::memory_order_relaxed);
+
+        dict_sampling_ = config_->compression.dictionaries;
+        if (!config_->compression.dict_dir.empty()) {
+            const auto dir = expand_home(config_->compression.dict_dir);
+            if (const size_t n = dicts_.load_dir(dir))
+                LOG_INFO("compression: {} zstd dictionaries from {}", n, dir);
+        }
+    }
+    path_scheduler_.store(sched ? std::move(sched)
+                                : std::make_shared<AdaptivePathScheduler>(),
+                          std::memory_order_relaxed);
 }
 
 // =============================================================================
@@ -47,10 +69,19 @@ void ConnectionManager::register_handler(handler_t* h)
 void ConnectionManager::register_connector(const std::string& s, connector_ops_t* o)      { impl_->register_connector(s, o); }
 void ConnectionManager::set_scheme_priority(std::vector<std::string> p)                   { impl_->set_scheme_priority(std::move(p)); }
 void ConnectionManager::fill_host_api(host_api_t* api)                                    { impl_->fill_host_api(api); }
-
-bool ConnectionManager::send(std::string_view u, uint32_t t, std::span<const uint8_t> p)  { return impl_->send(u, t, p); }
-bool ConnectionManager::send(conn_id_t id, uint32_t t, std::span<const uint8_t> p)        { return impl_->send(id, t, p); }
-void ConnectionManager::broadcast(uint32_t t, std::span<const uint8_t> p)                 { impl_->broadcast(t, p); }
+void ConnectionManager::set_flush_executor(boost::asio::io_context* ioc)                  { impl_->flush_ioc_.store(ioc, std::memory_order_release); }
+void ConnectionManager::start_handshake_pool(size_t threads)                              { impl_->start_handshake_pool(threads); }
+
+bool ConnectionManager::send(std::string_view u, uint32_t t, std::span<const uint8_t> p, SendClass c) { return impl_->send(u, t, p, c); }
+bool ConnectionManager::send(conn_id_t id, uint32_t t, std::span<const uint8_t> p, SendClass c)       { return impl_->send(id, t, p, c); }
+BroadcastHandle ConnectionManager::broadcast(uint32_t t, std::span<const uint8_t> p, SendClass c)     { return impl_->broadcast(t, p, c); }
+void ConnectionManager::set_send_class(uint32_t t, SendClass c)                                       { impl_->set_send_class(t, c); }
+SendClass ConnectionManager::send_class_of(uint32_t t)            const noexcept { return impl_->send_class_of(t); }
+void ConnectionManager::set_fragment_streaming(uint32_t t, bool on)                            { impl_->set_fragment_streaming(t, on); }
+void ConnectionManager::set_path_scheduler(std::shared_ptr<PathScheduler> s)                  { impl_->set_path_scheduler(std::move(s)); }
+void ConnectionManager::set_multipath_striping(bool on)                                        { impl_->set_multipath_striping(on); }
+uint32_t ConnectionManager::add_compression_dictionary(uint32_t t, std::span<const uint8_t> c) { return impl_->add_compression_dictionary(t, c); }
+size_t ConnectionManager::train_compression_dictionaries()                                     { return impl_->train_compression_dictionaries(); }
 
 void ConnectionManager::connect(std::string_view uri) { impl_->connect(uri); }
 void ConnectionManager::disconnect(conn_id_t id)      { impl_->disconnect(id); }
@@ -77,6 +108,7 @@ std::string                 ConnectionManager::get_peer_pubkey_hex(conn_id_t id)
 std::optional<endpoint_t>   ConnectionManager::get_peer_endpoint(conn_id_t id)       const { return impl_->get_peer_endpoint(id); }
 conn_id_t                   ConnectionManager::find_conn_by_pubkey(const char* h)    const { return impl_->find_conn_by_pubkey(h); }
 size_t ConnectionManager::get_pending_bytes(conn_id_t id) const noexcept { return impl_->get_pending_bytes(id); }
+size_t ConnectionManager::send_window(conn_id_t id)       const noexcept { return impl_->send_window(id); }
 std::string ConnectionManager::dump_connections() const { return impl_->dump_connections(); }
 
 const NodeIdentity& ConnectionManager::identity() const        { return impl_->identity_; }
@@ -103,6 +135,7 @@ void ConnectionManager::Impl::fill_host_api(host_api_t* api) {
     api->register_handler    = s_register_handler;
     api->add_transport       = s_add_transport;
     api->log                 = s_log;
+    api->on_sent             = s_on_sent;
     api->plugin_info         = nullptr;
 }
 
@@ -113,6 +146,7 @@ void ConnectionManager::Impl::fill_host_api(host_api_t* api) {
 conn_id_t ConnectionManager::Impl::handle_connect(const endpoint_t* ep) {
     LOG_TRACE("handle_connect: {}:{} flags=0x{:02X}", ep->address, ep->port, ep->flags);
     if (shutting_down_.load(std::memory_order_relaxed)) return CONN_ID_INVALID;
+    if (!admit_connection(*ep)) return CONN_ID_INVALID;
 
     const conn_id_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
     const bool is_local = (ep->flags & EP_FLAG_TRUSTED);
@@ -124,18 +158,27 @@ conn_id_t ConnectionManager::Impl::handle_connect(const endpoint_t* ep) {
     rec->state          = STATE_NOISE_HANDSHAKE;
     rec->is_localhost   = is_local;
     rec->is_initiator   = is_outbound;
+    rec->handshake_started = std::chrono::steady_clock::now();
+    if (hs_pool_.load(std::memory_order_acquire))
+        rec->hs_lane = std::make_shared<WorkerPool::Lane>();
+
+    const std::string addr_key = std::string(ep->address) + ":"
+                               + std::to_string(ep->port);
 
-    // Конвертируем Ed25519 device_key -> X25519 для Noise static key
-    uint8_t x25519_pk[noise::DHLEN], x25519_sk[noise::DHLEN];
+    // Известный пир на этом адресе → 1-RTT Noise_IK к его запомненному static key
+    const auto resume = is_outbound ? resume_target(addr_key) : std::nullopt;
+
+    // Noise static key — X25519 из device_key, посчитан один раз (local_static_)
+    rec->handshake = std::make_unique<noise::HandshakeState>();
     {
         std::shared_lock lk(identity_mu_);
-        [[maybe_unused]] int r1 = crypto_sign_ed25519_pk_to_curve25519(x25519_pk, identity_.device_pubkey);
-        [[maybe_unused]] int r2 = crypto_sign_ed25519_sk_to_curve25519(x25519_sk, identity_.device_seckey);
+        if (resume)
+            rec->handshake->init(true, local_static_.x25519_pk, local_static_.x25519_sk,
+                                 noise::Pattern::IK, resume->static_x25519);
+        else
+            rec->handshake->init(is_outbound, local_static_.x25519_pk, local_static_.x25519_sk);
     }
-
-    rec->handshake = std::make_unique<noise::HandshakeState>();
-    rec->handshake->init(is_outbound, x25519_pk, x25519_sk);
-    sodium_memzero(x25519_sk, sizeof(x25519_sk));
+    handshakes_active_.fetch_add(1, std::memory_order_relaxed);
 
     // Начальный транспортный путь (scheme обновится после handshake negotiate)
     {
@@ -148,8 +191,6 @@ conn_id_t ConnectionManager::Impl::handle_connect(const endpoint_t* ep) {
         rec->transport_paths.push_back(std::move(tp));
     }
 
-    const std::string addr_key = std::string(ep->address) + ":"
-                               + std::to_string(ep->port);
     {
         std::lock_guard wlk(records_write_mu_);
         rcu_update([&](RecordMap& m) { m[id] = rec; });
@@ -160,19 +201,21 @@ conn_id_t ConnectionManager::Impl::handle_connect(const endpoint_t* ep) {
     }
     {
         std::unique_lock lk(queues_mu_);
-        send_queues_[id] = std::make_shared<PerConnQueue>();
+        send_queues_[id] = std::make_shared<PerConnQueue>(&bus_);
     }
 
-    LOG_DEBUG("Connect #{} {}:{}{}{}", id, ep->address, ep->port,
+    LOG_DEBUG("Connect #{} {}:{}{}{}{}", id, ep->address, ep->port,
               is_local ? " [localhost]" : "",
-              is_outbound ? " [outbound]" : "");
+              is_outbound ? " [outbound]" : "",
+              resume ? " [resume]" : "");
 
     bus_.emit_stat({StatsEvent::Kind::Connect, 1, id});
 
-    // Initiator отправляет первое Noise сообщение
-    if (is_outbound) {
-        send_noise_init(id);
-    }
+    // Initiator отправляет первое Noise сообщение (IK msg1 — уже 2 DH)
+    if (resume)
+        run_handshake_step(*rec, [this, id] { send_noise_resume(id); });
+    else if (is_outbound)
+        run_handshake_step(*rec, [this, id] { send_noise_init(id); });
     return id;
 }
 
@@ -255,6 +298,10 @@ void ConnectionManager::Impl::shutdown() {
     LOG_DEBUG("CM shutdown initiated");
     shutting_down_.store(true, std::memory_order_release);
 
+    // Воркеры handshake дорабатывают текущие задачи; ещё не начатые отбрасываются
+    if (auto* pool = hs_pool_.load(std::memory_order_acquire))
+        pool->stop();
+
     // M5 fix: wait for in-flight dispatches to drain before closing connections
     LOG_TRACE("CM shutdown: waiting for {} in-flight dispatches",
               in_flight_dispatches_.load(std::memory_order_acquire));
@@ -268,6 +315,17 @@ void ConnectionManager::Impl::shutdown() {
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
+    // Executor останавливается следом — отложенные flush-задачи не выполнятся.
+    // send() уже отклоняет новые кадры, поэтому сдаём очереди коннекторам здесь.
+    flush_ioc_.store(nullptr, std::memory_order_release);
+    std::vector<std::pair<conn_id_t, std::shared_ptr<PerConnQueue>>> queues;
+    {
+        std::shared_lock lk(queues_mu_);
+        queues.assign(send_queues_.begin(), send_queues_.end());
+    }
+    LOG_TRACE("CM shutdown: draining {} send queues", queues.size());
+    for (auto& [id, q] : queues) drain_queue(id, *q);
+
     auto map = rcu_read();
     LOG_TRACE("CM shutdown: closing {} connections", map->size());
     for (auto& [id, _] : *map) close_now(id);
@@ -280,7 +338,15 @@ void ConnectionManager::Impl::shutdown() {
 msg::CoreMeta ConnectionManager::Impl::local_core_meta() const {
     msg::CoreMeta m{};
     m.core_version = GN_CORE_VERSION;
-    m.caps_mask    = CORE_CAP_ZSTD | CORE_CAP_KEYROT | CORE_CAP_RELAY;
+    m.caps_mask    = CORE_CAP_ZSTD | CORE_CAP_KEYROT | CORE_CAP_RELAY | CORE_CAP_FRAGMENT
+                   | CORE_CAP_STRIPE | CORE_CAP_ZSTD_DICT | CORE_CAP_ZSTD_STREAM
+                   | CORE_CAP_LZ4 | CORE_CAP_KEY_EPOCH;
+    if (resumption_enabled())
+        m.caps_mask |= CORE_CAP_RESUME;
+    // AES-GCM объявляем только с аппаратной поддержкой: программный AES
+    // медленнее ChaCha и не constant-time
+    if (aes256gcm_available() && (!config_ || config_->security.cipher != "chacha20"))
+        m.caps_mask |= CORE_CAP_AES256GCM;
     {
         std::shared_lock lk(connectors_mu_);
         if (connectors_.count("ice"))
@@ -304,6 +370,8 @@ void ConnectionManager::Impl::s_on_data(void* ctx, conn_id_t id, const void* r,
     static_cast<Impl*>(ctx)->handle_data(id, r, sz); }
 void ConnectionManager::Impl::s_on_disconnect(void* ctx, conn_id_t id, int err) {
     static_cast<Impl*>(ctx)->handle_disconnect(id, err); }
+void ConnectionManager::Impl::s_on_sent(void* ctx, conn_id_t id, size_t bytes) {
+    static_cast<Impl*>(ctx)->handle_sent(id, bytes); }
 void ConnectionManager::Impl::s_send(void* ctx, const char* uri, uint32_t t,
                                       const void* p, size_t sz) {
     static_cast<Impl*>(ctx)->send(
@@ -0,0 +1,330 @@
+/// @file core/cm/multipath.cpp
+/// Path scheduling, bulk striping across transport paths, receive-side reordering.
+
+#include "impl.hpp"
+#include "config.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <boost/asio/steady_timer.hpp>
+
+namespace gn {
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// PathScheduler
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void PriorityPathScheduler::rank(std::vector<TransportPath*>& paths) const {
+    std::stable_sort(paths.begin(), paths.end(),
+                     [](const TransportPath* a, const TransportPath* b) {
+                         return a->priority < b->priority;
+                     });
+}
+
+uint64_t AdaptivePathScheduler::cost_us(const TransportPath& path) noexcept {
+    const auto& st = *path.state;
+    const uint64_t srtt = st.srtt_us.load(std::memory_order_relaxed);
+    const uint64_t rtt  = srtt ? srtt : UNKNOWN_RTT_US;
+    const uint64_t loss = st.loss_ppm.load(std::memory_order_relaxed);
+    // Дрожащий путь дороже стабильного с тем же srtt (как RTO: srtt + 4·rttvar)
+    const uint64_t base = rtt + 4 * st.rttvar_us.load(std::memory_order_relaxed);
+
+    uint64_t cost = base + base * LOSS_FACTOR * loss / PathState::LOSS_SCALE;
+    cost += rtt * st.in_flight.load(std::memory_order_relaxed) / QUEUE_BYTES;
+    cost += uint64_t{path.priority} * PRIORITY_STEP_US;
+    return cost ? cost : 1;
+}
+
+void AdaptivePathScheduler::rank(std::vector<TransportPath*>& paths) const {
+    if (paths.size() < 2) return;
+    std::vector<std::pair<uint64_t, TransportPath*>> scored;
+    scored.reserve(paths.size());
+    for (auto* p : paths) scored.emplace_back(cost_us(*p), p);
+    std::stable_sort(scored.begin(), scored.end(),
+                     [](const auto& a, const auto& b) {
+                         return a.first != b.first ? a.first < b.first
+                                                   : a.second->priority < b.second->priority;
+                     });
+    for (size_t i = 0; i < paths.size(); ++i) paths[i] = scored[i].second;
+}
+
+uint64_t AdaptivePathScheduler::stripe_weight(const TransportPath& path) const {
+    // Доля пропорциональна 1/cost: путь вдвое «дешевле» получает вдвое больше
+    return std::max<uint64_t>(1, 1'000'000'000ULL / cost_us(path));
+}
+
+std::shared_ptr<PathScheduler> make_path_scheduler(std::string_view name) {
+    if (name == "adaptive") return std::make_shared<AdaptivePathScheduler>();
+    if (name == "priority") return std::make_shared<PriorityPathScheduler>();
+    return nullptr;
+}
+
+void ConnectionManager::Impl::set_path_scheduler(std::shared_ptr<PathScheduler> s) {
+    if (!s) s = std::make_shared<AdaptivePathScheduler>();
+    LOG_INFO("path scheduler: {}", s->name());
+    path_scheduler_.store(std::move(s), std::memory_order_release);
+}
+
+void ConnectionManager::Impl::set_multipath_striping(bool on) noexcept {
+    multipath_stripe_.store(on, std::memory_order_relaxed);
+}
+
+bool ConnectionManager::Impl::should_stripe(const ConnectionRecord& rec) const noexcept {
+    if (!multipath_stripe_.load(std::memory_order_relaxed)) return false;
+    if (!(rec.peer_core_meta.caps_mask & CORE_CAP_STRIPE))  return false;
+    size_t active = 0;
+    for (const auto& tp : rec.transport_paths)
+        if (tp.active && ++active > 1) return true;
+    return false;
+}
+
+bool ConnectionManager::Impl::ordered_delivery(const ConnectionRecord& rec) const noexcept {
+    // Несколько активных путей: failover / striping могут переставить кадры
+    const TransportPath* only = nullptr;
+    for (const auto& tp : rec.transport_paths) {
+        if (!tp.active) continue;
+        if (only) return false;
+        only = &tp;
+    }
+    const std::string_view scheme = only ? std::string_view(only->scheme)
+        : rec.negotiated_scheme.empty() ? std::string_view(rec.local_scheme)
+                                        : std::string_view(rec.negotiated_scheme);
+    // Датаграммные транспорты порядок не гарантируют
+    return scheme != "ice" && scheme != "udp";
+}
+
+bool ConnectionManager::Impl::stream_compression(const ConnectionRecord& rec) const noexcept {
+    if (!config_ || !config_->compression.enabled || !config_->compression.stream) return false;
+    if (!rec.session || rec.is_localhost) return false;
+    if (!(rec.peer_core_meta.caps_mask & CORE_CAP_ZSTD_STREAM)) return false;
+    if (codec_for_peer(rec) != Codec::Zstd) return false;
+    if (ordered_delivery(rec)) return true;
+    rec.session->stream.pause_tx();   // вернёмся — начнём с новой эпохи
+    return false;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Send side
+// ═══════════════════════════════════════════════════════════════════════════════
+
+bool ConnectionManager::Impl::transmit_on_path(conn_id_t id, TransportPath& path,
+                                               PerConnQueue& q,
+                                               std::vector<sdk::FrameBuffer>& frames) {
+    auto* ops = find_connector(path.scheme);
+    if (!ops) return false;
+
+    const bool reports = (ops->flags & CONNECTOR_FLAG_REPORTS_SENT) != 0;
+    uint64_t bytes = 0;
+    for (auto& f : frames) bytes += f.size();
+    if (reports) path.state->in_flight.fetch_add(bytes, std::memory_order_relaxed);
+
+    const bool ok = flush_frames_to_connector(path.transport_conn_id, ops, q, frames);
+    path.state->record_send(ok, frames.size(), bytes);
+    if (ok) {
+        path.consecutive_errors = 0;
+        return true;
+    }
+    if (reports) path.state->credit(bytes);
+    path.consecutive_errors++;
+    if (path.consecutive_errors >= 3) {
+        path.active = false;
+        LOG_WARN("flush_batch #{}: path '{}' deactivated after {} consecutive errors",
+                 id, path.scheme, path.consecutive_errors);
+    }
+    return false;
+}
+
+TransportPath* ConnectionManager::Impl::take_probe_path(ConnectionRecord& rec,
+                                                       uint64_t packet_id) {
+    conn_id_t tcid = CONN_ID_INVALID;
+    {
+        std::lock_guard lk(rec.probe_mu);
+        auto it = std::find_if(rec.probe_routes.begin(), rec.probe_routes.end(),
+                               [&](const auto& r) { return r.first == packet_id; });
+        if (it == rec.probe_routes.end()) return nullptr;
+        tcid = it->second;
+        rec.probe_routes.erase(it);
+    }
+    rec.probe_pending.fetch_sub(1, std::memory_order_relaxed);
+    // Путь пропал или отключён — probe уйдёт как обычный кадр
+    auto* path = rec.find_path_by_transport_id(tcid);
+    return path && path->active ? path : nullptr;
+}
+
+bool ConnectionManager::Impl::send_via_paths(conn_id_t id, PerConnQueue& q,
+                                             const std::vector<TransportPath*>& paths,
+                                             size_t first,
+                                             std::vector<sdk::FrameBuffer>& frames) {
+    // Начинаем с paths[first], затем остальные по кругу в порядке планировщика
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto* path = paths[(first + i) % paths.size()];
+        if (!path->active) continue;
+        if (transmit_on_path(id, *path, q, frames)) return true;
+    }
+    bus_.emit_drop(id, DropReason::ConnectorNotFound);
+    LOG_WARN("flush_batch #{}: all transport paths failed", id);
+    return false;
+}
+
+void ConnectionManager::Impl::stripe_batch(conn_id_t id, PerConnQueue& q,
+                                           const PathScheduler& sched,
+                                           const std::vector<TransportPath*>& paths,
+                                           std::vector<sdk::FrameBuffer>& batch) {
+    // Smooth weighted round-robin (как в nginx): striped-кадры чередуются по
+    // путям пропорционально stripe_weight(), состояние живёт в PathState и
+    // переживает батчи. Остальные кадры держатся лучшего пути — для них
+    // порядок гарантирует сам транспорт.
+    constexpr uint64_t WEIGHT_SCALE = 100;
+    const size_t n = paths.size();
+    std::vector<std::vector<sdk::FrameBuffer>> lanes(n);
+    std::vector<int64_t> weight(n);
+    uint64_t max_w = 1;
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t w = sched.stripe_weight(*paths[i]);
+        weight[i] = static_cast<int64_t>(w);
+        max_w     = std::max(max_w, w);
+    }
+    int64_t total = 0;
+    for (auto& w : weight) {
+        w = std::max<int64_t>(1, static_cast<int64_t>(
+                static_cast<uint64_t>(w) * WEIGHT_SCALE / max_w));
+        total += w;
+    }
+
+    for (auto& f : batch) {
+        size_t lane = 0;
+        const auto* hdr = reinterpret_cast<const header_t*>(f.data());
+        if (hdr->flags & GNET_FLAG_STRIPED) {
+            int64_t best = INT64_MIN;
+            for (size_t i = 0; i < n; ++i) {
+                const int64_t cur = paths[i]->state->stripe_current.fetch_add(
+                    weight[i], std::memory_order_relaxed) + weight[i];
+                if (cur > best) { best = cur; lane = i; }
+            }
+            paths[lane]->state->stripe_current.fetch_sub(total, std::memory_order_relaxed);
+        }
+        lanes[lane].push_back(std::move(f));
+    }
+
+    LOG_TRACE("stripe #{}: {} frames over {} paths", id, batch.size(), n);
+    for (size_t i = 0; i < n; ++i)
+        if (!lanes[i].empty()) send_via_paths(id, q, paths, i, lanes[i]);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// StripeReorderBuffer
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void StripeReorderBuffer::push(Frame f, std::vector<Frame>& out) {
+    std::lock_guard lk(mu_);
+    if (f.seq < next_) {                 // пробел уже пропущен — отдаём как есть
+        out.push_back(std::move(f));
+        return;
+    }
+    if (f.seq == next_) {
+        out.push_back(std::move(f));
+        ++next_;
+        drain_locked(out);
+        return;
+    }
+    const size_t sz = f.data.size();
+    if (held_.emplace(f.seq, std::move(f)).second) held_bytes_ += sz;
+    if (held_.size() > MAX_HELD || held_bytes_ > MAX_HELD_BYTES) {
+        next_ = held_.begin()->first;
+        drain_locked(out);
+    }
+}
+
+void StripeReorderBuffer::release_expired(std::chrono::steady_clock::time_point deadline,
+                                          std::vector<Frame>& out) {
+    std::lock_guard lk(mu_);
+    while (!held_.empty() && held_.begin()->second.held_at <= deadline) {
+        next_ = held_.begin()->first;
+        drain_locked(out);
+    }
+}
+
+size_t StripeReorderBuffer::held() const {
+    std::lock_guard lk(mu_);
+    return held_.size();
+}
+
+void StripeReorderBuffer::drain_locked(std::vector<Frame>& out) {
+    for (auto it = held_.begin(); it != held_.end() && it->first == next_;
+         it = held_.erase(it), ++next_) {
+        held_bytes_ -= it->second.data.size();
+        out.push_back(std::move(it->second));
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Receive side
+// ═══════════════════════════════════════════════════════════════════════════════
+
+void ConnectionManager::Impl::handle_striped(conn_id_t id, ConnectionRecord& rec,
+                                             const header_t& hdr,
+                                             std::vector<uint8_t> plaintext,
+                                             uint64_t recv_ts_ns) {
+    if (plaintext.size() < sizeof(uint64_t)) {
+        LOG_WARN("striped #{}: {} bytes, shorter than sequence prefix", id, plaintext.size());
+        bus_.emit_drop(id, DropReason::ReassemblyFailed);
+        return;
+    }
+
+    StripeReorderBuffer::Frame f;
+    std::memcpy(&f.seq, plaintext.data(), sizeof(f.seq));
+    plaintext.erase(plaintext.begin(), plaintext.begin() + sizeof(uint64_t));
+    f.hdr              = hdr;
+    f.hdr.flags       &= ~GNET_FLAG_STRIPED;
+    f.hdr.payload_len  = static_cast<uint32_t>(plaintext.size());
+    f.data             = std::move(plaintext);
+    f.recv_ts_ns       = recv_ts_ns;
+    f.held_at          = std::chrono::steady_clock::now();
+    LOG_TRACE("striped #{}: seq={} type={}", id, f.seq, hdr.payload_type);
+
+    const auto deadline = f.held_at - REORDER_TIMEOUT;
+    std::vector<StripeReorderBuffer::Frame> ready;
+    rec.reorder.push(std::move(f), ready);
+    rec.reorder.release_expired(deadline, ready);
+    deliver_reordered(id, rec, ready);
+
+    if (rec.reorder.held()) arm_reorder_timer(id, rec);
+}
+
+void ConnectionManager::Impl::deliver_reordered(conn_id_t id, ConnectionRecord& rec,
+                                                std::vector<StripeReorderBuffer::Frame>& ready) {
+    for (auto& f : ready) {
+        if (f.hdr.flags & GNET_FLAG_FRAGMENT)
+            handle_fragment(id, rec, f.hdr, std::span<const uint8_t>(f.data), f.recv_ts_ns);
+        else
+            deliver_to_handlers(id, rec, f.hdr, std::move(f.data), f.recv_ts_ns);
+    }
+}
+
+void ConnectionManager::Impl::arm_reorder_timer(conn_id_t id, ConnectionRecord& rec) {
+    // Без executor'а пробел закроет следующий кадр, MAX_HELD или expire_reassembly()
+    auto* ioc = flush_ioc_.load(std::memory_order_acquire);
+    if (!ioc) return;
+    if (rec.reorder_timer_armed.exchange(true, std::memory_order_acq_rel)) return;
+
+    auto timer = std::make_shared<boost::asio::steady_timer>(*ioc, REORDER_TIMEOUT);
+    timer->async_wait([this, id, timer](const boost::system::error_code&) {
+        if (shutting_down_.load(std::memory_order_relaxed)) return;
+        auto rec = rcu_find(id);
+        if (!rec) return;
+        rec->reorder_timer_armed.store(false, std::memory_order_release);
+
+        std::vector<StripeReorderBuffer::Frame> ready;
+        rec->reorder.release_expired(std::chrono::steady_clock::now() - REORDER_TIMEOUT,
+                                     ready);
+        if (!ready.empty())
+            LOG_DEBUG("striped #{}: gap timed out, releasing {} frame(s)", id, ready.size());
+        deliver_reordered(id, *rec, ready);
+        if (rec->reorder.held()) arm_reorder_timer(id, *rec);
+    });
+}
+
+} // namespace gn
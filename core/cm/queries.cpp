@@ -2,6 +2,7 @@
 /// Read-only getters and diagnostic output for ConnectionManager.
 
 #include "impl.hpp"
+#include "config.hpp"
 #include "logger.hpp"
 
 #include <nlohmann/json.hpp>
@@ -96,6 +97,12 @@ size_t ConnectionManager::Impl::get_pending_bytes(conn_id_t id) const noexcept {
         ? it->second->pending_bytes.load(std::memory_order_relaxed) : 0;
 }
 
+size_t ConnectionManager::Impl::send_window(conn_id_t id) const noexcept {
+    if (!rcu_find(id)) return 0;
+    auto q = find_queue(id);
+    return q ? q->window() : PerConnQueue::MAX_BYTES;
+}
+
 // =============================================================================
 // JSON diagnostic dump
 // =============================================================================
@@ -136,9 +143,56 @@ std::string ConnectionManager::Impl::dump_connections() const {
             pj["active"]       = tp.active;
             pj["rtt_us"]       = tp.last_rtt_us;
             pj["errors"]       = tp.consecutive_errors;
+
+            const auto& st = *tp.state;
+            const auto age_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - tp.added_at).count();
+            const uint64_t tx = st.tx_bytes.load(std::memory_order_relaxed);
+            const uint64_t rx = st.rx_bytes.load(std::memory_order_relaxed);
+            pj["srtt_us"]      = st.srtt_us.load(std::memory_order_relaxed);
+            pj["rttvar_us"]    = st.rttvar_us.load(std::memory_order_relaxed);
+            pj["loss"]         = static_cast<double>(st.loss_ppm.load(std::memory_order_relaxed))
+                               / PathState::LOSS_SCALE;
+            pj["in_flight"]    = st.in_flight.load(std::memory_order_relaxed);
+            pj["tx_bytes"]     = tx;
+            pj["tx_frames"]    = st.tx_frames.load(std::memory_order_relaxed);
+            pj["tx_errors"]    = st.tx_errors.load(std::memory_order_relaxed);
+            pj["rx_bytes"]     = rx;
+            // Средняя пропускная способность за время жизни пути
+            pj["tx_bps"]       = age_us > 0 ? tx * 8'000'000 / static_cast<uint64_t>(age_us) : 0;
+            pj["rx_bps"]       = age_us > 0 ? rx * 8'000'000 / static_cast<uint64_t>(age_us) : 0;
             paths.push_back(std::move(pj));
         }
         j["transport_paths"] = std::move(paths);
+        j["path_scheduler"]  = std::string(path_scheduler_.load(std::memory_order_acquire)->name());
+        j["reorder_held"]    = rec->reorder.held();
+
+        j["cipher"]          = rec->session ? aead_name(rec->session->cipher()) : "";
+        j["resumed"]         = rec->resumed;
+        if (rec->session)
+            j["key_epoch"] = {
+                {"tx",            rec->session->tx_epoch()},
+                {"rx",            rec->session->rx_epoch()},
+                {"rx_prev_hits",  rec->session->rx_prev_key_hits()},
+                {"rx_rekey_ns",   rec->session->last_rx_rekey_cost_ns()},
+            };
+
+        const auto& ac = rec->compression;
+        const int   lv = ac.level.load(std::memory_order_relaxed);
+        j["compression"] = {
+            {"level",         lv ? lv : (config_ ? config_->compression.level : 1)},
+            {"compressed",    ac.compressed.load(std::memory_order_relaxed)},
+            {"skipped",       ac.skipped.load(std::memory_order_relaxed)},
+            {"skipped_bytes", ac.skipped_bytes.load(std::memory_order_relaxed)},
+            {"cpu_saved_us",  ac.cpu_saved_ns() / 1000},
+            {"zstd_bps",      ac.zstd_bps.load(std::memory_order_relaxed)},
+            {"link_bps",      ac.link_bps.load(std::memory_order_relaxed)},
+            {"level_ups",     ac.level_ups.load(std::memory_order_relaxed)},
+            {"level_downs",   ac.level_downs.load(std::memory_order_relaxed)},
+            {"stream_tx_blocks",    rec->session ? rec->session->stream.tx_blocks()   : 0},
+            {"stream_rx_blocks",    rec->session ? rec->session->stream.rx_blocks()   : 0},
+            {"stream_rx_rejected",  rec->session ? rec->session->stream.rx_rejected() : 0},
+        };
 
         arr.push_back(std::move(j));
     }
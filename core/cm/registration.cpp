@@ -5,6 +5,9 @@
 #include "logger.hpp"
 #include "signals.hpp"
 
+#include <algorithm>
+#include <array>
+
 namespace gn {
 
 // =============================================================================
@@ -54,27 +57,49 @@ void ConnectionManager::Impl::register_handler_internal(handler_t* h,
         return;
     }
 
-    auto make_cb = [h, name](std::string_view,
-                              std::shared_ptr<header_t> hdr,
-                              const endpoint_t*          ep,
-                              PacketData                 data) -> propagation_t {
+    // handle_batch — поле ABI 2; у коннектора может быть структура ABI 1
+    const auto batch_fn = source == HandlerSource::Connector ? nullptr
+                                                             : h->handle_batch;
+
+    auto make_cb = [h, batch_fn](std::string_view,
+                                 const header_t&   hdr,
+                                 const endpoint_t* ep,
+                                 const PacketData& data) -> propagation_t {
+        if (batch_fn) {
+            const handler_packet_t one{&hdr, data->data(), data->size()};
+            return batch_fn(h->user_data, ep, &one, 1);
+        }
         if (h->handle_message)
-            h->handle_message(h->user_data, hdr.get(), ep,
+            h->handle_message(h->user_data, &hdr, ep,
                               data->data(), data->size());
         if (h->on_message_result)
-            return h->on_message_result(h->user_data, hdr.get(),
-                                         hdr->payload_type);
+            return h->on_message_result(h->user_data, &hdr,
+                                         hdr.payload_type);
         return PROPAGATION_CONTINUE;
     };
 
+    // Пакеты одного чтения коннектора — одним вызовом handle_batch
+    HandlerBatchFn batch_cb;
+    if (batch_fn) {
+        batch_cb = [h, batch_fn](std::string_view, const endpoint_t* ep,
+                                 std::span<const PacketData> pkts) -> propagation_t {
+            std::array<handler_packet_t, PipelineSignal::MAX_BATCH> arr;
+            const size_t n = std::min(pkts.size(), arr.size());
+            for (size_t i = 0; i < n; ++i)
+                arr[i] = {&pkts[i].header(), pkts[i]->data(), pkts[i]->size()};
+            return batch_fn(h->user_data, ep, arr.data(), n);
+        };
+    }
+
     HandlerEntry entry;
     entry.name    = name;
     entry.handler = h;
     entry.source  = source;
 
     if (!h->num_supported_types) {
-        bus_.subscribe_wildcard(name, make_cb, priority);
-        LOG_INFO("Handler '{}' registered (wildcard, prio={})", name, priority);
+        bus_.subscribe_wildcard(name, make_cb, priority, batch_cb);
+        LOG_INFO("Handler '{}' registered (wildcard, prio={}{})", name, priority,
+                 batch_cb ? ", batch" : "");
     } else {
         for (size_t i = 0; i < h->num_supported_types; ++i) {
             const uint32_t t = h->supported_types[i];
@@ -86,7 +111,7 @@ void ConnectionManager::Impl::register_handler_internal(handler_t* h,
                 continue;
             }
 
-            bus_.subscribe(t, name, make_cb, priority);
+            bus_.subscribe(t, name, make_cb, priority, batch_cb);
             entry.subscribed_types.push_back(t);
         }
 
@@ -96,9 +121,10 @@ void ConnectionManager::Impl::register_handler_internal(handler_t* h,
             return;
         }
 
-        LOG_INFO("Handler '{}' registered ({} types, prio={}, source={})",
+        LOG_INFO("Handler '{}' registered ({} types, prio={}, source={}{})",
                  name, entry.subscribed_types.size(), priority,
-                 source == HandlerSource::Connector ? "connector" : "plugin");
+                 source == HandlerSource::Connector ? "connector" : "plugin",
+                 batch_cb ? ", batch" : "");
     }
 
     std::unique_lock lock(handlers_mu_);
@@ -119,7 +119,7 @@ void ConnectionManager::Impl::relay(conn_id_t exclude_conn, uint8_t ttl,
     conn_id_t direct = find_conn_by_pubkey(hex.c_str());
     if (direct != CONN_ID_INVALID && direct != exclude_conn) {
         LOG_TRACE("relay: direct path to {}... via #{}", hex.substr(0, 8), direct);
-        send_frame(direct, MSG_TYPE_RELAY, relay_span);
+        send_frame(direct, MSG_TYPE_RELAY, relay_span, SendClass::Relay);
         return;
     }
 
@@ -129,7 +129,7 @@ void ConnectionManager::Impl::relay(conn_id_t exclude_conn, uint8_t ttl,
     for (auto& [cid, rec] : *map) {
         if (cid == exclude_conn) continue;
         if (rec->state != STATE_ESTABLISHED) continue;
-        send_frame(cid, MSG_TYPE_RELAY, relay_span);
+        send_frame(cid, MSG_TYPE_RELAY, relay_span, SendClass::Relay);
         ++relay_count;
     }
     LOG_TRACE("relay: gossip to {} peers (exclude=#{})", relay_count, exclude_conn);
@@ -4,15 +4,22 @@
 #include "impl.hpp"
 #include "config.hpp"
 #include "logger.hpp"
+#include "util.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 #if !defined(_WIN32)
 #include <sys/uio.h>
 #endif
 
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <sodium/crypto_aead_aes256gcm.h>
 #include <sodium/crypto_aead_chacha20poly1305.h>
 #include <sodium/utils.h>
+#include <lz4.h>
 #include <zstd.h>
 
 #include "../sdk/connector.h"
@@ -69,10 +76,16 @@ std::shared_ptr<PerConnQueue> ConnectionManager::Impl::get_or_create_queue(conn_
     }
     std::unique_lock lk(queues_mu_);
     auto& q = send_queues_[id];
-    if (!q) q = std::make_shared<PerConnQueue>();
+    if (!q) q = std::make_shared<PerConnQueue>(&bus_);
     return q;
 }
 
+std::shared_ptr<PerConnQueue> ConnectionManager::Impl::find_queue(conn_id_t id) const {
+    std::shared_lock lk(queues_mu_);
+    auto it = send_queues_.find(id);
+    return it != send_queues_.end() ? it->second : nullptr;
+}
+
 uint64_t ConnectionManager::Impl::monotonic_ns() noexcept {
     auto now = std::chrono::steady_clock::now().time_since_epoch();
     return static_cast<uint64_t>(
@@ -83,156 +96,453 @@ uint64_t ConnectionManager::Impl::monotonic_ns() noexcept {
 // NonceWindow
 // ═══════════════════════════════════════════════════════════════════════════════
 
+void NonceWindow::configure(size_t window) {
+    window = std::clamp(window, BLOCK_BITS, MAX_WINDOW);
+    slots_ = (window + BLOCK_BITS - 1) / BLOCK_BITS + 1;
+    reset();
+}
+
 bool NonceWindow::accept(uint64_t nonce) {
-    std::lock_guard lk(mu);
     if (nonce == 0) return false;
 
-    if (highest_nonce == 0) {
-        highest_nonce = nonce;
-        bitmap.reset();
-        bitmap.set(0);
-        return true;
-    }
-
-    if (nonce > highest_nonce) {
-        const uint64_t shift = nonce - highest_nonce;
-        if (shift >= WINDOW_SIZE)
-            bitmap.reset();
-        else
-            bitmap <<= static_cast<size_t>(shift);
-        bitmap.set(0);
-        highest_nonce = nonce;
-        return true;
+    // Быстрый отказ по highest; устаревшее значение безопасно — решает CAS ниже
+    const uint64_t high = highest_.load(std::memory_order_acquire);
+    if (high > nonce && high - nonce >= window()) return false;
+
+    const uint64_t block = nonce / BLOCK_BITS;
+    const auto     tag   = static_cast<uint32_t>(block);
+    const uint64_t bit   = uint64_t{1} << (nonce % BLOCK_BITS);
+    auto&          word  = words_[block % slots_];
+
+    uint64_t cur = word.load(std::memory_order_acquire);
+    while (true) {
+        const auto cur_tag = static_cast<uint32_t>(cur >> 32);
+        uint64_t   next;
+        if (cur_tag == tag) {
+            if (cur & bit) return false;                  // replay
+            next = cur | bit;
+        } else if (static_cast<int32_t>(tag - cur_tag) > 0) {
+            next = (uint64_t{tag} << 32) | bit;           // слот ушёл из окна
+        } else {
+            return false;                                 // слот уже занят более новым блоком
+        }
+        if (word.compare_exchange_weak(cur, next, std::memory_order_acq_rel,
+                                       std::memory_order_acquire))
+            break;
     }
 
-    const uint64_t diff = highest_nonce - nonce;
-    if (diff >= WINDOW_SIZE) return false;
-
-    const auto idx = static_cast<size_t>(diff);
-    if (bitmap.test(idx)) return false;
-    bitmap.set(idx);
+    uint64_t h = highest_.load(std::memory_order_relaxed);
+    while (nonce > h && !highest_.compare_exchange_weak(h, nonce, std::memory_order_release,
+                                                        std::memory_order_relaxed)) {}
     return true;
 }
 
 void NonceWindow::reset() {
-    std::lock_guard lk(mu);
-    highest_nonce = 0;
-    bitmap.reset();
+    for (auto& w : words_) w.store(0, std::memory_order_relaxed);
+    highest_.store(0, std::memory_order_release);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
 // NoiseSession encrypt / decrypt
 // ═══════════════════════════════════════════════════════════════════════════════
 
-static constexpr uint8_t FLAG_RAW  = 0x00;
-static constexpr uint8_t FLAG_ZSTD = 0x01;
+static constexpr uint8_t FLAG_RAW       = 0x00;
+static constexpr uint8_t FLAG_ZSTD      = 0x01;
+static constexpr uint8_t FLAG_ZSTD_DICT = 0x02;   ///< + orig_size + dict_id (ZstdDict)
+static constexpr uint8_t FLAG_ZSTD_STREAM = 0x03; ///< + ctl + seq + orig_size (ZstdStream)
+static constexpr uint8_t FLAG_LZ4         = 0x04; ///< + orig_size (LZ4 block)
+static constexpr uint8_t STREAM_CTL_RESET = 0x01;
+
+size_t NoiseSession::max_wire_size(size_t len, bool compress_enabled,
+                                   int compress_threshold) {
+    constexpr size_t MAC_SIZE = crypto_aead_chacha20poly1305_IETF_ABYTES;
+    const bool try_zstd = compress_enabled
+                       && len > static_cast<size_t>(compress_threshold);
+    // Худший случай: raw (1 + len) или zstd (1 + 4 [+ 4 dict_id | + 1 ctl + 4 seq] + bound)
+    // или lz4 (1 + 4 + bound)
+    const size_t bound = std::max<size_t>(
+        ZSTD_compressBound(len),
+        len <= LZ4_MAX_INPUT_SIZE ? static_cast<size_t>(LZ4_compressBound(static_cast<int>(len))) : 0);
+    const size_t body = try_zstd ? std::max(1 + len, 1 + 9 + bound)
+                                 : 1 + len;
+    return body + MAC_SIZE;
+}
 
 std::vector<uint8_t> NoiseSession::encrypt(const void* plain, size_t plain_len,
                                             uint64_t nonce,
                                             bool compress_enabled,
                                             int compress_threshold,
                                             int compress_level) {
+    std::vector<uint8_t> wire(max_wire_size(plain_len, compress_enabled,
+                                            compress_threshold));
+    wire.resize(encrypt_into(wire.data(), wire.size(), plain, plain_len, nonce,
+                             compress_enabled, compress_threshold, compress_level));
+    return wire;
+}
+
+size_t NoiseSession::encrypt_into(uint8_t* out, size_t out_cap,
+                                  const void* plain, size_t plain_len,
+                                  uint64_t nonce,
+                                  bool compress_enabled,
+                                  int compress_threshold,
+                                  int compress_level,
+                                  const ZstdDict* dict) {
     LOG_TRACE("encrypt: {} bytes, nonce={}", plain_len, nonce);
-    bool compressed = false;
-    std::vector<uint8_t> comp_buf;
-
-    if (compress_enabled
-        && plain_len > static_cast<size_t>(compress_threshold)) {
-        const size_t bound = ZSTD_compressBound(plain_len);
-        comp_buf.resize(bound);
-        const size_t csize = ZSTD_compress(comp_buf.data(), bound,
-                                            static_cast<const uint8_t*>(plain),
-                                            plain_len, compress_level);
+    constexpr size_t MAC_SIZE = crypto_aead_chacha20poly1305_IETF_ABYTES;
+    // Формируем body прямо в out, затем шифруем его на месте
+    const size_t body_len = encode_body(out, out_cap - MAC_SIZE, plain, plain_len,
+                                        compress_enabled, compress_threshold,
+                                        compress_level, dict);
+    return seal_in_place(out, body_len, nonce);
+}
+
+size_t NoiseSession::encode_body(uint8_t* out, size_t out_cap,
+                                 const void* plain, size_t plain_len,
+                                 bool compress_enabled,
+                                 int compress_threshold,
+                                 int compress_level,
+                                 const ZstdDict* dict,
+                                 Codec codec) {
+    const bool try_zstd = compress_enabled
+                       && plain_len > static_cast<size_t>(compress_threshold)
+                       && out_cap > 9;
+
+    // body = flags + [orig_size [+ dict_id]] + data
+    if (try_zstd && codec == Codec::Lz4) {
+        const int csize = plain_len <= LZ4_MAX_INPUT_SIZE
+            ? LZ4_compress_fast_extState(lz4_thread_state(),
+                                         static_cast<const char*>(plain),
+                                         reinterpret_cast<char*>(out + 5),
+                                         static_cast<int>(plain_len),
+                                         static_cast<int>(std::min<size_t>(out_cap - 5, INT32_MAX)),
+                                         1)
+            : 0;
+        if (csize > 0 && static_cast<size_t>(csize) < plain_len) {
+            const uint32_t orig32 = static_cast<uint32_t>(plain_len);
+            out[0] = FLAG_LZ4;
+            std::memcpy(out + 1, &orig32, 4);
+            return 5 + static_cast<size_t>(csize);
+        }
+    } else if (try_zstd && dict) {
+        const size_t csize = ZSTD_compress_usingCDict(zstd_thread_cctx(),
+                                                      out + 9, out_cap - 9,
+                                                      plain, plain_len, dict->cdict.get());
+        if (!ZSTD_isError(csize) && 8 + csize < plain_len) {
+            const uint32_t orig32 = static_cast<uint32_t>(plain_len);
+            out[0] = FLAG_ZSTD_DICT;
+            std::memcpy(out + 1, &orig32, 4);
+            std::memcpy(out + 5, &dict->id, 4);
+            return 9 + csize;
+        }
+    } else if (try_zstd) {
+        const size_t csize = ZSTD_compressCCtx(zstd_thread_cctx(), out + 5, out_cap - 5,
+                                               plain, plain_len, compress_level);
         if (!ZSTD_isError(csize) && csize < plain_len) {
-            comp_buf.resize(csize);
-            compressed = true;
+            const uint32_t orig32 = static_cast<uint32_t>(plain_len);
+            out[0] = FLAG_ZSTD;
+            std::memcpy(out + 1, &orig32, 4);
+            return 5 + csize;
         }
     }
+    out[0] = FLAG_RAW;
+    if (plain_len && plain)
+        std::memcpy(out + 1, plain, plain_len);
+    return 1 + plain_len;
+}
+
+size_t NoiseSession::encode_stream_body(uint8_t* out, size_t out_cap,
+                                        const void* plain, size_t plain_len,
+                                        int compress_level) {
+    // body = flags + ctl + seq + orig_size + block
+    if (out_cap <= 10 || plain_len > ZstdStream::MAX_FRAME) return 0;
+    const auto b = stream.compress(out + 10, out_cap - 10, plain, plain_len, compress_level);
+    if (!b.size) return 0;
+    const uint32_t orig32 = static_cast<uint32_t>(plain_len);
+    out[0] = FLAG_ZSTD_STREAM;
+    out[1] = b.reset ? STREAM_CTL_RESET : 0;
+    std::memcpy(out + 2, &b.seq, 4);
+    std::memcpy(out + 6, &orig32, 4);
+    return 10 + b.size;
+}
+
+// Кадр не зависит от шифра: MAC_SIZE ниже одинаков для обоих AEAD
+static_assert(crypto_aead_aes256gcm_ABYTES    == crypto_aead_chacha20poly1305_IETF_ABYTES);
+static_assert(crypto_aead_aes256gcm_NPUBBYTES == crypto_aead_chacha20poly1305_IETF_NPUBBYTES);
+static_assert(crypto_aead_aes256gcm_KEYBYTES  == noise::KEYLEN);
+
+const char* aead_name(AeadCipher c) noexcept {
+    return c == AeadCipher::Aes256Gcm ? "aes-256-gcm" : "chacha20-poly1305";
+}
+
+bool aes256gcm_available() noexcept {
+    // Результат зависит только от CPU — проверяем один раз
+    static const bool ok = sodium_init() >= 0 && crypto_aead_aes256gcm_is_available();
+    return ok;
+}
+
+namespace {
 
-    // Формируем body: flags + [orig_size] + data
-    std::vector<uint8_t> body;
-    if (compressed) {
-        const uint32_t orig32 = static_cast<uint32_t>(plain_len);
-        body.resize(1 + 4 + comp_buf.size());
-        body[0] = FLAG_ZSTD;
-        std::memcpy(body.data() + 1, &orig32, 4);
-        std::memcpy(body.data() + 5, comp_buf.data(), comp_buf.size());
+uint64_t steady_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// k' = HKDF(k) — та же деривация, что и у rekey_session (первый выход)
+void next_key(const uint8_t* key, uint8_t* out) {
+    uint8_t unused[noise::KEYLEN];
+    noise::hkdf2(key, nullptr, 0, out, unused);
+    sodium_memzero(unused, sizeof(unused));
+}
+
+} // namespace
+
+bool NoiseSession::set_cipher(AeadCipher c) noexcept {
+    if (c == AeadCipher::Aes256Gcm) {
+        if (!aes256gcm_available()) return false;
+        for (int ph = 0; ph < 2; ++ph) {
+            crypto_aead_aes256gcm_beforenm(&aes_send_[ph], tx_key(ph));
+            crypto_aead_aes256gcm_beforenm(&aes_recv_[ph], rx_key(ph));
+        }
     } else {
-        body.resize(1 + plain_len);
-        body[0] = FLAG_RAW;
-        if (plain_len && plain)
-            std::memcpy(body.data() + 1, plain, plain_len);
+        sodium_memzero(aes_send_, sizeof(aes_send_));
+        sodium_memzero(aes_recv_, sizeof(aes_recv_));
     }
+    cipher_ = c;
+    return true;
+}
 
-    // AEAD encrypt (ChaChaPoly IETF)
-    constexpr size_t MAC_SIZE = crypto_aead_chacha20poly1305_IETF_ABYTES;
-    std::vector<uint8_t> wire(body.size() + MAC_SIZE);
+uint64_t NoiseSession::rotate_tx(uint64_t now_ns) {
+    std::unique_lock lk(tx_rotate_mu_, std::try_to_lock);
+    if (!lk.owns_lock()) return 0;   // другой поток уже ротирует
+
+    // Получатель узнаёт эпоху только по кадрам (кроме нулевой): пропущенная
+    // эпоха рассинхронизировала бы фазу. Интервал > overlap — предыдущий ключ
+    // получателя гарантированно отработал до следующей смены.
+    const uint32_t epoch = tx_epoch_.load(std::memory_order_relaxed);
+    const uint64_t last  = tx_rotated_at_.load(std::memory_order_relaxed);
+    if (epoch && tx_packets_.load(std::memory_order_relaxed) == 0) return 0;
+    if (last && now_ns - last < REKEY_MIN_INTERVAL_NS)            return 0;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const bool     next  = !(epoch & 1);
+    next_key(tx_key(!next), tx_key(next));
+    if (cipher_ == AeadCipher::Aes256Gcm)
+        crypto_aead_aes256gcm_beforenm(&aes_send_[next], tx_key(next));
+
+    tx_packets_.store(0, std::memory_order_relaxed);
+    tx_bytes_.store(0, std::memory_order_relaxed);
+    tx_rotated_at_.store(now_ns, std::memory_order_relaxed);
+    // Блок под новым ключом не ссылается на plaintext прошлой эпохи: сброс
+    // истории публикуется тем же release, что и фаза
+    stream.restart_tx();
+    // release: ключ новой фазы записан до того, как отправители её увидят
+    tx_epoch_.store(epoch + 1, std::memory_order_release);
+
+    return std::max<uint64_t>(1, static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count()));
+}
 
+size_t NoiseSession::seal_in_place(uint8_t* body, size_t body_len, uint64_t nonce,
+                                   bool phase) {
+    // AEAD encrypt in-place: c == m допускается libsodium для обоих шифров
     uint8_t nonce12[12]{};
     std::memcpy(nonce12 + 4, &nonce, 8);
 
     unsigned long long clen = 0;
-    crypto_aead_chacha20poly1305_ietf_encrypt(
-        wire.data(), &clen,
-        body.data(), body.size(),
-        nullptr, 0,
-        nullptr, nonce12, send_key);
+    if (cipher_ == AeadCipher::Aes256Gcm)
+        crypto_aead_aes256gcm_encrypt_afternm(
+            body, &clen,
+            body, body_len,
+            nullptr, 0,
+            nullptr, nonce12, &aes_send_[phase]);
+    else
+        crypto_aead_chacha20poly1305_ietf_encrypt(
+            body, &clen,
+            body, body_len,
+            nullptr, 0,
+            nullptr, nonce12, tx_key(phase));
 
-    wire.resize(static_cast<size_t>(clen));
-    return wire;
+    tx_packets_.fetch_add(1, std::memory_order_relaxed);
+    tx_bytes_.fetch_add(body_len, std::memory_order_relaxed);
+    return static_cast<size_t>(clen);
+}
+
+std::vector<uint8_t> NoiseSession::decrypt(const void* wire, size_t wire_len,
+                                            uint64_t nonce,
+                                            const ZstdDictionaries* dicts) {
+    std::vector<uint8_t> out;
+    if (!decrypt_into(out, wire, wire_len, nonce, dicts)) return {};
+    return out;
 }
 
-std::vector<uint8_t> NoiseSession::decrypt(const void* wire_ptr, size_t wire_len,
-                                            uint64_t nonce) {
+bool NoiseSession::open(uint8_t* m, unsigned long long* mlen,
+                        const uint8_t* c, size_t clen, const uint8_t* npub,
+                        const uint8_t* key,
+                        const crypto_aead_aes256gcm_state* aes) const noexcept {
+    return (cipher_ == AeadCipher::Aes256Gcm
+        ? crypto_aead_aes256gcm_decrypt_afternm(m, mlen, nullptr, c, clen,
+                                                nullptr, 0, npub, aes)
+        : crypto_aead_chacha20poly1305_ietf_decrypt(m, mlen, nullptr, c, clen,
+                                                    nullptr, 0, npub, key)) == 0;
+}
+
+bool NoiseSession::open_other_phase(uint8_t* m, unsigned long long* mlen,
+                                    const uint8_t* c, size_t clen,
+                                    const uint8_t* npub, bool phase) {
+    std::lock_guard lk(rx_rotate_mu_);
+
+    // Пока ждали мьютекс, ротацию мог принять другой поток
+    const uint32_t epoch = rx_epoch_.load(std::memory_order_relaxed);
+    if ((epoch & 1) == phase)
+        return open(m, mlen, c, clen, npub, rx_key(phase), &aes_recv_[phase]);
+
+    // Хвост предыдущей эпохи: кадры, отправленные до ротации пира
+    const uint64_t now = steady_ns();
+    if (now < rx_prev_until_) {
+        if (!open(m, mlen, c, clen, npub, rx_key(phase), &aes_recv_[phase]))
+            return false;
+        rx_prev_hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Пир сменил ключ: пробный вывод следующего, фиксируем только после MAC —
+    // поддельный кадр с чужой фазой не сдвигает эпоху
+    const auto t0 = std::chrono::steady_clock::now();
+    uint8_t key[noise::KEYLEN];
+    next_key(rx_key(!phase), key);
+    crypto_aead_aes256gcm_state aes{};
+    if (cipher_ == AeadCipher::Aes256Gcm) crypto_aead_aes256gcm_beforenm(&aes, key);
+    const bool ok = open(m, mlen, c, clen, npub, key, &aes);
+    if (ok) {
+        std::memcpy(rx_key(phase), key, noise::KEYLEN);
+        aes_recv_[phase] = aes;
+        rx_prev_until_ = now + REKEY_OVERLAP_NS;
+        rx_rotated_at_.store(now, std::memory_order_relaxed);
+        rx_rotate_cost_.store(std::max<uint64_t>(1, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count())),
+            std::memory_order_relaxed);
+        rx_epoch_.store(epoch + 1, std::memory_order_release);
+    }
+    sodium_memzero(key, sizeof(key));
+    sodium_memzero(&aes, sizeof(aes));
+    return ok;
+}
+
+bool NoiseSession::decrypt_into(std::vector<uint8_t>& out,
+                                const void* wire_ptr, size_t wire_len,
+                                uint64_t nonce,
+                                const ZstdDictionaries* dicts,
+                                bool phase) {
     LOG_TRACE("decrypt: {} bytes, nonce={}", wire_len, nonce);
     constexpr size_t MAC_SIZE = crypto_aead_chacha20poly1305_IETF_ABYTES;
-    if (wire_len < MAC_SIZE) {
+    out.clear();
+    if (wire_len <= MAC_SIZE) {
         LOG_WARN("decrypt: too short ({} bytes)", wire_len);
-        return {};
-    }
-
-    if (!recv_window.accept(nonce)) {
-        LOG_WARN("decrypt: replay/out-of-window (nonce={})", nonce);
-        return {};
+        return false;
     }
 
     uint8_t nonce12[12]{};
     std::memcpy(nonce12 + 4, &nonce, 8);
 
+    // AEAD расшифровывает прямо в буфер получателя: capacity @p out
+    // переиспользуется, промежуточного вектора тела нет
     const auto* wire = static_cast<const uint8_t*>(wire_ptr);
-    std::vector<uint8_t> body(wire_len - MAC_SIZE);
+    out.resize(wire_len - MAC_SIZE);
 
     unsigned long long mlen = 0;
-    if (crypto_aead_chacha20poly1305_ietf_decrypt(
-            body.data(), &mlen, nullptr,
-            wire, wire_len,
-            nullptr, 0,
-            nonce12, recv_key) != 0) {
-        LOG_WARN("decrypt: AEAD MAC failed (nonce={})", nonce);
-        return {};
+    const bool current = (rx_epoch_.load(std::memory_order_acquire) & 1) == phase;
+    const bool ok = current
+        ? open(out.data(), &mlen, wire, wire_len, nonce12, rx_key(phase), &aes_recv_[phase])
+        : open_other_phase(out.data(), &mlen, wire, wire_len, nonce12, phase);
+    if (!ok) {
+        LOG_WARN("decrypt: AEAD MAC failed (nonce={}, phase={})", nonce, int(phase));
+        out.clear();
+        return false;
+    }
+
+    // Окно сдвигается только аутентифицированными nonce: поддельный кадр
+    // не может «занять» чужой packet_id или увести окно вперёд
+    if (!recv_window.accept(nonce)) {
+        LOG_WARN("decrypt: replay/out-of-window (nonce={})", nonce);
+        out.clear();
+        return false;
     }
 
-    body.resize(static_cast<size_t>(mlen));
-    if (body.empty()) { LOG_WARN("decrypt: empty body"); return {}; }
+    // RAW: payload уже на месте, сдвигаем на байт флага (memmove в кэше)
+    if (out[0] == FLAG_RAW) {
+        out.erase(out.begin());
+        return true;
+    }
+
+    auto plain = decode_body(out.data(), static_cast<size_t>(mlen), dicts);
+    if (plain.empty()) { out.clear(); return false; }
+    out.swap(plain);
+    return true;
+}
+
+std::vector<uint8_t> NoiseSession::decode_body(const uint8_t* body, size_t body_len,
+                                                const ZstdDictionaries* dicts) {
+    if (!body_len) { LOG_WARN("decrypt: empty body"); return {}; }
 
     const uint8_t  flags   = body[0];
-    const uint8_t* payload = body.data() + 1;
-    const size_t   plen    = body.size() - 1;
+    const uint8_t* payload = body + 1;
+    const size_t   plen    = body_len - 1;
 
     if (flags == FLAG_RAW)
         return std::vector<uint8_t>(payload, payload + plen);
 
-    if (flags == FLAG_ZSTD) {
+    if (flags == FLAG_LZ4) {
         if (plen < 4) { LOG_WARN("decrypt: no orig_size"); return {}; }
         uint32_t orig_size = 0;
         std::memcpy(&orig_size, payload, 4);
+        if (!orig_size || orig_size > 128 * 1024 * 1024
+            || plen - 4 > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+            LOG_WARN("decrypt: implausible orig_size={}", orig_size);
+            return {};
+        }
+        std::vector<uint8_t> plain(orig_size);
+        const int dsize = LZ4_decompress_safe(reinterpret_cast<const char*>(payload + 4),
+                                              reinterpret_cast<char*>(plain.data()),
+                                              static_cast<int>(plen - 4),
+                                              static_cast<int>(orig_size));
+        if (dsize < 0) {
+            LOG_WARN("decrypt: LZ4 error ({})", dsize);
+            return {};
+        }
+        plain.resize(static_cast<size_t>(dsize));
+        return plain;
+    }
+
+    if (flags == FLAG_ZSTD || flags == FLAG_ZSTD_DICT) {
+        const size_t hdr_len = flags == FLAG_ZSTD ? 4 : 8;
+        if (plen < hdr_len) { LOG_WARN("decrypt: no orig_size"); return {}; }
+        uint32_t orig_size = 0;
+        std::memcpy(&orig_size, payload, 4);
         if (!orig_size || orig_size > 128 * 1024 * 1024) {
             LOG_WARN("decrypt: implausible orig_size={}", orig_size);
             return {};
         }
+
+        std::shared_ptr<const ZstdDict> dict;
+        if (flags == FLAG_ZSTD_DICT) {
+            uint32_t dict_id = 0;
+            std::memcpy(&dict_id, payload + 4, 4);
+            if (dicts) dict = dicts->find(dict_id);
+            if (!dict) {
+                LOG_WARN("decrypt: unknown zstd dictionary id={}", dict_id);
+                return {};
+            }
+        }
+
         std::vector<uint8_t> plain(orig_size);
-        const size_t dsize = ZSTD_decompress(plain.data(), orig_size,
-                                              payload + 4, plen - 4);
+        const size_t dsize = dict
+            ? ZSTD_decompress_usingDDict(zstd_thread_dctx(), plain.data(), orig_size,
+                                         payload + hdr_len, plen - hdr_len,
+                                         dict->ddict.get())
+            : ZSTD_decompressDCtx(zstd_thread_dctx(), plain.data(), orig_size,
+                                  payload + hdr_len, plen - hdr_len);
         if (ZSTD_isError(dsize)) {
             LOG_WARN("decrypt: ZSTD error: {}", ZSTD_getErrorName(dsize));
             return {};
@@ -241,6 +551,19 @@ std::vector<uint8_t> NoiseSession::decrypt(const void* wire_ptr, size_t wire_len
         return plain;
     }
 
+    if (flags == FLAG_ZSTD_STREAM) {
+        if (plen < 9) { LOG_WARN("decrypt: short stream block"); return {}; }
+        uint32_t seq = 0, orig_size = 0;
+        std::memcpy(&seq, payload + 1, 4);
+        std::memcpy(&orig_size, payload + 5, 4);
+        if (!orig_size || orig_size > ZstdStream::MAX_FRAME) {
+            LOG_WARN("decrypt: implausible stream orig_size={}", orig_size);
+            return {};
+        }
+        return stream.decompress(seq, (payload[0] & STREAM_CTL_RESET) != 0,
+                                 payload + 9, plen - 9, orig_size);
+    }
+
     LOG_WARN("decrypt: unknown flags 0x{:02X}", flags);
     return {};
 }
@@ -249,28 +572,29 @@ std::vector<uint8_t> NoiseSession::decrypt(const void* wire_ptr, size_t wire_len
 // build_frame / send_frame / flush
 // ═══════════════════════════════════════════════════════════════════════════════
 
-std::vector<uint8_t> ConnectionManager::Impl::build_frame(conn_id_t id,
-                                                            uint32_t msg_type,
-                                                            std::span<const uint8_t> payload) {
+sdk::FrameBuffer ConnectionManager::Impl::build_frame(conn_id_t id,
+                                                       uint32_t msg_type,
+                                                       std::span<const uint8_t> payload,
+                                                       uint8_t flags,
+                                                       std::span<const uint8_t> encoded,
+                                                       bool stream) {
     auto rec = rcu_find(id);
     if (!rec) return {};
     LOG_TRACE("build_frame #{}: type={} len={}", id, msg_type, payload.size());
 
-    const bool is_handshake = (msg_type == MSG_TYPE_NOISE_INIT)
-                           || (msg_type == MSG_TYPE_NOISE_RESP)
-                           || (msg_type == MSG_TYPE_NOISE_FIN);
+    const bool is_handshake = is_handshake_msg(msg_type);
 
     // ── Localhost fast-path: без шифрования/сжатия ───────────────────────────
     if (rec->localhost_passthrough && !is_handshake) {
         header_t hdr{};
         hdr.magic        = GNET_MAGIC;
         hdr.proto_ver    = GNET_PROTO_VER;
-        hdr.flags        = GNET_FLAG_TRUSTED;
+        hdr.flags        = GNET_FLAG_TRUSTED | flags;
         hdr.payload_type = static_cast<uint16_t>(msg_type);
         hdr.payload_len  = static_cast<uint32_t>(payload.size());
         hdr.packet_id    = rec->send_packet_id.fetch_add(1, std::memory_order_relaxed);
 
-        std::vector<uint8_t> frame(sizeof(header_t) + payload.size());
+        sdk::FrameBuffer frame(sizeof(header_t) + payload.size());
         std::memcpy(frame.data(), &hdr, sizeof(header_t));
         if (!payload.empty())
             std::memcpy(frame.data() + sizeof(header_t),
@@ -279,47 +603,158 @@ std::vector<uint8_t> ConnectionManager::Impl::build_frame(conn_id_t id,
     }
 
     // ── Standard path ────────────────────────────────────────────────────────
-    thread_local std::vector<uint8_t> tl_enc;
-
+    // Один pooled-буфер на кадр: header_t резервируется впереди, body шифруется
+    // на месте сразу за ним — без промежуточных comp_buf/body/wire.
     const uint64_t pkt_id = rec->send_packet_id.fetch_add(1, std::memory_order_relaxed);
 
     const bool do_encrypt = !is_handshake
                          && !rec->is_localhost
                          && rec->session;
 
-    std::span<const uint8_t> final_payload = payload;
+    sdk::FrameBuffer frame;
+    size_t body_len = payload.size();
+    // Фаза читается один раз: флаг заголовка и ключ seal обязаны совпасть,
+    // даже если другой поток ротирует ключ посреди кадра
+    const bool key_phase = do_encrypt && rec->session->tx_phase();
 
-    if (do_encrypt) {
-        const bool comp_en = config_ ? config_->compression.enabled   : true;
-        const int  comp_th = config_ ? config_->compression.threshold : 512;
-        const int  comp_lv = config_ ? config_->compression.level     : 1;
-        tl_enc = rec->session->encrypt(payload.data(), payload.size(),
-                                        pkt_id, comp_en, comp_th, comp_lv);
-        final_payload = tl_enc;
+    constexpr size_t MAC_SIZE = crypto_aead_chacha20poly1305_IETF_ABYTES;
+    if (do_encrypt && !encoded.empty()) {
+        // Тело уже сжато один раз на весь broadcast — только AEAD этой сессии
+        frame = sdk::FrameBuffer(sizeof(header_t) + encoded.size() + MAC_SIZE);
+        std::memcpy(frame.data() + sizeof(header_t), encoded.data(), encoded.size());
+        body_len = rec->session->seal_in_place(frame.data() + sizeof(header_t),
+                                               encoded.size(), pkt_id, key_phase);
+        if (encoded[0] != FLAG_RAW)
+            bus_.add_compression(msg_type, payload.size(), encoded.size(),
+                                 encoded[0] == FLAG_ZSTD_DICT, encoded[0] == FLAG_LZ4);
+    } else if (do_encrypt) {
+        bool       comp_en  = config_ ? config_->compression.enabled   : true;
+        int        comp_th  = config_ ? config_->compression.threshold : 512;
+        int        comp_lv  = config_ ? config_->compression.level     : 1;
+        const bool adaptive = config_ ? config_->compression.adaptive  : true;
+        const Codec codec   = codec_for_peer(*rec);
+
+        // Словарь — только если пир объявил его ID; с ним жмём и мелкие payload.
+        // Поток сессии заменяет словарь: история прошлых кадров — тот же контекст
+        const bool use_stream = stream && payload.size() <= ZstdStream::MAX_FRAME;
+        std::shared_ptr<const ZstdDict> dict;
+        if (comp_en && codec == Codec::Zstd) {
+            if (dict_sampling_) dicts_.sample(msg_type, payload);
+            if (use_stream || (dict = dict_for_peer(*rec, msg_type)))
+                comp_th = std::min(comp_th, config_ ? config_->compression.dict_threshold : 64);
+        }
+
+        // Адаптивная политика: несжимаемое — сразу raw; уровень — по очереди
+        const bool comp_try = comp_en && payload.size() > static_cast<size_t>(comp_th);
+        bool timed = false;
+        if (comp_try && adaptive) {
+            auto& ac = rec->compression;
+            if (!ac.probe(payload)) {
+                comp_en = false;
+            } else if (codec == Codec::Zstd) {   // уровень у LZ4 не подбираем
+                const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+                if (ac.adapt_due(now)) {
+                    const auto q = find_queue(id);
+                    uint64_t tx = 0;
+                    for (const auto& tp : rec->transport_paths)
+                        tx += tp.state->tx_bytes.load(std::memory_order_relaxed);
+                    ac.adapt(comp_lv, config_ ? config_->compression.max_level : 9,
+                             q ? q->pending_bytes.load(std::memory_order_relaxed) : 0,
+                             tx, now);
+                }
+                if (const int lv = ac.level.load(std::memory_order_relaxed)) comp_lv = lv;
+                timed = true;
+            }
+        }
+
+        // encode_body + seal_in_place == encrypt_into; флаг тела нужен статистике
+        const size_t cap = NoiseSession::max_wire_size(payload.size(), comp_en, comp_th);
+        frame = sdk::FrameBuffer(sizeof(header_t) + cap);
+        uint8_t* body = frame.data() + sizeof(header_t);
+        const auto t0 = timed ? std::chrono::steady_clock::now()
+                              : std::chrono::steady_clock::time_point{};
+        size_t plain_len = 0;
+        if (use_stream && comp_en && comp_try)
+            plain_len = rec->session->encode_stream_body(body, cap - MAC_SIZE,
+                                                         payload.data(), payload.size(),
+                                                         comp_lv);
+        if (!plain_len)
+            plain_len = NoiseSession::encode_body(body, cap - MAC_SIZE,
+                                                  payload.data(), payload.size(),
+                                                  comp_en, comp_th, comp_lv, dict.get(),
+                                                  codec);
+        if (timed)
+            rec->compression.record(payload.size(), static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - t0).count()));
+        // Пропуски probe() уже видны в AdaptiveCompression::skipped.
+        if (comp_try && comp_en)
+            bus_.add_compression(msg_type, payload.size(),
+                                 body[0] == FLAG_RAW ? payload.size() : plain_len,
+                                 body[0] == FLAG_ZSTD_DICT, body[0] == FLAG_LZ4);
+        body_len = rec->session->seal_in_place(body, plain_len, pkt_id, key_phase);
+        frame.resize(sizeof(header_t) + body_len);
+    } else {
+        frame = sdk::FrameBuffer(sizeof(header_t) + payload.size());
+        if (!payload.empty())
+            std::memcpy(frame.data() + sizeof(header_t),
+                        payload.data(), payload.size());
     }
 
     header_t hdr{};
     hdr.magic        = GNET_MAGIC;
     hdr.proto_ver    = GNET_PROTO_VER;
+    hdr.flags        = flags;
     if (rec->is_localhost)
-        hdr.flags = GNET_FLAG_TRUSTED;
+        hdr.flags |= GNET_FLAG_TRUSTED;
+    if (key_phase)
+        hdr.flags |= GNET_FLAG_KEY_PHASE;
     hdr.payload_type = static_cast<uint16_t>(msg_type);
-    hdr.payload_len  = static_cast<uint32_t>(final_payload.size());
+    hdr.payload_len  = static_cast<uint32_t>(body_len);
     hdr.packet_id    = pkt_id;
 
-    std::vector<uint8_t> frame(sizeof(header_t) + final_payload.size());
     std::memcpy(frame.data(), &hdr, sizeof(header_t));
-    if (!final_payload.empty())
-        std::memcpy(frame.data() + sizeof(header_t),
-                    final_payload.data(), final_payload.size());
+    if (do_encrypt) maybe_rekey(id, *rec);
     return frame;
 }
 
 bool ConnectionManager::Impl::flush_frames_to_connector(
-        conn_id_t id, connector_ops_t* ops,
-        std::vector<std::vector<uint8_t>>& frames) {
+        conn_id_t id, connector_ops_t* ops, PerConnQueue& q,
+        std::vector<sdk::FrameBuffer>& frames) {
     if (frames.empty()) return true;
 
+    // Коннектор с on_sent(): байты остаются в окне, пока он их не подтвердит.
+    // in_flight растёт ДО вызова — иначе быстрый on_sent() придёт раньше.
+    const bool reports = (ops->flags & CONNECTOR_FLAG_REPORTS_SENT) != 0;
+    size_t batch_bytes = 0;
+    for (auto& f : frames) batch_bytes += f.size();
+    if (reports) q.in_flight.fetch_add(batch_bytes, std::memory_order_relaxed);
+
+    // v2: передаём коннектору собственные ссылки на pooled-кадры — он пишет
+    // их в сокет без копирования. batch остаётся у нас для fallback-пути.
+    if (ops->send_owned) {
+        thread_local std::vector<owned_buf_t> owned;
+        owned.clear();
+        for (auto& f : frames) {
+            sdk::FrameBuffer ref = f;
+            owned_buf_t ob{ref.data(), ref.size(),
+                           &sdk::FrameBuffer::release_detached, nullptr};
+            ob.release_ctx = ref.detach();
+            owned.push_back(ob);
+        }
+        const int rc = ops->send_owned(ops->connector_ctx, id,
+                                        owned.data(), static_cast<int>(owned.size()));
+        if (rc < 0) {
+            LOG_ERROR("send_owned #{}: connector error", id);
+            if (reports) q.credit(batch_bytes);
+            return false;
+        }
+        bus_.emit_stat({StatsEvent::Kind::TxBytes,  batch_bytes, id});
+        bus_.emit_stat({StatsEvent::Kind::TxPacket, (uint64_t)frames.size(), id});
+        return true;
+    }
+
     if (ops->send_gather && frames.size() > 1) {
         std::vector<struct iovec> iov;
         iov.reserve(frames.size());
@@ -330,11 +765,10 @@ bool ConnectionManager::Impl::flush_frames_to_connector(
                                          iov.data(), static_cast<int>(iov.size()));
         if (rc < 0) {
             LOG_ERROR("send_gather #{}: connector error", id);
+            if (reports) q.credit(batch_bytes);
             return false;
         }
-        size_t total = 0;
-        for (auto& f : frames) total += f.size();
-        bus_.emit_stat({StatsEvent::Kind::TxBytes,  total, id});
+        bus_.emit_stat({StatsEvent::Kind::TxBytes,  batch_bytes, id});
         bus_.emit_stat({StatsEvent::Kind::TxPacket, (uint64_t)frames.size(), id});
         return true;
     } else {
@@ -347,6 +781,7 @@ bool ConnectionManager::Impl::flush_frames_to_connector(
                 bus_.emit_stat({StatsEvent::Kind::TxPacket, 1,        id});
             } else {
                 LOG_ERROR("send_to #{}: connector error", id);
+                if (reports) q.credit(f.size());
                 all_ok = false;
             }
         }
@@ -354,69 +789,280 @@ bool ConnectionManager::Impl::flush_frames_to_connector(
     }
 }
 
-void ConnectionManager::Impl::send_frame(conn_id_t id, uint32_t msg_type,
-                                          std::span<const uint8_t> payload) {
-    if (shutting_down_.load(std::memory_order_relaxed)) return;
-    LOG_TRACE("send_frame #{}: type={} payload={}", id, msg_type, payload.size());
-    auto frame = build_frame(id, msg_type, payload);
-    if (frame.empty()) return;
-
+bool ConnectionManager::Impl::send_frame(conn_id_t id, uint32_t msg_type,
+                                          std::span<const uint8_t> payload,
+                                          SendClass cls, uint8_t flags,
+                                          std::span<const uint8_t> encoded) {
+    if (shutting_down_.load(std::memory_order_relaxed)) return false;
+    if (cls == SendClass::Auto) cls = send_class_of(msg_type);
+    LOG_TRACE("send_frame #{}: type={} payload={} class={}",
+              id, msg_type, payload.size(), static_cast<int>(cls));
     auto q = get_or_create_queue(id);
-    if (!q->try_push(std::move(frame))) {
+    // Окно закрыто — не тратим шифрование на кадр, который всё равно отклоним.
+    // Control окном не ограничен: heartbeat не должен теряться из-за bulk.
+    if (cls != SendClass::Control && q->window() < payload.size()) {
+        q->want_writable.store(true, std::memory_order_release);
+        bus_.emit_drop(id, DropReason::PerConnLimitExceeded);
+        LOG_DEBUG("send_frame #{}: send window exhausted", id);
+        return false;
+    }
+
+    // Multipath striping: bulk-кадр получает порядковый номер, чтобы приёмник
+    // восстановил порядок после доставки по разным путям. Номер расходуется
+    // только после try_push: кадр, не попавший в очередь, оставил бы пробел,
+    // и приёмник ждал бы его REORDER_TIMEOUT.
+    thread_local std::vector<uint8_t> striped;
+    std::shared_ptr<ConnectionRecord> stripe_rec;
+    std::unique_lock<std::mutex>      stripe_lk;
+    if (cls == SendClass::Bulk && multipath_stripe_.load(std::memory_order_relaxed)) {
+        if (auto rec = rcu_find(id); rec && should_stripe(*rec)) {
+            stripe_lk  = std::unique_lock(rec->stripe_tx_mu);
+            const uint64_t seq = rec->send_stripe_seq.load(std::memory_order_relaxed);
+            stripe_rec = std::move(rec);
+            striped.resize(sizeof(seq) + payload.size());
+            std::memcpy(striped.data(), &seq, sizeof(seq));
+            if (!payload.empty())
+                std::memcpy(striped.data() + sizeof(seq), payload.data(), payload.size());
+            payload = striped;
+            flags  |= GNET_FLAG_STRIPED;
+            encoded = {};   // префикс меняет plaintext — общее тело не подходит
+        }
+    }
+
+    // Потоковое сжатие: блоки должны лечь в очередь в порядке сжатия, поэтому
+    // tx_mu держим до try_push. Только Interactive — кольца разных классов
+    // дренируются с обгоном.
+    std::shared_ptr<ConnectionRecord> stream_rec;
+    std::unique_lock<std::mutex>      stream_lk;
+    if (cls == SendClass::Interactive && encoded.empty()
+        && !(flags & (GNET_FLAG_STRIPED | GNET_FLAG_FRAGMENT))) {
+        if (auto rec = rcu_find(id); rec && stream_compression(*rec)) {
+            stream_lk  = std::unique_lock(rec->session->stream.tx_mu);
+            stream_rec = std::move(rec);
+        }
+    }
+
+    auto frame = build_frame(id, msg_type, payload, flags, encoded, stream_rec != nullptr);
+    if (frame.empty()) return false;
+
+    if (!q->try_push(std::move(frame), cls)) {
+        // Блок уже в истории кодера, но приёмник его не увидит
+        if (stream_rec) stream_rec->session->stream.restart_tx();
         bus_.emit_drop(id, DropReason::PerConnLimitExceeded);
         LOG_WARN("send_frame #{}: per-conn queue full", id);
+        return false;
+    }
+    if (stream_lk) stream_lk.unlock();
+    if (stripe_rec) {
+        stripe_rec->send_stripe_seq.fetch_add(1, std::memory_order_relaxed);
+        stripe_lk.unlock();
+    }
+    schedule_flush(id, std::move(q));
+    return true;
+}
+
+void ConnectionManager::Impl::schedule_flush(conn_id_t id, std::shared_ptr<PerConnQueue> q) {
+    auto* ioc = flush_ioc_.load(std::memory_order_acquire);
+    if (!ioc) { flush_queue(id, *q); return; }
+
+    // Задача уже в очереди io_context — она заберёт и этот кадр
+    if (q->flush_scheduled.exchange(true, std::memory_order_acq_rel)) return;
+
+    auto task = [this, id, q] {
+        // RMW (а не store): синхронизируется с exchange продюсера, поэтому
+        // кадры, запушенные до этого момента, видны flush_queue ниже;
+        // более поздние продюсеры запланируют новую задачу.
+        q->flush_scheduled.exchange(false, std::memory_order_acq_rel);
+        flush_queue(id, *q);
+    };
+
+    const int delay_us = config_ ? config_->core.flush_delay_us : 0;
+    if (delay_us <= 0) {
+        boost::asio::post(*ioc, std::move(task));
         return;
     }
-    flush_queue(id, *q);
+    auto timer = std::make_shared<boost::asio::steady_timer>(
+        *ioc, std::chrono::microseconds(delay_us));
+    timer->async_wait([timer, task = std::move(task)](const boost::system::error_code&) {
+        task();   // даже при отмене — иначе flush_scheduled останется поднятым
+    });
 }
 
 void ConnectionManager::Impl::flush_queue(conn_id_t id, PerConnQueue& q) {
     if (shutting_down_.load(std::memory_order_relaxed)) return;
+    drain_queue(id, q);
+}
+
+void ConnectionManager::Impl::drain_queue(conn_id_t id, PerConnQueue& q) {
     auto rec = rcu_find(id);
     if (!rec) return;
 
-    auto batch = q.drain_batch(64);
-    if (batch.empty()) return;
+    // Один дренер на соединение: проигравшие потоки просто оставляют кадр
+    // в кольце — текущий владелец draining заберёт его (end_drain() ловит
+    // кадры, опубликованные после последнего pop).
+    do {
+        if (!q.try_begin_drain()) return;
+        for (;;) {
+            auto batch = q.pop_batch(FLUSH_MAX_FRAMES);
+            if (batch.empty()) break;
+            bus_.emit_stat({StatsEvent::Kind::Flush, batch.size(), id});
+            flush_batch(id, *rec, q, batch);
+        }
+    } while (q.end_drain());
+
+    // Коннекторы без on_sent() освобождают окно сразу после передачи
+    notify_if_writable(id, q);
+}
+
+void ConnectionManager::Impl::notify_if_writable(conn_id_t id, PerConnQueue& q) {
+    kick_parked(id, q);
+    if (q.take_writable())
+        bus_.on_writable.emit(id);
+}
+
+void ConnectionManager::Impl::handle_sent(conn_id_t id, size_t bytes) {
+    // transport_conn_id вторичного пути → peer conn_id (очередь общая)
+    conn_id_t peer_id = id;
+    {
+        std::shared_lock lk(transport_mu_);
+        auto it = transport_index_.find(id);
+        if (it != transport_index_.end()) peer_id = it->second;
+    }
+    if (auto rec = rcu_find(peer_id))
+        if (auto* path = rec->find_path_by_transport_id(id))
+            path->state->credit(bytes);
+    auto q = find_queue(peer_id);
+    if (!q) return;
+    q->credit(bytes);
+    notify_if_writable(peer_id, *q);
+}
 
-    // Собираем активные пути, отсортированные по приоритету
+void ConnectionManager::Impl::flush_batch(conn_id_t id, ConnectionRecord& rec,
+                                          PerConnQueue& q,
+                                          std::vector<sdk::FrameBuffer>& batch) {
     std::vector<TransportPath*> paths;
-    for (auto& tp : rec->transport_paths)
+    for (auto& tp : rec.transport_paths)
         if (tp.active) paths.push_back(&tp);
-    std::sort(paths.begin(), paths.end(),
-              [](const TransportPath* a, const TransportPath* b) {
-                  return a->priority < b->priority;
-              });
-
-    // Пробуем каждый путь в порядке приоритета
-    for (auto* path : paths) {
-        auto* ops = find_connector(path->scheme);
-        if (!ops) continue;
-        if (flush_frames_to_connector(path->transport_conn_id, ops, batch)) {
-            path->consecutive_errors = 0;
+
+    // Порядок путей — за планировщиком (RTT / потери / очередь или priority)
+    auto sched = path_scheduler_.load(std::memory_order_acquire);
+    if (!paths.empty()) sched->rank(paths);
+
+    auto route = [&](std::vector<sdk::FrameBuffer>& frames) {
+        // Fallback: если transport_paths пуст — старая логика
+        if (paths.empty()) {
+            const std::string& scheme = rec.negotiated_scheme.empty()
+                ? rec.local_scheme : rec.negotiated_scheme;
+            if (auto* ops = find_connector(scheme)) {
+                flush_frames_to_connector(id, ops, q, frames);
+                return;
+            }
+            bus_.emit_drop(id, DropReason::ConnectorNotFound);
+            LOG_WARN("flush_batch #{}: all transport paths failed", id);
             return;
         }
-        path->consecutive_errors++;
-        if (path->consecutive_errors >= 3) {
-            path->active = false;
-            LOG_WARN("flush_queue #{}: path '{}' deactivated after {} consecutive errors",
-                     id, path->scheme, path->consecutive_errors);
+        if (paths.size() > 1 && multipath_stripe_.load(std::memory_order_relaxed)) {
+            stripe_batch(id, q, *sched, paths, frames);
+            return;
         }
+        send_via_paths(id, q, paths, 0, frames);
+    };
+
+    if (rec.probe_pending.load(std::memory_order_acquire) == 0) {
+        route(batch);
+        return;
     }
 
-    // Fallback: если transport_paths пуст — старая логика
-    if (paths.empty()) {
-        const std::string& scheme = rec->negotiated_scheme.empty()
-            ? rec->local_scheme : rec->negotiated_scheme;
-        auto* ops = find_connector(scheme);
-        if (ops) {
-            flush_frames_to_connector(id, ops, batch);
-            return;
+    // Heartbeat probe уходит по пути, который измеряет; кадры перед ним —
+    // раньше него, так что порядок packet_id внутри батча сохраняется
+    std::vector<sdk::FrameBuffer> run;
+    run.reserve(batch.size());
+    for (auto& f : batch) {
+        auto* path = take_probe_path(rec, PerConnQueue::packet_id_of(f));
+        if (!path) {
+            run.push_back(std::move(f));
+            continue;
         }
+        if (!run.empty()) { route(run); run.clear(); }
+        std::vector<sdk::FrameBuffer> probe;
+        probe.push_back(std::move(f));
+        transmit_on_path(id, *path, q, probe);
     }
+    if (!run.empty()) route(run);
+}
 
-    // Все пути отказали
-    bus_.emit_drop(id, DropReason::ConnectorNotFound);
-    LOG_WARN("flush_queue #{}: all transport paths failed", id);
+// ═══════════════════════════════════════════════════════════════════════════════
+// QoS send classes
+// ═══════════════════════════════════════════════════════════════════════════════
+
+SendClass ConnectionManager::Impl::default_send_class(uint32_t msg_type) noexcept {
+    switch (msg_type) {
+    case MSG_TYPE_NOISE_INIT:
+    case MSG_TYPE_NOISE_RESP:
+    case MSG_TYPE_NOISE_FIN:
+    case MSG_TYPE_NOISE_RESUME:
+    case MSG_TYPE_NOISE_RESUME_RESP:
+    case MSG_TYPE_HEARTBEAT:
+    case MSG_TYPE_ICE_SIGNAL:
+    case MSG_TYPE_SYS_DHT_PING:
+    case MSG_TYPE_SYS_HEALTH_PING:
+    case MSG_TYPE_SYS_HEALTH_PONG:
+        return SendClass::Control;
+    case MSG_TYPE_RELAY:
+        return SendClass::Relay;
+    case MSG_TYPE_FILE:
+    case MSG_TYPE_SYS_STORE_SYNC:
+        return SendClass::Bulk;
+    default:
+        return SendClass::Interactive;
+    }
+}
+
+SendClass ConnectionManager::Impl::send_class_of(uint32_t msg_type) const noexcept {
+    if (auto map = send_class_overrides_.load(std::memory_order_acquire)) {
+        if (auto it = map->find(msg_type); it != map->end())
+            return it->second;
+    }
+    return default_send_class(msg_type);
+}
+
+void ConnectionManager::Impl::set_send_class(uint32_t msg_type, SendClass cls) {
+    std::lock_guard lk(send_class_mu_);
+    auto old  = send_class_overrides_.load(std::memory_order_acquire);
+    auto next = old ? std::make_shared<SendClassMap>(*old)
+                    : std::make_shared<SendClassMap>();
+    if (cls == SendClass::Auto || cls >= SendClass::_Count) next->erase(msg_type);
+    else                                                    (*next)[msg_type] = cls;
+    send_class_overrides_.store(next->empty() ? nullptr : std::move(next),
+                                std::memory_order_release);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Compression codec / dictionaries
+// ═══════════════════════════════════════════════════════════════════════════════
+
+Codec ConnectionManager::Impl::codec_for_peer(const ConnectionRecord& rec) const noexcept {
+    if (!config_ || config_->compression.codec != "lz4") return Codec::Zstd;
+    return (rec.peer_core_meta.caps_mask & CORE_CAP_LZ4) ? Codec::Lz4 : Codec::Zstd;
+}
+
+std::shared_ptr<const ZstdDict> ConnectionManager::Impl::dict_for_peer(
+        const ConnectionRecord& rec, uint32_t msg_type) const {
+    if (rec.peer_dict_ids.empty()) return nullptr;
+    auto dict = dicts_.for_type(msg_type);
+    return dict && rec.peer_has_dict(dict->id) ? dict : nullptr;
+}
+
+uint32_t ConnectionManager::Impl::add_compression_dictionary(
+        uint32_t msg_type, std::span<const uint8_t> content) {
+    return dicts_.add(msg_type, content);
+}
+
+size_t ConnectionManager::Impl::train_compression_dictionaries() {
+    const size_t n = dicts_.train_ready();
+    if (n && config_ && !config_->compression.dict_dir.empty())
+        dicts_.save_dir(expand_home(config_->compression.dict_dir));
+    return n;
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -424,7 +1070,8 @@ void ConnectionManager::Impl::flush_queue(conn_id_t id, PerConnQueue& q) {
 // ═══════════════════════════════════════════════════════════════════════════════
 
 bool ConnectionManager::Impl::send(std::string_view uri, uint32_t msg_type,
-                                    std::span<const uint8_t> payload) {
+                                    std::span<const uint8_t> payload,
+                                    SendClass cls) {
     LOG_TRACE("send(uri): uri={} type={} len={}", uri, msg_type, payload.size());
     if (uri.empty() || shutting_down_.load(std::memory_order_relaxed)) return false;
 
@@ -446,7 +1093,7 @@ bool ConnectionManager::Impl::send(std::string_view uri, uint32_t msg_type,
                 return false;
             }
 
-            queue.emplace_back(msg_type, std::vector<uint8_t>(payload.begin(), payload.end()));
+            queue.emplace_back(msg_type, std::vector<uint8_t>(payload.begin(), payload.end()), cls);
             LOG_DEBUG("Queued message type={} for pending URI: {} (queue size: {})",
                       msg_type, uri_key, queue.size());
         }
@@ -464,9 +1111,7 @@ bool ConnectionManager::Impl::send(std::string_view uri, uint32_t msg_type,
     auto rec = rcu_find(id);
     if (!rec) return false;
 
-    const bool is_handshake = (msg_type == MSG_TYPE_NOISE_INIT)
-                           || (msg_type == MSG_TYPE_NOISE_RESP)
-                           || (msg_type == MSG_TYPE_NOISE_FIN);
+    const bool is_handshake = is_handshake_msg(msg_type);
 
     if (rec->state != STATE_ESTABLISHED && !is_handshake) {
         std::unique_lock lk(pending_mu_);
@@ -477,7 +1122,7 @@ bool ConnectionManager::Impl::send(std::string_view uri, uint32_t msg_type,
             return false;
         }
 
-        queue.emplace_back(msg_type, std::vector<uint8_t>(payload.begin(), payload.end()));
+        queue.emplace_back(msg_type, std::vector<uint8_t>(payload.begin(), payload.end()), cls);
         LOG_DEBUG("Queued message type={} for connecting URI: {} (state={})",
                   msg_type, uri_key, static_cast<int>(rec->state));
         return true;
@@ -489,35 +1134,107 @@ bool ConnectionManager::Impl::send(std::string_view uri, uint32_t msg_type,
         return false;
     }
 
-    if (payload.size() > CHUNK_SIZE * 2) {
-        size_t offset = 0;
-        while (offset < payload.size()) {
-            const size_t chunk = std::min(CHUNK_SIZE, payload.size() - offset);
-            send_frame(id, msg_type, payload.subspan(offset, chunk));
-            offset += chunk;
-        }
-    } else {
-        send_frame(id, msg_type, payload);
-    }
-    return true;
+    return send_message(id, msg_type, payload, cls);
 }
 
 bool ConnectionManager::Impl::send(conn_id_t id, uint32_t msg_type,
-                                    std::span<const uint8_t> payload) {
+                                    std::span<const uint8_t> payload,
+                                    SendClass cls) {
     LOG_TRACE("send(id): #{} type={} len={}", id, msg_type, payload.size());
     if (!rcu_find(id)) return false;
-    send_frame(id, msg_type, payload);
-    return true;
+    return send_message(id, msg_type, payload, cls);
 }
 
-void ConnectionManager::Impl::broadcast(uint32_t msg_type,
-                                         std::span<const uint8_t> payload) {
+BroadcastHandle ConnectionManager::Impl::broadcast(uint32_t msg_type,
+                                                   std::span<const uint8_t> payload,
+                                                   SendClass cls) {
     LOG_TRACE("broadcast: type={} len={}", msg_type, payload.size());
-    auto map = rcu_read();
-    for (auto& [id, rec] : *map) {
-        if (rec->state == STATE_ESTABLISHED)
-            send_frame(id, msg_type, payload);
+    std::vector<conn_id_t> peers;
+    {
+        auto map = rcu_read();
+        peers.reserve(map->size());
+        for (auto& [id, rec] : *map)
+            if (rec->state == STATE_ESTABLISHED) peers.push_back(id);
+    }
+
+    auto st = std::make_shared<BroadcastHandle::State>(peers.size());
+    BroadcastHandle handle(st);
+
+    // Мало пиров или нет executor'а — inline, как раньше: задача дороже работы
+    auto* ioc = flush_ioc_.load(std::memory_order_acquire);
+    if (!ioc || peers.size() < BROADCAST_PARALLEL_MIN) {
+        for (conn_id_t id : peers)
+            st->complete(send_message(id, msg_type, payload, cls));
+        return handle;
+    }
+
+    // Fan-out: payload копируется и сжимается один раз, шифрование и постановка
+    // в очередь каждого пира — на IO-потоках, чанками по BROADCAST_CHUNK
+    struct Job {
+        uint32_t                         type;
+        SendClass                        cls;
+        std::vector<uint8_t>             plain;
+        std::vector<uint8_t>             body;   ///< encode_body(plain); пусто — фрагментируем
+        std::vector<uint8_t>             dict_body;  ///< То же со словарём типа
+        uint32_t                         dict_id = 0;
+        bool                             lz4 = false;  ///< body закодирован LZ4
+        std::vector<conn_id_t>           peers;
+        std::shared_ptr<BroadcastHandle::State> st;
+    };
+    auto job = std::make_shared<Job>(Job{msg_type, cls,
+                                         {payload.begin(), payload.end()}, {}, {}, 0, false,
+                                         std::move(peers), st});
+    if (payload.size() <= FRAGMENT_THRESHOLD) {
+        constexpr size_t MAC_SIZE = crypto_aead_chacha20poly1305_IETF_ABYTES;
+        // Общее тело — на базовом уровне; проба энтропии одна на весь fan-out
+        const bool comp_en = (config_ ? config_->compression.enabled : true)
+                          && (!(config_ ? config_->compression.adaptive : true)
+                              || AdaptiveCompression::looks_compressible(payload));
+        const int  comp_th = config_ ? config_->compression.threshold : 512;
+        const int  comp_lv = config_ ? config_->compression.level     : 1;
+        // codec = lz4: общее тело — LZ4, пиры без CORE_CAP_LZ4 кодируются сами
+        job->lz4 = config_ && config_->compression.codec == "lz4";
+        auto encode = [&](std::vector<uint8_t>& out, int th, const ZstdDict* dict) {
+            out.resize(NoiseSession::max_wire_size(payload.size(), comp_en, th) - MAC_SIZE);
+            out.resize(NoiseSession::encode_body(out.data(), out.size(),
+                                                 job->plain.data(), job->plain.size(),
+                                                 comp_en, th, comp_lv, dict,
+                                                 job->lz4 ? Codec::Lz4 : Codec::Zstd));
+        };
+        encode(job->body, comp_th, nullptr);
+        // Пиры со словарём типа получают вторую версию тела
+        if (auto dict = comp_en && !job->lz4 ? dicts_.for_type(msg_type) : nullptr) {
+            job->dict_id = dict->id;
+            encode(job->dict_body,
+                   std::min(comp_th, config_ ? config_->compression.dict_threshold : 64),
+                   dict.get());
+        }
+    }
+
+    LOG_DEBUG("broadcast: type={} len={} → {} peers in {} task(s)",
+              msg_type, payload.size(), job->peers.size(),
+              (job->peers.size() + BROADCAST_CHUNK - 1) / BROADCAST_CHUNK);
+    for (size_t off = 0; off < job->peers.size(); off += BROADCAST_CHUNK) {
+        boost::asio::post(*ioc, [this, job, off] {
+            const size_t end = std::min(off + BROADCAST_CHUNK, job->peers.size());
+            for (size_t i = off; i < end; ++i) {
+                const conn_id_t id = job->peers[i];
+                std::span<const uint8_t> body = job->body;
+                if (job->dict_id || job->lz4) {
+                    auto rec = rcu_find(id);
+                    if (rec && job->dict_id && rec->peer_has_dict(job->dict_id))
+                        body = job->dict_body;
+                    else if (job->lz4 && (!rec || codec_for_peer(*rec) != Codec::Lz4))
+                        body = {};   // LZ4 пир не поймёт — send_message сожмёт zstd
+                }
+                const bool ok = body.empty()
+                    ? send_message(id, job->type, job->plain, job->cls)
+                    : send_frame(id, job->type, job->plain, job->cls, 0, body);
+                job->st->complete(ok);
+            }
+        });
     }
+    return handle;
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -541,11 +1258,15 @@ void ConnectionManager::Impl::flush_pending_messages(const std::string& uri,
     LOG_INFO("Flushing {} pending messages for URI: {}", messages.size(), uri);
 
     for (auto& msg : messages) {
-        send_frame(id, msg.msg_type, std::span<const uint8_t>(msg.payload));
+        send_message(id, msg.msg_type, std::span<const uint8_t>(msg.payload), msg.send_class);
     }
 }
 
 void ConnectionManager::Impl::cleanup_stale_pending() {
+    expire_reassembly();
+    expire_admission_buckets();
+    expire_handshakes();
+    if (dict_sampling_) train_compression_dictionaries();
     const auto now = std::chrono::steady_clock::now();
     std::vector<std::string> stale_uris;
 
@@ -1,5 +1,5 @@
 /// @file core/crypto/noise.cpp
-/// Noise_XX_25519_ChaChaPoly_BLAKE2b — реализация на libsodium.
+/// Noise_XX / Noise_IK _25519_ChaChaPoly_BLAKE2b — реализация на libsodium.
 ///
 /// Криптопримитивы:
 ///   DH:   crypto_scalarmult (X25519)
@@ -229,13 +229,22 @@ void SymmetricState::split(CipherState& c1, CipherState& c2) {
 
 void HandshakeState::init(bool is_initiator,
                            const uint8_t static_pk[DHLEN],
-                           const uint8_t static_sk[DHLEN]) {
-    symmetric.init(PROTOCOL_NAME);
+                           const uint8_t static_sk[DHLEN],
+                           Pattern p,
+                           const uint8_t* remote_static) {
+    clear();
+    symmetric.init(p == Pattern::IK ? PROTOCOL_NAME_IK : PROTOCOL_NAME);
     std::memcpy(s_pk, static_pk, DHLEN);
     std::memcpy(s_sk, static_sk, DHLEN);
     initiator = is_initiator;
+    pattern   = p;
     step      = 0;
-    // XX: нет pre-messages
+
+    // XX: нет pre-messages. IK: ← s — обе стороны хешируют static responder'а
+    if (p == Pattern::IK) {
+        if (is_initiator && remote_static) std::memcpy(rs, remote_static, DHLEN);
+        symmetric.mix_hash(is_initiator ? rs : s_pk, DHLEN);
+    }
 }
 
 bool HandshakeState::write_message(const uint8_t* payload, size_t payload_len,
@@ -243,6 +252,55 @@ bool HandshakeState::write_message(const uint8_t* payload, size_t payload_len,
     size_t offset = 0;
     uint8_t dh_out[DHLEN];
 
+    if (pattern == Pattern::IK) {
+        switch (step) {
+        case 0: {
+            // ══ IK msg1: → e, es, s, ss ═════════════════════════════════
+            if (!initiator) return false;
+            generate_keypair(e_pk, e_sk);
+            std::memcpy(out, e_pk, DHLEN);
+            symmetric.mix_hash(e_pk, DHLEN);
+            offset = DHLEN;
+
+            if (!dh(dh_out, e_sk, rs)) return false;          // es
+            symmetric.mix_key(dh_out, DHLEN);
+
+            size_t slen;
+            if (!symmetric.encrypt_and_hash(s_pk, DHLEN, out + offset, &slen))
+                return false;
+            offset += slen;
+
+            if (!dh(dh_out, s_sk, rs)) return false;          // ss
+            symmetric.mix_key(dh_out, DHLEN);
+            break;
+        }
+        case 1: {
+            // ══ IK msg2: ← e, ee, se ════════════════════════════════════
+            if (initiator) return false;
+            generate_keypair(e_pk, e_sk);
+            std::memcpy(out, e_pk, DHLEN);
+            symmetric.mix_hash(e_pk, DHLEN);
+            offset = DHLEN;
+
+            if (!dh(dh_out, e_sk, re)) return false;          // ee
+            symmetric.mix_key(dh_out, DHLEN);
+            if (!dh(dh_out, e_sk, rs)) return false;          // se
+            symmetric.mix_key(dh_out, DHLEN);
+            break;
+        }
+        default:
+            return false;
+        }
+
+        size_t plen;
+        if (!symmetric.encrypt_and_hash(payload, payload_len, out + offset, &plen))
+            return false;
+        sodium_memzero(dh_out, sizeof(dh_out));
+        *out_len = offset + plen;
+        ++step;
+        return true;
+    }
+
     switch (step) {
     case 0: {
         // ══ msg1: → e ════════════════════════════════════════════════════
@@ -341,6 +399,52 @@ bool HandshakeState::read_message(const uint8_t* msg, size_t msg_len,
     size_t offset = 0;
     uint8_t dh_out[DHLEN];
 
+    if (pattern == Pattern::IK) {
+        if (msg_len < DHLEN) return false;
+        std::memcpy(re, msg, DHLEN);
+        symmetric.mix_hash(re, DHLEN);
+        offset = DHLEN;
+
+        switch (step) {
+        case 0: {
+            // ══ IK msg1: → e, es, s, ss ═════════════════════════════════
+            if (initiator) return false;
+            if (!dh(dh_out, s_sk, re)) return false;          // es
+            symmetric.mix_key(dh_out, DHLEN);
+
+            const size_t s_enc_len = DHLEN + MACLEN;
+            if (msg_len < offset + s_enc_len) return false;
+            size_t dec_len;
+            if (!symmetric.decrypt_and_hash(msg + offset, s_enc_len, rs, &dec_len))
+                return false;
+            offset += s_enc_len;
+
+            if (!dh(dh_out, s_sk, rs)) return false;          // ss
+            symmetric.mix_key(dh_out, DHLEN);
+            break;
+        }
+        case 1: {
+            // ══ IK msg2: ← e, ee, se ════════════════════════════════════
+            if (!initiator) return false;
+            if (!dh(dh_out, e_sk, re)) return false;          // ee
+            symmetric.mix_key(dh_out, DHLEN);
+            if (!dh(dh_out, s_sk, re)) return false;          // se
+            symmetric.mix_key(dh_out, DHLEN);
+            break;
+        }
+        default:
+            return false;
+        }
+
+        size_t plen;
+        if (!symmetric.decrypt_and_hash(msg + offset, msg_len - offset, payload_out, &plen))
+            return false;
+        sodium_memzero(dh_out, sizeof(dh_out));
+        *payload_len = plen;
+        ++step;
+        return true;
+    }
+
     switch (step) {
     case 0: {
         // ══ msg1: → e ════════════════════════════════════════════════════
@@ -11,6 +11,11 @@
 ///   → e                     (msg1: initiator → responder)
 ///   ← e, ee, s, es          (msg2: responder → initiator)
 ///   → s, se                 (msg3: initiator → responder)
+///
+/// Handshake pattern IK (resumption — static responder уже известен, 1-RTT):
+///   ← s                     (pre-message)
+///   → e, es, s, ss          (msg1: initiator → responder)
+///   ← e, ee, se             (msg2: responder → initiator)
 
 #include <cstddef>
 #include <cstdint>
@@ -28,6 +33,11 @@ static constexpr size_t NONCELEN = 12;  ///< ChaChaPoly-IETF nonce
 /// Имя протокола для InitSymmetric (34 байта > HASHLEN → хешируется).
 static constexpr const char* PROTOCOL_NAME =
     "Noise_XX_25519_ChaChaPoly_BLAKE2b";
+static constexpr const char* PROTOCOL_NAME_IK =
+    "Noise_IK_25519_ChaChaPoly_BLAKE2b";
+
+/// Handshake pattern.
+enum class Pattern : uint8_t { XX, IK };
 
 // ── CipherState ──────────────────────────────────────────────────────────────
 
@@ -87,7 +97,7 @@ struct SymmetricState {
 
 // ── HandshakeState ───────────────────────────────────────────────────────────
 
-/// Полное состояние Noise_XX handshake.
+/// Полное состояние Noise handshake (XX или IK).
 struct HandshakeState {
     SymmetricState symmetric;
 
@@ -98,13 +108,18 @@ struct HandshakeState {
     uint8_t rs[DHLEN]{};    ///< Remote static pk
     uint8_t re[DHLEN]{};    ///< Remote ephemeral pk
 
-    bool initiator = false;
-    int  step      = 0;     ///< 0→msg1, 1→msg2, 2→msg3, 3→done
+    bool    initiator = false;
+    Pattern pattern   = Pattern::XX;
+    int     step      = 0;  ///< 0→msg1, 1→msg2, 2→msg3 (XX); done at messages()
 
     /// Инициализация. static_pk/sk — X25519 (Ed25519 конвертировать до вызова).
+    /// IK: инициатор передаёт @p remote_static (известный static responder'а),
+    /// responder — nullptr (pre-message — его собственный static_pk).
     void init(bool is_initiator,
               const uint8_t static_pk[DHLEN],
-              const uint8_t static_sk[DHLEN]);
+              const uint8_t static_sk[DHLEN],
+              Pattern p = Pattern::XX,
+              const uint8_t* remote_static = nullptr);
 
     /// Записать следующее handshake-сообщение.
     /// @param payload    Данные для вложения (user_pk, schemes, meta и т.д.)
@@ -117,7 +132,9 @@ struct HandshakeState {
     bool read_message(const uint8_t* msg, size_t msg_len,
                       uint8_t* payload_out, size_t* payload_len);
 
-    [[nodiscard]] bool is_complete() const { return step >= 3; }
+    /// Число сообщений паттерна: XX — 3, IK — 2.
+    [[nodiscard]] int  messages()    const { return pattern == Pattern::IK ? 2 : 3; }
+    [[nodiscard]] bool is_complete() const { return step >= messages(); }
 
     /// Вывести transport CipherState'ы.
     /// Initiator: send=c1, recv=c2. Responder: send=c2, recv=c1.
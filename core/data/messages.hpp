@@ -33,10 +33,18 @@ namespace gn::msg {
 /// supports.  This is NOT in types.h because it is payload data, not framing.
 
 /// @brief Feature flags advertised by a running GoodNet core.
-#define CORE_CAP_ZSTD   (1U << 0) ///< Payload compression available
-#define CORE_CAP_ICE    (1U << 1) ///< ICE/DTLS transport supported
-#define CORE_CAP_KEYROT (1U << 2) ///< On-line key rotation supported
-#define CORE_CAP_RELAY  (1U << 3) ///< Gossip relay supported
+#define CORE_CAP_ZSTD     (1U << 0) ///< Payload compression available
+#define CORE_CAP_ICE      (1U << 1) ///< ICE/DTLS transport supported
+#define CORE_CAP_KEYROT   (1U << 2) ///< On-line key rotation supported
+#define CORE_CAP_RELAY    (1U << 3) ///< Gossip relay supported
+#define CORE_CAP_FRAGMENT (1U << 4) ///< GNET_FLAG_FRAGMENT reassembly supported
+#define CORE_CAP_STRIPE   (1U << 5) ///< GNET_FLAG_STRIPED reordering supported
+#define CORE_CAP_ZSTD_DICT (1U << 6) ///< zstd dictionary bodies + HandshakeDictExt
+#define CORE_CAP_ZSTD_STREAM (1U << 7) ///< Per-session streaming zstd bodies (FLAG_ZSTD_STREAM)
+#define CORE_CAP_LZ4      (1U << 8) ///< LZ4 block bodies (FLAG_LZ4)
+#define CORE_CAP_AES256GCM (1U << 9) ///< AES-256-GCM transport AEAD (AES-NI host)
+#define CORE_CAP_KEY_EPOCH (1U << 10) ///< Automatic send-key rotation signalled by GNET_FLAG_KEY_PHASE
+#define CORE_CAP_RESUME   (1U << 11) ///< Accepts 1-RTT Noise_IK resumption (MSG_TYPE_NOISE_RESUME)
 
 #pragma pack(push, 1)
 /// @brief Peer capability block embedded in AuthPayload.
@@ -93,6 +101,18 @@ struct HandshakePayload {
 
 static constexpr size_t kHandshakePayloadSize = sizeof(HandshakePayload);
 
+/// Optional tail after HandshakePayload (CORE_CAP_ZSTD_DICT): IDs of the zstd
+/// dictionaries the sender can decode.  Only `1 + 4 * count` bytes are sent;
+/// old peers ignore bytes past kHandshakePayloadSize.
+static constexpr uint8_t HANDSHAKE_MAX_DICTS = 16;
+
+#pragma pack(push, 1)
+struct HandshakeDictExt {
+    uint8_t  count;
+    uint32_t ids[HANDSHAKE_MAX_DICTS];
+};
+#pragma pack(pop)
+
 // ─── HEARTBEAT (MSG_TYPE_HEARTBEAT = 4) ───────────────────────────────────────
 /// Keepalive ping/pong.  flags 0x00 = ping, 0x01 = pong.
 
@@ -1,4 +1,8 @@
 #include "impl.hpp"
+
+#include <cstddef>
+#include <cstring>
+
 #include "cm/connectionManager.hpp"
 #include "logger.hpp"
 #include "static_registry.hpp"
@@ -11,7 +15,8 @@ HandlerInfo::~HandlerInfo() {
 }
 
 HandlerInfo::HandlerInfo(HandlerInfo&& o) noexcept
-    : lib(std::move(o.lib)), handler(o.handler), api(o.api),
+    : lib(std::move(o.lib)), handler(o.handler),
+      handler_abi1(std::move(o.handler_abi1)), api(o.api),
       path(std::move(o.path)), name(std::move(o.name)),
       enabled(o.enabled.load(std::memory_order_relaxed))
 { o.handler = nullptr; }
@@ -20,6 +25,7 @@ HandlerInfo& HandlerInfo::operator=(HandlerInfo&& o) noexcept {
     if (this != &o) {
         lib     = std::move(o.lib);
         handler = o.handler; o.handler = nullptr;
+        handler_abi1 = std::move(o.handler_abi1);
         api     = o.api;
         path    = std::move(o.path);
         name    = std::move(o.name);
@@ -34,7 +40,7 @@ ConnectorInfo::~ConnectorInfo() {
 }
 
 ConnectorInfo::ConnectorInfo(ConnectorInfo&& o) noexcept
-    : lib(std::move(o.lib)), ops(o.ops), api(o.api),
+    : lib(std::move(o.lib)), ops(o.ops), ops_abi1(std::move(o.ops_abi1)), api(o.api),
       path(std::move(o.path)), name(std::move(o.name)),
       scheme(std::move(o.scheme)),
       enabled(o.enabled.load(std::memory_order_relaxed))
@@ -44,6 +50,7 @@ ConnectorInfo& ConnectorInfo::operator=(ConnectorInfo&& o) noexcept {
     if (this != &o) {
         lib    = std::move(o.lib);
         ops    = o.ops; o.ops = nullptr;
+        ops_abi1 = std::move(o.ops_abi1);
         api    = o.api;
         path   = std::move(o.path);
         name   = std::move(o.name);
@@ -53,6 +60,16 @@ ConnectorInfo& ConnectorInfo::operator=(ConnectorInfo&& o) noexcept {
     return *this;
 }
 
+namespace {
+
+/// ABI revision a dynamic plugin was built against (1 if it does not export one).
+uint32_t plugin_abi(const DynLib& lib) {
+    auto sym = lib.symbol<plugin_abi_version_t>("plugin_abi_version");
+    return sym ? (*sym)() : 1u;
+}
+
+} // namespace
+
 PluginManager::PluginManager(host_api_t* api, fs::path plugins_base_dir)
     : impl_(std::make_unique<Impl>(api, std::move(plugins_base_dir)))
 {
@@ -95,6 +112,15 @@ std::expected<void, std::string> PluginManager::load_plugin(const fs::path& path
             return std::unexpected(
                 fmt::format("handler_init() failed: {}", path.filename().string()));
 
+        // ABI 1: структура плагина кончается на user_data — дальше чужая память
+        if (plugin_abi(info->lib) < 2) {
+            info->handler_abi1 = std::make_unique<handler_t>();
+            std::memcpy(info->handler_abi1.get(), h, offsetof(handler_t, handle_batch));
+            h = info->handler_abi1.get();
+            LOG_DEBUG("load_plugin: '{}' is ABI 1 — handle_batch disabled",
+                      path.filename().string());
+        }
+
         std::string name = (h->name && h->name[0]) ? h->name : path.stem().string();
 
         std::unique_lock lock(impl_->rw_mutex);
@@ -126,6 +152,15 @@ std::expected<void, std::string> PluginManager::load_plugin(const fs::path& path
             return std::unexpected(
                 fmt::format("connector_init() failed: {}", path.filename().string()));
 
+        // ABI 1: структура плагина кончается на connector_ctx — дальше чужая память
+        if (plugin_abi(info->lib) < 2) {
+            info->ops_abi1 = std::make_unique<connector_ops_t>();
+            std::memcpy(info->ops_abi1.get(), ops, offsetof(connector_ops_t, send_owned));
+            ops = info->ops_abi1.get();
+            LOG_DEBUG("load_plugin: '{}' is ABI 1 — send_owned/flags disabled",
+                      path.filename().string());
+        }
+
         char buf[256] = {};
         if (ops->get_scheme) ops->get_scheme(ops->connector_ctx, buf, sizeof(buf));
         std::string scheme = buf;
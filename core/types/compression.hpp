@@ -0,0 +1,291 @@
+#pragma once
+/// @file core/types/compression.hpp
+/// @brief Body codecs, reusable zstd/LZ4 contexts, per-message-type zstd
+///        dictionaries, the per-connection adaptive compression policy and
+///        streaming contexts.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+namespace gn {
+
+/// @brief Compression context of the calling thread, reused for every frame
+///        (ZSTD_compress() would allocate ~1 MB of state per call).
+ZSTD_CCtx_s* zstd_thread_cctx();
+
+/// @brief Decompression context of the calling thread.
+ZSTD_DCtx_s* zstd_thread_dctx();
+
+/// Body codec of a frame.  Zstd is always available; LZ4 (~3–5x faster per
+/// byte, weaker ratio) is used towards peers with CORE_CAP_LZ4 when
+/// `compression.codec = "lz4"` — fast LAN links where zstd level 1 is the
+/// bottleneck but localhost passthrough is not possible.
+enum class Codec : uint8_t { Zstd, Lz4 };
+
+/// @brief "zstd" / "lz4" (config spelling).
+const char* codec_name(Codec c) noexcept;
+
+/// @brief LZ4_compress_fast_extState() state of the calling thread.
+void* lz4_thread_state();
+
+/// Per-connection adaptive compression policy (compression.adaptive).
+///
+/// - probe(): order-0 entropy of up to PROBE_BYTES sampled from the payload;
+///   above SKIP_ENTROPY_BITS the payload (media, archives, ciphertext) is sent
+///   raw without running zstd.  Long-range repeats of random blocks are not
+///   seen by the probe — such payloads are sent raw too.
+/// - adapt(): at most once per ADAPT_INTERVAL moves the level by one step:
+///   up while the send backlog exceeds BACKLOG_HIGH and zstd outruns the
+///   link (the link is the bottleneck — trade CPU for bytes), down towards
+///   the base level once the backlog drains, and below it while zstd is
+///   slower than the link (CPU is the bottleneck).
+///
+/// Thread-safety: all counters are relaxed atomics; adapt() elects one
+/// caller per interval via CAS on `next_adapt_ns`.
+struct AdaptiveCompression {
+    static constexpr double   SKIP_ENTROPY_BITS = 7.0;             ///< bits/byte
+    static constexpr size_t   PROBE_MIN_BYTES   = 512;             ///< Smaller payloads are not probed
+    static constexpr size_t   PROBE_BYTES       = 1024;            ///< Sampled in 4 stripes
+    static constexpr int64_t  ADAPT_INTERVAL_NS = 100'000'000;     ///< 100 ms
+    static constexpr size_t   BACKLOG_HIGH      = 256 * 1024;
+    static constexpr size_t   BACKLOG_LOW       = 32 * 1024;
+    static constexpr int      MIN_LEVEL         = 1;
+    static constexpr uint64_t DEFAULT_NS_PER_KB = 2'000;           ///< ~500 MB/s, before the first measurement
+
+    std::atomic<int>      level{0};            ///< 0 = base level (not adapted yet)
+    std::atomic<int64_t>  next_adapt_ns{0};
+    std::atomic<int64_t>  last_adapt_ns{0};
+    std::atomic<uint64_t> last_tx_bytes{0};
+    std::atomic<uint64_t> link_bps{0};         ///< EWMA bytes/s leaving over the paths
+    std::atomic<uint64_t> zstd_bps{0};         ///< EWMA input bytes/s of zstd at `level`
+
+    std::atomic<uint64_t> compressed{0};       ///< Frames run through zstd
+    std::atomic<uint64_t> compressed_bytes{0};
+    std::atomic<uint64_t> compress_ns{0};
+    std::atomic<uint64_t> skipped{0};          ///< Frames sent raw after the probe
+    std::atomic<uint64_t> skipped_bytes{0};
+    std::atomic<uint64_t> level_ups{0};
+    std::atomic<uint64_t> level_downs{0};
+
+    /// @brief Shannon entropy (bits per byte) of the sampled payload.
+    static double entropy_bits(std::span<const uint8_t> payload) noexcept;
+
+    /// @brief Stateless probe: false if @p payload looks incompressible.
+    static bool looks_compressible(std::span<const uint8_t> payload) noexcept;
+
+    /// @brief looks_compressible() + skip accounting.
+    bool probe(std::span<const uint8_t> payload) noexcept;
+
+    /// @brief Account one zstd run of @p raw input bytes taking @p ns.
+    void record(size_t raw, uint64_t ns) noexcept;
+
+    /// @brief true if adapt() would re-evaluate at @p now_ns (skip gathering inputs otherwise).
+    [[nodiscard]] bool adapt_due(int64_t now_ns) const noexcept {
+        return now_ns >= next_adapt_ns.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Current level, re-evaluated at most once per ADAPT_INTERVAL.
+    /// @param backlog   PerConnQueue::pending_bytes.
+    /// @param tx_bytes  Total bytes sent over the connection's paths.
+    int adapt(int base, int max_level, size_t backlog, uint64_t tx_bytes,
+              int64_t now_ns) noexcept;
+
+    /// @brief Estimated zstd time avoided by probe() skips.
+    [[nodiscard]] uint64_t cpu_saved_ns() const noexcept;
+};
+
+/// Per-session streaming zstd context (CORE_CAP_ZSTD_STREAM).
+///
+/// Each frame is one ZSTD_e_flush block of an endless zstd frame, so it may
+/// reference the previous WINDOW_LOG bytes sent on the same session — small
+/// chatty messages (store notifications, RPC) share structure with earlier ones.
+/// The decoder must see blocks in the order they were produced: every block
+/// carries a sequence number, and a block with `reset` starts a new epoch
+/// (both sides drop the history).  A gap leaves the receiver out of sync —
+/// blocks are rejected until the next reset, which the sender emits after
+/// a failed enqueue, on rekey and on every send key epoch (no block sealed
+/// under a new key references plaintext of the old one), when streaming is
+/// re-enabled and every RESYNC_EVERY blocks.
+///
+/// Contexts are allocated on first use: a session that never streams costs
+/// two mutexes.
+///
+/// Thread-safety: the tx side is guarded by `tx_mu`, which the send path holds
+/// across compress + enqueue so queue order equals block order; the rx side
+/// locks internally.
+class ZstdStream {
+public:
+    static constexpr int      WINDOW_LOG   = 17;          ///< 128 KB history per direction
+    static constexpr size_t   MAX_FRAME    = 64 * 1024;   ///< Larger payloads — per-frame zstd
+    static constexpr uint32_t RESYNC_EVERY = 1024;        ///< Blocks per epoch
+
+    /// One compressed block.
+    struct Block {
+        uint32_t seq   = 0;
+        bool     reset = false;   ///< First block of an epoch
+        size_t   size  = 0;       ///< Compressed bytes written (0 = error)
+    };
+
+    ZstdStream() = default;
+    ~ZstdStream();
+    ZstdStream(const ZstdStream&)            = delete;
+    ZstdStream& operator=(const ZstdStream&) = delete;
+
+    /// Held by the caller across compress() and the enqueue of its frame.
+    std::mutex tx_mu;
+
+    /// @brief Append @p len bytes to the tx history and flush them as one block.
+    /// @pre tx_mu held.  @p out_cap ≥ ZSTD_compressBound(len).
+    Block compress(uint8_t* out, size_t out_cap, const void* plain, size_t len, int level);
+
+    /// @brief Start a new epoch with the next block.
+    /// @details Lock-free — NoiseSession::rotate_tx() calls it from build_frame(),
+    ///          which may run under tx_mu.
+    void restart_tx() noexcept { tx_restart_.store(true, std::memory_order_relaxed); }
+
+    /// @brief Streaming is off for now (unordered path): restart on resume.
+    /// @details Lock-free — called on every frame while paused.
+    void pause_tx() noexcept { tx_paused_.store(true, std::memory_order_relaxed); }
+
+    /// @brief Decode block @p seq into exactly @p orig_size bytes.
+    /// @return Plaintext, or empty if the block is out of sequence or corrupt.
+    std::vector<uint8_t> decompress(uint32_t seq, bool reset,
+                                    const uint8_t* data, size_t len, size_t orig_size);
+
+    /// @brief Drop both histories (rekey): the next tx block resets, rx waits for one.
+    void reset() noexcept;
+
+    [[nodiscard]] uint64_t tx_blocks() const noexcept { return tx_blocks_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t rx_blocks() const noexcept { return rx_blocks_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t rx_rejected() const noexcept { return rx_rejected_.load(std::memory_order_relaxed); }
+
+private:
+    struct CCtxFree { void operator()(ZSTD_CCtx_s*) const noexcept; };
+    struct DCtxFree { void operator()(ZSTD_DCtx_s*) const noexcept; };
+
+    std::unique_ptr<ZSTD_CCtx_s, CCtxFree> cctx_;   // under tx_mu
+    uint32_t tx_seq_     = 0;
+    uint32_t tx_epoch_   = 0;                       ///< Blocks since the last reset
+    std::atomic<bool> tx_restart_{true};
+    std::atomic<bool> tx_paused_{false};
+    int      tx_level_   = 0;
+
+    std::mutex                             rx_mu_;
+    std::unique_ptr<ZSTD_DCtx_s, DCtxFree> dctx_;   // under rx_mu_
+    uint32_t rx_expect_ = 0;
+    bool     rx_synced_ = false;
+
+    std::atomic<uint64_t> tx_blocks_{0};
+    std::atomic<uint64_t> rx_blocks_{0};
+    std::atomic<uint64_t> rx_rejected_{0};
+};
+
+/// One zstd dictionary bound to a payload_type.
+///
+/// Immutable after creation; shared by the send path (cdict) and the
+/// receive path (ddict) through ZstdDictionaries snapshots.
+struct ZstdDict {
+    struct CDictFree { void operator()(ZSTD_CDict_s*) const noexcept; };
+    struct DDictFree { void operator()(ZSTD_DDict_s*) const noexcept; };
+
+    uint32_t             id       = 0;  ///< ZDICT dictionary ID (never 0)
+    uint32_t             msg_type = 0;
+    std::vector<uint8_t> content;
+    std::unique_ptr<ZSTD_CDict_s, CDictFree> cdict;  ///< Digested at the configured level
+    std::unique_ptr<ZSTD_DDict_s, DDictFree> ddict;
+};
+
+/// Registry of zstd dictionaries, one active per payload_type.
+///
+/// Small structured payloads (200–2000 bytes) barely compress on their own;
+/// a dictionary trained on earlier messages of the same type supplies the
+/// shared structure.  Dictionaries come from `<dict_dir>/<msg_type>.zdict`
+/// files, add(), or train_ready() over payloads collected by sample().
+///
+/// A dictionary is only usable towards peers that can decode it: IDs are
+/// advertised in the handshake (CORE_CAP_ZSTD_DICT) and the sender picks
+/// for_type() only if the peer listed that ID.  Retraining a type replaces
+/// its encoder dictionary but keeps the old one decodable.
+///
+/// Thread-safety: find()/for_type() read an RCU snapshot (lock-free);
+/// add()/train_ready() rebuild it under `write_mu_`; sample() takes
+/// `sample_mu_` for one in SAMPLE_EVERY eligible payloads.
+class ZstdDictionaries {
+public:
+    static constexpr size_t   MAX_DICTS        = 16;          ///< Decodable dictionaries (advertised)
+    static constexpr size_t   DICT_CAPACITY    = 16 * 1024;   ///< Max trained dictionary size
+    static constexpr size_t   SAMPLE_MIN_BYTES = 16;
+    static constexpr size_t   SAMPLE_MAX_BYTES = 16 * 1024;
+    static constexpr uint32_t SAMPLE_EVERY     = 4;           ///< Keep one of N eligible payloads
+    static constexpr size_t   TRAIN_SAMPLES    = 1000;        ///< Samples per type before training
+    static constexpr size_t   TRAIN_MIN_SAMPLES = 64;         ///< train() refuses fewer
+
+    /// @param level  zstd level the encoder dictionaries are digested at.
+    explicit ZstdDictionaries(int level = 1);
+    ~ZstdDictionaries();
+
+    /// @brief Register @p content as the dictionary of @p msg_type.
+    /// @return Dictionary ID, 0 if the content is not a zstd dictionary or
+    ///         MAX_DICTS are already registered.
+    uint32_t add(uint32_t msg_type, std::span<const uint8_t> content);
+
+    /// @brief Dictionary by ID (decode side); nullptr if unknown.
+    [[nodiscard]] std::shared_ptr<const ZstdDict> find(uint32_t id) const;
+
+    /// @brief Active dictionary of @p msg_type (encode side); nullptr if none.
+    [[nodiscard]] std::shared_ptr<const ZstdDict> for_type(uint32_t msg_type) const;
+
+    /// @brief IDs of every decodable dictionary (handshake advertisement).
+    [[nodiscard]] std::vector<uint32_t> ids() const;
+
+    /// @brief Offer an outgoing payload as training material.
+    void sample(uint32_t msg_type, std::span<const uint8_t> payload);
+
+    /// @brief Train every type that collected TRAIN_SAMPLES samples.
+    /// @return Number of dictionaries added.
+    size_t train_ready();
+
+    /// @brief Train @p msg_type from whatever has been sampled so far.
+    /// @return New dictionary ID, 0 if too few samples or training failed.
+    uint32_t train(uint32_t msg_type);
+
+    /// @brief Load every `<msg_type>.zdict` file of @p dir. @return Count loaded.
+    size_t load_dir(const std::filesystem::path& dir);
+
+    /// @brief Write the active dictionary of every type to @p dir.
+    bool save_dir(const std::filesystem::path& dir) const;
+
+private:
+    struct Table {
+        std::unordered_map<uint32_t, std::shared_ptr<const ZstdDict>> by_id;
+        std::unordered_map<uint32_t, std::shared_ptr<const ZstdDict>> by_type;
+    };
+    struct Samples {
+        std::vector<uint8_t> data;
+        std::vector<size_t>  sizes;
+    };
+
+    uint32_t train_samples(uint32_t msg_type, Samples samples);
+
+    const int                               level_;
+    std::atomic<std::shared_ptr<const Table>> table_;
+    std::mutex                              write_mu_;
+
+    std::mutex                              sample_mu_;
+    std::unordered_map<uint32_t, Samples>   samples_;
+    std::atomic<uint32_t>                   sample_tick_{0};
+};
+
+} // namespace gn
@@ -2,18 +2,25 @@
 /// @file core/types/connection.hpp
 /// @brief Connection state types: NoiseSession, ConnectionRecord, HandlerEntry.
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 #include <functional>
 
+#include <sodium/crypto_aead_aes256gcm.h>
 #include <sodium/crypto_sign.h>
 #include <sodium/utils.h>
 
+#include "compression.hpp"
 #include "nonce_window.hpp"
+#include "reassembly.hpp"
+#include "worker_pool.hpp"
 #include "crypto/noise.hpp"
 #include "data/messages.hpp"
 #include "../sdk/handler.h"
@@ -24,9 +31,68 @@ namespace gn {
 
 // ── TransportPath ────────────────────────────────────────────────────────────
 
+/// @brief Измеряемое состояние пути: RTT, потери, очередь, счётчики трафика.
+///
+/// Живёт в shared_ptr, чтобы TransportPath оставался перемещаемым, а счётчики
+/// обновлялись атомарно из flush / on_sent / on_data без records_write_mu_.
+/// Читается PathScheduler'ом на каждом flush.
+struct PathState {
+    static constexpr uint32_t LOSS_SCALE = 1'000'000;  ///< loss_ppm = 100 %
+
+    std::atomic<uint64_t> srtt_us{0};     ///< Smoothed RTT (RFC 6298, α = 1/8); 0 = нет замеров
+    std::atomic<uint64_t> rttvar_us{0};   ///< RTT variation (β = 1/4)
+    std::atomic<uint32_t> loss_ppm{0};    ///< EWMA доли неудачных отправок (1/8), ppm
+    std::atomic<uint64_t> in_flight{0};   ///< Байты у REPORTS_SENT коннектора без on_sent()
+    std::atomic<uint64_t> tx_bytes{0};
+    std::atomic<uint64_t> tx_frames{0};
+    std::atomic<uint64_t> tx_errors{0};
+    std::atomic<uint64_t> rx_bytes{0};
+    std::atomic<uint32_t> probe_seq{0};   ///< heartbeat seq + 1 последнего PING по пути; 0 = нет
+    std::atomic<int64_t>  stripe_current{0}; ///< Smooth WRR state для striped-кадров
+
+    /// Сборка TCP-потока для вторичного пути: чанки разных путей
+    /// не должны склеиваться в общем ConnectionRecord::rx_stream.
+    StreamReassembler rx_stream;
+
+    /// @brief Учесть замер RTT (первый замер: srtt = R, rttvar = R/2).
+    void add_rtt_sample(uint64_t rtt_us) noexcept {
+        const uint64_t srtt = srtt_us.load(std::memory_order_relaxed);
+        if (srtt == 0) {
+            srtt_us.store(rtt_us ? rtt_us : 1, std::memory_order_relaxed);
+            rttvar_us.store(rtt_us / 2, std::memory_order_relaxed);
+            return;
+        }
+        const uint64_t var = rttvar_us.load(std::memory_order_relaxed);
+        const uint64_t err = srtt > rtt_us ? srtt - rtt_us : rtt_us - srtt;
+        rttvar_us.store(var - var / 4 + err / 4, std::memory_order_relaxed);
+        const uint64_t next = srtt - srtt / 8 + rtt_us / 8;
+        srtt_us.store(next ? next : 1, std::memory_order_relaxed);
+    }
+
+    /// @brief Учесть исход передачи @p frames кадров / @p bytes байт.
+    void record_send(bool ok, uint64_t frames, uint64_t bytes) noexcept {
+        const uint32_t loss = loss_ppm.load(std::memory_order_relaxed);
+        if (ok) {
+            tx_frames.fetch_add(frames, std::memory_order_relaxed);
+            tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+            loss_ppm.store(loss - loss / 8, std::memory_order_relaxed);
+        } else {
+            tx_errors.fetch_add(1, std::memory_order_relaxed);
+            loss_ppm.store(loss + (LOSS_SCALE - loss) / 8, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Вернуть @p bytes кредита (clamp на нуле).
+    void credit(uint64_t bytes) noexcept {
+        uint64_t cur = in_flight.load(std::memory_order_relaxed);
+        while (!in_flight.compare_exchange_weak(cur, cur > bytes ? cur - bytes : 0,
+                                                std::memory_order_relaxed)) {}
+    }
+};
+
 /// @brief Один транспортный путь к пиру.
 /// ConnectionRecord::transport_paths содержит все доступные пути.
-/// Ядро выбирает лучший активный путь для отправки.
+/// Порядок путей на каждом flush выбирает PathScheduler (types/path_scheduler.hpp).
 ///
 /// connector_ops НЕ кэшируется — разрешается динамически через find_connector(scheme).
 /// Причина: коннекторы могут перерегистрироваться, и кэшированный указатель может стать dangling.
@@ -39,25 +105,93 @@ struct TransportPath {
     uint64_t    last_rtt_us = 0;                     ///< Последний RTT (микросекунды)
     uint32_t    consecutive_errors = 0;              ///< Ошибок подряд; 3+ → active=false
     std::chrono::steady_clock::time_point added_at{};///< Время добавления
+    std::shared_ptr<PathState> state = std::make_shared<PathState>(); ///< Метрики (никогда не null)
 };
 
 // ── NoiseSession ─────────────────────────────────────────────────────────────
 
+/// @brief Transport AEAD of an established session.
+/// @details Оба шифра: 32-байтный ключ, 12-байтный nonce, 16-байтный MAC —
+///          формат кадра не меняется. Aes256Gcm выбирается в finalize_handshake(),
+///          только если обе стороны объявили CORE_CAP_AES256GCM.
+enum class AeadCipher : uint8_t { ChaCha20Poly1305, Aes256Gcm };
+
+/// @brief "chacha20-poly1305" / "aes-256-gcm".
+const char* aead_name(AeadCipher c) noexcept;
+
+/// @brief true if libsodium can run AES-256-GCM on this CPU (AES-NI + PCLMUL).
+bool aes256gcm_available() noexcept;
+
 /// @brief Per-connection transport encryption state after Noise_XX handshake.
 ///
 /// Created by `finalize_handshake()` after msg3 completes.
-/// Uses ChaChaPoly-IETF AEAD with `packet_id` as nonce (from header_t).
+/// Uses ChaChaPoly-IETF (or negotiated AES-256-GCM) AEAD with `packet_id`
+/// as nonce (from header_t).
+///
+/// Key epochs (CORE_CAP_KEY_EPOCH): each direction rotates independently.
+/// The sender derives `k' = HKDF(k)` into the other key-phase slot and flips
+/// GNET_FLAG_KEY_PHASE; the receiver derives the same key when it sees the
+/// flip, commits it only after the MAC verifies and keeps the previous key
+/// for REKEY_OVERLAP_NS, so frames in flight across the switch still open.
+/// packet_id keeps counting across epochs (the replay window is not reset).
 ///
-/// Thread-safety: encrypt() and decrypt() must not be called concurrently
-/// on the same session — the core serializes per-connection operations.
+/// Thread-safety: seal_in_place() / encrypt_into() may run concurrently on
+/// one session (parallel broadcast fan-out seals under a phase read once per
+/// frame), and so may decrypt_into(): NonceWindow is lock-free, and opens
+/// under the other key phase serialize on rx_rotate_mu_. rotate_tx() may
+/// race both — tx_rotate_mu_ admits one rotation, the rest skip.
+/// The zstd stream has its own locks: stream.tx_mu (held by the sender
+/// across compress + enqueue) and the internal rx_mu_ of decompress().
+/// set_cipher() and the legacy in-place rekey (rekey_session() without
+/// CORE_CAP_KEY_EPOCH) rewrite the keys and must not overlap any of these.
 ///
 /// Ownership: held by `ConnectionRecord::session` as unique_ptr.
 /// Destroyed when the connection closes — keys are securely wiped.
 struct NoiseSession {
-    uint8_t send_key[noise::KEYLEN]{};        ///< AEAD send key (ChaChaPoly-IETF)
-    uint8_t recv_key[noise::KEYLEN]{};        ///< AEAD receive key (ChaChaPoly-IETF)
+    uint8_t send_key[noise::KEYLEN]{};        ///< AEAD send key (key phase 0)
+    uint8_t recv_key[noise::KEYLEN]{};        ///< AEAD receive key (key phase 0)
     uint8_t handshake_hash[noise::HASHLEN]{}; ///< Channel binding token (h after split)
     NonceWindow recv_window;                  ///< Anti-replay window for inbound packets
+    ZstdStream  stream;                       ///< Cross-frame zstd history (CORE_CAP_ZSTD_STREAM)
+
+    /// @brief Select the AEAD and expand the current keys for it.
+    /// @details Для AES-256-GCM раскладка ключей (beforenm) делается один раз,
+    ///          а не на каждый пакет. Вызывать после каждой смены send_key/recv_key
+    ///          (finalize_handshake, rekey_session).
+    /// @return false if @p c is unavailable on this CPU (cipher unchanged).
+    bool set_cipher(AeadCipher c) noexcept;
+
+    /// @brief Active transport AEAD (ChaCha20Poly1305 until set_cipher()).
+    AeadCipher cipher() const noexcept { return cipher_; }
+
+    // ── Key epochs ───────────────────────────────────────────────────────────
+
+    static constexpr uint64_t REKEY_OVERLAP_NS      = 1'000'000'000; ///< Previous recv key stays valid
+    static constexpr uint64_t REKEY_MIN_INTERVAL_NS = 2'000'000'000; ///< Between two send rotations (> overlap)
+
+    uint32_t tx_epoch() const noexcept { return tx_epoch_.load(std::memory_order_acquire); }
+    uint32_t rx_epoch() const noexcept { return rx_epoch_.load(std::memory_order_acquire); }
+    /// @brief GNET_FLAG_KEY_PHASE value for the next sealed frame.
+    bool     tx_phase() const noexcept { return tx_epoch() & 1; }
+
+    /// @brief true once @p max_packets frames or @p max_bytes were sealed
+    ///        under the current send key (0 = no limit).
+    bool rekey_due(uint64_t max_packets, uint64_t max_bytes) const noexcept {
+        return (max_packets && tx_packets_.load(std::memory_order_relaxed) >= max_packets)
+            || (max_bytes   && tx_bytes_  .load(std::memory_order_relaxed) >= max_bytes);
+    }
+
+    /// @brief Rotate the send key: epoch+1, next frames carry the flipped phase.
+    /// @details Пропускается, если ротация уже идёт в другом потоке, с прошлой
+    ///          прошло меньше REKEY_MIN_INTERVAL_NS или в текущей (ненулевой)
+    ///          эпохе не ушло ни одного кадра — получатель должен увидеть каждую.
+    /// @return Nanoseconds spent deriving the key, 0 if skipped.
+    uint64_t rotate_tx(uint64_t now_ns);
+
+    uint64_t rx_prev_key_hits() const noexcept { return rx_prev_hits_.load(std::memory_order_relaxed); }
+    uint64_t last_tx_rekey_ns() const noexcept { return tx_rotated_at_.load(std::memory_order_relaxed); }
+    uint64_t last_rx_rekey_ns() const noexcept { return rx_rotated_at_.load(std::memory_order_relaxed); }
+    uint64_t last_rx_rekey_cost_ns() const noexcept { return rx_rotate_cost_.load(std::memory_order_relaxed); }
 
     /// @brief Encrypt payload with optional zstd compression.
     /// @param plain              Plaintext payload.
@@ -73,13 +207,95 @@ struct NoiseSession {
                                   int compress_threshold,
                                   int compress_level);
 
+    /// @brief Upper bound of encrypt_into() output for a @p len byte payload.
+    static size_t max_wire_size(size_t len, bool compress_enabled,
+                                int compress_threshold);
+
+    /// @brief Encrypt payload directly into caller memory.
+    /// @details Zstd пишет прямо в @p out, AEAD шифрует in-place — без
+    ///          промежуточных буферов. @p out_cap должен быть не меньше
+    ///          max_wire_size(len, ...); build_frame кладёт header_t перед @p out.
+    /// @param dict  Dictionary the peer advertised for this payload_type, or null.
+    /// @return Ciphertext byte count written to @p out.
+    size_t encrypt_into(uint8_t* out, size_t out_cap,
+                        const void* plain, size_t len,
+                        uint64_t nonce,
+                        bool compress_enabled,
+                        int compress_threshold,
+                        int compress_level,
+                        const ZstdDict* dict = nullptr);
+
+    /// @brief Compression stage of encrypt_into(): writes the plaintext body
+    ///        (flag + [orig_size] + raw/zstd data) to @p out.
+    /// @details Не зависит от ключей — broadcast кодирует payload один раз
+    ///          и запечатывает копию тела под каждую сессию (seal_in_place).
+    ///          @p out_cap = max_wire_size(...) - MAC.
+    /// @param codec  Codec::Lz4 only towards peers with CORE_CAP_LZ4 (@p dict
+    ///               and @p compress_level are ignored then).
+    /// @return Body byte count.
+    static size_t encode_body(uint8_t* out, size_t out_cap,
+                              const void* plain, size_t len,
+                              bool compress_enabled,
+                              int compress_threshold,
+                              int compress_level,
+                              const ZstdDict* dict = nullptr,
+                              Codec codec = Codec::Zstd);
+
+    /// @brief Streaming variant of encode_body(): appends @p plain to the
+    ///        session's zstd history as one flushed block.
+    /// @pre stream.tx_mu held until the frame is enqueued.
+    /// @return Body byte count, 0 on failure (caller falls back to encode_body()).
+    size_t encode_stream_body(uint8_t* out, size_t out_cap,
+                              const void* plain, size_t len, int compress_level);
+
+    /// @brief AEAD stage of encrypt_into(): encrypt @p body_len bytes at
+    ///        @p body in place; the buffer must have MAC bytes of headroom.
+    /// @return Ciphertext byte count (body_len + MAC).
+    size_t seal_in_place(uint8_t* body, size_t body_len, uint64_t nonce) {
+        return seal_in_place(body, body_len, nonce, tx_phase());
+    }
+
+    /// @brief seal_in_place() under the key of @p phase (read once per frame
+    ///        by build_frame, so the header flag and the key always match).
+    size_t seal_in_place(uint8_t* body, size_t body_len, uint64_t nonce, bool phase);
+
     /// @brief Decrypt AEAD ciphertext and decompress if zstd-prefixed.
     /// @param wire   Wire bytes (ciphertext).
     /// @param len    Wire byte count.
     /// @param nonce  packet_id from header (used as AEAD nonce).
+    /// @param dicts  Resolves the dictionary ID of FLAG_ZSTD_DICT bodies.
     /// @return Decrypted plaintext, or empty vector on failure.
     std::vector<uint8_t> decrypt(const void* wire, size_t len,
-                                  uint64_t nonce);
+                                  uint64_t nonce,
+                                  const ZstdDictionaries* dicts = nullptr);
+
+    /// @brief decrypt() into caller memory — the receive hot path.
+    /// @details AEAD открывает @p wire прямо в @p out (resize без realloc, если
+    ///          capacity хватает); RAW-тело сдвигается на месте, сжатое
+    ///          распаковывается в новый вектор. @p wire не изменяется.
+    /// @return false on replay / MAC failure / malformed body (@p out cleared).
+    bool decrypt_into(std::vector<uint8_t>& out,
+                      const void* wire, size_t len,
+                      uint64_t nonce,
+                      const ZstdDictionaries* dicts = nullptr) {
+        return decrypt_into(out, wire, len, nonce, dicts, rx_epoch() & 1);
+    }
+
+    /// @brief decrypt_into() for a frame sealed under key @p phase
+    ///        (header_t::flags & GNET_FLAG_KEY_PHASE).
+    /// @details Фаза текущего ключа — быстрый путь без блокировок; другая фаза —
+    ///          предыдущий ключ (в пределах REKEY_OVERLAP_NS) или ротация пира:
+    ///          следующий ключ выводится и принимается только после проверки MAC.
+    bool decrypt_into(std::vector<uint8_t>& out,
+                      const void* wire, size_t len,
+                      uint64_t nonce,
+                      const ZstdDictionaries* dicts,
+                      bool phase);
+
+    /// @brief Decompression stage of decrypt(): plaintext body → payload.
+    /// @return Payload, or empty vector on a malformed body.
+    std::vector<uint8_t> decode_body(const uint8_t* body, size_t len,
+                                     const ZstdDictionaries* dicts = nullptr);
 
     NoiseSession()                             = default;
     NoiseSession(const NoiseSession&)          = delete;
@@ -89,7 +305,51 @@ struct NoiseSession {
         sodium_memzero(send_key, sizeof(send_key));
         sodium_memzero(recv_key, sizeof(recv_key));
         sodium_memzero(handshake_hash, sizeof(handshake_hash));
+        sodium_memzero(send_key_p1_, sizeof(send_key_p1_));
+        sodium_memzero(recv_key_p1_, sizeof(recv_key_p1_));
+        sodium_memzero(aes_send_, sizeof(aes_send_));
+        sodium_memzero(aes_recv_, sizeof(aes_recv_));
     }
+
+private:
+    uint8_t*       tx_key(bool phase) noexcept { return phase ? send_key_p1_ : send_key; }
+    uint8_t*       rx_key(bool phase) noexcept { return phase ? recv_key_p1_ : recv_key; }
+    bool open(uint8_t* m, unsigned long long* mlen, const uint8_t* c, size_t clen,
+              const uint8_t* npub, const uint8_t* key,
+              const crypto_aead_aes256gcm_state* aes) const noexcept;
+    bool open_other_phase(uint8_t* m, unsigned long long* mlen, const uint8_t* c,
+                          size_t clen, const uint8_t* npub, bool phase);
+
+    AeadCipher cipher_ = AeadCipher::ChaCha20Poly1305;
+    uint8_t send_key_p1_[noise::KEYLEN]{};            ///< Send key of key phase 1
+    uint8_t recv_key_p1_[noise::KEYLEN]{};            ///< Receive key of key phase 1
+    crypto_aead_aes256gcm_state aes_send_[2]{};       ///< Expanded send keys by phase (Aes256Gcm only)
+    crypto_aead_aes256gcm_state aes_recv_[2]{};       ///< Expanded receive keys by phase
+
+    std::mutex            tx_rotate_mu_;              ///< One sender rotation at a time
+    std::atomic<uint32_t> tx_epoch_{0};
+    std::atomic<uint64_t> tx_packets_{0};             ///< Sealed under the current send key
+    std::atomic<uint64_t> tx_bytes_{0};
+    std::atomic<uint64_t> tx_rotated_at_{0};          ///< steady ns of the last send rotation
+
+    std::mutex            rx_rotate_mu_;              ///< Other-phase (slow) receive path
+    std::atomic<uint32_t> rx_epoch_{0};
+    uint64_t              rx_prev_until_ = 0;         ///< Previous recv key valid until (rx_rotate_mu_)
+    std::atomic<uint64_t> rx_rotated_at_{0};
+    std::atomic<uint64_t> rx_rotate_cost_{0};
+    std::atomic<uint64_t> rx_prev_hits_{0};           ///< Frames opened with the previous key
+};
+
+// ── PeerHello ────────────────────────────────────────────────────────────────
+
+/// @brief Peer's HandshakePayload after signature and static-key checks,
+///        not yet bound to a ConnectionRecord (peer_* fields).
+struct PeerHello {
+    uint8_t user_pubkey  [crypto_sign_PUBLICKEYBYTES]{};
+    uint8_t device_pubkey[crypto_sign_PUBLICKEYBYTES]{};
+    std::vector<std::string> schemes;
+    msg::CoreMeta            core_meta{};
+    std::vector<uint32_t>    dict_ids;
 };
 
 // ── ConnectionRecord ─────────────────────────────────────────────────────────
@@ -119,6 +379,14 @@ struct ConnectionRecord {
     bool    is_initiator        = false;           ///< true = outgoing (sends NOISE_INIT)
 
     msg::CoreMeta peer_core_meta{};               ///< Peer capabilities from handshake
+    std::vector<uint32_t> peer_dict_ids;          ///< zstd dictionaries the peer can decode
+    AdaptiveCompression   compression;            ///< Send-side level / skip decisions
+
+    /// @brief true if the peer advertised zstd dictionary @p dict_id.
+    bool peer_has_dict(uint32_t dict_id) const noexcept {
+        return std::find(peer_dict_ids.begin(), peer_dict_ids.end(), dict_id)
+            != peer_dict_ids.end();
+    }
 
     /// @brief Статус транспортных путей пира (из heartbeat extension).
     struct PeerPathInfo {
@@ -129,26 +397,62 @@ struct ConnectionRecord {
     };
     std::vector<PeerPathInfo> peer_transport_info; ///< Updated from heartbeat
 
-    /// @brief Handler pinned by PROPAGATION_CONSUMED (session affinity).
-    std::string affinity_plugin;
+    /// @brief handler_id_t (signals.hpp) pinned by the first PROPAGATION_CONSUMED
+    ///        (session affinity); 0 = none.  Set in place — no RCU map copy.
+    std::atomic<uint32_t> affinity_handler{0};
 
     std::atomic<uint64_t> send_packet_id{0};      ///< Monotonic AEAD nonce counter
+    std::atomic<uint32_t> send_msg_id{0};         ///< frag_hdr_t::msg_id counter
+    std::atomic<uint64_t> send_stripe_seq{0};     ///< GNET_FLAG_STRIPED sequence counter
+    std::mutex            stripe_tx_mu;           ///< Held from taking a stripe seq to try_push
 
     // Heartbeat keepalive state
     std::atomic<int64_t>  last_heartbeat_recv{0}; ///< Timestamp of last heartbeat (microseconds)
     std::atomic<uint32_t> heartbeat_seq{0};        ///< Monotonic heartbeat sequence counter
     std::atomic<uint32_t> missed_heartbeats{0};    ///< Consecutive missed heartbeats (3 = disconnect)
 
-    /// @brief Noise_XX handshake state.
+    /// @brief Multipath heartbeat probes queued in the Control ring, each bound
+    ///        to the path it measures (packet_id → transport_conn_id).
+    ///        flush_batch() takes the entry when the probe is drained.
+    std::mutex                                  probe_mu;
+    std::vector<std::pair<uint64_t, conn_id_t>> probe_routes;
+    std::atomic<uint32_t>                       probe_pending{0};
+
+    /// @brief Noise handshake state (XX, or IK when resuming).
     ///        Active during handshake, reset to nullptr after split().
     std::unique_ptr<noise::HandshakeState> handshake;
+    bool resumed = false;  ///< Session came from a 1-RTT Noise_IK resumption
+    std::chrono::steady_clock::time_point handshake_started{}; ///< HANDSHAKE_TIMEOUT origin
+
+    /// @brief Serial lane on the handshake pool (nullptr = handshake inline on
+    ///        the IO thread). Handshake frames and the frames queued behind
+    ///        them run here in arrival order.
+    std::shared_ptr<WorkerPool::Lane> hs_lane;
 
     /// @brief Transport session — AEAD keys + anti-replay.
     ///        Active after ESTABLISHED, nullptr before.
     std::unique_ptr<NoiseSession> session;
 
-    /// @brief Receive buffer for TCP stream reassembly.
-    std::vector<uint8_t> recv_buf;
+    /// @brief Noise_IK responder: keys derived after msg2 and the peer's
+    ///        verified payload.  Moved into `session` / peer_* once the
+    ///        initiator's first frame decrypts under them — a replayed RESUME
+    ///        reads fine but never produces such a frame, so it never binds
+    ///        an identity to the connection.
+    struct PendingResume {
+        std::unique_ptr<NoiseSession> session;
+        PeerHello                     peer;
+    };
+    std::unique_ptr<PendingResume> resume;
+
+    /// @brief Framing of the primary transport's byte stream (partial frame only).
+    StreamReassembler rx_stream;
+
+    /// @brief Partial GNET_FLAG_FRAGMENT messages (bounded, see MAX_REASSEMBLY_BYTES).
+    FragmentReassembler reassembly;
+
+    /// @brief Striped bulk frames waiting for their predecessors (multipath).
+    StripeReorderBuffer reorder;
+    std::atomic<bool>   reorder_timer_armed{false}; ///< Gap timer pending on flush executor
 
     // ── Multi-transport ──────────────────────────────────────────────────────
 
@@ -0,0 +1,102 @@
+#pragma once
+/// @file core/types/mpsc_ring.hpp
+/// @brief Bounded lock-free multi-producer / single-consumer ring.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace gn {
+
+/// Bounded MPSC ring (Vyukov sequence-per-slot scheme).
+///
+/// Producers claim a slot with one CAS on `tail_` and publish it by bumping
+/// the slot sequence; the consumer never touches shared counters except the
+/// slot it reads.  push() fails instead of blocking when the ring is full.
+///
+/// Thread-safety: push() from any number of threads; pop()/peek()/ready() from one
+/// consumer at a time (callers serialise consumers, e.g. PerConnQueue::draining).
+template<typename T, size_t Capacity>
+class MpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t CAPACITY = Capacity;
+
+    MpscRing() : slots_(std::make_unique<Slot[]>(Capacity)) {
+        for (size_t i = 0; i < Capacity; ++i)
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing&)            = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /// @brief Enqueue @p v. @return false if all slots are occupied.
+    bool push(T&& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Slot*  s   = nullptr;
+        for (;;) {
+            s = &slots_[pos & MASK];
+            const size_t   seq = s->seq.load(std::memory_order_acquire);
+            const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;                            // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        s->value = std::move(v);
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Dequeue the next published element. @return false if none is ready.
+    bool pop(T& out) {
+        const size_t pos = head_.load(std::memory_order_relaxed);
+        Slot& s = slots_[pos & MASK];
+        if (s.seq.load(std::memory_order_acquire) != pos + 1) return false;
+        out = std::move(s.value);
+        s.value = T{};
+        s.seq.store(pos + Capacity, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// @brief Head element if published, else nullptr.  Valid until the next pop().
+    const T* peek() const {
+        const size_t pos = head_.load(std::memory_order_relaxed);
+        const Slot& s = slots_[pos & MASK];
+        return s.seq.load(std::memory_order_acquire) == pos + 1 ? &s.value : nullptr;
+    }
+
+    /// @brief true if the head slot is published (pop() would succeed).
+    bool ready() const {
+        const size_t pos = head_.load(std::memory_order_relaxed);
+        return slots_[pos & MASK].seq.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    /// @brief Approximate element count (claimed, not necessarily published).
+    size_t size_approx() const {
+        return tail_.load(std::memory_order_relaxed)
+             - head_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        T                   value{};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> tail_{0};   ///< producers
+    alignas(64) std::atomic<size_t> head_{0};   ///< consumer (atomic: consumer may migrate threads)
+};
+
+} // namespace gn
@@ -1,26 +1,56 @@
 #pragma once
 
-#include <bitset>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <mutex>
 
 namespace gn {
 
-/// Sliding-window anti-replay filter (IPsec/DTLS-style).
-/// Accepts nonces within WINDOW_SIZE of the highest seen nonce;
+/// Sliding-window anti-replay filter (IPsec/DTLS-style), lock-free.
+/// Accepts nonces within window() of the highest seen nonce;
 /// rejects duplicates and nonces older than the window.
+///
+/// The bitmap is a ring of 64-bit words, each covering one block of
+/// BLOCK_BITS consecutive nonces: `block_tag(32) | bits(32)`.  accept()
+/// is a single CAS on the word of the nonce's block — a word whose tag is
+/// older is taken over (its block already left the window), a newer tag
+/// means the nonce itself is too old.  Тег и биты меняются одной CAS, поэтому
+/// бит не теряется при конкурентном сдвиге окна (multipath / ICE reorder).
+///
+/// Thread-safety: accept() may run concurrently from any threads.
+/// configure()/reset() must not race with accept() (handshake / rekey).
 struct NonceWindow {
-    static constexpr size_t WINDOW_SIZE = 256;
+    static constexpr size_t BLOCK_BITS  = 32;
+    static constexpr size_t WINDOW_SIZE = 1024;  ///< Default (security.replay_window)
+    static constexpr size_t MAX_WINDOW  = 8192;
+    /// Floor for security.replay_window.  The sender does not know the peer's
+    /// window, so PerConnQueue::MAX_REORDER is bounded by this value.
+    static constexpr size_t MIN_CONFIG_WINDOW = WINDOW_SIZE;
 
-    std::mutex mu;
-    uint64_t   highest_nonce{0};
-    std::bitset<WINDOW_SIZE> bitmap{};
+    /// @brief Set the window width (rounded up to BLOCK_BITS, clamped to
+    ///        [BLOCK_BITS, MAX_WINDOW]) and clear all state.
+    void configure(size_t window);
+
+    /// Effective window width in packets.
+    size_t window() const noexcept { return (slots_ - 1) * BLOCK_BITS; }
+
+    /// Highest accepted nonce (diagnostics).
+    uint64_t highest() const noexcept { return highest_.load(std::memory_order_relaxed); }
 
     /// Returns true if @p nonce is valid (not a replay, within window).
     bool accept(uint64_t nonce);
 
     /// Reset state (used after rekey).
     void reset();
+
+private:
+    // +1 слот: блок, в который попадает highest, заполнен частично
+    static constexpr size_t MAX_SLOTS = MAX_WINDOW / BLOCK_BITS + 1;
+
+    std::atomic<uint64_t>                       highest_{0};
+    size_t                                      slots_ = WINDOW_SIZE / BLOCK_BITS + 1;
+    std::array<std::atomic<uint64_t>, MAX_SLOTS> words_{};
 };
 
 } // namespace gn
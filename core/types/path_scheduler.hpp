@@ -0,0 +1,70 @@
+#pragma once
+/// @file core/types/path_scheduler.hpp
+/// @brief Pluggable choice of TransportPath for outbound frames.
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "connection.hpp"
+
+namespace gn {
+
+/// Orders the active transport paths of one peer before every flush.
+///
+/// The core sends each batch over the first path of rank() and fails over
+/// down the list.  When multipath striping is on, GNET_FLAG_STRIPED bulk
+/// frames are spread over the ranked paths in proportion to stripe_weight().
+///
+/// Implementations read TransportPath / PathState only; they must be
+/// thread-safe — flushes of different connections run concurrently.
+class PathScheduler {
+public:
+    virtual ~PathScheduler() = default;
+
+    /// @brief Short name for logs and `core.path_scheduler`.
+    [[nodiscard]] virtual std::string_view name() const noexcept = 0;
+
+    /// @brief Sort @p paths (all active) best-first, in place.
+    virtual void rank(std::vector<TransportPath*>& paths) const = 0;
+
+    /// @brief Relative share of striped bytes for @p path (> 0).
+    [[nodiscard]] virtual uint64_t stripe_weight(const TransportPath&) const { return 1; }
+};
+
+/// Static order by scheme_priority_ — behaviour before adaptive scheduling.
+class PriorityPathScheduler final : public PathScheduler {
+public:
+    [[nodiscard]] std::string_view name() const noexcept override { return "priority"; }
+    void rank(std::vector<TransportPath*>& paths) const override;
+};
+
+/// Lowest expected delivery cost first (default).
+///
+/// cost = (srtt + 4·rttvar) · (1 + LOSS_FACTOR · loss) + queueing + priority bias
+///
+/// - paths without RTT samples count as UNKNOWN_RTT_US, so a fresh path does
+///   not steal traffic from a measured fast one;
+/// - queueing adds one srtt per QUEUE_BYTES unconfirmed by on_sent();
+/// - the static priority adds PRIORITY_STEP_US per level and breaks ties,
+///   so with no measurements the order equals PriorityPathScheduler.
+class AdaptivePathScheduler final : public PathScheduler {
+public:
+    static constexpr uint64_t UNKNOWN_RTT_US   = 50'000;
+    static constexpr uint64_t PRIORITY_STEP_US = 1'000;
+    static constexpr uint64_t LOSS_FACTOR      = 8;
+    static constexpr uint64_t QUEUE_BYTES      = 1024 * 1024;
+
+    [[nodiscard]] std::string_view name() const noexcept override { return "adaptive"; }
+    void rank(std::vector<TransportPath*>& paths) const override;
+    [[nodiscard]] uint64_t stripe_weight(const TransportPath& path) const override;
+
+    /// @brief Expected cost of sending over @p path, in microseconds (>= 1).
+    [[nodiscard]] static uint64_t cost_us(const TransportPath& path) noexcept;
+};
+
+/// @brief Built-in scheduler by name ("adaptive", "priority"); nullptr if unknown.
+std::shared_ptr<PathScheduler> make_path_scheduler(std::string_view name);
+
+} // namespace gn
@@ -5,6 +5,8 @@
 #include <vector>
 #include <cstdint>
 
+#include "signals.hpp"
+
 namespace gn {
 
 // ── PendingMessage ────────────────────────────────────────────────────────────
@@ -15,11 +17,14 @@ struct PendingMessage {
     uint32_t msg_type;
     std::vector<uint8_t> payload;
     std::chrono::steady_clock::time_point queued_at;
+    SendClass send_class = SendClass::Auto;   ///< QoS class requested by send()
 
-    PendingMessage(uint32_t type, std::vector<uint8_t> data)
+    PendingMessage(uint32_t type, std::vector<uint8_t> data,
+                   SendClass cls = SendClass::Auto)
         : msg_type(type)
         , payload(std::move(data))
         , queued_at(std::chrono::steady_clock::now())
+        , send_class(cls)
     {}
 };
 
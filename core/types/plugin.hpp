@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <filesystem>
+#include <memory>
 #include <string>
 
 #include "../sdk/connector.h"
@@ -18,6 +19,7 @@ namespace fs = std::filesystem;
 struct HandlerInfo {
     DynLib      lib;
     handler_t*  handler = nullptr;
+    std::unique_ptr<handler_t> handler_abi1;  ///< Host copy of an ABI 1 plugin's handler (handler points here)
     host_api_t  api{};
     fs::path    path;
     std::string name;
@@ -37,6 +39,7 @@ struct HandlerInfo {
 struct ConnectorInfo {
     DynLib           lib;
     connector_ops_t* ops    = nullptr;
+    std::unique_ptr<connector_ops_t> ops_abi1;  ///< Host copy of an ABI 1 plugin's ops (ops points here)
     host_api_t       api{};
     fs::path         path;
     std::string      name;
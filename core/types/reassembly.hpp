@@ -0,0 +1,178 @@
+#pragma once
+/// @file core/types/reassembly.hpp
+/// @brief Per-connection framing of the byte stream, reassembly of
+///        GNET_FLAG_FRAGMENT messages and reordering of GNET_FLAG_STRIPED frames.
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "../sdk/types.h"
+
+namespace gn {
+
+/// Cuts a connector byte stream into frames (header_t + payload).
+///
+/// Frames lying whole inside a read chunk are returned as views into the
+/// chunk — zero-copy, nothing is buffered.  Only a frame cut by a chunk
+/// boundary is staged: its bytes are appended until it completes, it is
+/// returned from the stash, and the stash is emptied on the next call.
+/// At most one partial frame is ever held, so consumed bytes are never
+/// shifted out of the buffer and each byte is copied at most once.
+/// The header is validated as soon as it is complete; a frame declaring more
+/// than `max_frame` bytes is rejected before its payload is buffered.
+///
+/// Thread-safety: none — one connector read loop feeds one stream.
+class StreamReassembler {
+public:
+    static constexpr size_t KEEP_CAPACITY = 256 * 1024;  ///< Larger stash is freed after use
+
+    enum class Status : uint8_t {
+        Ready,        ///< `out` holds a complete frame
+        NeedMore,     ///< Input exhausted; partial frame (if any) staged
+        BadMagic,     ///< Header rejected — see rejected()
+        BadProtoVer,
+        TooLarge,     ///< Declared frame size exceeds `max_frame`
+    };
+
+    struct View {
+        const header_t*          hdr = nullptr;
+        std::span<const uint8_t> payload;
+    };
+
+    /// @brief Take the next frame from @p in, advancing it past the bytes used.
+    ///
+    /// A returned View stays valid until the next call (stash) or for as
+    /// long as the chunk behind @p in lives.  After an error the stream is
+    /// empty; the caller is expected to close the connection.
+    Status next(std::span<const uint8_t>& in, size_t max_frame, View& out);
+
+    /// Header of the last rejected frame (diagnostics).
+    const header_t& rejected() const noexcept { return rejected_; }
+
+    /// Bytes of the partial frame currently staged.
+    size_t buffered() const noexcept { return delivered_ ? 0 : stash_len_; }
+
+    void reset() noexcept;
+
+private:
+    Status check(const uint8_t* hdr, size_t max_frame) noexcept;
+    Status fill(std::span<const uint8_t>& in, size_t max_frame, View& out);
+    void   take(std::span<const uint8_t>& in, size_t n);
+    void   reserve(size_t n);
+
+    // Сырой буфер, а не vector: insert() по нескольку байт на мелких чтениях
+    // стоил дороже самого memcpy, а resize() обнулял бы весь кадр
+    std::unique_ptr<uint8_t[]> stash_;
+    size_t                     stash_len_ = 0;
+    size_t                     stash_cap_ = 0;
+    header_t                   rejected_{};
+    bool                       delivered_ = false;  ///< stash_ was handed out by the last next()
+};
+
+/// Collects fragments (frag_hdr_t + chunk) into whole messages.
+///
+/// Memory is bounded: the full `total_len` of a message is reserved on its
+/// first fragment and counted against the caller's budget until the message
+/// completes, is rejected or expires.  Fragments may arrive in any order
+/// (multi-path); a message completes when its fragments cover all `total_len`
+/// bytes.  A fragment overlapping bytes already received (repeated or crafted
+/// offsets) rejects the whole message — it could otherwise reach `total_len`
+/// while leaving holes.
+///
+/// Thread-safety: add() runs on the connection's dispatch path, expire() on
+/// the maintenance timer — both take `mu_`.
+class FragmentReassembler {
+public:
+    static constexpr size_t MAX_PARTIAL  = 8;  ///< Concurrent partial messages
+    static constexpr size_t RECENT_DROPS = 8;  ///< Rejected msg_ids remembered
+
+    enum class Result : uint8_t {
+        Partial,    ///< Fragment stored, message incomplete
+        Complete,   ///< Message assembled into `out`
+        Rejected,   ///< Fragment invalid or over budget — whole message dropped
+    };
+
+    /// @brief Store one fragment.
+    /// @param budget  Max bytes reserved across all partial messages.
+    /// @param out     Receives the message on Result::Complete.
+    Result add(uint32_t msg_type, const frag_hdr_t& fh,
+               std::span<const uint8_t> chunk, size_t budget,
+               std::vector<uint8_t>& out);
+
+    /// @brief Drop partial messages started before @p deadline.
+    /// @return Number of messages dropped.
+    size_t expire(std::chrono::steady_clock::time_point deadline);
+
+    /// @brief Bytes currently reserved by partial messages.
+    [[nodiscard]] size_t reserved_bytes() const;
+
+private:
+    struct Partial {
+        uint32_t             msg_type = 0;
+        uint64_t             received = 0;
+        std::map<uint64_t, uint64_t> covered;   ///< Received ranges, begin → end (merged)
+        std::vector<uint8_t> data;
+        std::chrono::steady_clock::time_point started{};
+    };
+
+    void drop_locked(uint32_t msg_id);
+    bool recently_dropped(uint32_t msg_id) const;
+
+    mutable std::mutex                    mu_;
+    std::unordered_map<uint32_t, Partial> partial_;
+    size_t                                reserved_ = 0;
+    std::array<uint64_t, RECENT_DROPS>    dropped_{};   ///< msg_id + 1, 0 = empty
+    size_t                                dropped_pos_ = 0;
+};
+
+/// Restores send order of GNET_FLAG_STRIPED frames spread over several paths.
+///
+/// The sender numbers striped frames per connection; a frame is released as
+/// soon as every lower sequence number has been released.  A gap is skipped
+/// when more than MAX_HELD frames or MAX_HELD_BYTES wait behind it, or when
+/// the caller expires it (release_expired) — a frame lost with a failed path
+/// must not stall the stream forever.  Frames arriving after their gap was skipped are released
+/// immediately, out of order.
+///
+/// Thread-safety: push() from any connector thread, release_expired() from
+/// the gap timer — both take `mu_`; released frames are handed out by value.
+class StripeReorderBuffer {
+public:
+    static constexpr size_t MAX_HELD       = 256;               ///< Frames buffered behind a gap
+    static constexpr size_t MAX_HELD_BYTES = 32UL * 1024 * 1024; ///< Bytes buffered behind a gap
+
+    struct Frame {
+        uint64_t             seq = 0;
+        header_t             hdr{};
+        std::vector<uint8_t> data;           ///< Plaintext without the sequence prefix
+        uint64_t             recv_ts_ns = 0;
+        std::chrono::steady_clock::time_point held_at{};
+    };
+
+    /// @brief Accept one frame; append every deliverable frame, in order, to @p out.
+    void push(Frame f, std::vector<Frame>& out);
+
+    /// @brief Skip gaps whose first waiting frame arrived before @p deadline.
+    void release_expired(std::chrono::steady_clock::time_point deadline,
+                         std::vector<Frame>& out);
+
+    /// @brief Frames currently waiting behind a gap.
+    [[nodiscard]] size_t held() const;
+
+private:
+    void drain_locked(std::vector<Frame>& out);
+
+    mutable std::mutex         mu_;
+    uint64_t                   next_ = 0;   ///< Next sequence number to release
+    std::map<uint64_t, Frame>  held_;
+    size_t                     held_bytes_ = 0;
+};
+
+} // namespace gn
@@ -0,0 +1,193 @@
+#pragma once
+/// @file core/types/worker_pool.hpp
+/// @brief Bounded worker pool with per-key serial lanes.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gn {
+
+/// Fixed set of worker threads draining one bounded FIFO.
+///
+/// Used to move CPU-heavy work (Noise DH, Ed25519 verify) off connector IO
+/// threads.  try_post() fails instead of blocking once `max_queued` tasks are
+/// waiting — the caller decides how to shed load.
+///
+/// A Lane serialises the tasks of one key (one connection): they run in post
+/// order and never concurrently, on whichever worker picks the lane up.
+/// `Lane::pending` counts tasks posted and not yet finished; once it reads 0
+/// (acquire) every lane task's effects are visible to the reader.  stop()
+/// discards lane tasks that have not started, so `pending` drops with them.
+///
+/// Thread-safety: try_post() from any thread; stop() once, from a non-worker.
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    struct Lane {
+        std::atomic<uint32_t> pending{0};   ///< Posted, not yet finished
+
+        /// @brief true on the worker currently draining this lane.
+        bool running_in_this_thread() const noexcept { return tls_lane() == this; }
+
+    private:
+        friend class WorkerPool;
+        std::mutex       mu;
+        std::deque<Task> tasks;
+        bool             scheduled = false;  ///< A drain task is queued or running
+    };
+
+    WorkerPool(size_t threads, size_t max_queued) : max_queued_(max_queued) {
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { run(); });
+    }
+
+    ~WorkerPool() { stop(); }
+
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t threads() const noexcept { return workers_.size(); }
+    size_t capacity() const noexcept { return max_queued_; }
+
+    /// Tasks waiting to start (pool queue + lanes).
+    size_t queued() const noexcept { return queued_.load(std::memory_order_relaxed); }
+
+    /// @brief Enqueue @p t. @return false if stopped or `max_queued` tasks wait.
+    bool try_post(Task t) {
+        if (!reserve()) return false;
+        if (!enqueue(std::move(t))) { queued_.fetch_sub(1, std::memory_order_relaxed); return false; }
+        return true;
+    }
+
+    /// @brief Enqueue @p t behind the earlier tasks of @p lane.
+    bool try_post(const std::shared_ptr<Lane>& lane, Task t) {
+        if (!reserve()) return false;
+        // Drain ставится в очередь под lane->mu: задача публикуется только после
+        // того, как stop() уже не может её отбросить молча (или отказ — целиком)
+        std::lock_guard lk(lane->mu);
+        if (!lane->scheduled) {
+            if (!enqueue(Item{{}, lane})) {
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            lane->scheduled = true;
+        }
+        lane->tasks.push_back(std::move(t));   // текущий drain заберёт и эту задачу
+        lane->pending.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// @brief Join the workers; tasks not yet started are discarded.
+    void stop() {
+        {
+            std::lock_guard lk(mu_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_) w.join();
+        for (auto& item : queue_) {
+            if (item.lane) cancel(*item.lane);
+            else           queued_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        queue_.clear();
+    }
+
+private:
+    static const Lane*& tls_lane() noexcept {
+        thread_local const Lane* lane = nullptr;
+        return lane;
+    }
+
+    bool reserve() noexcept {
+        size_t n = queued_.load(std::memory_order_relaxed);
+        do {
+            if (n >= max_queued_) return false;
+        } while (!queued_.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+        return true;
+    }
+
+    /// Pool queue entry: a plain task, or the drain of @p lane.
+    struct Item {
+        Task                  task;
+        std::shared_ptr<Lane> lane;
+    };
+
+    bool enqueue(Item item) {
+        {
+            std::lock_guard lk(mu_);
+            if (stopping_) return false;
+            queue_.push_back(std::move(item));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    bool enqueue(Task t) { return enqueue(Item{std::move(t), nullptr}); }
+
+    void run() {
+        for (;;) {
+            Item item;
+            {
+                std::unique_lock lk(mu_);
+                cv_.wait(lk, [&] { return stopping_ || !queue_.empty(); });
+                if (stopping_) return;
+                item = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            if (item.lane) drain(*item.lane);
+            else           item.task();
+        }
+    }
+
+    /// Drop the unstarted tasks of a lane whose drain never ran (stop()).
+    void cancel(Lane& lane) {
+        std::lock_guard lk(lane.mu);
+        const auto n = static_cast<uint32_t>(lane.tasks.size());
+        lane.tasks.clear();
+        lane.scheduled = false;   // следующий try_post упрётся в stopping_
+        queued_.fetch_sub(n, std::memory_order_relaxed);
+        lane.pending.fetch_sub(n, std::memory_order_release);
+    }
+
+    /// Drain task of a lane: holds one queued_ slot per lane task, released as each starts.
+    void drain(Lane& lane) {
+        queued_.fetch_add(1, std::memory_order_relaxed);   // run() снял слот drain-задачи
+        tls_lane() = &lane;
+        for (;;) {
+            Task t;
+            {
+                std::lock_guard lk(lane.mu);
+                if (lane.tasks.empty()) { lane.scheduled = false; break; }
+                t = std::move(lane.tasks.front());
+                lane.tasks.pop_front();
+            }
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            t();
+            lane.pending.fetch_sub(1, std::memory_order_release);
+        }
+        tls_lane() = nullptr;
+    }
+
+    const size_t             max_queued_;
+    std::atomic<size_t>      queued_{0};
+    std::mutex               mu_;
+    std::condition_variable  cv_;
+    std::deque<Item>         queue_;
+    bool                     stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace gn
@@ -27,7 +27,7 @@
             !(b == "build" || b == "result" || b == ".git" || b == ".direnv");
         };
 
-        coreBuildInputs = with pkgs; [ boost spdlog fmt nlohmann_json libsodium zstd ]
+        coreBuildInputs = with pkgs; [ boost spdlog fmt nlohmann_json libsodium zstd lz4 ]
           ++ lib.optionals isDarwin [ darwin.apple_sdk.frameworks.CoreFoundation
                                       darwin.apple_sdk.frameworks.Security ];
         coreNative      = with pkgs; [ cmake ninja pkg-config ];
@@ -45,7 +45,7 @@
 
             nativeBuildInputs = coreNative ++ [ pkgs.gtest ];
             buildInputs = with pkgs; [
-              fmt nlohmann_json libsodium zstd boost gtest
+              fmt nlohmann_json libsodium zstd lz4 boost gtest
             ] ++ lib.optionals isDarwin [
               darwin.apple_sdk.frameworks.CoreFoundation
               darwin.apple_sdk.frameworks.Security
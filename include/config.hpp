@@ -25,7 +25,13 @@ public:
         std::string listen_address = "0.0.0.0";
         int         listen_port    = 25565;
         int         io_threads     = 0;       ///< 0 = auto (hardware concurrency).
-        int         max_connections = 1000;
+        int         max_connections = 1000;   ///< 0 = unlimited.
+        int         handshake_threads = 2;    ///< Noise handshake workers (0 = inline on IO threads).
+        int         max_handshakes = 256;     ///< Unfinished handshakes before inbound connects are refused (0 = unlimited).
+        int         handshake_rate_per_ip = 20; ///< Inbound handshakes/s per remote address (0 = unlimited).
+        int         flush_delay_us = 0;       ///< Max send coalescing delay (µs); 0 = flush on next io tick.
+        std::string path_scheduler = "adaptive"; ///< "adaptive" (RTT/loss/queue) or "priority" (static).
+        bool        multipath_stripe = false;  ///< Stripe bulk frames across all active paths.
     };
 
     /// @brief Logging configuration.
@@ -41,6 +47,12 @@ public:
         int key_exchange_timeout = 30;    ///< Seconds.
         int max_auth_attempts    = 3;
         int session_timeout      = 3600;  ///< Seconds.
+        std::string cipher       = "auto"; ///< "auto" (AES-256-GCM with AES-NI on both sides) | "chacha20".
+        int replay_window        = 1024;  ///< Anti-replay window, packets (1024 … 8192).
+        int rekey_after_packets  = 1 << 24; ///< Rotate the send key after N frames (0 = off).
+        int rekey_after_mb       = 65536;   ///< … or after N MiB sealed (0 = off).
+        bool resumption          = true;  ///< 1-RTT Noise_IK reconnect to peers in the identity cache.
+        int  peer_cache_size     = 4096;  ///< Verified peer identities kept for resumption (0 = off).
     };
 
     /// @brief Zstd compression settings for encrypted payloads.
@@ -48,6 +60,13 @@ public:
         bool enabled   = true;
         int  threshold = 512;  ///< Min payload bytes to trigger compression.
         int  level     = 1;    ///< Zstd compression level.
+        bool        dictionaries   = false; ///< Sample traffic and train per-type dictionaries.
+        std::string dict_dir;               ///< `<msg_type>.zdict` files: loaded at start, trained ones saved.
+        int         dict_threshold = 64;    ///< Min payload bytes when a dictionary applies.
+        bool        adaptive       = true;  ///< Entropy probe + per-connection level by backlog.
+        int         max_level      = 9;     ///< Upper bound for the adaptive level.
+        bool        stream         = false; ///< Cross-frame zstd history on ordered paths.
+        std::string codec          = "zstd"; ///< "zstd" | "lz4" (peers without CORE_CAP_LZ4 get zstd).
     };
 
     /// @brief Plugin loading configuration.
@@ -21,7 +21,7 @@
 #include "../sdk/types.h"   /* propagation_t, conn_id_t */
 
 /// @brief Number of DropReason variants.  Must match `DropReason::_Count` in signals.hpp.
-#define GN_DROP_REASON_COUNT 17
+#define GN_DROP_REASON_COUNT 19
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,10 +55,10 @@ concept Serializable = std::derived_from<std::remove_cvref_t<T>, sdk::IData>;
 class Core {
 public:
     using PacketHandler = std::function<propagation_t(
-        std::string_view          name,
-        std::shared_ptr<header_t> hdr,
-        const endpoint_t*         ep,
-        PacketData                data)>;
+        std::string_view  name,
+        const header_t&   hdr,
+        const endpoint_t* ep,
+        const PacketData& data)>;
 
     // ── Lifecycle ─────────────────────────────────────────────────────────────
 
@@ -92,46 +92,59 @@ public:
     /// @param uri       Peer address (e.g. "tcp://host:port").
     /// @param msg_type  Wire message type (MSG_TYPE_*).
     /// @param payload   Raw payload bytes.
+    /// @param cls       QoS class; Auto = by msg_type (see set_send_class()).
     /// @return false on backpressure or invalid URI.
     bool send(std::string_view uri, uint32_t msg_type,
-              std::span<const uint8_t> payload);
+              std::span<const uint8_t> payload,
+              SendClass cls = SendClass::Auto);
 
     /// @brief Send a contiguous byte range to a peer by URI.
     /// @tparam P  BytePayload type (vector<uint8_t>, string, string_view, span, etc.).
     template<BytePayload P>
-    bool send(std::string_view uri, uint32_t msg_type, const P& payload) {
-        return send(uri, msg_type, as_bytes(payload));
+    bool send(std::string_view uri, uint32_t msg_type, const P& payload,
+              SendClass cls = SendClass::Auto) {
+        return send(uri, msg_type, as_bytes(payload), cls);
     }
 
     /// @brief Send a serializable IData message to a peer by URI.
     /// @tparam T  Serializable type (PodData<S>, VarData, custom IData subclass).
     template<Serializable T>
-    bool send(std::string_view uri, uint32_t msg_type, const T& data) {
+    bool send(std::string_view uri, uint32_t msg_type, const T& data,
+              SendClass cls = SendClass::Auto) {
         auto buf = data.serialize();
-        return send(uri, msg_type, std::span<const uint8_t>{buf});
+        return send(uri, msg_type, std::span<const uint8_t>{buf}, cls);
     }
 
     // ── Send (by connection ID) ──────────────────────────────────────────────
 
     /// @brief Send raw bytes on an existing connection.
+    /// @details Never blocks.  A payload above the fragmentation threshold
+    ///          (2 MB) is accepted whole: the fragments that do not fit the
+    ///          send window wait in the core and follow as the window reopens.
     /// @param id        Connection identifier.
     /// @param msg_type  Wire message type.
     /// @param payload   Raw payload bytes.
-    /// @return false if connection not found.
+    /// @param cls       QoS class; Auto = by msg_type.
+    /// @return false if the connection is not found, the send window is
+    ///         exhausted (unfragmented payload; see send_window() and
+    ///         `bus().on_writable`), or 64 MB of large messages already wait.
     bool send(conn_id_t id, uint32_t msg_type,
-              std::span<const uint8_t> payload);
+              std::span<const uint8_t> payload,
+              SendClass cls = SendClass::Auto);
 
     /// @brief Send a contiguous byte range on an existing connection.
     template<BytePayload P>
-    bool send(conn_id_t id, uint32_t msg_type, const P& payload) {
-        return send(id, msg_type, as_bytes(payload));
+    bool send(conn_id_t id, uint32_t msg_type, const P& payload,
+              SendClass cls = SendClass::Auto) {
+        return send(id, msg_type, as_bytes(payload), cls);
     }
 
     /// @brief Send a serializable IData message on an existing connection.
     template<Serializable T>
-    bool send(conn_id_t id, uint32_t msg_type, const T& data) {
+    bool send(conn_id_t id, uint32_t msg_type, const T& data,
+              SendClass cls = SendClass::Auto) {
         auto buf = data.serialize();
-        return send(id, msg_type, std::span<const uint8_t>{buf});
+        return send(id, msg_type, std::span<const uint8_t>{buf}, cls);
     }
 
     // ── Broadcast ─────────────────────────────────────────────────────────────
@@ -139,21 +152,37 @@ public:
     /// @brief Broadcast raw bytes to all ESTABLISHED peers.
     /// @param msg_type  Wire message type.
     /// @param payload   Raw payload bytes.
-    void broadcast(uint32_t msg_type, std::span<const uint8_t> payload);
+    /// @param cls       QoS class; Auto = by msg_type.
+    /// @return Completion handle: per-peer sent/failed counts.  With many
+    ///         peers the fan-out finishes on the IO threads — wait() on the
+    ///         handle, not from an IO thread.
+    BroadcastHandle broadcast(uint32_t msg_type, std::span<const uint8_t> payload,
+                              SendClass cls = SendClass::Auto);
 
     /// @brief Broadcast a contiguous byte range to all ESTABLISHED peers.
     template<BytePayload P>
-    void broadcast(uint32_t msg_type, const P& payload) {
-        broadcast(msg_type, as_bytes(payload));
+    BroadcastHandle broadcast(uint32_t msg_type, const P& payload,
+                              SendClass cls = SendClass::Auto) {
+        return broadcast(msg_type, as_bytes(payload), cls);
     }
 
     /// @brief Broadcast a serializable IData message to all ESTABLISHED peers.
     template<Serializable T>
-    void broadcast(uint32_t msg_type, const T& data) {
+    BroadcastHandle broadcast(uint32_t msg_type, const T& data,
+                              SendClass cls = SendClass::Auto) {
         auto buf = data.serialize();
-        broadcast(msg_type, std::span<const uint8_t>{buf});
+        return broadcast(msg_type, std::span<const uint8_t>{buf}, cls);
     }
 
+    /// @brief Route @p msg_type through QoS class @p cls when a send passes
+    ///        SendClass::Auto.  SendClass::Auto restores the built-in mapping.
+    void set_send_class(uint32_t msg_type, SendClass cls);
+
+    /// @brief Hand fragments of large @p msg_type messages to handlers as they
+    ///        arrive (frag_hdr_t + chunk, GNET_FLAG_FRAGMENT in the header)
+    ///        instead of reassembling the whole message first.
+    void set_fragment_streaming(uint32_t msg_type, bool on);
+
     // ── Connection control ────────────────────────────────────────────────────
 
     /// @brief Initiate outbound connection (non-blocking).
@@ -217,7 +246,12 @@ public:
     // ── Stats ─────────────────────────────────────────────────────────────────
 
     /// @brief Atomic snapshot of accumulated traffic / auth / drop counters.
-    [[nodiscard]] StatsSnapshot       stats_snapshot()   const noexcept;
+    [[nodiscard]] StatsSnapshot       stats_snapshot()   const;
+
+    /// @brief Bytes that can be sent on @p id without backpressure.
+    /// @details Bulk senders pace on this plus `bus().on_writable`, which
+    ///          fires once the window reopens after a rejected send.
+    [[nodiscard]] size_t              send_window(conn_id_t id) const noexcept;
 
     /// @brief Number of currently active connections (any state).
     [[nodiscard]] size_t              connection_count() const noexcept;
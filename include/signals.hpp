@@ -16,14 +16,20 @@
 /// - PipelineSignal: `emit()` is wait-free (atomic shared_ptr read).
 ///   `connect()`/`disconnect()` take a mutex (rare path).
 /// - EventSignal: `emit()` posts to a strand — handlers run sequentially.
-/// - SignalBus: packet dispatch uses shared_mutex for channel map access.
+/// - SignalBus: packet dispatch finds the channel with two atomic loads
+///   (flat table by payload_type); subscribe/unsubscribe take a mutex.
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <span>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
@@ -54,9 +60,90 @@ enum class DropReason : uint8_t {
     RelayDropped        = 12,
     SenderIdMismatch    = 13,
     TrustedFromRemote   = 14,
-    RecvBufOverflow     = 15,  ///< recv_buf exceeded MAX_RECV_BUF → close
+    RecvBufOverflow     = 15,  ///< frame larger than MAX_RECV_BUF → close
     ConnectorNotFound   = 16,  ///< send_frame: no connector for negotiated scheme
-    _Count              = 17,
+    ReassemblyFailed    = 17,  ///< Fragment rejected or partial message timed out
+    AdmissionDenied     = 18,  ///< Connection refused by admission control / handshake pool full
+    _Count              = 19,
+};
+
+// ── Send classes ──────────────────────────────────────────────────────────────
+
+/// @brief QoS class of an outbound frame.
+/// Each class has its own per-connection queue; the flush drains Control with
+/// strict priority and the rest by weighted round-robin.
+/// Each value maps to a counter in StatsSnapshot::queue_depth[].
+enum class SendClass : uint8_t {
+    Control     = 0,   ///< Handshake, heartbeat, health/DHT pings — never wait behind data
+    Interactive = 1,   ///< Default for application messages
+    Bulk        = 2,   ///< File transfer, store sync, large chunked payloads
+    Relay       = 3,   ///< Frames forwarded for other peers
+    _Count      = 4,
+    Auto        = 0xFF,///< Resolve from msg_type (ConnectionManager::send_class_of)
+};
+
+// ── Broadcast completion ──────────────────────────────────────────────────────
+
+/// @brief Completion handle of one broadcast.
+///
+/// broadcast() snapshots the ESTABLISHED peers, then encrypts and enqueues
+/// per peer — possibly on the core's IO threads.  The handle counts peers
+/// whose frame was queued (`sent`) or rejected (`failed`, e.g. send window
+/// exhausted or the peer disconnected meanwhile).  "Sent" means accepted
+/// into the peer's send queue, not delivered.
+///
+/// Thread-safety: all methods may be called from any thread; copies share state.
+class BroadcastHandle {
+public:
+    /// Shared between the handle and the fan-out workers.
+    struct State {
+        explicit State(size_t n) : peers(n) {}
+
+        const size_t        peers;
+        std::atomic<size_t> sent{0};
+        std::atomic<size_t> failed{0};
+        std::mutex              mu;
+        std::condition_variable cv;
+
+        /// @brief Record the outcome for one peer; wakes waiters on the last one.
+        void complete(bool ok) {
+            (ok ? sent : failed).fetch_add(1, std::memory_order_acq_rel);
+            if (finished() == peers) {
+                std::lock_guard lk(mu);
+                cv.notify_all();
+            }
+        }
+        size_t finished() const noexcept {
+            return sent.load(std::memory_order_acquire)
+                 + failed.load(std::memory_order_acquire);
+        }
+    };
+
+    BroadcastHandle() = default;
+    explicit BroadcastHandle(std::shared_ptr<State> s) : st_(std::move(s)) {}
+
+    [[nodiscard]] size_t peers()  const noexcept { return st_ ? st_->peers : 0; }
+    [[nodiscard]] size_t sent()   const noexcept { return st_ ? st_->sent.load(std::memory_order_acquire) : 0; }
+    [[nodiscard]] size_t failed() const noexcept { return st_ ? st_->failed.load(std::memory_order_acquire) : 0; }
+    [[nodiscard]] bool   done()   const noexcept { return !st_ || st_->finished() == st_->peers; }
+
+    /// @brief Block until every peer has an outcome.
+    void wait() const {
+        if (done()) return;
+        std::unique_lock lk(st_->mu);
+        st_->cv.wait(lk, [&] { return done(); });
+    }
+
+    /// @brief Block up to @p timeout. @return true if the broadcast completed.
+    template<typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> timeout) const {
+        if (done()) return true;
+        std::unique_lock lk(st_->mu);
+        return st_->cv.wait_for(lk, timeout, [&] { return done(); });
+    }
+
+private:
+    std::shared_ptr<State> st_;
 };
 
 // ── Latency histogram ─────────────────────────────────────────────────────────
@@ -121,6 +208,9 @@ struct StatsEvent {
         Connect, Disconnect,
         Drop,
         DispatchLatencyNs,
+        Flush,              ///< One connector flush; value = frames coalesced
+        RekeyTx,            ///< Send key rotated; value = ns spent deriving it
+        RekeyRx,            ///< Peer's key rotation followed; value = ns spent
     };
     Kind       kind;
     uint64_t   value   = 1;
@@ -128,6 +218,22 @@ struct StatsEvent {
     DropReason drop_reason{};
 };
 
+/// @brief Compression counters of one payload_type (frames that tried a codec).
+/// @details frames — все кодеки; lz4_frames — их подмножество, ушедшее через
+///          LZ4, остальное — zstd (одиночный, словарный или потоковый).
+struct CompressionStats {
+    uint64_t frames      = 0;
+    uint64_t dict_frames = 0;   ///< Compressed with a zstd dictionary
+    uint64_t lz4_frames  = 0;   ///< Compressed with LZ4 instead of zstd
+    uint64_t raw_bytes   = 0;   ///< Payload bytes before compression
+    uint64_t wire_bytes  = 0;   ///< Body bytes after compression (before AEAD)
+
+    /// @brief raw / wire; 1.0 = no gain.
+    [[nodiscard]] double ratio() const noexcept {
+        return wire_bytes ? static_cast<double>(raw_bytes) / static_cast<double>(wire_bytes) : 0.0;
+    }
+};
+
 /// @brief Atomic snapshot of accumulated traffic, auth, and drop counters.
 ///
 /// Obtained via `SignalBus::stats_snapshot()` or `Core::stats_snapshot()`.
@@ -146,18 +252,59 @@ struct StatsSnapshot {
     uint32_t connections  = 0;
     uint32_t total_conn   = 0;
     uint32_t total_disc   = 0;
+    uint64_t pool_hits    = 0;   ///< Frame buffers served from sdk::BufferPool caches
+    uint64_t pool_misses  = 0;   ///< Frame buffers that required a fresh allocation
+    uint64_t flushes      = 0;   ///< Connector flushes (send_gather / send_owned batches)
+    uint64_t flush_frames = 0;   ///< Frames written by those flushes
+    uint64_t rekeys_tx    = 0;   ///< Send key rotations (key epochs)
+    uint64_t rekeys_rx    = 0;   ///< Peer rotations followed by receive side
+    uint64_t rekey_ns     = 0;   ///< Total time spent deriving rotated keys
+
+    [[nodiscard]] double frames_per_flush() const noexcept {
+        return flushes ? static_cast<double>(flush_frames) / static_cast<double>(flushes) : 0.0;
+    }
+    [[nodiscard]] uint64_t avg_rekey_ns() const noexcept {
+        const uint64_t n = rekeys_tx + rekeys_rx;
+        return n ? rekey_ns / n : 0;
+    }
 
     uint64_t drops[static_cast<size_t>(DropReason::_Count)]{};
+    uint64_t queue_depth[static_cast<size_t>(SendClass::_Count)]{}; ///< Frames queued now, all connections
     LatencyHistogram dispatch_latency;
+    std::map<uint32_t, CompressionStats> compression; ///< By payload_type
 };
 
+// ── Handler IDs ───────────────────────────────────────────────────────────────
+
+/// @brief Small integer ID of a handler name.  The dispatch path reports and
+///        pins handlers by ID; names are kept only for diagnostics.
+using handler_id_t = uint32_t;
+inline constexpr handler_id_t HANDLER_ID_NONE = 0;
+
+/// @brief ID of @p name, assigned on first use.  Process-wide, never reused —
+///        the same name always maps to the same ID.
+handler_id_t intern_handler(std::string_view name);
+
+/// @brief Name of @p id; empty for HANDLER_ID_NONE or an unknown ID.
+///        The view stays valid for the lifetime of the process.
+std::string_view handler_name(handler_id_t id) noexcept;
+
 // ── PipelineSignal ────────────────────────────────────────────────────────────
 
+/// @brief Packet handler.  @p hdr is `data.header()`; both are borrowed for
+///        the call — copy @p data (one refcount increment) to keep the packet.
 using HandlerPacketFn = std::function<
-    propagation_t(std::string_view name,
-                  std::shared_ptr<header_t> hdr,
-                  const endpoint_t*         ep,
-                  PacketData                data)>;
+    propagation_t(std::string_view  name,
+                  const header_t&   hdr,
+                  const endpoint_t* ep,
+                  const PacketData& data)>;
+
+/// @brief Optional batch handler: consecutive packets of one type from one
+///        connection.  The decision applies to every packet in @p batch.
+using HandlerBatchFn = std::function<
+    propagation_t(std::string_view            name,
+                  const endpoint_t*           ep,
+                  std::span<const PacketData> batch)>;
 
 /// @brief Lock-free ordered packet dispatch chain.
 ///
@@ -171,22 +318,46 @@ public:
     PipelineSignal()
         : handlers_ptr_(std::make_shared<const std::vector<Entry>>()) {}
 
+    static constexpr size_t MAX_BATCH = 64;   ///< Packets per emit_batch() (live mask width)
+
     /// @brief Add a handler to the pipeline. Rebuilds the sorted vector.
-    void connect   (uint8_t priority, std::string_view name, HandlerPacketFn fn);
+    /// @param batch  Optional: called once per emit_batch() instead of @p fn per packet.
+    void connect   (uint8_t priority, std::string_view name, HandlerPacketFn fn,
+                    HandlerBatchFn batch = {});
     /// @brief Remove a handler by name.
     void disconnect(std::string_view name);
 
     struct EmitResult {
         propagation_t result      = PROPAGATION_CONTINUE;
-        std::string   consumed_by;
+        handler_id_t  consumed_by = HANDLER_ID_NONE;   ///< Handler that stopped the chain
     };
 
-    EmitResult emit(std::shared_ptr<header_t> hdr,
-                    const endpoint_t*         ep,
-                    PacketData                data) const;
+    EmitResult emit(const endpoint_t* ep, const PacketData& data) const;
+
+    struct BatchResult {
+        size_t      consumed = 0;
+        size_t      rejected = 0;
+        handler_id_t consumed_by = HANDLER_ID_NONE;   ///< First handler that consumed a packet
+        handler_id_t rejected_by = HANDLER_ID_NONE;   ///< First handler that rejected a packet
+    };
+
+    /// @brief Run the packets whose bit is set in @p live through the chain.
+    ///
+    /// Batch-capable handlers see all still-propagating packets in one call,
+    /// the rest see them one by one.  A packet stops at the handler that
+    /// consumed or rejected it: its bit is cleared in @p live.
+    /// @pre pkts.size() <= MAX_BATCH.
+    void emit_batch(const endpoint_t* ep, std::span<const PacketData> pkts,
+                    uint64_t& live, BatchResult& out) const;
 
 private:
-    struct Entry { uint8_t priority; std::string name; HandlerPacketFn fn; };
+    struct Entry {
+        uint8_t          priority;
+        handler_id_t     id;
+        std::string_view name;      ///< Interned — valid for the process lifetime
+        HandlerPacketFn  fn;
+        HandlerBatchFn  batch;
+    };
     mutable std::mutex write_mu_;
     std::atomic<std::shared_ptr<const std::vector<Entry>>> handlers_ptr_;
 };
@@ -246,6 +417,16 @@ private:
 /// wildcard chain.  Stats are accumulated atomically for zero-allocation
 /// hot-path accounting.
 ///
+/// ## Channel lookup
+/// `payload_type` is 16 bits on the wire, so channels live in a two-level
+/// table indexed by it directly: 256 pages × 256 atomic slots, pages
+/// allocated on first subscribe.  Dispatch is two acquire loads — no lock,
+/// no hashing.  A channel is published once and lives as long as the bus;
+/// subscribe/unsubscribe change its handler vector copy-on-write
+/// (PipelineSignal), so readers never see a slot change under them.
+/// Types above 0xFFFF (never on the wire, local use only) fall back to a
+/// map under a shared_mutex.
+///
 /// ## Subscription model
 ///   - `subscribe(msg_type, ...)` → per-type channel
 ///   - `subscribe_wildcard(...)` → receives ALL message types
@@ -260,21 +441,29 @@ public:
     /// @brief Subscribe a handler to a specific message type.
     /// @return Subscription ID for unsubscribe().
     uint64_t subscribe(uint32_t msg_type, std::string_view name,
-                       HandlerPacketFn cb, uint8_t prio = 128);
+                       HandlerPacketFn cb, uint8_t prio = 128,
+                       HandlerBatchFn batch = {});
 
     /// @brief Subscribe to all message types (wildcard).
     void subscribe_wildcard(std::string_view name,
-                            HandlerPacketFn cb, uint8_t prio = 128);
+                            HandlerPacketFn cb, uint8_t prio = 128,
+                            HandlerBatchFn batch = {});
 
     /// @brief Remove a subscription by ID.
     void unsubscribe(uint64_t sub_id);
 
     /// @brief Dispatch a packet through the handler chain.
     /// @return Which handler consumed it (or CONTINUE if none did).
-    PipelineSignal::EmitResult dispatch_packet(uint32_t                  msg_type,
-                                               std::shared_ptr<header_t> hdr,
-                                               const endpoint_t*         ep,
-                                               PacketData                data);
+    PipelineSignal::EmitResult dispatch_packet(uint32_t          msg_type,
+                                               const endpoint_t* ep,
+                                               const PacketData& data);
+
+    /// @brief Dispatch up to PipelineSignal::MAX_BATCH packets of @p msg_type
+    ///        (one connection, in order): type chain, then wildcards for the
+    ///        packets still propagating.  One channel lookup for the batch.
+    PipelineSignal::BatchResult dispatch_batch(uint32_t                    msg_type,
+                                               const endpoint_t*           ep,
+                                               std::span<const PacketData> pkts);
     /// @}
 
     /// @name Stats accumulation (lock-free, relaxed atomics)
@@ -283,8 +472,20 @@ public:
     void emit_drop   (conn_id_t id, DropReason why) noexcept;
     void emit_latency(conn_id_t id, uint64_t ns)    noexcept;
 
+    /// @brief Adjust the queued-frame gauge of @p cls (no on_stat event —
+    ///        called twice per frame on the send path).
+    void add_queue_depth(SendClass cls, int64_t delta) noexcept;
+
+    /// @brief Account one frame of @p msg_type that went through a codec
+    ///        (zstd, or LZ4 when @p lz4).
+    /// @details Первый кадр типа выделяет его счётчики под comp_mu_ — может
+    ///          бросить std::bad_alloc / std::system_error.
+    void add_compression(uint32_t msg_type, uint64_t raw_bytes, uint64_t wire_bytes,
+                         bool dict, bool lz4 = false);
+
     /// @brief Read a consistent snapshot of all accumulated counters.
-    [[nodiscard]] StatsSnapshot stats_snapshot() const noexcept;
+    /// @details Копирует per-type compression в std::map — может бросить.
+    [[nodiscard]] StatsSnapshot stats_snapshot() const;
     /// @}
 
     /// @name Async event signals (strand-serialized delivery)
@@ -293,11 +494,31 @@ public:
     EventSignal<std::string>             on_log;         ///< Log messages
     EventSignal<conn_id_t, conn_state_t> on_conn_state;  ///< Connection state changes
     EventSignal<conn_id_t, std::string, bool> on_transport_change; ///< (peer_id, scheme, added)
+    EventSignal<conn_id_t>               on_writable;    ///< Send window reopened after backpressure
     /// @}
 
 private:
-    mutable std::shared_mutex mu_;
-    std::unordered_map<uint32_t, std::unique_ptr<PipelineSignal>> channels_;
+    static constexpr size_t PAGE_BITS = 8;
+    static constexpr size_t PAGE_SIZE = size_t{1} << PAGE_BITS;   ///< Slots per page
+    static constexpr size_t NUM_PAGES = 0x10000 / PAGE_SIZE;
+
+    struct ChannelPage {
+        std::array<std::atomic<PipelineSignal*>, PAGE_SIZE> slots{};
+    };
+
+    /// @brief Channel of @p msg_type, nullptr if nobody ever subscribed.
+    PipelineSignal* find_channel(uint32_t msg_type) const noexcept;
+    /// @brief find_channel() for callers that already hold mu_.
+    PipelineSignal* find_channel_locked(uint32_t msg_type) const noexcept;
+    /// @brief Channel of @p msg_type, created and published if missing.
+    /// @pre mu_ held exclusively.
+    PipelineSignal& channel_locked(uint32_t msg_type);
+
+    std::array<std::atomic<ChannelPage*>, NUM_PAGES> pages_{};  ///< Read lock-free
+    mutable std::shared_mutex mu_;                  ///< Writers; readers of wide_channels_
+    std::vector<std::unique_ptr<ChannelPage>>    page_store_;   ///< Owns pages_
+    std::vector<std::unique_ptr<PipelineSignal>> channel_store_;///< Owns table slots
+    std::unordered_map<uint32_t, std::unique_ptr<PipelineSignal>> wide_channels_; ///< msg_type > 0xFFFF
     PipelineSignal wildcards_;
 
     struct SubInfo { uint32_t msg_type; std::string name; };
@@ -311,10 +532,19 @@ private:
         std::atomic<uint64_t> auth_ok{0}, auth_fail{0};
         std::atomic<uint64_t> decrypt_fail{0}, backpressure{0};
         std::atomic<uint64_t> consumed{0}, rejected{0};
+        std::atomic<uint64_t> flushes{0}, flush_frames{0};
+        std::atomic<uint64_t> rekeys_tx{0}, rekeys_rx{0}, rekey_ns{0};
         std::atomic<uint32_t> connections{0}, total_conn{0}, total_disc{0};
         std::atomic<uint64_t> drops[static_cast<size_t>(DropReason::_Count)]{};
+        std::atomic<int64_t>  queue_depth[static_cast<size_t>(SendClass::_Count)]{};
         LatencyHistogram       dispatch_lat;
     } accum_;
+
+    struct CompressionAccum {
+        std::atomic<uint64_t> frames{0}, dict_frames{0}, lz4_frames{0}, raw_bytes{0}, wire_bytes{0};
+    };
+    mutable std::shared_mutex comp_mu_;
+    std::unordered_map<uint32_t, std::unique_ptr<CompressionAccum>> comp_;
 };
 
 } // namespace gn
@@ -17,6 +17,7 @@
 
 #include <logger.hpp>
 
+#include <cpp/buffer_pool.hpp>
 #include <cpp/connector.hpp>
 #include <connector.h>
 #include <handler.h>
@@ -171,11 +172,11 @@ public:
     int do_listen(const char*, uint16_t) override { return 0; }
 
     int do_send(conn_id_t id, std::span<const uint8_t> data) override {
-        auto buf = std::make_shared<std::vector<uint8_t>>(data.begin(), data.end());
-        asio::post(io_, [this, id, buf] {
+        auto buf = sdk::FrameBuffer::copy_of(data);
+        asio::post(io_, [this, id, buf = std::move(buf)] {
             auto s = by_conn(id);
             if (!s || s->state() != ice::SessionState::Connected) return;
-            s->send({buf->data(), buf->size()});
+            s->send(buf.span());
         });
         return 0;
     }
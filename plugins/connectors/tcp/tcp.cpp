@@ -10,6 +10,7 @@
 #include <vector>
 
 #include <../sdk/cpp/data.hpp>
+#include <../sdk/cpp/buffer_pool.hpp>
 #include <connector.hpp>
 #include <logger.hpp>
 
@@ -35,9 +36,9 @@ struct TcpConnection {
     std::vector<uint8_t> frame_buf;
 
     // ── Write state (guarded by write_mu) ────────────────────────────────────
-    std::mutex                       write_mu;
-    std::deque<std::vector<uint8_t>> write_queue;
-    bool                             writing = false;
+    std::mutex                   write_mu;
+    std::deque<sdk::OwnedBuffer> write_queue;
+    bool                         writing = false;
 
     TcpConnection(tcp::socket s, conn_id_t cid, const endpoint_t& ep)
         : socket(std::move(s)), id(cid), remote(ep)
@@ -57,6 +58,7 @@ public:
     ~TcpConnector() = default;
 
     std::string get_scheme() const override { return "tcp"; }
+    bool reports_sent() const override { return true; }
     std::string get_name()   const override { return "GoodNet Boost.Asio TCP"; }
 
     // ─── Lifecycle ────────────────────────────────────────────────────────────
@@ -163,22 +165,22 @@ public:
     // ─── Send ────────────────────────────────────────────────────────────────
 
     int do_send(conn_id_t id, std::span<const uint8_t> data) override {
-        // Copy data into a shared buffer for async transmission.
-        auto buf = std::make_shared<std::vector<uint8_t>>(data.begin(), data.end());
+        // Copy data into a pooled buffer for async transmission.
+        auto buf = sdk::FrameBuffer::copy_of(data);
 
-        asio::post(io_, [this, id, buf]() {
+        asio::post(io_, [this, id, buf = std::move(buf)]() mutable {
             std::shared_ptr<TcpConnection> conn;
             {
                 std::lock_guard lock(conn_mu_);
                 auto it = connections_.find(id);
-                if (it == connections_.end()) return;
+                if (it == connections_.end()) { notify_sent(id, buf.size()); return; }
                 conn = it->second;
             }
 
             bool should_start = false;
             {
                 std::lock_guard lk(conn->write_mu);
-                conn->write_queue.push_back(std::move(*buf));
+                conn->write_queue.push_back(sdk::OwnedBuffer::from(std::move(buf)));
                 if (!conn->writing) {
                     conn->writing = true;
                     should_start  = true;
@@ -216,19 +218,35 @@ public:
 
     /// @brief Batch-enqueue all iov segments at once, avoiding per-frame do_send() loop.
     int do_send_gather(conn_id_t id, const struct iovec* iov, int n) override {
-        auto batch = std::make_shared<std::vector<std::vector<uint8_t>>>();
-        batch->reserve(n);
+        std::vector<sdk::OwnedBuffer> batch;
+        batch.reserve(n);
         for (int i = 0; i < n; ++i)
-            batch->emplace_back(
-                static_cast<const uint8_t*>(iov[i].iov_base),
-                static_cast<const uint8_t*>(iov[i].iov_base) + iov[i].iov_len);
+            batch.push_back(sdk::OwnedBuffer::from(sdk::FrameBuffer::copy_of(
+                {static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len})));
+        return enqueue_owned(id, std::move(batch));
+    }
+
+    /// @brief Zero-copy path: the core's frame buffers go straight into
+    ///        write_queue and from there to async_write — no deep copy.
+    int do_send_owned(conn_id_t id, std::vector<sdk::OwnedBuffer> bufs) override {
+        return enqueue_owned(id, std::move(bufs));
+    }
 
+private:
+    // ─── Write enqueue ───────────────────────────────────────────────────────
+
+    /// @brief Move buffers into the connection's write_queue on the IO thread.
+    int enqueue_owned(conn_id_t id, std::vector<sdk::OwnedBuffer> bufs) {
+        auto batch = std::make_shared<std::vector<sdk::OwnedBuffer>>(std::move(bufs));
         asio::post(io_, [this, id, batch]() {
             std::shared_ptr<TcpConnection> conn;
             {
                 std::lock_guard lock(conn_mu_);
                 auto it = connections_.find(id);
-                if (it == connections_.end()) return;
+                if (it == connections_.end()) {
+                    notify_sent(id, queued_bytes(*batch));   // отброшено — вернуть кредит
+                    return;
+                }
                 conn = it->second;
             }
             bool should_start = false;
@@ -246,7 +264,6 @@ public:
         return 0;
     }
 
-private:
     // ─── Accept ───────────────────────────────────────────────────────────────
 
     void accept_next() {
@@ -372,12 +389,19 @@ private:
 
     // ─── Write pipeline ───────────────────────────────────────────────────────
 
+    template<typename Seq>
+    static size_t queued_bytes(const Seq& bufs) {
+        size_t total = 0;
+        for (auto& b : bufs) total += b.size();
+        return total;
+    }
+
     static constexpr size_t WRITE_BATCH_SIZE = 64;
 
     void start_write(std::shared_ptr<TcpConnection> conn) {
         // Drain up to WRITE_BATCH_SIZE frames into a single scatter buffer list.
         // async_write with ConstBufferSequence maps to writev() — one syscall.
-        auto frames = std::make_shared<std::vector<std::vector<uint8_t>>>();
+        auto frames = std::make_shared<std::vector<sdk::OwnedBuffer>>();
         std::vector<asio::const_buffer> buffers;
         {
             std::lock_guard lk(conn->write_mu);
@@ -398,11 +422,18 @@ private:
 
         asio::async_write(conn->socket, buffers,
             [this, conn, frames](auto ec, std::size_t n) {
+                // Записано или отброшено — в любом случае кредит возвращается ядру
+                notify_sent(conn->id, queued_bytes(*frames));
                 if (ec && ec != asio::error::operation_aborted) {
                     LOG_WARN("[TCP] #{} write error: {}", conn->id, ec.message());
-                    std::lock_guard lk(conn->write_mu);
-                    conn->write_queue.clear();
-                    conn->writing = false;
+                    size_t dropped = 0;
+                    {
+                        std::lock_guard lk(conn->write_mu);
+                        for (auto& f : conn->write_queue) dropped += f.size();
+                        conn->write_queue.clear();
+                        conn->writing = false;
+                    }
+                    notify_sent(conn->id, dropped);
                     return;
                 }
                 LOG_TRACE("[TCP] #{} wrote {} bytes ({} frames)",
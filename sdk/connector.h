@@ -10,16 +10,28 @@
 ///   2. Plugin fills a `connector_ops_t` struct and returns 0.
 ///   3. Core calls `listen()` to start accepting connections.
 ///   4. Core calls `connect()` for outbound connections.
-///   5. Core calls `send_to()` / `send_gather()` to transmit frames.
+///   5. Core calls `send_owned()` (if set), `send_gather()` or `send_to()`
+///      to transmit frames.
 ///   6. On shutdown, core calls `ops->shutdown(ctx)`.
 ///
 /// ## Connector -> Core notifications
 ///   - New inbound connection: call `api->on_connect(ep)` -> get conn_id.
 ///   - Received data: call `api->on_data(id, buf, len)`.
 ///   - Connection closed: call `api->on_disconnect(id, err)`.
+///   - Bytes left the write queue: call `api->on_sent(id, n)` (only with
+///     `CONNECTOR_FLAG_REPORTS_SENT`, see below).
+///
+/// ## Flow control
+///   The core keeps a per-connection send window (bytes queued in the core
+///   plus bytes handed to the connector and not yet reported).  A connector
+///   that sets `CONNECTOR_FLAG_REPORTS_SENT` promises to call `on_sent()` for
+///   every byte it accepted once that byte is written to the socket (or
+///   discarded on error/close), so its own write queue counts against the
+///   window.  Without the flag, bytes are considered sent when send_*() returns.
 ///
 /// ## Thread-safety
-///   - `send_to()` and `send_gather()` may be called from any core thread.
+///   - `send_to()`, `send_gather()` and `send_owned()` may be called from any
+///     core thread.
 ///   - `on_connect()`, `on_data()`, `on_disconnect()` are safe to call from
 ///     any connector thread.
 ///   - `connect()` and `listen()` are called from the core's IO thread.
@@ -35,6 +47,22 @@ struct iovec { void* iov_base; size_t iov_len; };
 extern "C" {
 #endif
 
+/// @brief `connector_ops_t::flags`: the connector reports written bytes via
+///        `host_api_t::on_sent()`.
+#define CONNECTOR_FLAG_REPORTS_SENT 0x1u
+
+/// @brief Frame buffer handed to a connector together with ownership.
+///
+/// Used by `connector_ops_t::send_owned`.  The bytes stay valid and unchanged
+/// until `release(release_ctx)` is called; the connector must call it exactly
+/// once per buffer (from any thread) when it no longer needs the memory.
+typedef struct owned_buf_t {
+    const void* data;                       ///< Frame bytes
+    size_t      size;                       ///< Byte count
+    void      (*release)(void* release_ctx);///< Give the buffer back to its owner
+    void*       release_ctx;                ///< Opaque argument for release()
+} owned_buf_t;
+
 /// @brief Connector operations vtable.
 ///
 /// All function pointers receive `connector_ctx` as their first argument.
@@ -132,6 +160,30 @@ typedef struct connector_ops_t {
     ///        Passed as the first argument to every vtable function.
     void* connector_ctx;
 
+    // ── ABI 2 (read only if the plugin exports plugin_abi_version() >= 2) ───
+
+    /// @brief Zero-copy write: transfer ownership of frame buffers.
+    /// @param ctx      Connector context.
+    /// @param conn_id  Target connection.
+    /// @param bufs     Array of @p count buffers (the array itself is
+    ///                 core-owned and valid only for the call duration).
+    /// @param count    Number of buffers.
+    /// @return 0 on success, -1 on error.
+    ///
+    /// Ownership moves unconditionally: the connector must release every
+    /// buffer exactly once, even when it returns -1.  This lets a connector
+    /// keep the core's frame memory in its write queue and hand it straight
+    /// to the socket instead of deep-copying it as `send_gather()` requires.
+    ///
+    /// If NULL (or the plugin is ABI 1), the core falls back to
+    /// `send_gather()` / `send_to()`.
+    int (*send_owned)(void* ctx, conn_id_t conn_id,
+                      const owned_buf_t* bufs, int count);
+
+    /// @brief Capability bits (`CONNECTOR_FLAG_*`).  Must not change after init.
+    ///        Always 0 for ABI 1 plugins — they cannot promise `on_sent()`.
+    uint32_t flags;
+
 } connector_ops_t;
 
 /// @brief Connector plugin entry point.
@@ -0,0 +1,292 @@
+#pragma once
+/// @file sdk/cpp/buffer_pool.hpp
+/// @brief Size-classed frame buffer pool with per-thread caches.
+///
+/// Outbound frames live only until the connector's write completes, so the
+/// same handful of sizes are allocated and freed at packet rate.  The pool
+/// keeps freed blocks in power-of-two size classes (256 B … 4 MB):
+///   - per-thread cache   — lock-free fast path, bounded by TL_CACHE_BYTES;
+///   - central free list  — mutex per class, catches cross-thread frees
+///                          (frame built on a core thread, freed on the IO thread)
+///                          and the caches of exiting threads.
+/// Blocks larger than the biggest class bypass the pool entirely.
+///
+/// `FrameBuffer` is an intrusive ref-counted handle: copying is one atomic
+/// increment, the last reference returns the block to the pool.
+///
+/// ## Usage
+/// @code
+/// auto buf = gn::sdk::FrameBuffer::copy_of(data);     // pooled copy
+/// asio::post(io_, [buf] { write(buf.data(), buf.size()); });
+/// @endcode
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace gn::sdk {
+
+class FrameBuffer;
+
+namespace detail {
+
+/// @brief Header placed in front of every pooled allocation.
+struct PoolBlock {
+    std::atomic<uint32_t> refs{1};
+    uint8_t               size_class = 0;   ///< BufferPool::UNPOOLED for oversized
+    size_t                capacity   = 0;
+    size_t                size       = 0;
+
+    uint8_t* data() noexcept { return reinterpret_cast<uint8_t*>(this + 1); }
+};
+
+} // namespace detail
+
+// ── BufferPool ────────────────────────────────────────────────────────────────
+
+/// @brief Process-wide pool of frame buffers.
+///
+/// Thread-safety: acquire()/release() may be called from any thread.
+/// The singleton is intentionally leaked — handles released during static
+/// destruction must not touch a destroyed pool.
+class BufferPool {
+public:
+    static constexpr size_t  MIN_CLASS_SHIFT    = 8;                  ///< 256 B
+    static constexpr size_t  MAX_CLASS_SHIFT    = 22;                 ///< 4 MB
+    static constexpr size_t  NUM_CLASSES        = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+    static constexpr size_t  TL_CACHE_BYTES     = 4UL  * 1024 * 1024; ///< per class, per thread
+    static constexpr size_t  CENTRAL_CACHE_BYTES = 16UL * 1024 * 1024; ///< per class
+    static constexpr uint8_t UNPOOLED           = 0xFF;
+
+    static BufferPool& instance() noexcept {
+        static BufferPool* pool = new BufferPool();
+        return *pool;
+    }
+
+    /// @brief Size class index for @p n bytes, or UNPOOLED if too large.
+    static constexpr uint8_t class_of(size_t n) noexcept {
+        size_t shift = MIN_CLASS_SHIFT;
+        while (shift <= MAX_CLASS_SHIFT && (size_t{1} << shift) < n) ++shift;
+        return shift > MAX_CLASS_SHIFT
+            ? UNPOOLED : static_cast<uint8_t>(shift - MIN_CLASS_SHIFT);
+    }
+
+    static constexpr size_t class_size(uint8_t cls) noexcept {
+        return size_t{1} << (cls + MIN_CLASS_SHIFT);
+    }
+
+    /// @brief Get a block with capacity >= @p n and size == @p n (refs = 1).
+    detail::PoolBlock* acquire(size_t n) {
+        const uint8_t cls = class_of(n);
+        detail::PoolBlock* b = nullptr;
+
+        if (cls != UNPOOLED) {
+            auto* tc = tl_cache();
+            if (tc && !tc->free[cls].empty()) {
+                b = tc->free[cls].back();
+                tc->free[cls].pop_back();
+            } else {
+                auto& c = central_[cls];
+                std::lock_guard lk(c.mu);
+                if (!c.free.empty()) {
+                    b = c.free.back();
+                    c.free.pop_back();
+                }
+            }
+        }
+
+        if (b) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            b->refs.store(1, std::memory_order_relaxed);
+        } else {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            const size_t cap = cls != UNPOOLED ? class_size(cls) : n;
+            void* mem = ::operator new(sizeof(detail::PoolBlock) + cap);
+            b = new (mem) detail::PoolBlock();
+            b->size_class = cls;
+            b->capacity   = cap;
+        }
+        b->size = n;
+        return b;
+    }
+
+    /// @brief Return a block whose refcount dropped to zero.
+    void release(detail::PoolBlock* b) noexcept {
+        const uint8_t cls = b->size_class;
+        if (cls == UNPOOLED) { destroy(b); return; }
+
+        if (auto* tc = tl_cache(); tc && tc->free[cls].size() < tl_limit(cls)) {
+            tc->free[cls].push_back(b);
+            return;
+        }
+        release_central(b);
+    }
+
+    [[nodiscard]] uint64_t hits()   const noexcept { return hits_  .load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t misses() const noexcept { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    BufferPool() = default;
+
+    void release_central(detail::PoolBlock* b) noexcept {
+        const uint8_t cls = b->size_class;
+        auto& c = central_[cls];
+        {
+            std::lock_guard lk(c.mu);
+            if (c.free.size() < central_limit(cls)) {
+                c.free.push_back(b);
+                return;
+            }
+        }
+        destroy(b);
+    }
+
+    struct Central {
+        std::mutex                      mu;
+        std::vector<detail::PoolBlock*> free;
+    };
+
+    /// Per-thread cache: on thread exit its blocks move to the central list.
+    struct ThreadCache {
+        std::vector<detail::PoolBlock*> free[NUM_CLASSES];
+        ~ThreadCache() {
+            tl_cache_gone() = true;
+            for (auto& v : free)
+                for (auto* b : v) instance().release_central(b);
+        }
+    };
+
+    /// Trivially destructible, so still readable from other TLS destructors
+    /// that run after the cache is gone.
+    static bool& tl_cache_gone() noexcept {
+        thread_local bool gone = false;
+        return gone;
+    }
+
+    /// @brief This thread's cache; nullptr once it has been destroyed
+    ///        (handles released from later TLS destructors use the central list).
+    static ThreadCache* tl_cache() noexcept {
+        if (tl_cache_gone()) return nullptr;
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    static constexpr size_t tl_limit(uint8_t cls) noexcept {
+        const size_t n = TL_CACHE_BYTES / class_size(cls);
+        return n < 2 ? 2 : (n > 64 ? 64 : n);
+    }
+    static constexpr size_t central_limit(uint8_t cls) noexcept {
+        const size_t n = CENTRAL_CACHE_BYTES / class_size(cls);
+        return n < 4 ? 4 : (n > 1024 ? 1024 : n);
+    }
+
+    static void destroy(detail::PoolBlock* b) noexcept {
+        b->~PoolBlock();
+        ::operator delete(static_cast<void*>(b));
+    }
+
+    Central               central_[NUM_CLASSES];
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+// ── FrameBuffer ───────────────────────────────────────────────────────────────
+
+/// @brief Ref-counted handle to a pooled byte buffer.
+///
+/// Copies share the same bytes (no deep copy).  The contents are mutable
+/// through any handle — writers must own the only reference by convention
+/// (the frame builder fills the buffer before it is shared).
+class FrameBuffer {
+public:
+    FrameBuffer() noexcept = default;
+
+    /// @brief Allocate @p n uninitialised bytes from the pool.
+    explicit FrameBuffer(size_t n) : b_(BufferPool::instance().acquire(n)) {}
+
+    /// @brief Pooled copy of @p bytes.
+    static FrameBuffer copy_of(std::span<const uint8_t> bytes) {
+        FrameBuffer f(bytes.size());
+        if (!bytes.empty())
+            std::memcpy(f.data(), bytes.data(), bytes.size());
+        return f;
+    }
+
+    FrameBuffer(const FrameBuffer& o) noexcept : b_(o.b_) {
+        if (b_) b_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    FrameBuffer(FrameBuffer&& o) noexcept : b_(o.b_) { o.b_ = nullptr; }
+
+    FrameBuffer& operator=(const FrameBuffer& o) noexcept {
+        if (this != &o) { FrameBuffer tmp(o); swap(tmp); }
+        return *this;
+    }
+    FrameBuffer& operator=(FrameBuffer&& o) noexcept {
+        if (this != &o) { reset(); b_ = o.b_; o.b_ = nullptr; }
+        return *this;
+    }
+
+    ~FrameBuffer() { reset(); }
+
+    void swap(FrameBuffer& o) noexcept { std::swap(b_, o.b_); }
+
+    /// @brief Drop this reference; the block returns to the pool with the last one.
+    void reset() noexcept {
+        if (b_ && b_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            BufferPool::instance().release(b_);
+        b_ = nullptr;
+    }
+
+    /// @brief Change the logical size.  Within capacity this is O(1);
+    ///        growing past capacity moves the contents to a bigger block.
+    void resize(size_t n) {
+        if (b_ && n <= b_->capacity) { b_->size = n; return; }
+        FrameBuffer bigger(n);
+        if (b_ && b_->size)
+            std::memcpy(bigger.data(), b_->data(), b_->size);
+        swap(bigger);
+    }
+
+    [[nodiscard]] uint8_t*       data()       noexcept { return b_ ? b_->data() : nullptr; }
+    [[nodiscard]] const uint8_t* data() const noexcept { return b_ ? b_->data() : nullptr; }
+    [[nodiscard]] size_t         size()     const noexcept { return b_ ? b_->size : 0; }
+    [[nodiscard]] size_t         capacity() const noexcept { return b_ ? b_->capacity : 0; }
+    [[nodiscard]] bool           empty()    const noexcept { return size() == 0; }
+    [[nodiscard]] uint32_t       use_count() const noexcept {
+        return b_ ? b_->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+    /// @brief Give up this handle's reference without releasing it.
+    /// @return Opaque token for adopt() / release_detached() (C ABI hand-off).
+    [[nodiscard]] void* detach() noexcept {
+        auto* b = b_;
+        b_ = nullptr;
+        return b;
+    }
+
+    /// @brief Re-wrap a reference previously obtained from detach().
+    static FrameBuffer adopt(void* token) noexcept {
+        FrameBuffer f;
+        f.b_ = static_cast<detail::PoolBlock*>(token);
+        return f;
+    }
+
+    /// @brief C-style release trampoline for detached references.
+    static void release_detached(void* token) noexcept { adopt(token); }
+
+    [[nodiscard]] std::span<const uint8_t> span() const noexcept { return {data(), size()}; }
+    operator std::span<const uint8_t>() const noexcept { return span(); }
+
+    [[nodiscard]] const uint8_t* begin() const noexcept { return data(); }
+    [[nodiscard]] const uint8_t* end()   const noexcept { return data() + size(); }
+
+private:
+    detail::PoolBlock* b_ = nullptr;
+};
+
+} // namespace gn::sdk
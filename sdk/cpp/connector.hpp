@@ -22,12 +22,58 @@
 /// @endcode
 
 #include "../sdk/connector.h"
+#include "buffer_pool.hpp"
 #include <cstring>
 #include <span>
 #include <string>
+#include <vector>
 
 namespace gn {
 
+namespace sdk {
+
+/// @brief Move-only owner of an `owned_buf_t` — releases it on destruction.
+///
+/// Received by `IConnector::do_send_owned()`; keep it alive (e.g. in the
+/// write queue) until the socket write completes, then drop it.
+class OwnedBuffer {
+public:
+    OwnedBuffer() noexcept = default;
+    explicit OwnedBuffer(const owned_buf_t& raw) noexcept : raw_(raw) {}
+
+    /// @brief Wrap a pooled buffer (for connector-side copies).
+    static OwnedBuffer from(FrameBuffer f) noexcept {
+        owned_buf_t r{f.data(), f.size(), &FrameBuffer::release_detached, nullptr};
+        r.release_ctx = f.detach();
+        return OwnedBuffer(r);
+    }
+
+    OwnedBuffer(OwnedBuffer&& o) noexcept : raw_(o.raw_) { o.raw_ = {}; }
+    OwnedBuffer& operator=(OwnedBuffer&& o) noexcept {
+        if (this != &o) { reset(); raw_ = o.raw_; o.raw_ = {}; }
+        return *this;
+    }
+    OwnedBuffer(const OwnedBuffer&)            = delete;
+    OwnedBuffer& operator=(const OwnedBuffer&) = delete;
+
+    ~OwnedBuffer() { reset(); }
+
+    void reset() noexcept {
+        if (raw_.release) raw_.release(raw_.release_ctx);
+        raw_ = {};
+    }
+
+    [[nodiscard]] const uint8_t* data() const noexcept {
+        return static_cast<const uint8_t*>(raw_.data);
+    }
+    [[nodiscard]] size_t size() const noexcept { return raw_.size; }
+
+private:
+    owned_buf_t raw_{};
+};
+
+} // namespace sdk
+
 /// @brief C++ base class for transport connector plugins.
 ///
 /// Wraps the C `connector_ops_t` ABI with type-safe virtual methods and
@@ -62,6 +108,11 @@ public:
             return static_cast<IConnector*>(ctx)->do_send(id, {static_cast<const uint8_t*>(d), sz}); };
         ops_.send_gather = [](void* ctx, conn_id_t id, const struct iovec* iov, int n) -> int {
             return static_cast<IConnector*>(ctx)->do_send_gather(id, iov, n); };
+        ops_.send_owned  = [](void* ctx, conn_id_t id, const owned_buf_t* b, int n) -> int {
+            std::vector<sdk::OwnedBuffer> bufs;
+            bufs.reserve(static_cast<size_t>(n));
+            for (int i = 0; i < n; ++i) bufs.emplace_back(b[i]);
+            return static_cast<IConnector*>(ctx)->do_send_owned(id, std::move(bufs)); };
         ops_.close       = [](void* ctx, conn_id_t id) {
             static_cast<IConnector*>(ctx)->do_close(id, false); };
         ops_.close_now   = [](void* ctx, conn_id_t id) {
@@ -74,6 +125,7 @@ public:
             std::strncpy(buf, n.c_str(), sz - 1); buf[sz - 1] = '\0'; };
         ops_.shutdown    = [](void* ctx) {
             static_cast<IConnector*>(ctx)->on_shutdown(); };
+        ops_.flags       = reports_sent() ? CONNECTOR_FLAG_REPORTS_SENT : 0u;
         return &ops_;
     }
 
@@ -101,6 +153,10 @@ public:
     virtual int  do_listen (const char* host, uint16_t port)           = 0;
 
     /// @brief Send a contiguous byte span to a connection.
+    /// @details @p data is valid only for the call duration.  Connectors that
+    ///          queue writes should copy into `sdk::FrameBuffer::copy_of(data)`
+    ///          (pooled, ref-counted) rather than a fresh vector, or override
+    ///          do_send_owned() to avoid the copy altogether.
     /// @return 0 on success, -1 on error.
     virtual int  do_send(conn_id_t id, std::span<const uint8_t> data)  = 0;
 
@@ -118,6 +174,25 @@ public:
         return rc;
     }
 
+    /// @brief Ownership-transfer send (zero-copy).
+    ///
+    /// The core hands over its frame buffers; each OwnedBuffer releases its
+    /// memory when destroyed.  Default implementation: forward to
+    /// do_send_gather() (which copies) and release afterwards.  Override to
+    /// queue the buffers directly and write them without copying.
+    virtual int  do_send_owned(conn_id_t id, std::vector<sdk::OwnedBuffer> bufs) {
+        std::vector<struct iovec> iov;
+        iov.reserve(bufs.size());
+        for (auto& b : bufs)
+            iov.push_back({const_cast<uint8_t*>(b.data()), b.size()});
+        return do_send_gather(id, iov.data(), static_cast<int>(iov.size()));
+    }
+
+    /// @brief true if the connector calls notify_sent() for every accepted
+    ///        byte (sets CONNECTOR_FLAG_REPORTS_SENT).  Its write queue then
+    ///        counts against the core's per-connection send window.
+    virtual bool reports_sent() const { return false; }
+
     /// @brief Close a connection.
     /// @param id    Connection to close.
     /// @param hard  true = abort immediately, false = graceful drain.
@@ -154,6 +229,13 @@ protected:
             api_->on_disconnect(api_->ctx, id, error);
     }
 
+    /// @brief Return send credit for @p bytes written (or discarded) on @p id.
+    /// @details Only with reports_sent() == true.
+    void notify_sent(conn_id_t id, size_t bytes) {
+        if (api_ && api_->on_sent && bytes)
+            api_->on_sent(api_->ctx, id, bytes);
+    }
+
     /// @brief Find conn_id by hex-encoded pubkey.
     conn_id_t find_peer_conn(const char* pubkey_hex) const {
         return (api_ && api_->find_conn_by_pubkey)
@@ -237,6 +319,8 @@ protected:
         return _gn_connector_instance.get_plugin_info();                       \
     }                                                                          \
     extern "C" GN_EXPORT                                                       \
+    uint32_t plugin_abi_version() { return GN_PLUGIN_ABI_VERSION; }            \
+    extern "C" GN_EXPORT                                                       \
     int connector_init(host_api_t* api, connector_ops_t** out) {               \
         _gn_connector_instance.init(api);                                      \
         *out = _gn_connector_instance.to_c_ops();                              \
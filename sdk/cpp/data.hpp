@@ -25,27 +25,21 @@
 
 #include <concepts>
 #include <cstring>
-#include <memory>
 #include <span>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
 
 #include "../sdk/types.h"
+#include "packet.hpp"
 
 namespace gn {
 
 namespace sdk {
-    /// @brief Owned byte buffer for serialized messages.
-    using RawBuffer = std::vector<uint8_t>;
-
     /// @brief Non-owning view of raw bytes.
     using RawSpan   = std::span<const uint8_t>;
 }
 
-/// @brief Shared packet data buffer for zero-copy dispatch through the handler chain.
-using PacketData = std::shared_ptr<sdk::RawBuffer>;
-
 namespace sdk {
 
 // ── IData ─────────────────────────────────────────────────────────────────────
@@ -160,15 +154,11 @@ template<typename T>
     requires std::derived_from<T, IData>
 RawBuffer to_bytes(const T& obj) { return obj.serialize(); }
 
-/// @brief Wrap raw network bytes in a shared buffer for zero-copy dispatch.
+/// @brief Pooled packet holding a copy of @p len bytes under @p hdr.
 ///
-/// Used internally by the core to share packet data across the handler chain
-/// without copying per handler.
-inline PacketData make_packet(const void* data, size_t len) {
-    auto buf = std::make_shared<RawBuffer>(
-        static_cast<const uint8_t*>(data),
-        static_cast<const uint8_t*>(data) + len);
-    return buf;
+/// The packet is shared across the handler chain without copying per handler.
+inline PacketData make_packet(const void* data, size_t len, const header_t& hdr = {}) {
+    return PacketData::copy_of(hdr, RawSpan(static_cast<const uint8_t*>(data), len));
 }
 
 } // namespace sdk
@@ -46,6 +46,7 @@ protected:
     handler_t             handler_{};
     std::vector<uint32_t> supported_types_;
     host_api_t*           api_ = nullptr;
+    bool                  batch_ = false;
 
 public:
     IHandler() { handler_.user_data = this; }
@@ -82,6 +83,14 @@ public:
         handler_.shutdown = [](void* ud) {
             static_cast<IHandler*>(ud)->on_shutdown();
         };
+        handler_.handle_batch = nullptr;
+        if (batch_)
+            handler_.handle_batch = [](void* ud, const endpoint_t* ep,
+                                       const handler_packet_t* p,
+                                       size_t n) -> propagation_t {
+                return static_cast<IHandler*>(ud)->handle_batch(
+                    ep, std::span<const handler_packet_t>(p, n));
+            };
         handler_.supported_types     = supported_types_.data();
         handler_.num_supported_types = supported_types_.size();
         return &handler_;
@@ -106,6 +115,22 @@ public:
                                  const endpoint_t*        endpoint,
                                  std::span<const uint8_t> payload) = 0;
 
+    /// @brief Process consecutive packets of one type from one connection.
+    ///        Called instead of handle_message() + on_result() once
+    ///        enable_batch() was called.  Default: per-packet fallback,
+    ///        first non-CONTINUE result wins.
+    /// @return Propagation decision for the whole batch.
+    virtual propagation_t handle_batch(const endpoint_t*                 endpoint,
+                                       std::span<const handler_packet_t> packets) {
+        propagation_t r = PROPAGATION_CONTINUE;
+        for (const auto& p : packets) {
+            handle_message(p.header, endpoint, std::span<const uint8_t>(
+                static_cast<const uint8_t*>(p.payload), p.payload_size));
+            if (r == PROPAGATION_CONTINUE) r = on_result(p.header, p.header->payload_type);
+        }
+        return r;
+    }
+
     /// @brief Chain-of-responsibility result.  Default: CONTINUE.
     virtual propagation_t on_result(const header_t* /*hdr*/, uint32_t /*type*/) {
         return PROPAGATION_CONTINUE;
@@ -130,6 +155,9 @@ protected:
         handler_.num_supported_types = supported_types_.size();
     }
 
+    /// @brief Receive packets through handle_batch() (call from on_init()).
+    void enable_batch(bool on = true) { batch_ = on; }
+
     // ── Core API helpers ──────────────────────────────────────────────────────
 
     /// @brief Send a packet to a peer by URI.
@@ -237,6 +265,8 @@ protected:
         return _gn_plugin_instance.get_plugin_info();                          \
     }                                                                          \
     extern "C" GN_EXPORT                                                       \
+    uint32_t plugin_abi_version() { return GN_PLUGIN_ABI_VERSION; }            \
+    extern "C" GN_EXPORT                                                       \
     int handler_init(host_api_t* api, handler_t** out) {                       \
         _gn_plugin_instance.init(api);                                         \
         *out = _gn_plugin_instance.to_c_handler();                             \
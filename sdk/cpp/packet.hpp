@@ -0,0 +1,232 @@
+#pragma once
+/// @file sdk/cpp/packet.hpp
+/// @brief Pooled, intrusively ref-counted received packet (header + payload).
+///
+/// Every frame delivered to handlers needs a header and a payload that a
+/// handler may keep past its return (asynchronous processing).  Allocating
+/// both per packet — and bumping a shared_ptr count per handler in the
+/// chain — dominates small-frame dispatch.  `PacketData` keeps header and
+/// payload in one block with an embedded refcount:
+///   - the chain passes it by `const PacketData&` — no refcount traffic;
+///   - a handler that keeps the packet copies the handle (one increment);
+///   - the last reference returns the block to PacketPool; the payload
+///     vector keeps its capacity, so a warmed-up receive path delivers
+///     packets without touching the heap.
+///
+/// ## Usage
+/// @code
+/// bus.subscribe(MSG_TYPE_CHAT, "chat",
+///     [](std::string_view, const header_t& hdr, const endpoint_t*, const gn::PacketData& d) {
+///         use(hdr.packet_id, d->data(), d->size());
+///         return PROPAGATION_CONTINUE;
+///     });
+/// @endcode
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../sdk/types.h"
+
+namespace gn {
+
+namespace sdk {
+    /// @brief Owned byte buffer for serialized messages.
+    using RawBuffer = std::vector<uint8_t>;
+}
+
+namespace sdk::detail {
+
+struct PacketBlock {
+    std::atomic<uint32_t> refs{1};
+    header_t              hdr{};
+    RawBuffer             bytes;
+    PacketBlock*          next = nullptr;   ///< PacketPool list link
+};
+
+/// Process-wide pool of packet blocks, laid out like BufferPool:
+///   - per-thread cache — lock-free fast path, up to TL_MAX blocks;
+///   - central free list — under a mutex, takes what a full cache does not
+///     and the caches of exiting threads.
+/// Packets are acquired on the IO thread but often dropped on a worker that
+/// kept them; the central list hands those blocks back to the IO thread
+/// instead of leaving them with the worker.  Bounded by CENTRAL_MAX blocks;
+/// payload capacity above KEEP_BYTES is released (reassembled multi-MB
+/// messages).
+///
+/// Thread-safety: acquire()/release() may be called from any thread.
+/// The singleton is intentionally leaked — packets released during static
+/// destruction must not touch a destroyed pool.
+class PacketPool {
+public:
+    static constexpr size_t TL_MAX      = 64;
+    static constexpr size_t CENTRAL_MAX = 1024;
+    static constexpr size_t KEEP_BYTES  = 256 * 1024;
+
+    static PacketPool& instance() noexcept {
+        static PacketPool* pool = new PacketPool();
+        return *pool;
+    }
+
+    PacketBlock* acquire() {
+        PacketBlock* b = nullptr;
+        if (auto* tc = tl_cache(); tc && tc->head) {
+            b = tc->pop();
+        } else {
+            std::lock_guard lk(mu_);
+            if (central_.head) b = central_.pop();
+        }
+        if (!b) return new PacketBlock();
+        b->refs.store(1, std::memory_order_relaxed);
+        return b;
+    }
+
+    void release(PacketBlock* b) noexcept {
+        if (b->bytes.capacity() > KEEP_BYTES) RawBuffer().swap(b->bytes);
+        b->bytes.clear();
+        b->hdr = header_t{};
+        if (auto* tc = tl_cache(); tc && tc->count < TL_MAX) {
+            tc->push(b);
+            return;
+        }
+        release_central(b);
+    }
+
+    /// Blocks waiting in the central list (diagnostics, tests).
+    [[nodiscard]] size_t central_size() noexcept {
+        std::lock_guard lk(mu_);
+        return central_.count;
+    }
+
+private:
+    PacketPool() = default;
+
+    struct List {
+        PacketBlock* head  = nullptr;
+        size_t       count = 0;
+
+        void push(PacketBlock* b) noexcept { b->next = head; head = b; ++count; }
+        PacketBlock* pop() noexcept {
+            auto* b = head;
+            head    = b->next;
+            b->next = nullptr;
+            --count;
+            return b;
+        }
+    };
+
+    void release_central(PacketBlock* b) noexcept {
+        {
+            std::lock_guard lk(mu_);
+            if (central_.count < CENTRAL_MAX) {
+                central_.push(b);
+                return;
+            }
+        }
+        delete b;
+    }
+
+    /// Per-thread cache: on thread exit its blocks move to the central list.
+    struct ThreadCache : List {
+        ~ThreadCache() {
+            tl_cache_gone() = true;
+            while (head) instance().release_central(pop());
+        }
+    };
+
+    /// Trivially destructible, so still readable from other TLS destructors
+    /// that run after the cache is gone.
+    static bool& tl_cache_gone() noexcept {
+        thread_local bool gone = false;
+        return gone;
+    }
+
+    /// @brief This thread's cache; nullptr once it has been destroyed
+    ///        (packets released from later TLS destructors use the central list).
+    static ThreadCache* tl_cache() noexcept {
+        if (tl_cache_gone()) return nullptr;
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    std::mutex mu_;
+    List       central_;
+};
+
+} // namespace sdk::detail
+
+/// @brief Ref-counted handle to a received packet: header + payload bytes.
+///
+/// Behaves like a pointer to the payload (`*d`, `d->size()`), the header is
+/// `d.header()`.  Copies share the block; contents are mutable through any
+/// handle — the core fills the packet before it is shared.
+class PacketData {
+public:
+    PacketData() noexcept = default;
+
+    /// @brief Empty packet (zeroed header, no payload bytes) from the pool.
+    static PacketData acquire() {
+        PacketData p;
+        p.b_ = sdk::detail::PacketPool::instance().acquire();
+        return p;
+    }
+
+    /// @brief Pooled copy of @p payload under @p hdr.
+    static PacketData copy_of(const header_t& hdr, std::span<const uint8_t> payload) {
+        auto p = acquire();
+        p.b_->hdr = hdr;
+        p.b_->bytes.assign(payload.begin(), payload.end());
+        return p;
+    }
+
+    PacketData(const PacketData& o) noexcept : b_(o.b_) {
+        if (b_) b_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    PacketData(PacketData&& o) noexcept : b_(o.b_) { o.b_ = nullptr; }
+
+    PacketData& operator=(const PacketData& o) noexcept {
+        if (this != &o) { PacketData tmp(o); swap(tmp); }
+        return *this;
+    }
+    PacketData& operator=(PacketData&& o) noexcept {
+        if (this != &o) { reset(); b_ = o.b_; o.b_ = nullptr; }
+        return *this;
+    }
+
+    ~PacketData() { reset(); }
+
+    void swap(PacketData& o) noexcept { std::swap(b_, o.b_); }
+
+    /// @brief Drop this reference; the block is recycled with the last one.
+    void reset() noexcept {
+        if (b_ && b_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            sdk::detail::PacketPool::instance().release(b_);
+        b_ = nullptr;
+    }
+
+    [[nodiscard]] header_t&       header()       noexcept { return b_->hdr; }
+    [[nodiscard]] const header_t& header() const noexcept { return b_->hdr; }
+
+    /// @brief Payload bytes (pointer semantics, as with the shared handle it replaces).
+    [[nodiscard]] sdk::RawBuffer& operator*()  const noexcept { return b_->bytes; }
+    [[nodiscard]] sdk::RawBuffer* operator->() const noexcept { return &b_->bytes; }
+
+    [[nodiscard]] std::span<const uint8_t> span() const noexcept {
+        return b_ ? std::span<const uint8_t>(b_->bytes) : std::span<const uint8_t>{};
+    }
+
+    explicit operator bool() const noexcept { return b_ != nullptr; }
+
+    [[nodiscard]] uint32_t use_count() const noexcept {
+        return b_ ? b_->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    sdk::detail::PacketBlock* b_ = nullptr;
+};
+
+} // namespace gn
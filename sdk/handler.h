@@ -20,6 +20,12 @@
 ///     3. PROPAGATION_CONTINUE -> next handler.  CONSUMED -> stop + pin affinity.
 ///        REJECT -> stop + drop silently.
 ///
+/// ## Batch dispatch (optional)
+///   A handler that sets `handle_batch` receives the packets parsed from one
+///   connector read as an array (consecutive packets of one type from one
+///   connection, in order) instead of one `handle_message()` call each.
+///   Its return value is the propagation decision for the whole batch.
+///
 /// ## Session affinity
 ///   When a handler returns CONSUMED, subsequent packets on the same connection
 ///   skip lower-priority handlers and go directly to the pinned handler.
@@ -30,6 +36,14 @@
 extern "C" {
 #endif
 
+/// @brief One packet of a batch (see `handler_t::handle_batch`).
+///        Pointers are valid for the duration of the call.
+typedef struct handler_packet_t {
+    const header_t* header;
+    const void*     payload;
+    size_t          payload_size;
+} handler_packet_t;
+
 /// @brief Handler descriptor registered with the core.
 ///
 /// The core stores a raw pointer to this struct — the plugin owns the lifetime.
@@ -112,6 +126,28 @@ struct handler_t {
     /// @brief Opaque plugin context passed to every callback.
     ///        For C++ plugins, typically `this`.
     void* user_data;
+
+    // ── ABI 2 (read only if the plugin exports plugin_abi_version() >= 2) ───
+
+    /// @brief Batch packet callback (optional).
+    ///
+    /// Ignored for ABI 1 plugins and for handlers registered through
+    /// `host_api_t::register_handler()`.
+    ///
+    /// When set, the core delivers packets through this callback instead of
+    /// `handle_message()` + `on_message_result()`.  A batch holds up to 64
+    /// consecutive packets of one message type from one connection, in
+    /// arrival order; a single packet arrives as a batch of one.
+    ///
+    /// @param user_data  Plugin context.
+    /// @param endpoint   Remote peer info (shared by every packet).
+    /// @param packets    Array of @p count packets (core-owned, valid for the call).
+    /// @param count      Number of packets (>= 1).
+    /// @return Propagation decision applied to every packet of the batch.
+    propagation_t (*handle_batch)(void*                   user_data,
+                                  const endpoint_t*       endpoint,
+                                  const handler_packet_t* packets,
+                                  size_t                  count);
 };
 
 /// @brief Handler plugin entry point.
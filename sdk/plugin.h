@@ -154,6 +154,9 @@ typedef struct host_api_t {
     /// @param ctx  Core context.
     /// @param h    Handler descriptor (plugin-owned, must outlive the registration).
     ///
+    /// Only the ABI 1 fields of @p h are read (`handle_batch` is ignored):
+    /// the core cannot tell which plugin's headers built the struct.
+    ///
     /// @warning Only safe during on_init().  Calling after the first packet
     ///          arrives is undefined behavior.
     void (*register_handler)(void* ctx, handler_t* h);
@@ -196,6 +199,18 @@ typedef struct host_api_t {
     /// @brief Opaque core context — pass as first argument to every callback.
     void* ctx;
 
+    // ── v2 entry points ───────────────────────────────────────────────────────
+
+    /// @brief Return send credit: @p bytes accepted by send_*() have been
+    ///        written to the socket (or discarded on error/close).
+    /// @param ctx    Core context.
+    /// @param id     Connection ID the bytes were sent on.
+    /// @param bytes  Byte count (may aggregate several frames).
+    ///
+    /// Only meaningful for connectors with `CONNECTOR_FLAG_REPORTS_SENT`.
+    /// Thread-safety: safe from any connector thread.
+    void (*on_sent)(void* ctx, conn_id_t id, size_t bytes);
+
 } host_api_t;
 
 /// @brief Optional metadata export — called before `*_init()`.
@@ -213,6 +228,23 @@ typedef struct host_api_t {
 /// @endcode
 typedef const plugin_info_t* (*plugin_get_info_t)(void);
 
+/// @brief Plugin ABI revision of these SDK headers.
+///
+/// `connector_ops_t` and `handler_t` are owned by the plugin, and a plugin
+/// binary may predate fields appended to them.  Fields added after ABI 1:
+///   - 2: `connector_ops_t::send_owned`, `connector_ops_t::flags`,
+///        `handler_t::handle_batch`
+#define GN_PLUGIN_ABI_VERSION 2u
+
+/// @brief Optional export `plugin_abi_version` — ABI revision the plugin
+///        was built against (return `GN_PLUGIN_ABI_VERSION`).
+///
+/// A plugin that does not export it is ABI 1: PluginManager copies the ABI 1
+/// part of its structs into host-owned storage, so every later field reads
+/// as NULL / 0 instead of whatever follows the plugin's struct in memory.
+/// The SDK's CONNECTOR_PLUGIN / HANDLER_PLUGIN macros export it.
+typedef uint32_t (*plugin_abi_version_t)(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -60,6 +60,20 @@ extern "C" {
 ///        Set by the core for loopback connections where AEAD is bypassed.
 #define GNET_FLAG_TRUSTED  0x01U
 
+/// @brief Frame carries one fragment of a larger message.
+///        The (decrypted) payload starts with `frag_hdr_t`.
+#define GNET_FLAG_FRAGMENT 0x02U
+
+/// @brief Bulk frame striped across several transport paths.
+///        The (decrypted) payload starts with a little-endian uint64_t
+///        per-connection stripe sequence; the receiver restores send order.
+#define GNET_FLAG_STRIPED  0x04U
+
+/// @brief Key phase of the AEAD key that sealed the frame (low bit of the
+///        sender's key epoch).  A flip tells the receiver that the sender
+///        rotated its send key; see CORE_CAP_KEY_EPOCH.
+#define GNET_FLAG_KEY_PHASE 0x08U
+
 // ── Connection identifier ─────────────────────────────────────────────────────
 /// @brief Opaque, monotonically increasing connection handle.
 ///        Valid for the lifetime of one TCP/UDP session.  Never reused.
@@ -77,6 +91,8 @@ typedef uint64_t conn_id_t;
 #define MSG_TYPE_NOISE_RESP    2u   ///< Noise_XX handshake msg2: <- e, ee, s, es
 #define MSG_TYPE_NOISE_FIN     3u   ///< Noise_XX handshake msg3: -> s, se
 #define MSG_TYPE_HEARTBEAT     4u   ///< Keepalive ping/pong (see HeartbeatPayload)
+#define MSG_TYPE_NOISE_RESUME  5u   ///< Noise_IK resumption msg1: -> e, es, s, ss
+#define MSG_TYPE_NOISE_RESUME_RESP 6u ///< Noise_IK msg2: <- e, ee, se (empty = refused, fall back to XX)
 #define MSG_TYPE_RELAY        10u   ///< Gossip relay wrapper (see RelayPayload)
 #define MSG_TYPE_ICE_SIGNAL   11u   ///< ICE/DTLS SDP exchange (see IceSignalPayload)
 /// @}
@@ -179,6 +195,43 @@ static_assert(sizeof(header_t) == 20, "header_t must be exactly 20 bytes");
 _Static_assert(sizeof(header_t) == 20, "header_t must be exactly 20 bytes");
 #endif
 
+// ── Fragment extension header ─────────────────────────────────────────────────
+/// @brief Prefix of every GNET_FLAG_FRAGMENT payload (inside the AEAD body).
+///
+/// Messages above the core's fragmentation threshold are split into frames of
+/// the same `payload_type`.  The receiver reassembles them by `msg_id` and
+/// delivers one message to handlers — or, for msg types in streaming mode,
+/// delivers every fragment as-is (this header + chunk) so the handler can
+/// consume the message incrementally.
+///
+/// @verbatim
+/// Offset | Field      | Size | Notes
+/// -------|------------|------|------------------------------------------------
+///      0 | msg_id     |    4 | Per-connection message counter (sender-assigned)
+///      4 | flags      |    2 | FRAG_FLAG_* bitmask
+///      6 | reserved   |    2 | Zero
+///      8 | offset     |    8 | Byte offset of this chunk within the message
+///     16 | total_len  |    8 | Full message length
+/// @endverbatim
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t msg_id;     ///< Same for all fragments of one message
+    uint16_t flags;      ///< FRAG_FLAG_*
+    uint16_t reserved;   ///< Zero
+    uint64_t offset;     ///< Byte offset of the chunk that follows
+    uint64_t total_len;  ///< Full reassembled message length
+} frag_hdr_t;
+#pragma pack(pop)
+
+#define FRAG_FLAG_LAST 0x0001U  ///< Final fragment (offset + chunk == total_len)
+
+#ifdef __cplusplus
+static_assert(sizeof(frag_hdr_t) == 24, "frag_hdr_t must be exactly 24 bytes");
+#else
+_Static_assert(sizeof(frag_hdr_t) == 24, "frag_hdr_t must be exactly 24 bytes");
+#endif
+
 /// @brief Remote peer descriptor.
 ///
 /// Filled by the connector plugin on accept/connect, then enriched by the core
@@ -190,13 +190,13 @@ uint64_t gn_core_subscribe(gn_core_t* core, uint32_t type,
     }
 
     auto handler = [token](std::string_view,
-                            std::shared_ptr<header_t> hdr,
+                            const header_t&       hdr,
                             const endpoint_t*,
-                            gn::PacketData data) -> propagation_t {
+                            const gn::PacketData& data) -> propagation_t {
         std::lock_guard lock(g_csub_mu);
         auto it = g_csub_map.find(token);
         if (it == g_csub_map.end()) return PROPAGATION_CONTINUE;
-        return it->second.cb(hdr->payload_type,
+        return it->second.cb(hdr.payload_type,
                               data->data(), data->size(),
                               it->second.user_data);
     };
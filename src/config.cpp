@@ -77,6 +77,18 @@ bool Config::parse_json(const std::string& json_str) {
                 core.io_threads = c["io_threads"];
             if (c.contains("max_connections") && c["max_connections"].is_number_integer())
                 core.max_connections = c["max_connections"];
+            if (c.contains("handshake_threads") && c["handshake_threads"].is_number_integer())
+                core.handshake_threads = c["handshake_threads"];
+            if (c.contains("max_handshakes") && c["max_handshakes"].is_number_integer())
+                core.max_handshakes = c["max_handshakes"];
+            if (c.contains("handshake_rate_per_ip") && c["handshake_rate_per_ip"].is_number_integer())
+                core.handshake_rate_per_ip = c["handshake_rate_per_ip"];
+            if (c.contains("flush_delay_us") && c["flush_delay_us"].is_number_integer())
+                core.flush_delay_us = c["flush_delay_us"];
+            if (c.contains("path_scheduler") && c["path_scheduler"].is_string())
+                core.path_scheduler = c["path_scheduler"];
+            if (c.contains("multipath_stripe") && c["multipath_stripe"].is_boolean())
+                core.multipath_stripe = c["multipath_stripe"];
         }
 
         if (j.contains("logging")) {
@@ -99,6 +111,18 @@ bool Config::parse_json(const std::string& json_str) {
                 security.max_auth_attempts = s["max_auth_attempts"];
             if (s.contains("session_timeout") && s["session_timeout"].is_number_integer())
                 security.session_timeout = s["session_timeout"];
+            if (s.contains("cipher") && s["cipher"].is_string())
+                security.cipher = s["cipher"];
+            if (s.contains("replay_window") && s["replay_window"].is_number_integer())
+                security.replay_window = s["replay_window"];
+            if (s.contains("rekey_after_packets") && s["rekey_after_packets"].is_number_integer())
+                security.rekey_after_packets = s["rekey_after_packets"];
+            if (s.contains("rekey_after_mb") && s["rekey_after_mb"].is_number_integer())
+                security.rekey_after_mb = s["rekey_after_mb"];
+            if (s.contains("resumption") && s["resumption"].is_boolean())
+                security.resumption = s["resumption"];
+            if (s.contains("peer_cache_size") && s["peer_cache_size"].is_number_integer())
+                security.peer_cache_size = s["peer_cache_size"];
         }
 
         if (j.contains("compression")) {
@@ -109,6 +133,20 @@ bool Config::parse_json(const std::string& json_str) {
                 compression.threshold = c["threshold"];
             if (c.contains("level") && c["level"].is_number_integer())
                 compression.level = c["level"];
+            if (c.contains("dictionaries") && c["dictionaries"].is_boolean())
+                compression.dictionaries = c["dictionaries"];
+            if (c.contains("dict_dir") && c["dict_dir"].is_string())
+                compression.dict_dir = c["dict_dir"];
+            if (c.contains("dict_threshold") && c["dict_threshold"].is_number_integer())
+                compression.dict_threshold = c["dict_threshold"];
+            if (c.contains("adaptive") && c["adaptive"].is_boolean())
+                compression.adaptive = c["adaptive"];
+            if (c.contains("max_level") && c["max_level"].is_number_integer())
+                compression.max_level = c["max_level"];
+            if (c.contains("stream") && c["stream"].is_boolean())
+                compression.stream = c["stream"];
+            if (c.contains("codec") && c["codec"].is_string())
+                compression.codec = c["codec"];
         }
 
         if (j.contains("plugins")) {
@@ -162,6 +200,12 @@ std::string Config::to_json() const {
         {"listen_port",    core.listen_port},
         {"io_threads",     core.io_threads},
         {"max_connections", core.max_connections},
+        {"handshake_threads", core.handshake_threads},
+        {"max_handshakes", core.max_handshakes},
+        {"handshake_rate_per_ip", core.handshake_rate_per_ip},
+        {"flush_delay_us", core.flush_delay_us},
+        {"path_scheduler", core.path_scheduler},
+        {"multipath_stripe", core.multipath_stripe},
     };
 
     j["logging"] = {
@@ -175,12 +219,25 @@ std::string Config::to_json() const {
         {"key_exchange_timeout", security.key_exchange_timeout},
         {"max_auth_attempts",    security.max_auth_attempts},
         {"session_timeout",      security.session_timeout},
+        {"cipher",               security.cipher},
+        {"replay_window",        security.replay_window},
+        {"rekey_after_packets",  security.rekey_after_packets},
+        {"rekey_after_mb",       security.rekey_after_mb},
+        {"resumption",           security.resumption},
+        {"peer_cache_size",      security.peer_cache_size},
     };
 
     j["compression"] = {
         {"enabled",   compression.enabled},
         {"threshold", compression.threshold},
         {"level",     compression.level},
+        {"dictionaries",   compression.dictionaries},
+        {"dict_dir",       compression.dict_dir},
+        {"dict_threshold", compression.dict_threshold},
+        {"adaptive",       compression.adaptive},
+        {"max_level",      compression.max_level},
+        {"stream",         compression.stream},
+        {"codec",          compression.codec},
     };
 
     j["plugins"] = {
@@ -228,6 +285,12 @@ std::optional<std::string> Config::get_raw(std::string_view key) const {
     if (key == "core.listen_port")     return std::to_string(core.listen_port);
     if (key == "core.io_threads")      return std::to_string(core.io_threads);
     if (key == "core.max_connections") return std::to_string(core.max_connections);
+    if (key == "core.handshake_threads") return std::to_string(core.handshake_threads);
+    if (key == "core.max_handshakes")  return std::to_string(core.max_handshakes);
+    if (key == "core.handshake_rate_per_ip") return std::to_string(core.handshake_rate_per_ip);
+    if (key == "core.flush_delay_us")  return std::to_string(core.flush_delay_us);
+    if (key == "core.path_scheduler")  return core.path_scheduler;
+    if (key == "core.multipath_stripe") return std::string(core.multipath_stripe ? "true" : "false");
     // Logging
     if (key == "logging.level")     return logging.level;
     if (key == "logging.file")      return logging.file;
@@ -237,10 +300,23 @@ std::optional<std::string> Config::get_raw(std::string_view key) const {
     if (key == "security.key_exchange_timeout") return std::to_string(security.key_exchange_timeout);
     if (key == "security.max_auth_attempts")    return std::to_string(security.max_auth_attempts);
     if (key == "security.session_timeout")      return std::to_string(security.session_timeout);
+    if (key == "security.cipher")               return security.cipher;
+    if (key == "security.replay_window")        return std::to_string(security.replay_window);
+    if (key == "security.rekey_after_packets")  return std::to_string(security.rekey_after_packets);
+    if (key == "security.rekey_after_mb")       return std::to_string(security.rekey_after_mb);
+    if (key == "security.resumption")           return std::string(security.resumption ? "true" : "false");
+    if (key == "security.peer_cache_size")      return std::to_string(security.peer_cache_size);
     // Compression
     if (key == "compression.enabled")   return std::string(compression.enabled ? "true" : "false");
     if (key == "compression.threshold") return std::to_string(compression.threshold);
     if (key == "compression.level")     return std::to_string(compression.level);
+    if (key == "compression.dictionaries")   return std::string(compression.dictionaries ? "true" : "false");
+    if (key == "compression.dict_dir")       return compression.dict_dir;
+    if (key == "compression.dict_threshold") return std::to_string(compression.dict_threshold);
+    if (key == "compression.adaptive")       return std::string(compression.adaptive ? "true" : "false");
+    if (key == "compression.max_level")      return std::to_string(compression.max_level);
+    if (key == "compression.stream")         return std::string(compression.stream ? "true" : "false");
+    if (key == "compression.codec")          return compression.codec;
     // Plugins
     if (key == "plugins.base_dir")      return plugins.base_dir;
     if (key == "plugins.auto_load")     return std::string(plugins.auto_load ? "true" : "false");
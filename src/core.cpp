@@ -156,6 +156,8 @@ void Core::run_async(int threads) {
     LOG_TRACE("Core::run_async threads={}", threads);
 
     start_heartbeat_timer();
+    d.cm->set_flush_executor(d.ioc.get());   // sends больше не пишут в коннектор inline
+    d.cm->start_handshake_pool(static_cast<size_t>(std::max(d.config_->core.handshake_threads, 0)));
 
     int n = threads > 0 ? threads : d.config_->core.io_threads;
     if (n <= 0) n = std::max(2, (int)std::thread::hardware_concurrency());
@@ -169,6 +171,7 @@ void Core::stop() {
     auto& d = *impl_;
     if (!d.running.exchange(false)) return;
     if (d.heartbeat_timer) d.heartbeat_timer->cancel();
+    d.cm->set_flush_executor(nullptr);   // io_context остановится — flush inline
     d.cm->shutdown();
     d.work.reset();
     d.ioc->stop();
@@ -184,16 +187,25 @@ bool Core::is_running() const noexcept {
 
 // ── Network ───────────────────────────────────────────────────────────────────
 
-bool Core::send(std::string_view uri, uint32_t t, std::span<const uint8_t> p) {
-    return impl_->cm->send(uri, t, p);
+bool Core::send(std::string_view uri, uint32_t t, std::span<const uint8_t> p,
+                SendClass cls) {
+    return impl_->cm->send(uri, t, p, cls);
 }
 
-bool Core::send(conn_id_t id, uint32_t t, std::span<const uint8_t> p) {
-    return impl_->cm->send(id, t, p);
+bool Core::send(conn_id_t id, uint32_t t, std::span<const uint8_t> p, SendClass cls) {
+    return impl_->cm->send(id, t, p, cls);
 }
 
-void Core::broadcast(uint32_t t, std::span<const uint8_t> p) {
-    impl_->cm->broadcast(t, p);
+BroadcastHandle Core::broadcast(uint32_t t, std::span<const uint8_t> p, SendClass cls) {
+    return impl_->cm->broadcast(t, p, cls);
+}
+
+void Core::set_send_class(uint32_t t, SendClass cls) {
+    impl_->cm->set_send_class(t, cls);
+}
+
+void Core::set_fragment_streaming(uint32_t t, bool on) {
+    impl_->cm->set_fragment_streaming(t, on);
 }
 
 void Core::connect(std::string_view uri) { impl_->cm->connect(uri); }
@@ -237,8 +249,10 @@ std::string Core::device_pubkey_hex() const { return impl_->identity.device_pubk
 
 // ── Stats ─────────────────────────────────────────────────────────────────────
 
-StatsSnapshot Core::stats_snapshot() const noexcept {
+StatsSnapshot Core::stats_snapshot() const {
     return impl_->bus->stats_snapshot(); }
+size_t Core::send_window(conn_id_t id) const noexcept {
+    return impl_->cm->send_window(id); }
 size_t Core::connection_count() const noexcept {
     return impl_->cm->connection_count(); }
 std::vector<std::string> Core::active_uris() const {
@@ -58,6 +58,7 @@ int main(int argc, char** argv) {
     bool     no_color    = false;
     bool     exit_code   = false;
     bool     ice_upgrade = false;
+    bool     codec_bench = false;
     std::string config_path;
 
     po::options_description desc("GoodNet Benchmark");
@@ -82,6 +83,8 @@ int main(int argc, char** argv) {
                          "Structured exit codes: 0=ok, 1=crypto/timeout error")
         ("ice-upgrade",  po::bool_switch(&ice_upgrade),
                          "Upgrade to ICE/DTLS after TCP handshake")
+        ("codec-bench",  po::bool_switch(&codec_bench),
+                         "Offline zstd/LZ4 throughput for --size payloads, then exit")
         ("config,c",     po::value(&config_path),     "Path to JSON config file");
 
     po::variables_map vm;
@@ -94,6 +97,12 @@ int main(int argc, char** argv) {
     }
     if (vm.count("help")) { std::cout << desc << "\n"; return 0; }
 
+    if (codec_bench) {
+        cli::CodecBenchConfig ccfg;
+        ccfg.pkt_size_kb = kb_size;
+        return cli::run_codec_benchmark(ccfg);
+    }
+
     // ── Thread count ─────────────────────────────────────────────────────────
     if (threads <= 0) {
         const int hw = static_cast<int>(std::thread::hardware_concurrency());
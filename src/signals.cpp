@@ -1,9 +1,13 @@
 /// @file src/signals.cpp
 
 #include "signals.hpp"
+#include "../sdk/cpp/buffer_pool.hpp"
 
 #include <boost/asio.hpp>
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <deque>
 
 namespace gn {
 
@@ -27,13 +31,51 @@ bool EventSignalBase::try_post_to_strand(std::function<void()> task) {
     return true;
 }
 
+// ── Handler IDs ───────────────────────────────────────────────────────────────
+
+namespace {
+struct HandlerNames {
+    std::shared_mutex                                  mu;
+    std::deque<std::string>                            names;   ///< [id - 1]; адреса стабильны
+    std::unordered_map<std::string_view, handler_id_t> ids;
+};
+
+HandlerNames& handler_names() {
+    static HandlerNames t;
+    return t;
+}
+} // namespace
+
+handler_id_t intern_handler(std::string_view name) {
+    auto& t = handler_names();
+    {
+        std::shared_lock lk(t.mu);
+        if (auto it = t.ids.find(name); it != t.ids.end()) return it->second;
+    }
+    std::unique_lock lk(t.mu);
+    if (auto it = t.ids.find(name); it != t.ids.end()) return it->second;
+    const auto& s  = t.names.emplace_back(name);
+    const auto  id = static_cast<handler_id_t>(t.names.size());
+    t.ids.emplace(s, id);
+    return id;
+}
+
+std::string_view handler_name(handler_id_t id) noexcept {
+    auto& t = handler_names();
+    std::shared_lock lk(t.mu);
+    return id != HANDLER_ID_NONE && id <= t.names.size() ? std::string_view(t.names[id - 1])
+                                                         : std::string_view{};
+}
+
 // ── PipelineSignal ────────────────────────────────────────────────────────────
 
-void PipelineSignal::connect(uint8_t priority, std::string_view name, HandlerPacketFn fn) {
+void PipelineSignal::connect(uint8_t priority, std::string_view name, HandlerPacketFn fn,
+                             HandlerBatchFn batch) {
     std::lock_guard lock(write_mu_);
     auto old = handlers_ptr_.load(std::memory_order_acquire);
     auto vec  = std::make_shared<std::vector<Entry>>(*old);
-    vec->push_back({priority, std::string(name), std::move(fn)});
+    const handler_id_t id = intern_handler(name);
+    vec->push_back({priority, id, handler_name(id), std::move(fn), std::move(batch)});
     std::stable_sort(vec->begin(), vec->end(),
         [](const Entry& a, const Entry& b) { return a.priority > b.priority; });
     handlers_ptr_.store(std::move(vec), std::memory_order_release);
@@ -43,31 +85,74 @@ void PipelineSignal::disconnect(std::string_view name) {
     std::lock_guard lock(write_mu_);
     auto old = handlers_ptr_.load(std::memory_order_acquire);
     auto vec  = std::make_shared<std::vector<Entry>>();
+    const handler_id_t id = intern_handler(name);
     for (auto& e : *old)
-        if (e.name != name) vec->push_back(e);
+        if (e.id != id) vec->push_back(e);
     handlers_ptr_.store(std::move(vec), std::memory_order_release);
 }
 
-PipelineSignal::EmitResult PipelineSignal::emit(
-        std::shared_ptr<header_t> hdr,
-        const endpoint_t*         ep,
-        PacketData                data) const {
+PipelineSignal::EmitResult PipelineSignal::emit(const endpoint_t* ep,
+                                                const PacketData& data) const {
     auto handlers = handlers_ptr_.load(std::memory_order_acquire);
+    const header_t& hdr = data.header();
     for (auto& e : *handlers) {
         auto r = e.fn(e.name, hdr, ep, data);
-        if (r == PROPAGATION_CONSUMED) return {PROPAGATION_CONSUMED, e.name};
-        if (r == PROPAGATION_REJECT)   return {PROPAGATION_REJECT,   e.name};
+        if (r == PROPAGATION_CONSUMED) return {PROPAGATION_CONSUMED, e.id};
+        if (r == PROPAGATION_REJECT)   return {PROPAGATION_REJECT,   e.id};
     }
     return {};
 }
 
+void PipelineSignal::emit_batch(const endpoint_t* ep, std::span<const PacketData> pkts,
+                                uint64_t& live, BatchResult& out) const {
+    auto handlers = handlers_ptr_.load(std::memory_order_acquire);
+    const uint64_t all = pkts.size() == 64 ? ~uint64_t{0} : (uint64_t{1} << pkts.size()) - 1;
+
+    auto stop = [&](uint64_t bits, propagation_t r, handler_id_t id) {
+        const auto n = static_cast<size_t>(std::popcount(bits));
+        if (r == PROPAGATION_CONSUMED) {
+            if (!out.consumed) out.consumed_by = id;
+            out.consumed += n;
+        } else {
+            if (!out.rejected) out.rejected_by = id;
+            out.rejected += n;
+        }
+        live &= ~bits;
+    };
+
+    for (auto& e : *handlers) {
+        if (!live) return;
+        if (e.batch) {
+            propagation_t r;
+            if (live == all) {
+                r = e.batch(e.name, ep, pkts);
+            } else {
+                // Часть пакетов уже остановлена — batch-хэндлер видит только остальные
+                std::array<PacketData, MAX_BATCH> rest;
+                size_t n = 0;
+                for (uint64_t m = live; m; m &= m - 1)
+                    rest[n++] = pkts[static_cast<size_t>(std::countr_zero(m))];
+                r = e.batch(e.name, ep, std::span<const PacketData>(rest.data(), n));
+            }
+            if (r != PROPAGATION_CONTINUE) stop(live, r, e.id);
+            continue;
+        }
+        for (uint64_t m = live; m; m &= m - 1) {
+            const auto i = static_cast<size_t>(std::countr_zero(m));
+            const auto r = e.fn(e.name, pkts[i].header(), ep, pkts[i]);
+            if (r != PROPAGATION_CONTINUE) stop(uint64_t{1} << i, r, e.id);
+        }
+    }
+}
+
 // ── SignalBus ─────────────────────────────────────────────────────────────────
 
 SignalBus::SignalBus(asio::io_context& ioc)
-    : on_stat(ioc), on_log(ioc), on_conn_state(ioc), on_transport_change(ioc) {}
+    : on_stat(ioc), on_log(ioc), on_conn_state(ioc), on_transport_change(ioc),
+      on_writable(ioc) {}
 
 uint64_t SignalBus::subscribe(uint32_t msg_type, std::string_view name,
-                               HandlerPacketFn cb, uint8_t prio) {
+                               HandlerPacketFn cb, uint8_t prio, HandlerBatchFn batch) {
     const uint64_t id = next_sub_id_.fetch_add(1, std::memory_order_relaxed);
     {
         std::unique_lock lock(sub_mu_);
@@ -75,16 +160,14 @@ uint64_t SignalBus::subscribe(uint32_t msg_type, std::string_view name,
     }
     {
         std::unique_lock lock(mu_);
-        auto& ch = channels_[msg_type];
-        if (!ch) ch = std::make_unique<PipelineSignal>();
-        ch->connect(prio, name, std::move(cb));
+        channel_locked(msg_type).connect(prio, name, std::move(cb), std::move(batch));
     }
     return id;
 }
 
 void SignalBus::subscribe_wildcard(std::string_view name,
-                                    HandlerPacketFn cb, uint8_t prio) {
-    wildcards_.connect(prio, name, std::move(cb));
+                                    HandlerPacketFn cb, uint8_t prio, HandlerBatchFn batch) {
+    wildcards_.connect(prio, name, std::move(cb), std::move(batch));
 }
 
 void SignalBus::unsubscribe(uint64_t sub_id) {
@@ -94,25 +177,75 @@ void SignalBus::unsubscribe(uint64_t sub_id) {
     const auto& [msg_type, name] = it->second;
 
     std::unique_lock chlk(mu_);
-    if (auto cit = channels_.find(msg_type); cit != channels_.end())
-        cit->second->disconnect(name);
+    if (auto* ch = find_channel_locked(msg_type))
+        ch->disconnect(name);
     sub_map_.erase(it);
 }
 
-PipelineSignal::EmitResult SignalBus::dispatch_packet(
-        uint32_t                  msg_type,
-        std::shared_ptr<header_t> hdr,
-        const endpoint_t*         ep,
-        PacketData                data) {
-    {
+PipelineSignal* SignalBus::find_channel(uint32_t msg_type) const noexcept {
+    if (msg_type > 0xFFFF) [[unlikely]] {
         std::shared_lock lock(mu_);
-        auto it = channels_.find(msg_type);
-        if (it != channels_.end()) {
-            auto r = it->second->emit(hdr, ep, data);
-            if (r.result != PROPAGATION_CONTINUE) return r;
-        }
+        return find_channel_locked(msg_type);
+    }
+    return find_channel_locked(msg_type);
+}
+
+PipelineSignal* SignalBus::find_channel_locked(uint32_t msg_type) const noexcept {
+    if (msg_type > 0xFFFF) [[unlikely]] {
+        auto it = wide_channels_.find(msg_type);
+        return it != wide_channels_.end() ? it->second.get() : nullptr;
+    }
+    auto* page = pages_[msg_type >> PAGE_BITS].load(std::memory_order_acquire);
+    return page ? page->slots[msg_type & (PAGE_SIZE - 1)].load(std::memory_order_acquire)
+                : nullptr;
+}
+
+PipelineSignal& SignalBus::channel_locked(uint32_t msg_type) {
+    if (msg_type > 0xFFFF) {
+        auto& ch = wide_channels_[msg_type];
+        if (!ch) ch = std::make_unique<PipelineSignal>();
+        return *ch;
+    }
+    auto& page_slot = pages_[msg_type >> PAGE_BITS];
+    auto* page = page_slot.load(std::memory_order_relaxed);
+    if (!page) {
+        page = page_store_.emplace_back(std::make_unique<ChannelPage>()).get();
+        page_slot.store(page, std::memory_order_release);
     }
-    return wildcards_.emit(hdr, ep, data);
+    auto& slot = page->slots[msg_type & (PAGE_SIZE - 1)];
+    auto* ch = slot.load(std::memory_order_relaxed);
+    if (!ch) {
+        // Канал публикуется один раз и живёт до конца шины — читатель без
+        // блокировки не может увидеть освобождённый PipelineSignal
+        ch = channel_store_.emplace_back(std::make_unique<PipelineSignal>()).get();
+        slot.store(ch, std::memory_order_release);
+    }
+    return *ch;
+}
+
+PipelineSignal::EmitResult SignalBus::dispatch_packet(
+        uint32_t          msg_type,
+        const endpoint_t* ep,
+        const PacketData& data) {
+    if (auto* ch = find_channel(msg_type)) {
+        auto r = ch->emit(ep, data);
+        if (r.result != PROPAGATION_CONTINUE) return r;
+    }
+    return wildcards_.emit(ep, data);
+}
+
+PipelineSignal::BatchResult SignalBus::dispatch_batch(
+        uint32_t                    msg_type,
+        const endpoint_t*           ep,
+        std::span<const PacketData> pkts) {
+    PipelineSignal::BatchResult out;
+    if (pkts.empty()) return out;
+    uint64_t live = pkts.size() >= PipelineSignal::MAX_BATCH
+                  ? ~uint64_t{0} : (uint64_t{1} << pkts.size()) - 1;
+    if (auto* ch = find_channel(msg_type))
+        ch->emit_batch(ep, pkts, live, out);
+    if (live) wildcards_.emit_batch(ep, pkts, live, out);
+    return out;
 }
 
 // ── Stats ─────────────────────────────────────────────────────────────────────
@@ -146,6 +279,16 @@ void SignalBus::emit_stat(StatsEvent ev) noexcept {
         case K::DispatchLatencyNs:
             a.dispatch_lat.record(ev.value);
             break;
+        case K::Flush:
+            a.flushes     .fetch_add(1,        std::memory_order_relaxed);
+            a.flush_frames.fetch_add(ev.value, std::memory_order_relaxed);
+            break;
+        case K::RekeyTx:
+        case K::RekeyRx:
+            (ev.kind == K::RekeyTx ? a.rekeys_tx : a.rekeys_rx)
+                .fetch_add(1, std::memory_order_relaxed);
+            a.rekey_ns.fetch_add(ev.value, std::memory_order_relaxed);
+            break;
     }
     on_stat.emit(ev);
 }
@@ -167,7 +310,33 @@ void SignalBus::emit_latency(conn_id_t id, uint64_t ns) noexcept {
     emit_stat(ev);
 }
 
-StatsSnapshot SignalBus::stats_snapshot() const noexcept {
+void SignalBus::add_queue_depth(SendClass cls, int64_t delta) noexcept {
+    const auto i = static_cast<size_t>(cls);
+    if (i < static_cast<size_t>(SendClass::_Count))
+        accum_.queue_depth[i].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void SignalBus::add_compression(uint32_t msg_type, uint64_t raw_bytes,
+                                uint64_t wire_bytes, bool dict, bool lz4) {
+    CompressionAccum* c = nullptr;
+    {
+        std::shared_lock lk(comp_mu_);
+        if (auto it = comp_.find(msg_type); it != comp_.end()) c = it->second.get();
+    }
+    if (!c) {
+        std::unique_lock lk(comp_mu_);
+        auto& slot = comp_[msg_type];
+        if (!slot) slot = std::make_unique<CompressionAccum>();
+        c = slot.get();
+    }
+    c->frames    .fetch_add(1,          std::memory_order_relaxed);
+    c->raw_bytes .fetch_add(raw_bytes,  std::memory_order_relaxed);
+    c->wire_bytes.fetch_add(wire_bytes, std::memory_order_relaxed);
+    if (dict) c->dict_frames.fetch_add(1, std::memory_order_relaxed);
+    if (lz4)  c->lz4_frames .fetch_add(1, std::memory_order_relaxed);
+}
+
+StatsSnapshot SignalBus::stats_snapshot() const {
     auto& a = accum_;
     StatsSnapshot s;
     s.rx_bytes     = a.rx_bytes    .load(std::memory_order_relaxed);
@@ -183,8 +352,19 @@ StatsSnapshot SignalBus::stats_snapshot() const noexcept {
     s.connections  = a.connections .load(std::memory_order_relaxed);
     s.total_conn   = a.total_conn  .load(std::memory_order_relaxed);
     s.total_disc   = a.total_disc  .load(std::memory_order_relaxed);
+    s.pool_hits    = sdk::BufferPool::instance().hits();
+    s.pool_misses  = sdk::BufferPool::instance().misses();
+    s.flushes      = a.flushes     .load(std::memory_order_relaxed);
+    s.flush_frames = a.flush_frames.load(std::memory_order_relaxed);
+    s.rekeys_tx    = a.rekeys_tx   .load(std::memory_order_relaxed);
+    s.rekeys_rx    = a.rekeys_rx   .load(std::memory_order_relaxed);
+    s.rekey_ns     = a.rekey_ns    .load(std::memory_order_relaxed);
     for (size_t i = 0; i < static_cast<size_t>(DropReason::_Count); ++i)
         s.drops[i] = a.drops[i].load(std::memory_order_relaxed);
+    for (size_t i = 0; i < static_cast<size_t>(SendClass::_Count); ++i) {
+        const int64_t d = a.queue_depth[i].load(std::memory_order_relaxed);
+        s.queue_depth[i] = d > 0 ? static_cast<uint64_t>(d) : 0;
+    }
     // Copy histogram (non-atomic read — approximate, good enough for telemetry)
     for (int i = 0; i < 7; ++i)
         s.dispatch_latency.buckets[i].store(
@@ -193,6 +373,16 @@ StatsSnapshot SignalBus::stats_snapshot() const noexcept {
         a.dispatch_lat.total_ns.load(std::memory_order_relaxed));
     s.dispatch_latency.count.store(
         a.dispatch_lat.count.load(std::memory_order_relaxed));
+
+    std::shared_lock lk(comp_mu_);
+    for (auto& [type, c] : comp_) {
+        auto& out = s.compression[type];
+        out.frames      = c->frames     .load(std::memory_order_relaxed);
+        out.dict_frames = c->dict_frames.load(std::memory_order_relaxed);
+        out.lz4_frames  = c->lz4_frames .load(std::memory_order_relaxed);
+        out.raw_bytes   = c->raw_bytes  .load(std::memory_order_relaxed);
+        out.wire_bytes  = c->wire_bytes .load(std::memory_order_relaxed);
+    }
     return s;
 }
 
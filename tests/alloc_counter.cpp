@@ -0,0 +1,28 @@
+/// @file tests/alloc_counter.cpp
+/// @brief Replaces global operator new/delete for unit_tests to count heap
+///        allocations per thread (t_count_allocs / t_allocs, test_helpers.hpp).
+///
+/// Kept in its own TU: inlined into a test body, the malloc/free pair
+/// trips -Wmismatched-new-delete against the callers' new-expressions.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+thread_local bool        t_count_allocs = false;
+thread_local std::size_t t_allocs       = 0;
+
+void* operator new(std::size_t n) {
+    if (t_count_allocs) ++t_allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    if (t_count_allocs) ++t_allocs;
+    return std::malloc(n ? n : 1);
+}
+
+void operator delete(void* p) noexcept                         { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept            { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept  { std::free(p); }
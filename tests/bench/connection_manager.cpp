@@ -0,0 +1,672 @@
+/// @file tests/bench/connection_manager.cpp
+/// @brief ConnectionManager micro-benchmarks (micro_bench, not run by ctest).
+///
+/// Each case prints one `[ bench    ]` line per configuration and checks only
+/// that the work was done — timings depend on the machine and its load, so
+/// they are reported, never asserted.  Deterministic properties measured
+/// alongside (copies, allocations, ordering) stay in unit_tests.
+
+#include <sodium.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zstd.h>
+
+#include "../cm_fixture.hpp"
+
+// ─── build_frame ──────────────────────────────────────────────────────────────
+
+/// Прежняя схема build_frame: comp_buf → body → wire → frame (до 4 буферов).
+/// Оставлена только как baseline для сравнения.
+static std::vector<uint8_t> legacy_build_frame(NoiseSession& s, uint64_t pkt_id,
+                                               std::span<const uint8_t> payload) {
+    std::vector<uint8_t> comp_buf;
+    bool compressed = false;
+    if (payload.size() > 512) {
+        const size_t bound = ZSTD_compressBound(payload.size());
+        comp_buf.resize(bound);
+        const size_t csize = ZSTD_compress(comp_buf.data(), bound,
+                                           payload.data(), payload.size(), 1);
+        if (!ZSTD_isError(csize) && csize < payload.size()) {
+            comp_buf.resize(csize);
+            compressed = true;
+        }
+    }
+    std::vector<uint8_t> body;
+    if (compressed) {
+        const uint32_t orig32 = static_cast<uint32_t>(payload.size());
+        body.resize(5 + comp_buf.size());
+        body[0] = 0x01;
+        std::memcpy(body.data() + 1, &orig32, 4);
+        std::memcpy(body.data() + 5, comp_buf.data(), comp_buf.size());
+    } else {
+        body.resize(1 + payload.size());
+        body[0] = 0x00;
+        std::memcpy(body.data() + 1, payload.data(), payload.size());
+    }
+    std::vector<uint8_t> wire(body.size() + crypto_aead_chacha20poly1305_IETF_ABYTES);
+    uint8_t nonce12[12]{};
+    std::memcpy(nonce12 + 4, &pkt_id, 8);
+    unsigned long long clen = 0;
+    crypto_aead_chacha20poly1305_ietf_encrypt(wire.data(), &clen, body.data(), body.size(),
+                                              nullptr, 0, nullptr, nonce12, s.send_key);
+    wire.resize(static_cast<size_t>(clen));
+
+    header_t hdr{};
+    hdr.magic       = GNET_MAGIC;
+    hdr.proto_ver   = GNET_PROTO_VER;
+    hdr.payload_len = static_cast<uint32_t>(wire.size());
+    hdr.packet_id   = pkt_id;
+    std::vector<uint8_t> frame(sizeof(header_t) + wire.size());
+    std::memcpy(frame.data(), &hdr, sizeof(header_t));
+    std::memcpy(frame.data() + sizeof(header_t), wire.data(), wire.size());
+    return frame;
+}
+
+TEST_F(CMTest, BuildFrame_LegacyVsInPlace) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    auto rec = impl(*cm_a_).rcu_find(cid_a);
+    ASSERT_TRUE(rec && rec->session);
+
+    struct Case { size_t size; int iters; };
+    for (auto [size, iters] : {Case{1024, 4000}, Case{64 * 1024, 400}, Case{1024 * 1024, 25}}) {
+        // Полусжимаемые данные: случайные блоки вперемешку с повторами
+        std::vector<uint8_t> payload(size);
+        randombytes_buf(payload.data(), payload.size());
+        for (size_t i = 0; i < size; i += 64)
+            std::memset(payload.data() + i, 0x42, std::min<size_t>(32, size - i));
+
+        using clock = std::chrono::steady_clock;
+        size_t sink = 0;
+
+        auto t0 = clock::now();
+        for (int i = 0; i < iters; ++i)
+            sink += legacy_build_frame(*rec->session, 1000 + i, payload).size();
+        auto t1 = clock::now();
+        for (int i = 0; i < iters; ++i)
+            sink += impl(*cm_a_).build_frame(cid_a, MSG_TYPE_CHAT, payload).size();
+        auto t2 = clock::now();
+
+        const double legacy_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / iters;
+        const double inplace_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / iters;
+        std::printf("[ bench    ] build_frame %7zu B: legacy %9.2f us  in-place %9.2f us  (x%.2f)\n",
+                    size, legacy_us, inplace_us, legacy_us / std::max(inplace_us, 1e-9));
+        EXPECT_GT(sink, 0u);
+    }
+}
+
+// ─── send_owned (v2 zero-copy ABI) ────────────────────────────────────────────
+
+TEST_F(CMTest, SendOwned_CopiesPerByte) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+
+    constexpr int    N    = 200;
+    constexpr size_t SIZE = 64 * 1024;
+    std::vector<uint8_t> payload(SIZE);
+    randombytes_buf(payload.data(), payload.size());   // несжимаемые
+
+    using clock = std::chrono::steady_clock;
+    auto run = [&](connector_ops_t& ops, OwnedSink& sink) {
+        cm_a_->register_connector("tcp", &ops);
+        auto t0 = clock::now();
+        for (int i = 0; i < N; ++i) {
+            cm_a_->send(cid_a, MSG_TYPE_CHAT, payload);
+            sink.release_all();          // «запись завершилась»
+        }
+        return std::chrono::duration<double, std::micro>(clock::now() - t0).count() / N;
+    };
+
+    OwnedSink gather_sink, owned_sink;
+    auto gather_ops = make_copying_gather_ops(&gather_sink);
+    auto owned_ops  = make_owned_ops(&owned_sink);
+    const double gather_us = run(gather_ops, gather_sink);
+    const double owned_us  = run(owned_ops,  owned_sink);
+    cm_a_->register_connector("tcp", &mock_ops_);
+
+    const double gather_cpb = double(gather_sink.copied) / std::max<size_t>(gather_sink.bytes, 1);
+    const double owned_cpb  = double(owned_sink.copied)  / std::max<size_t>(owned_sink.bytes, 1);
+    std::printf("[ bench    ] send %zu B: gather+copy %.2f copies/B %8.2f us  "
+                "send_owned %.2f copies/B %8.2f us\n",
+                SIZE, gather_cpb, gather_us, owned_cpb, owned_us);
+    EXPECT_GT(owned_sink.bytes, 0u);
+}
+
+// ─── Async flush scheduler ────────────────────────────────────────────────────
+
+TEST_F(CMTest, FlushExecutor_ConcurrentSenders) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    constexpr int THREADS = 4, PER_THREAD = 500;
+    std::vector<uint8_t> payload(1024);
+    randombytes_buf(payload.data(), payload.size());
+
+    const auto before = bus_.stats_snapshot();
+    auto work = boost::asio::make_work_guard(ioc_);
+    std::thread io([&] { ioc_.run(); });
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> senders;
+    for (int t = 0; t < THREADS; ++t)
+        senders.emplace_back([&] {
+            for (int i = 0; i < PER_THREAD; ++i)
+                while (!cm_a_->send(cid_a, MSG_TYPE_CHAT, payload))
+                    std::this_thread::yield();
+        });
+    for (auto& s : senders) s.join();
+    while (cm_a_->get_pending_bytes(cid_a) > 0) std::this_thread::yield();
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    work.reset();
+    ioc_.stop();
+    io.join();
+    ioc_.restart();
+
+    const auto after = bus_.stats_snapshot();
+    const uint64_t flushes = after.flushes - before.flushes;
+    const uint64_t frames  = after.flush_frames - before.flush_frames;
+    std::printf("[ bench    ] async flush: %d senders x %d frames in %.2f ms, "
+                "%llu flushes, %.1f frames/flush\n",
+                THREADS, PER_THREAD, ms, (unsigned long long)flushes,
+                flushes ? double(frames) / double(flushes) : 0.0);
+
+    EXPECT_EQ(frames, uint64_t(THREADS) * PER_THREAD);
+    sink.release_all();
+
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+// ─── Broadcast fan-out ────────────────────────────────────────────────────────
+
+TEST_F(CMTest, Broadcast_LatencyVsPeers) {
+    auto& im = impl(*cm_a_);
+    cm_a_->register_connector("tcp", &mock_ops_);
+
+    std::vector<uint8_t> payload(4096);
+    randombytes_buf(payload.data(), payload.size());
+    for (size_t i = 0; i < payload.size(); i += 64)
+        std::memset(payload.data() + i, 0x42, 32);
+
+    constexpr int THREADS = 4;
+    using clock = std::chrono::steady_clock;
+    conn_id_t base = 100000;
+    for (size_t peers : {size_t{10}, size_t{100}, size_t{1000}}) {
+        auto ids = add_fake_peers(im, peers, base);
+        base += peers;
+
+        auto drained = [&] {
+            for (auto id : ids)
+                while (cm_a_->get_pending_bytes(id) > 0) std::this_thread::yield();
+        };
+
+        // Serial: всё на потоке вызывающего, как до fan-out
+        cm_a_->set_flush_executor(nullptr);
+        auto t0 = clock::now();
+        auto hs = cm_a_->broadcast(MSG_TYPE_CHAT, payload);
+        const double serial_us = std::chrono::duration<double, std::micro>(
+            clock::now() - t0).count();
+        EXPECT_EQ(hs.sent(), peers);
+
+        // Parallel: IO-пул из THREADS потоков
+        cm_a_->set_flush_executor(&ioc_);
+        auto work = boost::asio::make_work_guard(ioc_);
+        std::vector<std::thread> pool;
+        for (int t = 0; t < THREADS; ++t) pool.emplace_back([&] { ioc_.run(); });
+
+        auto t1 = clock::now();
+        auto hp = cm_a_->broadcast(MSG_TYPE_CHAT, payload);
+        const double return_us = std::chrono::duration<double, std::micro>(
+            clock::now() - t1).count();
+        hp.wait();
+        drained();
+        const double done_us = std::chrono::duration<double, std::micro>(
+            clock::now() - t1).count();
+
+        work.reset();
+        ioc_.stop();
+        for (auto& t : pool) t.join();
+        ioc_.restart();
+        cm_a_->set_flush_executor(nullptr);
+
+        EXPECT_EQ(hp.sent(), peers);
+        std::printf("[ bench    ] broadcast %4zu peers: serial %9.1f us  "
+                    "parallel(%d) return %7.1f us  done %9.1f us  (x%.2f)\n",
+                    peers, serial_us, THREADS, return_us, done_us,
+                    serial_us / std::max(done_us, 1e-9));
+
+        std::lock_guard wlk(im.records_write_mu_);
+        im.rcu_update([&](ConnectionManager::Impl::RecordMap& m) {
+            for (auto id : ids) m.erase(id);
+        });
+    }
+}
+
+// ─── Adaptive compression ─────────────────────────────────────────────────────
+
+TEST_F(CMTest, Compression_AdaptiveOnNoise) {
+    auto& im = impl(*cm_a_);
+    const conn_id_t id = add_fake_peers(im, 1, 81000)[0];
+    std::vector<uint8_t> noise(64 * 1024);
+    randombytes_buf(noise.data(), noise.size());
+
+    constexpr int N = 500;
+    auto run = [&](bool adaptive) {
+        Config cfg(true);
+        cfg.compression.adaptive = adaptive;
+        im.config_ = &cfg;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) (void)im.build_frame(id, MSG_TYPE_CHAT, noise);
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        im.config_ = nullptr;
+        return us;
+    };
+    const auto zstd_us = run(false);
+    const auto skip_us = run(true);
+    std::printf("[ bench    ] build_frame 64 KB noise x%d: zstd %lld us, "
+                "probe+skip %lld us (cpu_saved est %llu us)\n",
+                N, static_cast<long long>(zstd_us), static_cast<long long>(skip_us),
+                static_cast<unsigned long long>(
+                    im.rcu_find(id)->compression.cpu_saved_ns() / 1000));
+    EXPECT_EQ(im.rcu_find(id)->compression.skipped.load(), static_cast<uint64_t>(N));
+}
+
+// ─── Cipher suite (CORE_CAP_AES256GCM) ────────────────────────────────────────
+
+TEST(SessionTest, AeadCipherThroughput) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    for (const size_t size : {size_t{1400}, size_t{64 * 1024}}) {
+        std::vector<uint8_t> plain(size);
+        randombytes_buf(plain.data(), plain.size());
+        std::vector<uint8_t> buf(size + crypto_aead_aes256gcm_ABYTES);
+
+        for (const auto c : {AeadCipher::ChaCha20Poly1305, AeadCipher::Aes256Gcm}) {
+            NoiseSession s;
+            randombytes_buf(s.send_key, sizeof(s.send_key));
+            if (!s.set_cipher(c)) {
+                std::printf("[ bench    ] %-17s unavailable (no AES-NI)\n", aead_name(c));
+                continue;
+            }
+            const int n = static_cast<int>((64u << 20) / size);
+            const auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; ++i) {
+                std::memcpy(buf.data(), plain.data(), size);
+                s.seal_in_place(buf.data(), size, static_cast<uint64_t>(i) + 1);
+            }
+            const double sec = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - t0).count();
+            std::printf("[ bench    ] %-17s %6zu B: seal %7.0f MB/s\n", aead_name(c), size,
+                        static_cast<double>(size) * n / 1e6 / sec);
+        }
+    }
+}
+
+// ─── NonceWindow (lock-free, security.replay_window) ──────────────────────────
+
+TEST(NonceWindowTest, AcceptThroughput) {
+    constexpr uint64_t N = 4'000'000;
+    auto bench = [](const char* what, size_t threads, auto&& body) {
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> ts;
+        for (size_t t = 0; t < threads; ++t) ts.emplace_back(body, t);
+        for (auto& th : ts) th.join();
+        const double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - t0).count();
+        std::printf("[ bench    ] NonceWindow %-26s %6.1f ns/accept\n", what,
+                    ns / static_cast<double>(N));
+    };
+
+    NonceWindow w;
+    w.configure(NonceWindow::MAX_WINDOW);
+    bench("in-order, 1 thread", 1, [&](size_t) {
+        for (uint64_t n = 1; n <= N; ++n) w.accept(n);
+    });
+
+    w.reset();
+    bench("reordered(±4096), 1 thread", 1, [&](size_t) {
+        // Пары блоков в обратном порядке — каждый nonce приходит с опозданием до 4096
+        for (uint64_t base = 1; base <= N; base += 8192)
+            for (uint64_t i = 0; i < 8192; ++i) w.accept(base + (i + 4096) % 8192);
+    });
+
+    w.reset();
+    constexpr size_t T = 4;
+    bench("striped over 4 threads", T, [&](size_t t) {
+        for (uint64_t n = 1 + t; n <= N; n += T) w.accept(n);
+    });
+}
+
+// ─── Resumption (Noise_IK, peer identity cache) ───────────────────────────────
+
+TEST_F(CMTest, ReconnectStorm) {
+    // Рестарт relay: N пиров переподключаются к нему. С кэшем — Noise_IK без
+    // Ed25519-проверок, без кэша — полный Noise_XX с проверкой каждой identity.
+    constexpr int N = 200;
+    auto storm = [&](bool resume) {
+        Config cfg(true);
+        cfg.security.resumption      = resume;
+        cfg.security.peer_cache_size = resume ? 4096 : 0;
+        cfg.core.handshake_rate_per_ip = 0;   // все N переподключений с одного адреса
+        ConnectionManager peer (bus_, id_a_, &cfg);
+        ConnectionManager relay(bus_, id_b_, &cfg);
+        auto [a0, b0] = do_handshake(peer, id_a_, relay, id_b_, false);
+        impl(peer).handle_disconnect(a0, 0);
+        impl(relay).handle_disconnect(b0, 0);
+
+        int resumed = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            auto [a, b] = do_handshake(peer, id_a_, relay, id_b_, false);
+            resumed += impl(relay).rcu_find(b)->resumed;
+            impl(peer).handle_disconnect(a, 0);
+            impl(relay).handle_disconnect(b, 0);
+        }
+        const double us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - t0).count() / N;
+        EXPECT_EQ(resumed, resume ? N : 0);
+        peer.shutdown();
+        relay.shutdown();
+        return us;
+    };
+
+    const double xx = storm(false);
+    const double ik = storm(true);
+    std::printf("[ bench    ] reconnect storm x%d: full Noise_XX %.1f us, "
+                "Noise_IK resumption %.1f us per reconnect (%.2fx)\n",
+                N, xx, ik, xx / ik);
+}
+
+// ─── Handshake pool + admission control ───────────────────────────────────────
+
+TEST_F(CMTest, HandshakeStormVsDataLatency) {
+    // IO-поток relay получает кадры данных установленного пира каждые 20 us и
+    // шторм входящих NOISE_INIT. Inline каждая INIT держит IO-поток на DH, и
+    // данные ждут за ней; с пулом поток сразу возвращается к данным.
+    constexpr int  DATA   = 3000;
+    constexpr auto PERIOD = std::chrono::microseconds(20);
+
+    std::atomic<int> delivered{0};
+    bus_.subscribe(MSG_TYPE_CHAT, "storm_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            return PROPAGATION_CONTINUE;
+        });
+
+    struct Result { double hs_per_sec, p50_us, p99_us; };
+    auto run = [&](size_t workers, int data_per_init) {
+        Config cfg(true);
+        cfg.core.max_handshakes        = 0;
+        cfg.core.handshake_rate_per_ip = 0;
+        ConnectionManager peer (bus_, id_a_);
+        ConnectionManager relay(bus_, id_b_, &cfg);
+        auto [a, b] = do_handshake(peer, id_a_, relay, id_b_, false);
+        relay.start_handshake_pool(workers);   // путь данных открыт до пула — он inline
+
+        // Кадры данных и INIT'ы шторма заранее: их построение не входит в замер
+        const std::vector<uint8_t> msg(64, 0x5A);
+        std::vector<sdk::FrameBuffer> frames;
+        for (int i = 0; i < DATA; ++i)
+            frames.push_back(impl(peer).build_frame(a, MSG_TYPE_CHAT, msg));
+
+        CapturingSink sink;
+        auto cap_ops = make_capturing_connector(&sink);
+        ConnectionManager storm(bus_, id_a_);
+        host_api_t api_s{}, api_r{};
+        storm.fill_host_api(&api_s);
+        relay.fill_host_api(&api_r);
+        storm.register_connector("tcp", &cap_ops);
+        relay.register_connector("tcp", &cap_ops);
+        const int inits = DATA / data_per_init;
+        std::vector<std::vector<uint8_t>> init_frames;
+        for (int i = 0; i < inits; ++i) {
+            endpoint_t ep{};
+            strncpy(ep.address, "10.0.0.2", sizeof(ep.address));
+            ep.port  = static_cast<uint16_t>(20000 + i);
+            ep.flags = EP_FLAG_OUTBOUND;
+            api_s.on_connect(api_s.ctx, &ep);
+            init_frames.push_back(sink.extract(MSG_TYPE_NOISE_INIT));
+        }
+
+        const int before = delivered.load();
+        std::vector<double> lat;
+        lat.reserve(DATA);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < DATA; ++i) {
+            const auto due = t0 + i * PERIOD;
+            while (std::chrono::steady_clock::now() < due) std::this_thread::yield();
+            if (i % data_per_init == 0) {
+                const int k = i / data_per_init;
+                endpoint_t ep{};
+                std::snprintf(ep.address, sizeof(ep.address), "10.1.%d.%d", k / 250, k % 250 + 1);
+                ep.port = 40000;
+                const conn_id_t c = api_r.on_connect(api_r.ctx, &ep);
+                api_r.on_data(api_r.ctx, c, init_frames[k].data(), init_frames[k].size());
+            }
+            api_r.on_data(api_r.ctx, b, frames[i].data(), frames[i].size());
+            lat.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - due).count());
+        }
+        for (int i = 0; i < 10000 && sink.count_frames(MSG_TYPE_NOISE_RESP) < size_t(inits); ++i)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        const double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        EXPECT_EQ(sink.count_frames(MSG_TYPE_NOISE_RESP), size_t(inits));
+        EXPECT_EQ(delivered.load() - before, DATA);
+        relay.register_connector("tcp", &mock_ops_);
+        g_cap_sink = nullptr;
+        storm.shutdown();
+        relay.shutdown();
+        peer.shutdown();
+
+        std::sort(lat.begin(), lat.end());
+        return Result{inits / secs, lat[lat.size() / 2], lat[lat.size() * 99 / 100]};
+    };
+
+    for (int per : {10, 4}) {
+        const auto in = run(0, per);
+        const auto po = run(2, per);
+        std::printf("[ bench    ] handshake storm 1 INIT / %d data frames: "
+                    "inline %6.0f hs/s, data p50 %7.1f us p99 %8.1f us | "
+                    "pool(2) %6.0f hs/s, data p50 %7.1f us p99 %8.1f us\n",
+                    per, in.hs_per_sec, in.p50_us, in.p99_us,
+                    po.hs_per_sec, po.p50_us, po.p99_us);
+    }
+}
+
+// ─── Stream reassembly (random fragmentation) ─────────────────────────────────
+
+TEST(StreamReassemblerTest, FragmentedStream) {
+    const auto stream = make_frame_stream(20000, 1400, 5);
+    constexpr int ROUNDS = 5;
+    volatile size_t sink = 0;   // не даём оптимизатору выбросить чтение payload
+
+    // Прежняя схема: insert в буфер, копия кадра, erase с начала
+    auto legacy = [&](const std::vector<size_t>& cuts) {
+        std::vector<uint8_t> buf, pkt;
+        size_t frames = 0, sum = 0, off = 0;
+        for (size_t n : cuts) {
+            buf.insert(buf.end(), stream.data() + off, stream.data() + off + n);
+            off += n;
+            size_t consumed = 0;
+            while (buf.size() - consumed >= sizeof(header_t)) {
+                const auto* h = reinterpret_cast<const header_t*>(buf.data() + consumed);
+                const size_t total = sizeof(header_t) + h->payload_len;
+                if (buf.size() - consumed < total) break;
+                pkt.assign(buf.data() + consumed, buf.data() + consumed + total);
+                sum += pkt[total - 1];
+                consumed += total;
+                ++frames;
+            }
+            buf.erase(buf.begin(), buf.begin() + static_cast<ptrdiff_t>(consumed));
+        }
+        sink = sum;
+        return frames;
+    };
+    auto framed = [&](const std::vector<size_t>& cuts) {
+        StreamReassembler rs;
+        size_t frames = 0, sum = 0, off = 0;
+        for (size_t n : cuts) {
+            std::span<const uint8_t> in(stream.data() + off, n);
+            off += n;
+            StreamReassembler::View v;
+            while (rs.next(in, 16UL << 20, v) == StreamReassembler::Status::Ready) {
+                if (!v.payload.empty()) sum += v.payload.back();
+                ++frames;
+            }
+        }
+        sink = sum;
+        return frames;
+    };
+    auto mb_per_s = [&](auto&& fn, const std::vector<size_t>& cuts) {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            const auto t0 = std::chrono::steady_clock::now();
+            EXPECT_EQ(fn(cuts), 20000u);
+            const double s = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - t0).count();
+            best = std::max(best, stream.size() / s / 1e6);
+        }
+        return best;
+    };
+
+    for (size_t max_chunk : {512, 4096, 65536}) {
+        const auto cuts = random_cuts(stream.size(), max_chunk, max_chunk);
+        const double old_mbs = mb_per_s(legacy, cuts);
+        const double new_mbs = mb_per_s(framed, cuts);
+        std::printf("[ bench    ] framing, random chunks <= %5zu B: "
+                    "insert+copy+erase %8.0f MB/s  in-place %8.0f MB/s  (x%.2f)\n",
+                    max_chunk, old_mbs, new_mbs, new_mbs / old_mbs);
+    }
+}
+
+// ─── Pooled PacketData ────────────────────────────────────────────────────────
+
+TEST_F(CMTest, DispatchPooledVsSharedPtr) {
+    constexpr int HANDLERS = 4, N = 200'000;
+    std::vector<uint8_t> payload(64, 0x5A);
+    header_t h{};
+    h.magic        = GNET_MAGIC;
+    h.proto_ver    = GNET_PROTO_VER;
+    h.payload_type = MSG_TYPE_CHAT;
+    h.payload_len  = static_cast<uint32_t>(payload.size());
+
+    // Прежнее представление: make_shared на заголовок и тело, shared_ptr по
+    // значению в каждый хэндлер цепочки
+    using LegacyFn = std::function<propagation_t(std::string_view, std::shared_ptr<header_t>,
+                                                 const endpoint_t*,
+                                                 std::shared_ptr<sdk::RawBuffer>)>;
+    size_t seen = 0;
+    std::vector<LegacyFn> legacy(HANDLERS,
+        [&](std::string_view, std::shared_ptr<header_t> hp, const endpoint_t*,
+            std::shared_ptr<sdk::RawBuffer> d) {
+            seen += d->size() + hp->payload_len;
+            return PROPAGATION_CONTINUE;
+        });
+    for (int k = 0; k < HANDLERS; ++k)
+        bus_.subscribe(MSG_TYPE_CHAT, "bench_" + std::to_string(k),
+            [&](std::string_view, const header_t& hp, const endpoint_t*, const PacketData& d) {
+                seen += d->size() + hp.payload_len;
+                return PROPAGATION_CONTINUE;
+            });
+
+    auto run = [&](auto&& one) {
+        for (int i = 0; i < 1000; ++i) one();   // прогрев free list
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) one();
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - t0).count() / N;
+    };
+
+    const double old_ns = run([&] {
+        auto hp = std::make_shared<header_t>(h);
+        auto d  = std::make_shared<sdk::RawBuffer>(payload.begin(), payload.end());
+        for (auto& fn : legacy)
+            if (fn("legacy", hp, nullptr, d) != PROPAGATION_CONTINUE) break;
+    });
+    const double new_ns = run([&] {
+        bus_.dispatch_packet(MSG_TYPE_CHAT, nullptr, PacketData::copy_of(h, payload));
+    });
+
+    // Весь путь приёма: handle_data → decrypt → пакет → цепочка хэндлеров
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    std::vector<sdk::FrameBuffer> frames;
+    for (int i = 0; i < 1000 + 20'000; ++i)
+        frames.push_back(impl(*cm_a_).build_frame(cid_a, MSG_TYPE_CHAT, payload));
+    size_t next = 0;
+    const auto e2e_warm = [&] { auto& f = frames[next++]; impl(*cm_b_).handle_data(cid_b, f.data(), f.size()); };
+    for (int i = 0; i < 1000; ++i) e2e_warm();
+    const auto t0 = std::chrono::steady_clock::now();
+    while (next < frames.size()) e2e_warm();
+    const double e2e_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count() / 20'000;
+
+    std::printf("[ bench    ] dispatch %zu B x %d handlers: shared_ptr %6.1f ns  "
+                "pooled %6.1f ns  (x%.2f) | handle_data %6.1f ns\n",
+                payload.size(), HANDLERS, old_ns, new_ns, old_ns / new_ns, e2e_ns);
+    EXPECT_GT(seen, 0u);
+}
+
+// ─── Batch dispatch (handler_t::handle_batch) ─────────────────────────────────
+
+TEST_F(CMTest, SmallMessagePps) {
+    constexpr int READS = 2000, PER_READ = 64;
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, true);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    // Чтения коннектора по 64 кадра с 64-байтным payload
+    std::vector<uint8_t> msg(64, 0x42);
+    std::vector<std::vector<uint8_t>> reads(READS);
+    for (auto& r : reads)
+        for (int i = 0; i < PER_READ; ++i) {
+            auto f = im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg);
+            r.insert(r.end(), f.data(), f.data() + f.size());
+        }
+
+    size_t bytes = 0;
+    auto run = [&](const char* name, HandlerBatchFn batch) {
+        const uint64_t sub = bus_.subscribe(MSG_TYPE_CHAT, name,
+            [&](std::string_view, const header_t&, const endpoint_t*, const PacketData& d) {
+                bytes += d->size();
+                return PROPAGATION_CONTINUE;
+            }, 128, std::move(batch));
+        for (int i = 0; i < 50; ++i) im_b.handle_data(cid_b, reads[i].data(), reads[i].size());
+        bytes = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (auto& r : reads) im_b.handle_data(cid_b, r.data(), r.size());
+        const double s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+        bus_.unsubscribe(sub);
+        EXPECT_EQ(bytes, size_t{READS} * PER_READ * msg.size());
+        return READS * PER_READ / s;
+    };
+
+    const double per_packet = run("pps_single", {});
+    const double batched    = run("pps_batch",
+        [&](std::string_view, const endpoint_t*, std::span<const PacketData> b) {
+            for (auto& p : b) bytes += p->size();
+            return PROPAGATION_CONTINUE;
+        });
+    std::printf("[ bench    ] %zu B msgs, %d frames/read: per-packet handler %8.0f kpps  "
+                "handle_batch %8.0f kpps  (x%.2f)\n",
+                msg.size(), PER_READ, per_packet / 1e3, batched / 1e3, batched / per_packet);
+}
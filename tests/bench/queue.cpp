@@ -0,0 +1,50 @@
+/// @file tests/bench/queue.cpp
+/// @brief PerConnQueue micro-benchmarks (micro_bench, not run by ctest).
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "cm/connectionManager.hpp"
+#include "cm/impl.hpp"
+
+using namespace gn;
+
+// ─── N producers → 1 drainer, 64 B frames ─────────────────────────────────────
+
+TEST(PerConnQueueTest, MpscThroughput) {
+    for (int producers : {1, 4, 16}) {
+        PerConnQueue q;
+        constexpr int FRAMES = 200'000;
+        const int per_producer = FRAMES / producers;
+        std::atomic<bool> go{false};
+        std::atomic<int>  drained{0};
+
+        std::vector<std::thread> ts;
+        for (int p = 0; p < producers; ++p) {
+            ts.emplace_back([&] {
+                auto frame = sdk::FrameBuffer::copy_of(std::vector<uint8_t>(64, 0x5C));
+                while (!go.load()) std::this_thread::yield();
+                for (int i = 0; i < per_producer; ++i)
+                    while (!q.try_push(frame)) std::this_thread::yield();
+            });
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        go = true;
+        const int expected = per_producer * producers;
+        while (drained.load(std::memory_order_relaxed) < expected)
+            drained.fetch_add(static_cast<int>(q.drain_batch(64).size()),
+                              std::memory_order_relaxed);
+        const auto t1 = std::chrono::steady_clock::now();
+        for (auto& t : ts) t.join();
+
+        const double sec = std::chrono::duration<double>(t1 - t0).count();
+        std::printf("[ bench    ] PerConnQueue %2d producers: %6.2f Mframes/s\n",
+                    producers, expected / sec / 1e6);
+        EXPECT_EQ(q.pending_bytes.load(), 0u);
+    }
+}
@@ -0,0 +1,104 @@
+/// @file tests/bench/signals.cpp
+/// @brief SignalBus micro-benchmarks (micro_bench, not run by ctest).
+
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "signals.hpp"
+
+using namespace gn;
+
+// ─── Fixture ──────────────────────────────────────────────────────────────────
+
+class SignalBusTest : public ::testing::Test {
+protected:
+    boost::asio::io_context ioc_;
+    std::unique_ptr<SignalBus> bus_;
+
+    void SetUp() override {
+        bus_ = std::make_unique<SignalBus>(ioc_);
+    }
+};
+
+// ─── Channel lookup under subscription churn ──────────────────────────────────
+
+TEST_F(SignalBusTest, ContendedDispatch) {
+    constexpr int TYPES = 16, ITERS = 500'000;
+    const int threads = static_cast<int>(std::clamp(std::thread::hardware_concurrency(), 2u, 8u));
+
+    // Хэндлер без общих записей — меряем поиск канала, а не счётчик
+    auto cb = [](std::string_view, const header_t& h, const endpoint_t*, const PacketData&) {
+        return h.payload_type == 0xFFFF ? PROPAGATION_CONSUMED : PROPAGATION_CONTINUE;
+    };
+    for (int t = 0; t < TYPES; ++t) bus_->subscribe(MSG_TYPE_SYS_BASE + t, "h", cb);
+
+    // Прежняя схема поиска канала: unordered_map под shared_mutex (+ пустые wildcards)
+    std::shared_mutex map_mu;
+    PipelineSignal    map_wild;
+    std::unordered_map<uint32_t, std::unique_ptr<PipelineSignal>> map;
+    for (int t = 0; t < TYPES; ++t) {
+        auto& ch = map[MSG_TYPE_SYS_BASE + t];
+        ch = std::make_unique<PipelineSignal>();
+        ch->connect(128, "h", cb);
+    }
+
+    auto run = [&](int n, auto&& dispatch) {
+        std::atomic<bool>     stop{false};
+        std::atomic<uint64_t> done{0};
+        // Писатель: подписки меняются, пока читатели диспатчат
+        std::thread writer([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto id = bus_->subscribe(MSG_TYPE_SYS_BASE + TYPES, "churn", cb);
+                bus_->unsubscribe(id);
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        });
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> ts;
+        for (int i = 0; i < n; ++i)
+            ts.emplace_back([&, i] {
+                auto pkt = PacketData::acquire();
+                uint64_t ok = 0;
+                for (int k = 0; k < ITERS; ++k)
+                    ok += dispatch(uint32_t(MSG_TYPE_SYS_BASE + (k + i) % TYPES), pkt);
+                done.fetch_add(ok);
+            });
+        for (auto& t : ts) t.join();
+        const double s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+        stop = true;
+        writer.join();
+        EXPECT_EQ(done.load(), uint64_t(n) * ITERS);
+        return double(n) * ITERS / s;
+    };
+
+    auto flat = [&](uint32_t type, const PacketData& p) {
+        return bus_->dispatch_packet(type, nullptr, p).result == PROPAGATION_CONTINUE;
+    };
+    auto locked = [&](uint32_t type, const PacketData& p) {
+        {
+            std::shared_lock lk(map_mu);
+            auto it = map.find(type);
+            if (it == map.end() || it->second->emit(nullptr, p).result != PROPAGATION_CONTINUE)
+                return false;
+        }
+        return map_wild.emit(nullptr, p).result == PROPAGATION_CONTINUE;
+    };
+
+    run(1, flat);   // прогрев
+    const double map_1  = run(1, locked),  map_n  = run(threads, locked);
+    const double flat_1 = run(1, flat),    flat_n = run(threads, flat);
+
+    std::printf("[ bench    ] dispatch_packet, %d types, %d threads: "
+                "shared_mutex+map %6.1f / %6.1f Mpps  flat table %6.1f / %6.1f Mpps (1 / %d thr)\n",
+                TYPES, threads, map_1 / 1e6, map_n / 1e6, flat_1 / 1e6, flat_n / 1e6, threads);
+}
@@ -0,0 +1,175 @@
+/// @file tests/buffer_pool.cpp
+/// @brief Unit tests for sdk::BufferPool / sdk::FrameBuffer.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../sdk/cpp/buffer_pool.hpp"
+#include "signals.hpp"
+
+#include <boost/asio.hpp>
+
+using namespace gn;
+using sdk::BufferPool;
+using sdk::FrameBuffer;
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SECTION 1: Size classes
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST(BufferPoolTest, ClassOf_RoundsUpToPowerOfTwo) {
+    EXPECT_EQ(BufferPool::class_of(0),   0);
+    EXPECT_EQ(BufferPool::class_of(256), 0);
+    EXPECT_EQ(BufferPool::class_of(257), 1);
+    EXPECT_EQ(BufferPool::class_size(BufferPool::class_of(70000)), 128u * 1024);
+    EXPECT_EQ(BufferPool::class_of(4u * 1024 * 1024), BufferPool::NUM_CLASSES - 1);
+    EXPECT_EQ(BufferPool::class_of(4u * 1024 * 1024 + 1), BufferPool::UNPOOLED);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SECTION 2: FrameBuffer handle
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST(FrameBufferTest, CopyOf_HoldsBytes) {
+    std::vector<uint8_t> src(1000);
+    for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>(i);
+    auto f = FrameBuffer::copy_of(src);
+    ASSERT_EQ(f.size(), src.size());
+    EXPECT_GE(f.capacity(), 1024u);
+    EXPECT_EQ(std::memcmp(f.data(), src.data(), src.size()), 0);
+}
+
+TEST(FrameBufferTest, CopiesShareBlock_RefCounted) {
+    FrameBuffer a(512);
+    EXPECT_EQ(a.use_count(), 1u);
+    {
+        FrameBuffer b = a;
+        EXPECT_EQ(b.data(), a.data());
+        EXPECT_EQ(a.use_count(), 2u);
+    }
+    EXPECT_EQ(a.use_count(), 1u);
+
+    FrameBuffer c = std::move(a);
+    EXPECT_EQ(a.data(), nullptr);
+    EXPECT_EQ(c.use_count(), 1u);
+}
+
+TEST(FrameBufferTest, ResizeWithinCapacity_KeepsPointer) {
+    FrameBuffer f(2000);
+    auto* p = f.data();
+    f.resize(100);
+    EXPECT_EQ(f.data(), p);
+    f.resize(f.capacity());
+    EXPECT_EQ(f.data(), p);
+}
+
+TEST(FrameBufferTest, ResizeBeyondCapacity_PreservesContents) {
+    auto f = FrameBuffer::copy_of(std::vector<uint8_t>(300, 0x7E));
+    f.resize(100000);
+    ASSERT_EQ(f.size(), 100000u);
+    for (size_t i = 0; i < 300; ++i) ASSERT_EQ(f.data()[i], 0x7E);
+}
+
+TEST(FrameBufferTest, EmptyHandle) {
+    FrameBuffer f;
+    EXPECT_TRUE(f.empty());
+    EXPECT_EQ(f.size(), 0u);
+    EXPECT_EQ(f.use_count(), 0u);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SECTION 3: Pool reuse + counters
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST(BufferPoolTest, ReleasedBlockIsReused_CountsHit) {
+    auto& pool = BufferPool::instance();
+    const uint8_t* first = nullptr;
+    { FrameBuffer f(3000); first = f.data(); }
+
+    const uint64_t hits = pool.hits();
+    FrameBuffer g(2500);   // тот же класс (4 KB) → из thread cache
+    EXPECT_EQ(g.data(), first);
+    EXPECT_EQ(pool.hits(), hits + 1);
+}
+
+TEST(BufferPoolTest, Oversized_BypassesPool) {
+    auto& pool = BufferPool::instance();
+    const uint64_t misses = pool.misses();
+    { FrameBuffer f(8u * 1024 * 1024); EXPECT_EQ(f.capacity(), 8u * 1024 * 1024); }
+    { FrameBuffer f(8u * 1024 * 1024); }
+    EXPECT_EQ(pool.misses(), misses + 2);
+}
+
+TEST(BufferPoolTest, CrossThreadRelease_Recycled) {
+    // Кадр собирается на одном потоке, освобождается на другом (IO) —
+    // блок должен вернуться в пул, а не утечь.
+    std::vector<FrameBuffer> made;
+    for (int i = 0; i < 1000; ++i) made.emplace_back(700);
+
+    std::thread t([&] { made.clear(); });
+    t.join();
+
+    auto& pool = BufferPool::instance();
+    const uint64_t hits = pool.hits();
+    std::vector<FrameBuffer> again;
+    for (int i = 0; i < 100; ++i) again.emplace_back(700);
+    EXPECT_GT(pool.hits(), hits);
+}
+
+TEST(BufferPoolTest, ReleaseFromTlsDestructorAfterCacheGone) {
+    // Хэндл в thread_local, созданном раньше кэша потока: его деструктор
+    // выполняется уже после ~ThreadCache — блок уходит в central list.
+    struct Holder { FrameBuffer buf; };
+    constexpr size_t SIZE = 3000u * 1024;   // класс 4 MB — в других тестах не встречается
+    std::thread([] {
+        thread_local Holder holder;
+        holder.buf = FrameBuffer(SIZE);
+    }).join();
+
+    auto& pool = BufferPool::instance();
+    const uint64_t hits = pool.hits();
+    std::thread([] { FrameBuffer f(SIZE); }).join();   // пустой thread cache → central
+    EXPECT_EQ(pool.hits(), hits + 1);
+}
+
+TEST(BufferPoolTest, ConcurrentAcquireRelease) {
+    constexpr int THREADS = 8;
+    constexpr int ITERS   = 20000;
+    std::atomic<uint64_t> checksum{0};
+
+    std::vector<std::thread> ts;
+    for (int t = 0; t < THREADS; ++t) {
+        ts.emplace_back([&, t] {
+            uint64_t local = 0;
+            std::vector<FrameBuffer> keep;
+            for (int i = 0; i < ITERS; ++i) {
+                const size_t sz = 64u << (i % 10);
+                FrameBuffer f(sz);
+                std::memset(f.data(), t, sz);
+                local += f.data()[sz - 1];
+                if (i % 7 == 0) keep.push_back(std::move(f));
+                if (keep.size() > 32) keep.clear();
+            }
+            checksum.fetch_add(local);
+        });
+    }
+    for (auto& t : ts) t.join();
+
+    uint64_t expected = 0;
+    for (int t = 0; t < THREADS; ++t) expected += static_cast<uint64_t>(t) * ITERS;
+    EXPECT_EQ(checksum.load(), expected);
+}
+
+TEST(BufferPoolTest, StatsSnapshot_ExposesCounters) {
+    boost::asio::io_context ioc;
+    SignalBus bus(ioc);
+    { FrameBuffer f(1024); }
+    { FrameBuffer f(1024); }
+    auto st = bus.stats_snapshot();
+    EXPECT_EQ(st.pool_hits,   BufferPool::instance().hits());
+    EXPECT_EQ(st.pool_misses, BufferPool::instance().misses());
+    EXPECT_GT(st.pool_hits + st.pool_misses, 0u);
+}
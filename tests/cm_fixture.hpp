@@ -0,0 +1,192 @@
+#pragma once
+/// @file tests/cm_fixture.hpp
+/// CMTest fixture: two ConnectionManagers (A, B) with fresh identities and a
+/// simulated Noise handshake between them.  Shared by unit_tests and
+/// micro_bench (both friend the connection manager through CMTest).
+
+#include <sodium.h>
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "test_helpers.hpp"
+#include "cm/connectionManager.hpp"
+#include "cm/impl.hpp"
+#include "signals.hpp"
+
+#include "../sdk/cpp/connector.hpp"
+
+using namespace gn;
+
+// ─── Fixture ──────────────────────────────────────────────────────────────────
+
+class CMTest : public ::testing::Test {
+protected:
+    boost::asio::io_context  ioc_;
+    SignalBus                bus_{ioc_};
+    fs::path                 dir_a_ = tmp_dir("a");
+    fs::path                 dir_b_ = tmp_dir("b");
+    NodeIdentity             id_a_  = NodeIdentity::load_or_generate(dir_a_);
+    NodeIdentity             id_b_  = NodeIdentity::load_or_generate(dir_b_);
+    std::unique_ptr<ConnectionManager> cm_a_;
+    std::unique_ptr<ConnectionManager> cm_b_;
+    connector_ops_t          mock_ops_  = make_mock_connector_ops();
+
+    void SetUp() override {
+        cm_a_ = std::make_unique<ConnectionManager>(bus_, id_a_);
+        cm_b_ = std::make_unique<ConnectionManager>(bus_, id_b_);
+    }
+
+    void TearDown() override {
+        if (cm_a_) cm_a_->shutdown();
+        if (cm_b_) cm_b_->shutdown();
+        fs::remove_all(dir_a_);
+        fs::remove_all(dir_b_);
+    }
+
+    host_api_t make_api(ConnectionManager& cm) {
+        host_api_t api{};
+        cm.fill_host_api(&api);
+        cm.register_connector("tcp", &mock_ops_);
+        return api;
+    }
+
+    // Wrappers for Impl access (CMTest is friend of ConnectionManager)
+    ConnectionManager::Impl& impl(ConnectionManager& cm) { return *cm.impl_; }
+    const ConnectionManager::Impl& impl(const ConnectionManager& cm) const { return *cm.impl_; }
+
+    /// Simulate full Noise_XX handshake between two CMs (or the 1-RTT Noise_IK
+    /// resumption when A already knows B at the dialled address).
+    /// Uses a single capturing connector to intercept all wire frames.
+    std::pair<conn_id_t, conn_id_t> do_handshake(
+        ConnectionManager& cm_a, const NodeIdentity&,
+        ConnectionManager& cm_b, const NodeIdentity&,
+        bool localhost = false)
+    {
+        CapturingSink sink;
+        auto cap_ops = make_capturing_connector(&sink);
+
+        host_api_t api_a{}, api_b{};
+        cm_a.fill_host_api(&api_a);
+        cm_b.fill_host_api(&api_b);
+        cm_a.register_connector("tcp", &cap_ops);
+        cm_b.register_connector("tcp", &cap_ops);
+
+        endpoint_t ep_ab{};
+        if (localhost) {
+            strncpy(ep_ab.address, "127.0.0.1", sizeof(ep_ab.address));
+            ep_ab.flags = EP_FLAG_TRUSTED | EP_FLAG_OUTBOUND;
+        } else {
+            strncpy(ep_ab.address, "10.0.0.2", sizeof(ep_ab.address));
+            ep_ab.flags = EP_FLAG_OUTBOUND;
+        }
+        ep_ab.port = 9999;
+
+        endpoint_t ep_ba{};
+        if (localhost) {
+            strncpy(ep_ba.address, "127.0.0.1", sizeof(ep_ba.address));
+            ep_ba.flags = EP_FLAG_TRUSTED;
+        } else {
+            strncpy(ep_ba.address, "10.0.0.1", sizeof(ep_ba.address));
+        }
+        ep_ba.port = 9998;
+
+        // A connects (outbound) — sends NOISE_INIT automatically
+        g_cap_sink = &sink;
+        conn_id_t cid_a = api_a.on_connect(api_a.ctx, &ep_ab);
+
+        // B connects (inbound) — no automatic send
+        conn_id_t cid_b = api_b.on_connect(api_b.ctx, &ep_ba);
+
+        // Helper: find and extract a captured frame by msg_type, remove it from sink
+        auto extract_frame = [&](uint16_t msg_type) -> std::vector<uint8_t> {
+            std::lock_guard lk(sink.mu);
+            for (auto it = sink.frames.begin(); it != sink.frames.end(); ++it) {
+                if (it->data.size() < sizeof(header_t)) continue;
+                auto* hdr = reinterpret_cast<const header_t*>(it->data.data());
+                if (hdr->payload_type == msg_type) {
+                    auto data = std::move(it->data);
+                    sink.frames.erase(it);
+                    return data;
+                }
+            }
+            return {};
+        };
+
+        // Resumption: A already knows B at this address → 1-RTT Noise_IK.
+        // An empty RESUME_RESP is B's refusal — A then restarts with NOISE_INIT.
+        auto resume_frame = extract_frame(MSG_TYPE_NOISE_RESUME);
+        if (!resume_frame.empty()) {
+            api_b.on_data(api_b.ctx, cid_b, resume_frame.data(), resume_frame.size());
+            auto rr_frame = extract_frame(MSG_TYPE_NOISE_RESUME_RESP);
+            EXPECT_FALSE(rr_frame.empty()) << "B did not answer NOISE_RESUME";
+            if (!rr_frame.empty())
+                api_a.on_data(api_a.ctx, cid_a, rr_frame.data(), rr_frame.size());
+            // B stays pending until a frame decrypts under the new keys —
+            // A's heartbeat right after finalize is that confirmation
+            auto hb_frame = extract_frame(MSG_TYPE_HEARTBEAT);
+            if (!hb_frame.empty())
+                api_b.on_data(api_b.ctx, cid_b, hb_frame.data(), hb_frame.size());
+        }
+
+        // Step 1: A sent NOISE_INIT → feed to B
+        auto init_frame = extract_frame(MSG_TYPE_NOISE_INIT);
+        if (!resume_frame.empty() && init_frame.empty()) {
+            cm_a.register_connector("tcp", &mock_ops_);
+            cm_b.register_connector("tcp", &mock_ops_);
+            g_cap_sink = nullptr;
+            return {cid_a, cid_b};
+        }
+        EXPECT_FALSE(init_frame.empty()) << "A did not send NOISE_INIT";
+        if (!init_frame.empty())
+            api_b.on_data(api_b.ctx, cid_b, init_frame.data(), init_frame.size());
+
+        // Step 2: B sent NOISE_RESP → feed to A
+        auto resp_frame = extract_frame(MSG_TYPE_NOISE_RESP);
+        EXPECT_FALSE(resp_frame.empty()) << "B did not send NOISE_RESP";
+        if (!resp_frame.empty())
+            api_a.on_data(api_a.ctx, cid_a, resp_frame.data(), resp_frame.size());
+
+        // Step 3: A sent NOISE_FIN (triggered by processing RESP) → feed to B
+        auto fin_frame = extract_frame(MSG_TYPE_NOISE_FIN);
+        EXPECT_FALSE(fin_frame.empty()) << "A did not send NOISE_FIN";
+        if (!fin_frame.empty())
+            api_b.on_data(api_b.ctx, cid_b, fin_frame.data(), fin_frame.size());
+
+        // Re-register the non-capturing mock for subsequent operations
+        cm_a.register_connector("tcp", &mock_ops_);
+        cm_b.register_connector("tcp", &mock_ops_);
+        g_cap_sink = nullptr;
+
+        return {cid_a, cid_b};
+    }
+};
+
+// ─── Fake peers ───────────────────────────────────────────────────────────────
+
+/// Зарегистрировать @p n ESTABLISHED пиров со случайными ключами (send == recv,
+/// чтобы кадр расшифровывался той же сессией) поверх коннектора "tcp".
+inline std::vector<conn_id_t> add_fake_peers(ConnectionManager::Impl& im, size_t n,
+                                             conn_id_t base) {
+    std::vector<conn_id_t> ids;
+    std::lock_guard wlk(im.records_write_mu_);
+    im.rcu_update([&](ConnectionManager::Impl::RecordMap& m) {
+        for (size_t i = 0; i < n; ++i) {
+            auto rec = std::make_shared<ConnectionRecord>();
+            rec->id           = base + i;
+            rec->state        = STATE_ESTABLISHED;
+            rec->local_scheme = "tcp";
+            rec->send_packet_id.store(1);   // nonce 0 ушёл бы на handshake
+            rec->session      = std::make_unique<NoiseSession>();
+            randombytes_buf(rec->session->send_key, sizeof(rec->session->send_key));
+            std::memcpy(rec->session->recv_key, rec->session->send_key,
+                        sizeof(rec->session->recv_key));
+            m[rec->id] = std::move(rec);
+            ids.push_back(base + i);
+        }
+    });
+    return ids;
+}
@@ -23,6 +23,7 @@ TEST(ConfigTest, DefaultsPopulatedOnConstruction) {
     EXPECT_EQ(cfg.core.listen_port, 25565);
     EXPECT_EQ(cfg.core.io_threads, 0);
     EXPECT_EQ(cfg.core.max_connections, 1000);
+    EXPECT_EQ(cfg.core.flush_delay_us, 0);
     // Logging
     EXPECT_EQ(cfg.logging.level, "info");
     EXPECT_TRUE(cfg.logging.file.empty());
@@ -135,7 +136,7 @@ TEST(ConfigTest, LoadBoolValue) {
 
 TEST(ConfigTest, LoadAllSections) {
     auto p = tmp_config(R"({
-        "core": {"listen_address":"10.0.0.1","listen_port":8080,"io_threads":4,"max_connections":500},
+        "core": {"listen_address":"10.0.0.1","listen_port":8080,"io_threads":4,"max_connections":500,"flush_delay_us":250},
         "logging": {"level":"warn","file":"/var/log/gn.log","max_size":5242880,"max_files":3},
         "security": {"key_exchange_timeout":60,"max_auth_attempts":5,"session_timeout":7200},
         "compression": {"enabled":false,"threshold":1024,"level":3},
@@ -150,6 +151,7 @@ TEST(ConfigTest, LoadAllSections) {
     EXPECT_EQ(cfg.core.listen_port, 8080);
     EXPECT_EQ(cfg.core.io_threads, 4);
     EXPECT_EQ(cfg.core.max_connections, 500);
+    EXPECT_EQ(cfg.core.flush_delay_us, 250);
 
     EXPECT_EQ(cfg.logging.level, "warn");
     EXPECT_EQ(cfg.logging.file, "/var/log/gn.log");
@@ -1,15 +1,22 @@
 #include <sodium.h>
 #include <gtest/gtest.h>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <numeric>
+#include <random>
 #include <thread>
 #include <chrono>
 #include <boost/asio.hpp>
 
 #include <nlohmann/json.hpp>
+#include <zstd.h>
 
 #include "test_helpers.hpp"
+#include "cm_fixture.hpp"
 #include "cm/connectionManager.hpp"
 #include "cm/impl.hpp"
 #include "signals.hpp"
@@ -17,130 +24,10 @@
 #include "data/messages.hpp"
 
 #include "../sdk/handler.h"
+#include "../sdk/cpp/connector.hpp"
 
 using namespace gn;
 
-// ─── Fixture ──────────────────────────────────────────────────────────────────
-
-class CMTest : public ::testing::Test {
-protected:
-    boost::asio::io_context  ioc_;
-    SignalBus                bus_{ioc_};
-    fs::path                 dir_a_ = tmp_dir("a");
-    fs::path                 dir_b_ = tmp_dir("b");
-    NodeIdentity             id_a_  = NodeIdentity::load_or_generate(dir_a_);
-    NodeIdentity             id_b_  = NodeIdentity::load_or_generate(dir_b_);
-    std::unique_ptr<ConnectionManager> cm_a_;
-    std::unique_ptr<ConnectionManager> cm_b_;
-    connector_ops_t          mock_ops_  = make_mock_connector_ops();
-
-    void SetUp() override {
-        cm_a_ = std::make_unique<ConnectionManager>(bus_, id_a_);
-        cm_b_ = std::make_unique<ConnectionManager>(bus_, id_b_);
-    }
-
-    void TearDown() override {
-        if (cm_a_) cm_a_->shutdown();
-        if (cm_b_) cm_b_->shutdown();
-        fs::remove_all(dir_a_);
-        fs::remove_all(dir_b_);
-    }
-
-    host_api_t make_api(ConnectionManager& cm) {
-        host_api_t api{};
-        cm.fill_host_api(&api);
-        cm.register_connector("tcp", &mock_ops_);
-        return api;
-    }
-
-    // Wrappers for Impl access (CMTest is friend of ConnectionManager)
-    ConnectionManager::Impl& impl(ConnectionManager& cm) { return *cm.impl_; }
-    const ConnectionManager::Impl& impl(const ConnectionManager& cm) const { return *cm.impl_; }
-
-    /// Simulate full Noise_XX handshake between two CMs.
-    /// Uses a single capturing connector to intercept all wire frames.
-    std::pair<conn_id_t, conn_id_t> do_handshake(
-        ConnectionManager& cm_a, const NodeIdentity&,
-        ConnectionManager& cm_b, const NodeIdentity&,
-        bool localhost = false)
-    {
-        CapturingSink sink;
-        auto cap_ops = make_capturing_connector(&sink);
-
-        host_api_t api_a{}, api_b{};
-        cm_a.fill_host_api(&api_a);
-        cm_b.fill_host_api(&api_b);
-        cm_a.register_connector("tcp", &cap_ops);
-        cm_b.register_connector("tcp", &cap_ops);
-
-        endpoint_t ep_ab{};
-        if (localhost) {
-            strncpy(ep_ab.address, "127.0.0.1", sizeof(ep_ab.address));
-            ep_ab.flags = EP_FLAG_TRUSTED | EP_FLAG_OUTBOUND;
-        } else {
-            strncpy(ep_ab.address, "10.0.0.2", sizeof(ep_ab.address));
-            ep_ab.flags = EP_FLAG_OUTBOUND;
-        }
-        ep_ab.port = 9999;
-
-        endpoint_t ep_ba{};
-        if (localhost) {
-            strncpy(ep_ba.address, "127.0.0.1", sizeof(ep_ba.address));
-            ep_ba.flags = EP_FLAG_TRUSTED;
-        } else {
-            strncpy(ep_ba.address, "10.0.0.1", sizeof(ep_ba.address));
-        }
-        ep_ba.port = 9998;
-
-        // A connects (outbound) — sends NOISE_INIT automatically
-        g_cap_sink = &sink;
-        conn_id_t cid_a = api_a.on_connect(api_a.ctx, &ep_ab);
-
-        // B connects (inbound) — no automatic send
-        conn_id_t cid_b = api_b.on_connect(api_b.ctx, &ep_ba);
-
-        // Helper: find and extract a captured frame by msg_type, remove it from sink
-        auto extract_frame = [&](uint16_t msg_type) -> std::vector<uint8_t> {
-            std::lock_guard lk(sink.mu);
-            for (auto it = sink.frames.begin(); it != sink.frames.end(); ++it) {
-                if (it->data.size() < sizeof(header_t)) continue;
-                auto* hdr = reinterpret_cast<const header_t*>(it->data.data());
-                if (hdr->payload_type == msg_type) {
-                    auto data = std::move(it->data);
-                    sink.frames.erase(it);
-                    return data;
-                }
-            }
-            return {};
-        };
-
-        // Step 1: A sent NOISE_INIT → feed to B
-        auto init_frame = extract_frame(MSG_TYPE_NOISE_INIT);
-        EXPECT_FALSE(init_frame.empty()) << "A did not send NOISE_INIT";
-        if (!init_frame.empty())
-            api_b.on_data(api_b.ctx, cid_b, init_frame.data(), init_frame.size());
-
-        // Step 2: B sent NOISE_RESP → feed to A
-        auto resp_frame = extract_frame(MSG_TYPE_NOISE_RESP);
-        EXPECT_FALSE(resp_frame.empty()) << "B did not send NOISE_RESP";
-        if (!resp_frame.empty())
-            api_a.on_data(api_a.ctx, cid_a, resp_frame.data(), resp_frame.size());
-
-        // Step 3: A sent NOISE_FIN (triggered by processing RESP) → feed to B
-        auto fin_frame = extract_frame(MSG_TYPE_NOISE_FIN);
-        EXPECT_FALSE(fin_frame.empty()) << "A did not send NOISE_FIN";
-        if (!fin_frame.empty())
-            api_b.on_data(api_b.ctx, cid_b, fin_frame.data(), fin_frame.size());
-
-        // Re-register the non-capturing mock for subsequent operations
-        cm_a.register_connector("tcp", &mock_ops_);
-        cm_b.register_connector("tcp", &mock_ops_);
-        g_cap_sink = nullptr;
-
-        return {cid_a, cid_b};
-    }
-};
-
 // ═══════════════════════════════════════════════════════════════════════════════
 // SECTION 1: NodeIdentity / cm_identity.cpp
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -1827,3 +1714,2923 @@ TEST_F(CMTest, HostApi_LogTrampoline) {
     // Вызов log через API — не крашится
     EXPECT_NO_THROW(api.log(api.ctx, 2, __FILE__, __LINE__, "test log message"));
 }
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SECTION: build_frame — single-allocation encrypt-in-place
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST(SessionTest, EncryptInto_PreservesPrefixAndRoundTrips) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    NoiseSession s;
+    randombytes_buf(s.send_key, sizeof(s.send_key));
+    std::memcpy(s.recv_key, s.send_key, sizeof(s.recv_key));
+
+    std::vector<uint8_t> plain(4096);
+    for (size_t i = 0; i < plain.size(); ++i) plain[i] = static_cast<uint8_t>(i % 13);
+
+    const size_t cap = NoiseSession::max_wire_size(plain.size(), true, 512);
+    std::vector<uint8_t> out(sizeof(header_t) + cap, 0x5A);
+    const size_t clen = s.encrypt_into(out.data() + sizeof(header_t), cap,
+                                       plain.data(), plain.size(), 7, true, 512, 1);
+    ASSERT_LE(clen, cap);
+    for (size_t i = 0; i < sizeof(header_t); ++i)
+        ASSERT_EQ(out[i], 0x5A) << "prefix byte " << i;
+
+    auto result = s.decrypt(out.data() + sizeof(header_t), clen, 7);
+    EXPECT_EQ(result, plain);
+}
+
+TEST_F(CMTest, BuildFrame_EncryptedDecryptsOnPeer) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    ASSERT_EQ(*cm_a_->get_state(cid_a), STATE_ESTABLISHED);
+
+    for (size_t sz : {size_t{0}, size_t{100}, size_t{4096}, size_t{70000}}) {
+        std::vector<uint8_t> payload(sz);
+        for (size_t i = 0; i < sz; ++i) payload[i] = static_cast<uint8_t>(i * 7);
+
+        auto frame = impl(*cm_a_).build_frame(cid_a, MSG_TYPE_CHAT, payload);
+        ASSERT_GE(frame.size(), sizeof(header_t));
+        header_t hdr{};
+        std::memcpy(&hdr, frame.data(), sizeof(hdr));
+        EXPECT_EQ(hdr.magic, GNET_MAGIC);
+        EXPECT_EQ(hdr.payload_type, MSG_TYPE_CHAT);
+        ASSERT_EQ(hdr.payload_len, frame.size() - sizeof(header_t));
+
+        auto rec_b = impl(*cm_b_).rcu_find(cid_b);
+        ASSERT_TRUE(rec_b && rec_b->session);
+        auto plain = rec_b->session->decrypt(frame.data() + sizeof(header_t),
+                                             hdr.payload_len, hdr.packet_id);
+        EXPECT_EQ(plain, payload) << "size " << sz;
+    }
+}
+
+// ─── send_owned (v2 zero-copy ABI) ────────────────────────────────────────────
+
+TEST_F(CMTest, SendOwned_ConnectorReceivesAndReleasesEveryBuffer) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+
+    const uint64_t before = sdk::BufferPool::instance().misses();
+    std::vector<uint8_t> payload(4096, 0x5A);
+    for (int i = 0; i < 32; ++i)
+        ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, payload));
+
+    EXPECT_EQ(sink.buffers, 32u);
+    EXPECT_EQ(sink.held.size(), 32u);
+    for (auto& b : sink.held) {
+        ASSERT_GE(b.size, sizeof(header_t));
+        header_t hdr{};
+        std::memcpy(&hdr, b.data, sizeof(hdr));
+        EXPECT_EQ(hdr.magic, GNET_MAGIC);
+        EXPECT_EQ(hdr.payload_len, b.size - sizeof(header_t));
+    }
+    sink.release_all();
+
+    // Освобождённые коннектором блоки вернулись в пул и переиспользуются
+    const uint64_t mid = sdk::BufferPool::instance().misses();
+    for (int i = 0; i < 32; ++i)
+        ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, payload));
+    sink.release_all();
+    EXPECT_LE(sdk::BufferPool::instance().misses() - mid, mid - before);
+
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+TEST_F(CMTest, SendOwned_ErrorStillTransfersOwnership) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    sink.rc = -1;
+    auto ops = make_owned_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+
+    std::vector<uint8_t> payload(1024, 0x11);
+    for (int i = 0; i < 8; ++i)
+        cm_a_->send(cid_a, MSG_TYPE_CHAT, payload);
+
+    // Коннектор отпустил всё сам; ядро не держит и не освобождает повторно
+    EXPECT_GE(sink.buffers, 1u);
+    EXPECT_TRUE(sink.held.empty());
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+TEST(OwnedBufferTest, FromFrameBufferReleasesOnDestruction) {
+    sdk::FrameBuffer fb = sdk::FrameBuffer::copy_of(std::vector<uint8_t>(300, 7));
+    sdk::FrameBuffer probe = fb;
+    EXPECT_EQ(probe.use_count(), 2u);
+    {
+        auto ob = sdk::OwnedBuffer::from(std::move(fb));
+        EXPECT_EQ(ob.size(), 300u);
+        EXPECT_EQ(ob.data(), probe.data());
+        auto moved = std::move(ob);
+        EXPECT_EQ(probe.use_count(), 2u);
+    }
+    EXPECT_EQ(probe.use_count(), 1u);
+}
+
+TEST_F(CMTest, SendOwned_NoCopiesPerByte) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+
+    constexpr int    N    = 16;
+    constexpr size_t SIZE = 64 * 1024;
+    std::vector<uint8_t> payload(SIZE);
+    randombytes_buf(payload.data(), payload.size());   // несжимаемые
+
+    auto run = [&](connector_ops_t& ops, OwnedSink& sink) {
+        cm_a_->register_connector("tcp", &ops);
+        for (int i = 0; i < N; ++i) {
+            cm_a_->send(cid_a, MSG_TYPE_CHAT, payload);
+            sink.release_all();          // «запись завершилась»
+        }
+    };
+
+    OwnedSink gather_sink, owned_sink;
+    auto gather_ops = make_copying_gather_ops(&gather_sink);
+    auto owned_ops  = make_owned_ops(&owned_sink);
+    run(gather_ops, gather_sink);
+    run(owned_ops,  owned_sink);
+    cm_a_->register_connector("tcp", &mock_ops_);
+
+    // gather: коннектор копирует каждый байт; send_owned — ни одного
+    EXPECT_EQ(owned_sink.copied, 0u);
+    EXPECT_GT(owned_sink.bytes, 0u);
+    EXPECT_EQ(gather_sink.copied, gather_sink.bytes);
+    EXPECT_GT(gather_sink.bytes, 0u);
+}
+
+// ─── Async flush scheduler ────────────────────────────────────────────────────
+
+TEST_F(CMTest, FlushExecutor_SendDoesNotWriteInline) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_copying_gather_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    const auto before = bus_.stats_snapshot();
+    std::vector<uint8_t> payload(256, 0x33);
+    for (int i = 0; i < 10; ++i)
+        ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, payload));
+
+    EXPECT_EQ(sink.buffers, 0u) << "connector called on the sender thread";
+    EXPECT_GT(cm_a_->get_pending_bytes(cid_a), 0u);
+
+    ioc_.poll();
+
+    // Одна задача, один send_gather со всеми десятью кадрами
+    EXPECT_EQ(sink.calls, 1u);
+    EXPECT_EQ(sink.buffers, 10u);
+    EXPECT_EQ(cm_a_->get_pending_bytes(cid_a), 0u);
+
+    const auto after = bus_.stats_snapshot();
+    EXPECT_EQ(after.flushes - before.flushes, 1u);
+    EXPECT_EQ(after.flush_frames - before.flush_frames, 10u);
+
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+TEST_F(CMTest, FlushExecutor_DelayCoalescesUntilTimer) {
+    Config cfg(true);
+    cfg.core.flush_delay_us = 20'000;
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+
+    OwnedSink sink;
+    auto ops = make_copying_gather_ops(&sink);
+    cm->register_connector("tcp", &ops);
+    cm->set_flush_executor(&ioc_);
+
+    std::vector<uint8_t> payload(128, 0x44);
+    ASSERT_TRUE(cm->send(cid_a, MSG_TYPE_CHAT, payload));
+    ioc_.poll();
+    EXPECT_EQ(sink.buffers, 0u) << "flushed before the coalescing delay";
+
+    for (int i = 0; i < 4; ++i)
+        ASSERT_TRUE(cm->send(cid_a, MSG_TYPE_CHAT, payload));
+
+    for (int spins = 0; spins < 200 && sink.buffers < 5; ++spins) {
+        ioc_.run_for(std::chrono::milliseconds(5));
+        ioc_.restart();
+    }
+    EXPECT_EQ(sink.calls, 1u);
+    EXPECT_EQ(sink.buffers, 5u);
+
+    cm->shutdown();
+}
+
+TEST_F(CMTest, FlushExecutor_ShutdownDrainsPendingFrames) {
+    Config cfg(true);
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+
+    OwnedSink sink;
+    auto ops = make_copying_gather_ops(&sink);
+    cm->register_connector("tcp", &ops);
+    cm->set_flush_executor(&ioc_);
+
+    // Задачи flush стоят в io_context, который уже никто не запустит
+    std::vector<uint8_t> payload(128, 0x55);
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(cm->send(cid_a, MSG_TYPE_CHAT, payload));
+    EXPECT_EQ(sink.buffers, 0u);
+
+    cm->shutdown();
+    EXPECT_EQ(sink.buffers, 3u) << "frames sent just before shutdown were lost";
+    EXPECT_EQ(cm->get_pending_bytes(cid_a), 0u);
+
+    ioc_.poll();   // отложенная задача после shutdown — no-op
+    EXPECT_EQ(sink.buffers, 3u);
+}
+
+TEST_F(CMTest, FlushExecutor_ConcurrentSendersDeliverEveryFrame) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    constexpr int THREADS = 4, PER_THREAD = 500;
+    std::vector<uint8_t> payload(1024);
+    randombytes_buf(payload.data(), payload.size());
+
+    const auto before = bus_.stats_snapshot();
+    auto work = boost::asio::make_work_guard(ioc_);
+    std::thread io([&] { ioc_.run(); });
+
+    std::vector<std::thread> senders;
+    for (int t = 0; t < THREADS; ++t)
+        senders.emplace_back([&] {
+            for (int i = 0; i < PER_THREAD; ++i)
+                while (!cm_a_->send(cid_a, MSG_TYPE_CHAT, payload))
+                    std::this_thread::yield();
+        });
+    for (auto& s : senders) s.join();
+    while (cm_a_->get_pending_bytes(cid_a) > 0) std::this_thread::yield();
+
+    work.reset();
+    ioc_.stop();
+    io.join();
+    ioc_.restart();
+
+    const auto after = bus_.stats_snapshot();
+    const uint64_t frames = after.flush_frames - before.flush_frames;
+    EXPECT_GT(after.flushes, before.flushes);
+    EXPECT_EQ(frames, uint64_t(THREADS) * PER_THREAD);
+    EXPECT_EQ(sink.buffers, size_t(THREADS) * PER_THREAD);
+    sink.release_all();
+
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+// ─── Credit-based flow control ────────────────────────────────────────────────
+
+TEST_F(CMTest, SendWindow_UnknownConnIsZero) {
+    EXPECT_EQ(cm_a_->send_window(424242), 0u);
+}
+
+TEST_F(CMTest, SendWindow_NonReportingConnectorFreesOnHandOff) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    EXPECT_EQ(cm_a_->send_window(cid_a), PerConnQueue::MAX_BYTES);
+
+    std::vector<uint8_t> payload(64 * 1024, 0x21);
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, payload));
+    // mock без CONNECTOR_FLAG_REPORTS_SENT: inline flush → окно снова полное
+    EXPECT_EQ(cm_a_->send_window(cid_a), PerConnQueue::MAX_BYTES);
+}
+
+TEST_F(CMTest, SendWindow_CreditsAndOnWritable) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    ops.flags = CONNECTOR_FLAG_REPORTS_SENT;
+    cm_a_->register_connector("tcp", &ops);
+
+    std::atomic<int> writable{0};
+    bus_.on_writable.connect([&](conn_id_t id) { if (id == cid_a) writable++; });
+
+    std::vector<uint8_t> payload(64 * 1024);
+    randombytes_buf(payload.data(), payload.size());
+
+    // Коннектор держит всё у себя — окно заканчивается, send() отказывает
+    int sent = 0;
+    while (cm_a_->send(cid_a, MSG_TYPE_CHAT, payload)) ++sent;
+    EXPECT_GT(sent, 0);
+    EXPECT_LT(cm_a_->send_window(cid_a), payload.size());
+    EXPECT_EQ(cm_a_->get_pending_bytes(cid_a), 0u) << "bytes are at the connector, not queued";
+
+    ioc_.restart(); ioc_.poll();
+    EXPECT_EQ(writable.load(), 0);
+
+    host_api_t api{};
+    cm_a_->fill_host_api(&api);
+    ASSERT_NE(api.on_sent, nullptr);
+
+    // Возвращаем кредит порциями: сигнал только после low-water mark, один раз
+    size_t total = 0;
+    for (auto& b : sink.held) total += b.size;
+    api.on_sent(api.ctx, cid_a, total / 4);
+    ioc_.restart(); ioc_.poll();
+    EXPECT_EQ(writable.load(), 0);
+
+    api.on_sent(api.ctx, cid_a, total - total / 4);
+    api.on_sent(api.ctx, cid_a, 1000);   // лишний кредит не уводит окно за лимит
+    ioc_.restart(); ioc_.poll();
+    EXPECT_EQ(writable.load(), 1);
+    EXPECT_EQ(cm_a_->send_window(cid_a), PerConnQueue::MAX_BYTES);
+    EXPECT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, payload));
+
+    sink.release_all();
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+TEST_F(CMTest, SendWindow_ConnectorErrorReturnsCredit) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    sink.rc = -1;
+    auto ops = make_owned_ops(&sink);
+    ops.flags = CONNECTOR_FLAG_REPORTS_SENT;
+    cm_a_->register_connector("tcp", &ops);
+
+    std::vector<uint8_t> payload(4096, 0x55);
+    cm_a_->send(cid_a, MSG_TYPE_CHAT, payload);
+    // Отказ коннектора: он не пришлёт on_sent(), ядро возвращает кредит само
+    EXPECT_EQ(cm_a_->send_window(cid_a), PerConnQueue::MAX_BYTES);
+
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// QoS send classes
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST_F(CMTest, SendClass_DefaultMappingAndOverride) {
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_NOISE_INIT),       SendClass::Control);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_HEARTBEAT),        SendClass::Control);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_SYS_HEALTH_PING),  SendClass::Control);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_RELAY),            SendClass::Relay);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_FILE),             SendClass::Bulk);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_SYS_STORE_SYNC),   SendClass::Bulk);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_CHAT),             SendClass::Interactive);
+
+    cm_a_->set_send_class(MSG_TYPE_CHAT, SendClass::Bulk);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_CHAT), SendClass::Bulk);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_FILE), SendClass::Bulk);
+    cm_a_->set_send_class(MSG_TYPE_CHAT, SendClass::Auto);
+    EXPECT_EQ(cm_a_->send_class_of(MSG_TYPE_CHAT), SendClass::Interactive);
+}
+
+TEST_F(CMTest, SendClass_ControlOvertakesQueuedBulk) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    const auto depth = [&](SendClass c) {
+        return bus_.stats_snapshot().queue_depth[static_cast<size_t>(c)];
+    };
+    const uint64_t bulk0 = depth(SendClass::Bulk);
+    const uint64_t ctl0  = depth(SendClass::Control);
+
+    std::vector<uint8_t> payload(1024, 0x66);
+    for (int i = 0; i < 20; ++i)
+        ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_FILE, payload));
+    // Класс на вызов: CHAT, но как control
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, payload, SendClass::Control));
+
+    EXPECT_EQ(depth(SendClass::Bulk) - bulk0, 20u);
+    EXPECT_EQ(depth(SendClass::Control) - ctl0, 1u);
+
+    ioc_.restart();
+    ioc_.poll();
+
+    ASSERT_EQ(sink.held.size(), 21u);
+    auto type_of = [](const owned_buf_t& b) {
+        return static_cast<const header_t*>(b.data)->payload_type;
+    };
+    EXPECT_EQ(type_of(sink.held.front()), MSG_TYPE_CHAT);
+    EXPECT_EQ(type_of(sink.held.back()),  MSG_TYPE_FILE);
+    EXPECT_EQ(depth(SendClass::Bulk),    bulk0);
+    EXPECT_EQ(depth(SendClass::Control), ctl0);
+
+    sink.release_all();
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+TEST_F(CMTest, SendClass_ControlNotRejectedByFullWindow) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    ops.flags = CONNECTOR_FLAG_REPORTS_SENT;   // окно держится до on_sent()
+    cm_a_->register_connector("tcp", &ops);
+
+    // Несжимаемый payload — иначе zstd ужмёт кадр и окно не закроется
+    std::vector<uint8_t> chunk(1024 * 1024);
+    randombytes_buf(chunk.data(), chunk.size());
+    int sent = 0;
+    while (cm_a_->send(cid_a, MSG_TYPE_FILE, chunk)) ASSERT_LT(++sent, 16);
+    EXPECT_FALSE(cm_a_->send(cid_a, MSG_TYPE_CHAT, chunk));
+    EXPECT_TRUE (cm_a_->send(cid_a, MSG_TYPE_CHAT, chunk, SendClass::Control));
+
+    sink.release_all();
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+// packet_id назначается при постановке в очередь: взвешенный drain не должен
+// увести bulk-кадр за окно replay приёмника
+TEST_F(CMTest, SendClass_BulkBehindInteractiveStaysInReplayWindow) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    size_t got_bulk = 0, got_chat = 0;
+    bus_.subscribe(MSG_TYPE_FILE, "bulk_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++got_bulk;
+            return PROPAGATION_CONSUMED;
+        });
+    bus_.subscribe(MSG_TYPE_CHAT, "chat_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++got_chat;
+            return PROPAGATION_CONSUMED;
+        });
+
+    const std::vector<uint8_t> msg(32, 0x77);
+    auto deliver = [&](std::vector<sdk::FrameBuffer> batch) {
+        for (auto& f : batch) im_b.handle_data(cid_b, f.data(), f.size());
+    };
+
+    // Полное кольцо Bulk, за ним — непрерывный interactive-трафик
+    PerConnQueue q;
+    size_t bulk = 0, chat = 0;
+    while (q.try_push(im_a.build_frame(cid_a, MSG_TYPE_FILE, msg), SendClass::Bulk)) ++bulk;
+    ASSERT_EQ(bulk, PerConnQueue::MAX_FRAMES);
+
+    const size_t round = PerConnQueue::DRAIN_WEIGHT[1] + PerConnQueue::DRAIN_WEIGHT[2];
+    ASSERT_TRUE(q.try_begin_drain());
+    while (q.depth(SendClass::Bulk) > 0) {
+        for (uint32_t i = 0; i < PerConnQueue::DRAIN_WEIGHT[1]; ++i, ++chat)
+            ASSERT_TRUE(q.try_push(im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg),
+                                   SendClass::Interactive));
+        deliver(q.pop_batch(round));
+        ASSERT_LT(chat, 16 * bulk);
+    }
+    const size_t chat_during_bulk = got_chat;
+    deliver(q.pop_batch(PerConnQueue::MAX_FRAMES));
+    q.end_drain();
+
+    EXPECT_EQ(got_bulk, bulk) << "bulk frames fell out of the replay window";
+    EXPECT_GT(bulk + chat, NonceWindow::WINDOW_SIZE) << "packet_ids span more than a window";
+    EXPECT_GT(chat_during_bulk, 0u) << "interactive starved by the bulk backlog";
+    EXPECT_EQ(got_chat, chat);
+}
+
+// Отправитель не знает окна приёмника: replay_window ниже минимума поднимается
+// до MIN_CONFIG_WINDOW, и это окно вмещает обгон в пределах MAX_REORDER
+TEST_F(CMTest, SendClass_ReorderFitsReplayWindowFloor) {
+    Config cfg(true);
+    cfg.security.replay_window = 32;   // ниже минимума → MIN_CONFIG_WINDOW
+    auto cm_b = std::make_unique<ConnectionManager>(bus_, id_b_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b);
+    ASSERT_EQ(im_b.rcu_find(cid_b)->session->recv_window.window(),
+              NonceWindow::MIN_CONFIG_WINDOW);
+
+    const auto drops = [&] {
+        // Отказ NonceWindow dispatch_packet сообщает как DecryptFail
+        return bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::DecryptFail)];
+    };
+    const uint64_t drops0 = drops();
+    size_t got_bulk = 0, got_chat = 0;
+    bus_.subscribe(MSG_TYPE_FILE, "bulk_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++got_bulk;
+            return PROPAGATION_CONSUMED;
+        });
+    bus_.subscribe(MSG_TYPE_CHAT, "chat_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++got_chat;
+            return PROPAGATION_CONSUMED;
+        });
+
+    // Bulk и interactive вперемешку: interactive обгоняет bulk на сотни packet_id
+    const std::vector<uint8_t> msg(32, 0x3C);
+    PerConnQueue q;
+    size_t bulk = 0, chat = 0;
+    ASSERT_TRUE(q.try_begin_drain());
+    for (int round = 0; round < 64; ++round) {
+        for (int i = 0; i < 16; ++i, ++bulk)
+            ASSERT_TRUE(q.try_push(im_a.build_frame(cid_a, MSG_TYPE_FILE, msg), SendClass::Bulk));
+        for (int i = 0; i < 16; ++i, ++chat)
+            ASSERT_TRUE(q.try_push(im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg),
+                                   SendClass::Interactive));
+        for (auto& f : q.pop_batch(8)) im_b.handle_data(cid_b, f.data(), f.size());
+    }
+    for (auto& f : q.pop_batch(PerConnQueue::MAX_FRAMES * PerConnQueue::NUM_CLASSES))
+        im_b.handle_data(cid_b, f.data(), f.size());
+    q.end_drain();
+
+    EXPECT_EQ(got_bulk, bulk) << "bulk frames fell out of the floor replay window";
+    EXPECT_EQ(got_chat, chat);
+    EXPECT_EQ(drops(), drops0);
+    cm_b->shutdown();
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Fragmentation / reassembly
+// ═══════════════════════════════════════════════════════════════════════════════
+
+namespace {
+
+/// Отправить @p payload и вернуть перехваченные кадры; затем вернуть @p restore.
+std::vector<CapturedFrame> capture_send(ConnectionManager& cm, conn_id_t cid,
+                                        uint32_t type, std::span<const uint8_t> payload,
+                                        connector_ops_t& restore) {
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm.register_connector("tcp", &ops);
+    EXPECT_TRUE(cm.send(cid, type, payload));
+    cm.register_connector("tcp", &restore);
+    g_cap_sink = nullptr;
+    std::lock_guard lk(sink.mu);
+    return std::move(sink.frames);
+}
+
+frag_hdr_t make_frag(uint32_t msg_id, uint64_t offset, uint64_t total, bool last = false) {
+    frag_hdr_t fh{};
+    fh.msg_id    = msg_id;
+    fh.offset    = offset;
+    fh.total_len = total;
+    fh.flags     = last ? FRAG_FLAG_LAST : 0;
+    return fh;
+}
+
+} // namespace
+
+TEST_F(CMTest, Fragment_ReassemblesOutOfOrderOnPeer) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    std::vector<uint8_t> payload(5 * 1024 * 1024 + 123);
+    randombytes_buf(payload.data(), payload.size());
+
+    auto frames = capture_send(*cm_a_, cid_a, MSG_TYPE_FILE, payload, mock_ops_);
+    ASSERT_EQ(frames.size(), 6u);
+    for (auto& f : frames) {
+        auto* h = reinterpret_cast<const header_t*>(f.data.data());
+        EXPECT_NE(h->flags & GNET_FLAG_FRAGMENT, 0);
+        EXPECT_EQ(h->payload_type, MSG_TYPE_FILE);
+    }
+
+    std::vector<std::vector<uint8_t>> got;
+    uint8_t got_flags = 0xFF;
+    bus_.subscribe(MSG_TYPE_FILE, "frag_sink",
+        [&](std::string_view, const header_t& h, const endpoint_t*, const PacketData& d) {
+            got.push_back(*d);
+            got_flags = h.flags;
+            return PROPAGATION_CONSUMED;
+        });
+
+    host_api_t api_b{};
+    cm_b_->fill_host_api(&api_b);
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+        api_b.on_data(api_b.ctx, cid_b, it->data.data(), it->data.size());
+
+    ASSERT_EQ(got.size(), 1u) << "handlers see one message, not raw chunks";
+    EXPECT_EQ(got[0], payload);
+    EXPECT_EQ(got_flags & GNET_FLAG_FRAGMENT, 0);
+    EXPECT_EQ(impl(*cm_b_).rcu_find(cid_b)->reassembly.reserved_bytes(), 0u);
+}
+
+TEST_F(CMTest, Fragment_StreamingDeliversEachFragment) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    std::vector<uint8_t> payload(3 * 1024 * 1024);
+    randombytes_buf(payload.data(), payload.size());
+    cm_b_->set_fragment_streaming(MSG_TYPE_FILE, true);
+
+    auto frames = capture_send(*cm_a_, cid_a, MSG_TYPE_FILE, payload, mock_ops_);
+    ASSERT_EQ(frames.size(), 3u);
+
+    std::vector<uint8_t> rebuilt(payload.size());
+    size_t fragments = 0, bytes = 0;
+    bool   saw_last = false;
+    bus_.subscribe(MSG_TYPE_FILE, "frag_stream",
+        [&](std::string_view, const header_t& h, const endpoint_t*, const PacketData& d) {
+            EXPECT_NE(h.flags & GNET_FLAG_FRAGMENT, 0);
+            frag_hdr_t fh;
+            std::memcpy(&fh, d->data(), sizeof(fh));
+            const size_t n = d->size() - sizeof(fh);
+            EXPECT_EQ(fh.total_len, payload.size());
+            std::memcpy(rebuilt.data() + fh.offset, d->data() + sizeof(fh), n);
+            bytes += n;
+            ++fragments;
+            saw_last |= (fh.flags & FRAG_FLAG_LAST) != 0;
+            return PROPAGATION_CONSUMED;
+        });
+
+    host_api_t api_b{};
+    cm_b_->fill_host_api(&api_b);
+    for (auto& f : frames)
+        api_b.on_data(api_b.ctx, cid_b, f.data.data(), f.data.size());
+
+    EXPECT_EQ(fragments, 3u);
+    EXPECT_EQ(bytes, payload.size());
+    EXPECT_TRUE(saw_last);
+    EXPECT_EQ(rebuilt, payload);
+    EXPECT_EQ(impl(*cm_b_).rcu_find(cid_b)->reassembly.reserved_bytes(), 0u)
+        << "streaming mode must not buffer";
+}
+
+TEST_F(CMTest, Fragment_LegacyPeerGetsRawChunks) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    impl(*cm_a_).rcu_find(cid_a)->peer_core_meta.caps_mask &= ~CORE_CAP_FRAGMENT;
+
+    std::vector<uint8_t> payload(3 * 1024 * 1024, 0x11);
+    auto frames = capture_send(*cm_a_, cid_a, MSG_TYPE_FILE, payload, mock_ops_);
+    ASSERT_EQ(frames.size(), 3u);
+    for (auto& f : frames)
+        EXPECT_EQ(reinterpret_cast<const header_t*>(f.data.data())->flags
+                  & GNET_FLAG_FRAGMENT, 0);
+}
+
+// Коннектор с on_sent(): сообщение больше окна не обрывается на середине —
+// остаток ждёт в очереди и уходит, когда «сокет» в другом потоке
+// подтверждает запись; send() при этом не блокируется
+TEST_F(CMTest, Fragment_LargerThanSendWindowResumesOnCredit) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+
+    struct Socket {
+        std::mutex              mu;
+        std::condition_variable cv;
+        std::deque<owned_buf_t> q;
+        bool                    stop = false;
+    } sock;
+    connector_ops_t ops = make_mock_connector_ops();
+    ops.connector_ctx = &sock;
+    ops.flags = CONNECTOR_FLAG_REPORTS_SENT;
+    ops.send_owned = [](void* ctx, conn_id_t, const owned_buf_t* bufs, int count) -> int {
+        auto* s = static_cast<Socket*>(ctx);
+        std::lock_guard lk(s->mu);
+        for (int i = 0; i < count; ++i) s->q.push_back(bufs[i]);
+        s->cv.notify_one();
+        return 0;
+    };
+    cm_a_->register_connector("tcp", &ops);
+
+    std::vector<uint8_t> got;
+    std::atomic<bool>    delivered{false};
+    bus_.subscribe(MSG_TYPE_FILE, "big_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData& d) {
+            got = *d;
+            delivered = true;
+            return PROPAGATION_CONSUMED;
+        });
+
+    host_api_t api_a{}, api_b{};
+    cm_a_->fill_host_api(&api_a);
+    cm_b_->fill_host_api(&api_b);
+    std::thread writer([&] {
+        std::unique_lock lk(sock.mu);
+        for (;;) {
+            sock.cv.wait(lk, [&] { return sock.stop || !sock.q.empty(); });
+            if (sock.q.empty()) return;
+            auto b = sock.q.front();
+            sock.q.pop_front();
+            lk.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            api_b.on_data(api_b.ctx, cid_b, b.data, b.size);
+            b.release(b.release_ctx);
+            api_a.on_sent(api_a.ctx, cid_a, b.size);
+            lk.lock();
+        }
+    });
+
+    std::vector<uint8_t> payload(PerConnQueue::MAX_BYTES + 3 * 1024 * 1024 + 17);
+    randombytes_buf(payload.data(), payload.size());
+    const uint64_t drops0 =
+        bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::PerConnLimitExceeded)];
+    EXPECT_TRUE(cm_a_->send(cid_a, MSG_TYPE_FILE, payload));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!delivered && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    {
+        std::lock_guard lk(sock.mu);
+        sock.stop = true;
+        sock.cv.notify_one();
+    }
+    writer.join();
+
+    EXPECT_EQ(got, payload);
+    EXPECT_EQ(bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::PerConnLimitExceeded)],
+              drops0);
+    EXPECT_EQ(cm_a_->send_window(cid_a), PerConnQueue::MAX_BYTES);
+    EXPECT_EQ(impl(*cm_b_).rcu_find(cid_b)->reassembly.reserved_bytes(), 0u);
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+// Единственный поток flush-исполнителя — он же отправитель: send() не ждёт
+// окна, остаток уходит из flush-задач, когда те освобождают очередь
+TEST_F(CMTest, Fragment_LargerThanSendWindowNeverBlocksFlushExecutor) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    OwnedSink sink;
+    auto ops = make_owned_ops(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    std::vector<uint8_t> payload(PerConnQueue::MAX_BYTES + 3 * 1024 * 1024 + 17);
+    randombytes_buf(payload.data(), payload.size());
+    const size_t fragments = (payload.size() + 1024 * 1024 - 1) / (1024 * 1024);
+
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_FILE, payload));
+    auto q = impl(*cm_a_).find_queue(cid_a);
+    ASSERT_NE(q, nullptr);
+    EXPECT_TRUE(q->has_parked.load()) << "tail must wait for the window, not the caller";
+    EXPECT_TRUE(sink.held.empty());
+
+    for (int i = 0; i < 100 && sink.held.size() < fragments; ++i) {
+        ioc_.restart();
+        ioc_.poll();
+    }
+    EXPECT_EQ(sink.held.size(), fragments);
+    EXPECT_FALSE(q->has_parked.load());
+    EXPECT_EQ(cm_a_->send_window(cid_a), PerConnQueue::MAX_BYTES);
+
+    sink.release_all();
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+}
+
+TEST(FragmentReassemblerTest, RejectsOverBudgetAndRemembersDroppedId) {
+    FragmentReassembler r;
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> chunk(100, 0x42);
+
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(1, 0, 1000), chunk, 500, out),
+              FragmentReassembler::Result::Rejected);
+    // Хвост отклонённого сообщения не резервирует память повторно
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(1, 900, 1000, true), chunk, 1 << 20, out),
+              FragmentReassembler::Result::Rejected);
+    EXPECT_EQ(r.reserved_bytes(), 0u);
+
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(2, 0, 200), chunk, 1 << 20, out),
+              FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.reserved_bytes(), 200u);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(2, 100, 200, true), chunk, 1 << 20, out),
+              FragmentReassembler::Result::Complete);
+    EXPECT_EQ(out.size(), 200u);
+    EXPECT_EQ(r.reserved_bytes(), 0u);
+}
+
+TEST(FragmentReassemblerTest, RejectsOutOfBoundsAndMismatchedFragments) {
+    FragmentReassembler r;
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> chunk(100, 0x42);
+    const size_t budget = 1 << 20;
+
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(1, 950, 1000), chunk, budget, out),
+              FragmentReassembler::Result::Rejected);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(2, 0, 1000, true), chunk, budget, out),
+              FragmentReassembler::Result::Rejected) << "LAST must end the message";
+
+    ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(3, 0, 1000), chunk, budget, out),
+              FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.add(MSG_TYPE_CHAT, make_frag(3, 100, 1000), chunk, budget, out),
+              FragmentReassembler::Result::Rejected);
+    EXPECT_EQ(r.reserved_bytes(), 0u) << "mismatch drops the partial message";
+}
+
+TEST(FragmentReassemblerTest, RejectsOverlappingFragments) {
+    FragmentReassembler r;
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> chunk(100, 0x42);
+    const size_t budget = 1 << 20;
+
+    // Повтор того же смещения набрал бы total_len, оставив дыру [100, 200)
+    ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(1, 0, 200), chunk, budget, out),
+              FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(1, 0, 200), chunk, budget, out),
+              FragmentReassembler::Result::Rejected);
+    EXPECT_EQ(r.reserved_bytes(), 0u);
+
+    // Частичное пересечение с обеих сторон
+    ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(2, 100, 400), chunk, budget, out),
+              FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(2, 150, 400), chunk, budget, out),
+              FragmentReassembler::Result::Rejected);
+    ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(3, 100, 400), chunk, budget, out),
+              FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(3, 50, 400), chunk, budget, out),
+              FragmentReassembler::Result::Rejected);
+    EXPECT_EQ(r.reserved_bytes(), 0u);
+
+    // Смежные фрагменты в любом порядке — не пересечение
+    ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(4, 200, 300, true), chunk, budget, out),
+              FragmentReassembler::Result::Partial);
+    ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(4, 0, 300), chunk, budget, out),
+              FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(4, 100, 300), chunk, budget, out),
+              FragmentReassembler::Result::Complete);
+    EXPECT_EQ(out.size(), 300u);
+}
+
+TEST(FragmentReassemblerTest, ExpireAndConcurrencyLimit) {
+    FragmentReassembler r;
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> chunk(10, 0x42);
+    for (uint32_t i = 0; i < FragmentReassembler::MAX_PARTIAL; ++i)
+        ASSERT_EQ(r.add(MSG_TYPE_FILE, make_frag(i, 0, 100), chunk, 1 << 20, out),
+                  FragmentReassembler::Result::Partial);
+    EXPECT_EQ(r.add(MSG_TYPE_FILE, make_frag(99, 0, 100), chunk, 1 << 20, out),
+              FragmentReassembler::Result::Rejected);
+
+    EXPECT_EQ(r.expire(std::chrono::steady_clock::now() - std::chrono::hours(1)), 0u);
+    EXPECT_EQ(r.expire(std::chrono::steady_clock::now() + std::chrono::seconds(1)),
+              FragmentReassembler::MAX_PARTIAL);
+    EXPECT_EQ(r.reserved_bytes(), 0u);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Multipath: path scheduler, striping, reordering
+// ═══════════════════════════════════════════════════════════════════════════════
+
+namespace {
+
+TransportPath make_path(conn_id_t tid, std::string scheme, uint8_t priority,
+                        uint64_t srtt_us = 0) {
+    TransportPath tp;
+    tp.transport_conn_id = tid;
+    tp.scheme            = std::move(scheme);
+    tp.priority          = priority;
+    tp.added_at          = std::chrono::steady_clock::now();
+    if (srtt_us) tp.state->add_rtt_sample(srtt_us);
+    return tp;
+}
+
+/// Добавить пиру вторичный путь "ice" (как handle_add_transport, без pubkey lookup).
+void add_ice_path(ConnectionManager::Impl& im, conn_id_t peer, conn_id_t tid) {
+    im.rcu_find(peer)->transport_paths.push_back(make_path(tid, "ice", 1));
+    std::unique_lock lk(im.transport_mu_);
+    im.transport_index_[tid] = peer;
+}
+
+StripeReorderBuffer::Frame make_striped(uint64_t seq) {
+    StripeReorderBuffer::Frame f;
+    f.seq     = seq;
+    f.data    = {static_cast<uint8_t>(seq)};
+    f.held_at = std::chrono::steady_clock::now();
+    return f;
+}
+
+} // namespace
+
+TEST(PathStateTest, RttEwmaAndLossRate) {
+    PathState st;
+    st.add_rtt_sample(80'000);
+    EXPECT_EQ(st.srtt_us.load(), 80'000u);
+    EXPECT_EQ(st.rttvar_us.load(), 40'000u);
+    for (int i = 0; i < 64; ++i) st.add_rtt_sample(10'000);
+    EXPECT_LT(st.srtt_us.load(), 11'000u) << "srtt converges to the new RTT";
+
+    for (int i = 0; i < 8; ++i) st.record_send(false, 1, 100);
+    const uint32_t lossy = st.loss_ppm.load();
+    EXPECT_GT(lossy, PathState::LOSS_SCALE / 2);
+    EXPECT_EQ(st.tx_errors.load(), 8u);
+    for (int i = 0; i < 8; ++i) st.record_send(true, 2, 100);
+    EXPECT_LT(st.loss_ppm.load(), lossy / 2);
+    EXPECT_EQ(st.tx_frames.load(), 16u);
+    EXPECT_EQ(st.tx_bytes.load(), 800u);
+}
+
+TEST(PathSchedulerTest, AdaptiveRanksByRttLossAndQueue) {
+    AdaptivePathScheduler adaptive;
+    PriorityPathScheduler priority;
+
+    // Без замеров — тот же порядок, что и у статического priority
+    auto tcp = make_path(1, "tcp", 0);
+    auto ice = make_path(2, "ice", 1);
+    std::vector<TransportPath*> paths{&ice, &tcp};
+    adaptive.rank(paths);
+    EXPECT_EQ(paths.front(), &tcp);
+
+    // Медленный TCP проигрывает быстрому ICE, priority этого не видит
+    tcp.state->add_rtt_sample(20'000);
+    ice.state->add_rtt_sample(5'000);
+    adaptive.rank(paths);
+    EXPECT_EQ(paths.front(), &ice);
+    EXPECT_GT(adaptive.stripe_weight(ice), adaptive.stripe_weight(tcp));
+    priority.rank(paths);
+    EXPECT_EQ(paths.front(), &tcp);
+
+    // Потери и очередь на ICE возвращают трафик на TCP
+    for (int i = 0; i < 8; ++i) ice.state->record_send(false, 1, 1);
+    adaptive.rank(paths);
+    EXPECT_EQ(paths.front(), &tcp);
+
+    auto ice2 = make_path(3, "ice", 1, 5'000);
+    ice2.state->in_flight = 64 * AdaptivePathScheduler::QUEUE_BYTES;
+    std::vector<TransportPath*> queued{&ice2, &tcp};
+    adaptive.rank(queued);
+    EXPECT_EQ(queued.front(), &tcp);
+
+    // Тот же srtt, но большой разброс — стабильный путь выигрывает
+    auto steady = make_path(4, "tcp", 1);
+    auto jitter = make_path(5, "ice", 0);
+    steady.state->srtt_us = 10'000;
+    steady.state->rttvar_us = 500;
+    jitter.state->srtt_us = 10'000;
+    jitter.state->rttvar_us = 8'000;
+    std::vector<TransportPath*> jittery{&jitter, &steady};
+    adaptive.rank(jittery);
+    EXPECT_EQ(jittery.front(), &steady);
+
+    EXPECT_EQ(make_path_scheduler("priority")->name(), "priority");
+    EXPECT_EQ(make_path_scheduler("adaptive")->name(), "adaptive");
+    EXPECT_EQ(make_path_scheduler("bogus"), nullptr);
+}
+
+TEST(StripeReorderBufferTest, ReleasesInOrderAndSkipsExpiredGaps) {
+    StripeReorderBuffer r;
+    std::vector<StripeReorderBuffer::Frame> out;
+
+    r.push(make_striped(2), out);
+    r.push(make_striped(1), out);
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(r.held(), 2u);
+    r.push(make_striped(0), out);
+    ASSERT_EQ(out.size(), 3u);
+    for (uint64_t i = 0; i < 3; ++i) EXPECT_EQ(out[i].seq, i);
+    out.clear();
+
+    // seq 3 потерян: 4 и 5 ждут, пока пробел не истечёт
+    r.push(make_striped(5), out);
+    r.push(make_striped(4), out);
+    r.release_expired(std::chrono::steady_clock::now() - std::chrono::seconds(1), out);
+    EXPECT_TRUE(out.empty());
+    r.release_expired(std::chrono::steady_clock::now(), out);
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[0].seq, 4u);
+    EXPECT_EQ(out[1].seq, 5u);
+    out.clear();
+
+    // Опоздавший кадр после пропуска пробела отдаётся сразу
+    r.push(make_striped(3), out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].seq, 3u);
+    EXPECT_EQ(r.held(), 0u);
+}
+
+TEST(StripeReorderBufferTest, GapSkippedWhenHeldLimitExceeded) {
+    StripeReorderBuffer r;
+    std::vector<StripeReorderBuffer::Frame> out;
+    for (uint64_t s = 1; s <= StripeReorderBuffer::MAX_HELD; ++s)
+        r.push(make_striped(s), out);
+    EXPECT_TRUE(out.empty());
+    r.push(make_striped(StripeReorderBuffer::MAX_HELD + 1), out);
+    EXPECT_EQ(out.size(), StripeReorderBuffer::MAX_HELD + 1);
+    EXPECT_EQ(out.front().seq, 1u);
+    EXPECT_EQ(r.held(), 0u);
+}
+
+TEST_F(CMTest, Multipath_SchedulerPicksPathByRtt) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    auto& im = impl(*cm_a_);
+    constexpr conn_id_t ICE_ID = 7777;
+    add_ice_path(im, cid_a, ICE_ID);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->register_connector("ice", &ops);
+
+    auto rec = im.rcu_find(cid_a);
+    rec->find_path("tcp")->state->add_rtt_sample(90'000);
+    rec->find_path("ice")->state->add_rtt_sample(3'000);
+
+    const std::vector<uint8_t> msg(256, 0x5A);
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, msg));
+    {
+        std::lock_guard lk(sink.mu);
+        ASSERT_EQ(sink.frames.size(), 1u);
+        EXPECT_EQ(sink.frames[0].id, ICE_ID) << "adaptive: lower srtt wins";
+    }
+
+    sink.clear();
+    cm_a_->set_path_scheduler(std::make_shared<PriorityPathScheduler>());
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, msg));
+    {
+        std::lock_guard lk(sink.mu);
+        ASSERT_EQ(sink.frames.size(), 1u);
+        EXPECT_EQ(sink.frames[0].id, cid_a) << "priority: tcp regardless of RTT";
+    }
+
+    auto dump = nlohmann::json::parse(cm_a_->dump_connections());
+    nlohmann::json conn;
+    for (auto& c : dump) if (c["id"] == cid_a) conn = c;
+    ASSERT_TRUE(conn.is_object());
+    EXPECT_EQ(conn["path_scheduler"], "priority");
+    ASSERT_EQ(conn["transport_paths"].size(), 2u);
+    for (auto& p : conn["transport_paths"]) {
+        EXPECT_GT(p["tx_bytes"].get<uint64_t>(), msg.size());
+        EXPECT_GT(p["srtt_us"].get<uint64_t>(), 0u);
+        EXPECT_TRUE(p.contains("tx_bps"));
+        if (p["scheme"] == "ice") {
+            EXPECT_EQ(p["tx_frames"], 1u);
+        }
+    }
+
+    cm_a_->register_connector("tcp", &mock_ops_);
+    cm_a_->register_connector("ice", &mock_ops_);
+    g_cap_sink = nullptr;
+}
+
+TEST_F(CMTest, Multipath_HeartbeatProbesEveryPath) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    auto& im = impl(*cm_a_);
+    constexpr conn_id_t ICE_ID = 7778;
+    add_ice_path(im, cid_a, ICE_ID);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->register_connector("ice", &ops);
+
+    im.send_heartbeat(cid_a);
+    {
+        std::lock_guard lk(sink.mu);
+        ASSERT_EQ(sink.frames.size(), 2u);
+        EXPECT_NE(sink.frames[0].id, sink.frames[1].id);
+    }
+    auto rec = im.rcu_find(cid_a);
+    EXPECT_NE(rec->find_path("tcp")->state->probe_seq.load(),
+              rec->find_path("ice")->state->probe_seq.load());
+
+    // PONG на probe ICE обновляет RTT именно ICE
+    msg::HeartbeatPayload pong{};
+    pong.timestamp_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()) - 2'000;
+    pong.seq   = rec->find_path("ice")->state->probe_seq.load() - 1;
+    pong.flags = 0x01;
+    im.handle_heartbeat(cid_a, std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(&pong), sizeof(pong)));
+    EXPECT_GE(rec->find_path("ice")->state->srtt_us.load(), 2'000u);
+    EXPECT_EQ(rec->find_path("tcp")->state->srtt_us.load(), 0u);
+
+    cm_a_->register_connector("tcp", &mock_ops_);
+    cm_a_->register_connector("ice", &mock_ops_);
+    g_cap_sink = nullptr;
+}
+
+// Probe не обходит очередь: уходит из drain'а вместе с кадрами, уже
+// стоящими в очереди, а не отдельной записью в коннектор
+TEST_F(CMTest, Multipath_HeartbeatProbesGoThroughQueue) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    auto& im = impl(*cm_a_);
+    constexpr conn_id_t ICE_ID = 7780;
+    add_ice_path(im, cid_a, ICE_ID);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->register_connector("ice", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    const std::vector<uint8_t> msg(64, 0x5A);
+    for (int i = 0; i < 10; ++i)
+        ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, msg));
+    im.send_heartbeat(cid_a);
+    {
+        std::lock_guard lk(sink.mu);
+        EXPECT_TRUE(sink.frames.empty()) << "probe written outside the drain";
+    }
+    auto rec = im.rcu_find(cid_a);
+    EXPECT_EQ(rec->probe_pending.load(), 2u);
+
+    ioc_.restart();
+    ioc_.poll();
+
+    {
+        std::lock_guard lk(sink.mu);
+        ASSERT_EQ(sink.frames.size(), 12u);
+        std::vector<conn_id_t> probe_ids;
+        for (auto& f : sink.frames) {
+            const auto* h = reinterpret_cast<const header_t*>(f.data.data());
+            if (h->payload_type == MSG_TYPE_HEARTBEAT) probe_ids.push_back(f.id);
+            else EXPECT_EQ(f.id, cid_a);
+        }
+        ASSERT_EQ(probe_ids.size(), 2u);
+        EXPECT_NE(probe_ids[0], probe_ids[1]) << "each probe on its own path";
+    }
+    EXPECT_EQ(rec->probe_pending.load(), 0u);
+    EXPECT_TRUE(rec->probe_routes.empty());
+
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+    cm_a_->register_connector("ice", &mock_ops_);
+    g_cap_sink = nullptr;
+}
+
+TEST_F(CMTest, Multipath_StripedBulkReorderedOnPeer) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im = impl(*cm_a_);
+    constexpr conn_id_t ICE_ID = 7779;
+    add_ice_path(im, cid_a, ICE_ID);
+    cm_a_->set_multipath_striping(true);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->register_connector("ice", &ops);
+
+    constexpr int N = 16;
+    for (int i = 0; i < N; ++i) {
+        std::vector<uint8_t> msg(4096, static_cast<uint8_t>(i));
+        ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_FILE, msg));
+    }
+    const std::vector<uint8_t> chat{1, 2, 3};
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_CHAT, chat));
+
+    std::vector<CapturedFrame> frames;
+    {
+        std::lock_guard lk(sink.mu);
+        frames = std::move(sink.frames);
+    }
+    cm_a_->register_connector("tcp", &mock_ops_);
+    cm_a_->register_connector("ice", &mock_ops_);
+    g_cap_sink = nullptr;
+
+    ASSERT_EQ(frames.size(), size_t(N + 1));
+    size_t via_ice = 0, striped = 0;
+    for (auto& f : frames) {
+        auto* h = reinterpret_cast<const header_t*>(f.data.data());
+        if (f.id == ICE_ID) ++via_ice;
+        if (h->flags & GNET_FLAG_STRIPED) {
+            ++striped;
+            EXPECT_EQ(h->payload_type, MSG_TYPE_FILE);
+        }
+    }
+    EXPECT_EQ(striped, size_t(N)) << "only bulk frames are striped";
+    EXPECT_GT(via_ice, 0u);
+    EXPECT_LT(via_ice, frames.size()) << "both paths carry traffic";
+
+    std::vector<uint8_t> order;
+    bus_.subscribe(MSG_TYPE_FILE, "stripe_sink",
+        [&](std::string_view, const header_t& h, const endpoint_t*, const PacketData& d) {
+            EXPECT_EQ(h.flags & GNET_FLAG_STRIPED, 0);
+            EXPECT_EQ(d->size(), 4096u);
+            order.push_back(d->front());
+            return PROPAGATION_CONSUMED;
+        });
+
+    host_api_t api_b{};
+    cm_b_->fill_host_api(&api_b);
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+        api_b.on_data(api_b.ctx, cid_b, it->data.data(), it->data.size());
+
+    ASSERT_EQ(order.size(), size_t(N));
+    for (int i = 0; i < N; ++i) EXPECT_EQ(order[i], i);
+    EXPECT_EQ(impl(*cm_b_).rcu_find(cid_b)->reorder.held(), 0u);
+}
+
+TEST_F(CMTest, Multipath_StripeSeqNotConsumedByRejectedFrame) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im = impl(*cm_a_);
+    add_ice_path(im, cid_a, 7780);
+    cm_a_->set_multipath_striping(true);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->register_connector("ice", &ops);
+    cm_a_->set_flush_executor(&ioc_);   // очередь не дренируется до poll()
+
+    // Маленькие кадры: кольцо Bulk переполнится раньше, чем окно
+    const std::vector<uint8_t> msg(16, 0x66);
+    uint64_t accepted = 0;
+    while (cm_a_->send(cid_a, MSG_TYPE_FILE, msg, SendClass::Bulk))
+        ASSERT_LT(++accepted, 100'000u);
+    EXPECT_FALSE(cm_a_->send(cid_a, MSG_TYPE_FILE, msg, SendClass::Bulk));
+    EXPECT_EQ(im.rcu_find(cid_a)->send_stripe_seq.load(), accepted)
+        << "rejected frame left a gap in the stripe sequence";
+
+    ioc_.poll();
+    ioc_.restart();
+    ASSERT_TRUE(cm_a_->send(cid_a, MSG_TYPE_FILE, msg, SendClass::Bulk));
+    ioc_.poll();
+    ioc_.restart();
+
+    std::vector<CapturedFrame> frames;
+    {
+        std::lock_guard lk(sink.mu);
+        frames = std::move(sink.frames);
+    }
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+    cm_a_->register_connector("ice", &mock_ops_);
+    g_cap_sink = nullptr;
+    ASSERT_EQ(frames.size(), accepted + 1);
+
+    size_t got = 0;
+    bus_.subscribe(MSG_TYPE_FILE, "stripe_gap_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++got;
+            return PROPAGATION_CONSUMED;
+        });
+    host_api_t api_b{};
+    cm_b_->fill_host_api(&api_b);
+    for (auto& f : frames)
+        api_b.on_data(api_b.ctx, cid_b, f.data.data(), f.data.size());
+    EXPECT_EQ(got, frames.size()) << "frame after the rejected one waited for a gap";
+    EXPECT_EQ(impl(*cm_b_).rcu_find(cid_b)->reorder.held(), 0u);
+}
+
+// ─── Broadcast fan-out ────────────────────────────────────────────────────────
+
+TEST(SessionTest, EncodeOnceSealPerSession) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    std::vector<uint8_t> plain(8192);
+    for (size_t i = 0; i < plain.size(); ++i) plain[i] = static_cast<uint8_t>(i % 29);
+
+    const size_t cap = NoiseSession::max_wire_size(plain.size(), true, 512);
+    std::vector<uint8_t> body(cap);
+    const size_t body_len = NoiseSession::encode_body(
+        body.data(), cap - crypto_aead_chacha20poly1305_IETF_ABYTES,
+        plain.data(), plain.size(), true, 512, 1);
+    ASSERT_LT(body_len, plain.size()) << "compressible payload stays raw";
+
+    for (int k = 0; k < 3; ++k) {
+        NoiseSession s;
+        randombytes_buf(s.send_key, sizeof(s.send_key));
+        std::memcpy(s.recv_key, s.send_key, sizeof(s.recv_key));
+
+        std::vector<uint8_t> wire(body.begin(), body.begin() + body_len);
+        wire.resize(cap);
+        const size_t clen = s.seal_in_place(wire.data(), body_len, 40 + k);
+        EXPECT_EQ(s.decrypt(wire.data(), clen, 40 + k), plain);
+    }
+}
+
+TEST_F(CMTest, Broadcast_HandleCountsPerPeerOutcome) {
+    auto& im = impl(*cm_a_);
+    auto ids = add_fake_peers(im, 4, 60000);
+    cm_a_->register_connector("tcp", &mock_ops_);
+    // Окно одного пира исчерпано — его кадр отклоняется
+    im.get_or_create_queue(ids[2])->in_flight.store(PerConnQueue::MAX_BYTES);
+
+    const std::vector<uint8_t> payload(300, 0x21);
+    auto h = cm_a_->broadcast(MSG_TYPE_CHAT, payload);
+    EXPECT_TRUE(h.done()) << "few peers, no executor: fan-out runs inline";
+    EXPECT_EQ(h.peers(), 4u);
+    EXPECT_EQ(h.sent(), 3u);
+    EXPECT_EQ(h.failed(), 1u);
+
+    auto none = ConnectionManager(bus_, id_b_).broadcast(MSG_TYPE_CHAT, payload);
+    EXPECT_TRUE(none.done());
+    EXPECT_EQ(none.peers(), 0u);
+}
+
+TEST_F(CMTest, Broadcast_ParallelFanOutDecryptsOnEveryPeer) {
+    auto& im = impl(*cm_a_);
+    constexpr size_t N = ConnectionManager::Impl::BROADCAST_CHUNK * 3 + 5;
+    auto ids = add_fake_peers(im, N, 70000);
+    im.get_or_create_queue(ids[7])->in_flight.store(PerConnQueue::MAX_BYTES);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &ops);
+    cm_a_->set_flush_executor(&ioc_);
+
+    std::vector<uint8_t> payload(16 * 1024);
+    for (size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<uint8_t>(i / 64);
+
+    auto h = cm_a_->broadcast(MSG_TYPE_CHAT, payload);
+    EXPECT_FALSE(h.done()) << "fan-out must not run on the caller thread";
+
+    auto work = boost::asio::make_work_guard(ioc_);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < 3; ++t) pool.emplace_back([&] { ioc_.run(); });
+    ASSERT_TRUE(h.wait_for(std::chrono::seconds(10)));
+    for (auto id : ids)
+        while (cm_a_->get_pending_bytes(id) > 0) std::this_thread::yield();
+    work.reset();
+    ioc_.stop();
+    for (auto& t : pool) t.join();
+    ioc_.restart();
+
+    EXPECT_EQ(h.sent(), N - 1);
+    EXPECT_EQ(h.failed(), 1u);
+
+    std::vector<CapturedFrame> frames;
+    {
+        std::lock_guard lk(sink.mu);
+        frames = std::move(sink.frames);
+    }
+    cm_a_->set_flush_executor(nullptr);
+    cm_a_->register_connector("tcp", &mock_ops_);
+    g_cap_sink = nullptr;
+
+    ASSERT_EQ(frames.size(), N - 1);
+    for (auto& f : frames) {
+        header_t hdr{};
+        std::memcpy(&hdr, f.data.data(), sizeof(hdr));
+        ASSERT_LT(hdr.payload_len, payload.size()) << "body compressed";
+        auto rec = im.rcu_find(f.id);
+        ASSERT_TRUE(rec);
+        EXPECT_EQ(rec->session->decrypt(f.data.data() + sizeof(header_t),
+                                        hdr.payload_len, hdr.packet_id),
+                  payload) << "peer #" << f.id;
+    }
+}
+
+// ─── zstd dictionaries ────────────────────────────────────────────────────────
+
+namespace {
+
+/// Структурированное сообщение ~300 байт: общий шаблон, разные значения.
+std::vector<uint8_t> make_structured_msg(uint32_t i) {
+    char buf[512];
+    const int n = std::snprintf(buf, sizeof(buf),
+        R"({"type":"chat.message","room":"general-%u","author":{"id":%u,"name":"user%u",)"
+        R"("status":"online"},"ts":%u,"text":"message number %u in the stream",)"
+        R"("attachments":[],"reply_to":null,"flags":{"edited":false,"pinned":%s}})",
+        i % 7, 1000 + i % 50, i % 50, 1700000000u + i * 13, i, i % 3 ? "false" : "true");
+    return {buf, buf + n};
+}
+
+std::vector<uint8_t> train_chat_dict(ZstdDictionaries& d) {
+    for (uint32_t i = 0; i < ZstdDictionaries::TRAIN_SAMPLES * ZstdDictionaries::SAMPLE_EVERY; ++i)
+        d.sample(MSG_TYPE_CHAT, make_structured_msg(i));
+    EXPECT_EQ(d.train_ready(), 1u);
+    auto dict = d.for_type(MSG_TYPE_CHAT);
+    return dict ? dict->content : std::vector<uint8_t>{};
+}
+
+} // namespace
+
+TEST(ZstdDictionariesTest, TrainedDictionaryShrinksSmallPayloads) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    ZstdDictionaries dicts;
+    auto content = train_chat_dict(dicts);
+    ASSERT_FALSE(content.empty());
+    auto dict = dicts.for_type(MSG_TYPE_CHAT);
+    EXPECT_EQ(dicts.find(dict->id), dict);
+    EXPECT_EQ(dicts.ids(), std::vector<uint32_t>{dict->id});
+    EXPECT_EQ(dicts.for_type(MSG_TYPE_FILE), nullptr);
+
+    NoiseSession s;
+    randombytes_buf(s.send_key, sizeof(s.send_key));
+    std::memcpy(s.recv_key, s.send_key, sizeof(s.recv_key));
+
+    size_t raw = 0, plain_zstd = 0, with_dict = 0;
+    for (uint32_t i = 50'000; i < 50'100; ++i) {
+        const auto msg = make_structured_msg(i);
+        const size_t cap = NoiseSession::max_wire_size(msg.size(), true, 16);
+        std::vector<uint8_t> a(cap), b(cap);
+        plain_zstd += NoiseSession::encode_body(a.data(), cap, msg.data(), msg.size(),
+                                                true, 16, 1);
+        const size_t clen = s.encrypt_into(b.data(), cap, msg.data(), msg.size(), i,
+                                           true, 16, 1, dict.get());
+        with_dict += clen - crypto_aead_chacha20poly1305_IETF_ABYTES;
+        raw += msg.size();
+
+        EXPECT_EQ(s.decrypt(b.data(), clen, i, &dicts), msg);
+    }
+    EXPECT_LT(with_dict * 2, plain_zstd) << "dictionary should at least halve the body";
+    EXPECT_LT(plain_zstd, raw);
+
+    // Без словаря у получателя кадр не распаковать
+    std::vector<uint8_t> w(NoiseSession::max_wire_size(400, true, 16));
+    const auto msg = make_structured_msg(1);
+    const size_t clen = s.encrypt_into(w.data(), w.size(), msg.data(), msg.size(), 90'000,
+                                       true, 16, 1, dict.get());
+    EXPECT_TRUE(s.decrypt(w.data(), clen, 90'000).empty());
+}
+
+TEST(ZstdDictionariesTest, RejectsGarbageAndPersists) {
+    ZstdDictionaries dicts;
+    const std::vector<uint8_t> junk(2048, 0x11);
+    EXPECT_EQ(dicts.add(MSG_TYPE_CHAT, junk), 0u);
+    EXPECT_EQ(dicts.train(MSG_TYPE_CHAT), 0u) << "no samples";
+
+    auto content = train_chat_dict(dicts);
+    ASSERT_FALSE(content.empty());
+
+    const auto dir = tmp_dir("zdict");
+    ASSERT_TRUE(dicts.save_dir(dir));
+    ZstdDictionaries loaded;
+    EXPECT_EQ(loaded.load_dir(dir), 1u);
+    ASSERT_TRUE(loaded.for_type(MSG_TYPE_CHAT));
+    EXPECT_EQ(loaded.for_type(MSG_TYPE_CHAT)->content, content);
+    fs::remove_all(dir);
+}
+
+TEST_F(CMTest, Compression_DictionaryNegotiatedInHandshake) {
+    ZstdDictionaries trainer;
+    const auto content = train_chat_dict(trainer);
+    ASSERT_FALSE(content.empty());
+    const uint32_t id = cm_a_->add_compression_dictionary(MSG_TYPE_CHAT, content);
+    ASSERT_NE(id, 0u);
+    ASSERT_EQ(cm_b_->add_compression_dictionary(MSG_TYPE_CHAT, content), id);
+
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto rec_a = impl(*cm_a_).rcu_find(cid_a);
+    ASSERT_TRUE(rec_a);
+    EXPECT_TRUE(rec_a->peer_core_meta.caps_mask & CORE_CAP_ZSTD_DICT);
+    EXPECT_EQ(rec_a->peer_dict_ids, std::vector<uint32_t>{id});
+
+    const auto before = bus_.stats_snapshot();
+    const auto msg = make_structured_msg(77'777);
+    auto frame = impl(*cm_a_).build_frame(cid_a, MSG_TYPE_CHAT, msg);
+    header_t hdr{};
+    std::memcpy(&hdr, frame.data(), sizeof(hdr));
+    EXPECT_LT(hdr.payload_len, msg.size() / 2);
+
+    auto rec_b = impl(*cm_b_).rcu_find(cid_b);
+    EXPECT_EQ(rec_b->session->decrypt(frame.data() + sizeof(header_t), hdr.payload_len,
+                                      hdr.packet_id, &impl(*cm_b_).dicts_),
+              msg);
+
+    const auto after = bus_.stats_snapshot();
+    ASSERT_TRUE(after.compression.contains(MSG_TYPE_CHAT));
+    const auto& c = after.compression.at(MSG_TYPE_CHAT);
+    const uint64_t prev_dict = before.compression.contains(MSG_TYPE_CHAT)
+        ? before.compression.at(MSG_TYPE_CHAT).dict_frames : 0;
+    EXPECT_EQ(c.dict_frames - prev_dict, 1u);
+    EXPECT_GT(c.ratio(), 2.0);
+}
+
+TEST_F(CMTest, Compression_PeerWithoutDictionaryGetsPlainZstd) {
+    ZstdDictionaries trainer;
+    const auto content = train_chat_dict(trainer);
+    ASSERT_NE(cm_a_->add_compression_dictionary(MSG_TYPE_CHAT, content), 0u);
+
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    EXPECT_TRUE(impl(*cm_a_).rcu_find(cid_a)->peer_dict_ids.empty());
+    EXPECT_FALSE(impl(*cm_b_).rcu_find(cid_b)->peer_dict_ids.empty())
+        << "A advertises its dictionary to B";
+
+    std::vector<uint8_t> msg;
+    for (uint32_t i = 0; i < 4; ++i) {
+        auto m = make_structured_msg(i);
+        msg.insert(msg.end(), m.begin(), m.end());
+    }
+    auto frame = impl(*cm_a_).build_frame(cid_a, MSG_TYPE_CHAT, msg);
+    header_t hdr{};
+    std::memcpy(&hdr, frame.data(), sizeof(hdr));
+    auto rec_b = impl(*cm_b_).rcu_find(cid_b);
+    EXPECT_EQ(rec_b->session->decrypt(frame.data() + sizeof(header_t), hdr.payload_len,
+                                      hdr.packet_id, &impl(*cm_b_).dicts_),
+              msg);
+}
+
+// ─── Adaptive compression ─────────────────────────────────────────────────────
+
+TEST(AdaptiveCompressionTest, EntropyProbeSkipsIncompressible) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    std::vector<uint8_t> noise(16 * 1024);
+    randombytes_buf(noise.data(), noise.size());
+    EXPECT_GT(AdaptiveCompression::entropy_bits(noise), 7.5);
+    EXPECT_FALSE(AdaptiveCompression::looks_compressible(noise));
+
+    std::vector<uint8_t> text;
+    for (uint32_t i = 0; text.size() < 16 * 1024; ++i) {
+        auto m = make_structured_msg(i);
+        text.insert(text.end(), m.begin(), m.end());
+    }
+    EXPECT_LT(AdaptiveCompression::entropy_bits(text), 6.0);
+    EXPECT_TRUE(AdaptiveCompression::looks_compressible(text));
+
+    // Мелкие payload не пробуются — энтропия по 256 байтам ненадёжна
+    EXPECT_TRUE(AdaptiveCompression::looks_compressible(
+        std::span(noise).first(AdaptiveCompression::PROBE_MIN_BYTES - 1)));
+
+    AdaptiveCompression ac;
+    EXPECT_FALSE(ac.probe(noise));
+    EXPECT_TRUE(ac.probe(text));
+    EXPECT_EQ(ac.skipped.load(), 1u);
+    EXPECT_EQ(ac.skipped_bytes.load(), noise.size());
+    EXPECT_GT(ac.cpu_saved_ns(), 0u);
+}
+
+TEST(AdaptiveCompressionTest, LevelFollowsBacklogAndThroughput) {
+    constexpr int64_t T = AdaptiveCompression::ADAPT_INTERVAL_NS;
+    AdaptiveCompression ac;
+    int64_t now = T;
+
+    // Очередь растёт, линк узкий — поднимаемся до max_level, не выше
+    for (int i = 0; i < 12; ++i, now += T)
+        ac.adapt(1, 5, 1 << 20, 0, now);
+    EXPECT_EQ(ac.level.load(), 5);
+    EXPECT_EQ(ac.level_ups.load(), 4u);
+
+    // Внутри интервала уровень не пересчитывается
+    EXPECT_EQ(ac.adapt(1, 5, 0, 0, now - T + 1), 5);
+
+    // Очередь разошлась — возврат к базовому уровню, не ниже
+    for (int i = 0; i < 12; ++i, now += T)
+        ac.adapt(1, 5, 0, 0, now);
+    EXPECT_EQ(ac.level.load(), 1);
+    EXPECT_EQ(ac.level_downs.load(), 4u);
+
+    // zstd медленнее линка — ниже базового уровня (до MIN_LEVEL)
+    AdaptiveCompression cpu;
+    uint64_t tx = 0;
+    cpu.adapt(3, 9, 1 << 20, tx, now);
+    for (int i = 0; i < 4; ++i) {
+        now += T;
+        tx  += 100'000'000;                  // 1 GB/s линк
+        cpu.record(1 << 20, 10'000'000);     // 100 MB/s zstd
+        cpu.adapt(3, 9, 1 << 20, tx, now);
+    }
+    EXPECT_EQ(cpu.level.load(), AdaptiveCompression::MIN_LEVEL);
+    EXPECT_GT(cpu.link_bps.load(), cpu.zstd_bps.load());
+}
+
+TEST_F(CMTest, Compression_AdaptiveSkipsNoiseAndRaisesLevelOnBacklog) {
+    auto& im = impl(*cm_a_);
+    const conn_id_t id = add_fake_peers(im, 1, 80000)[0];
+    auto rec = im.rcu_find(id);
+
+    std::vector<uint8_t> noise(8192);
+    randombytes_buf(noise.data(), noise.size());
+    auto frame = im.build_frame(id, MSG_TYPE_CHAT, noise);
+    header_t hdr{};
+    std::memcpy(&hdr, frame.data(), sizeof(hdr));
+    EXPECT_EQ(hdr.payload_len,
+              noise.size() + 1 + crypto_aead_chacha20poly1305_IETF_ABYTES)
+        << "incompressible payload goes out FLAG_RAW";
+    EXPECT_EQ(rec->session->decrypt(frame.data() + sizeof(header_t),
+                                    hdr.payload_len, hdr.packet_id), noise);
+    EXPECT_EQ(rec->compression.skipped.load(), 1u);
+    EXPECT_EQ(rec->compression.compressed.load(), 0u);
+
+    // Большая очередь: следующий сжимаемый кадр идёт уровнем выше
+    im.get_or_create_queue(id)->pending_bytes.store(1 << 20);
+    std::vector<uint8_t> text;
+    for (uint32_t i = 0; text.size() < 8192; ++i) {
+        auto m = make_structured_msg(i);
+        text.insert(text.end(), m.begin(), m.end());
+    }
+    frame = im.build_frame(id, MSG_TYPE_CHAT, text);
+    std::memcpy(&hdr, frame.data(), sizeof(hdr));
+    EXPECT_LT(hdr.payload_len, text.size());
+    EXPECT_EQ(rec->session->decrypt(frame.data() + sizeof(header_t),
+                                    hdr.payload_len, hdr.packet_id), text);
+    EXPECT_EQ(rec->compression.level.load(), 2);
+    EXPECT_EQ(rec->compression.compressed.load(), 1u);
+
+    auto dump = nlohmann::json::parse(im.dump_connections());
+    ASSERT_EQ(dump.size(), 1u);
+    const auto& c = dump[0]["compression"];
+    EXPECT_EQ(c["level"], 2);
+    EXPECT_EQ(c["skipped"], 1u);
+    EXPECT_EQ(c["skipped_bytes"], noise.size());
+    EXPECT_EQ(c["level_ups"], 1u);
+}
+
+// ─── Streaming compression ────────────────────────────────────────────────────
+
+TEST(ZstdStreamTest, BlocksReferenceHistoryAndNeedOrder) {
+    ZstdStream tx, rx;
+    std::vector<std::vector<uint8_t>> wire;
+    std::vector<ZstdStream::Block> blocks;
+    size_t plain_total = 0, wire_total = 0;
+    for (uint32_t i = 0; i < 64; ++i) {
+        const auto msg = make_structured_msg(i);
+        std::vector<uint8_t> out(ZSTD_compressBound(msg.size()) + 32);
+        std::lock_guard lk(tx.tx_mu);
+        const auto b = tx.compress(out.data(), out.size(), msg.data(), msg.size(), 1);
+        ASSERT_GT(b.size, 0u);
+        EXPECT_EQ(b.seq, i);
+        EXPECT_EQ(b.reset, i == 0);
+        out.resize(b.size);
+        plain_total += msg.size();
+        wire_total  += b.size;
+        wire.push_back(std::move(out));
+        blocks.push_back(b);
+    }
+    EXPECT_LT(wire_total * 3, plain_total) << "history makes small messages shrink";
+
+    // Пропуск блока — рассинхронизация до следующего reset
+    EXPECT_TRUE(rx.decompress(1, false, wire[1].data(), wire[1].size(), 1).empty());
+    for (uint32_t i = 0; i < 10; ++i)
+        EXPECT_EQ(rx.decompress(i, blocks[i].reset, wire[i].data(), wire[i].size(),
+                                make_structured_msg(i).size()),
+                  make_structured_msg(i));
+    EXPECT_TRUE(rx.decompress(11, false, wire[11].data(), wire[11].size(),
+                              make_structured_msg(11).size()).empty());
+    EXPECT_TRUE(rx.decompress(10, false, wire[10].data(), wire[10].size(),
+                              make_structured_msg(10).size()).empty())
+        << "stays out of sync until a reset block";
+    EXPECT_EQ(rx.rx_rejected(), 3u);
+
+    // Новая эпоха на отправителе — приёмник снова в синхроне
+    const auto msg = make_structured_msg(1000);
+    std::vector<uint8_t> out(ZSTD_compressBound(msg.size()) + 32);
+    ZstdStream::Block b;
+    {
+        std::lock_guard lk(tx.tx_mu);
+        tx.restart_tx();
+        b = tx.compress(out.data(), out.size(), msg.data(), msg.size(), 1);
+    }
+    EXPECT_TRUE(b.reset);
+    EXPECT_EQ(rx.decompress(b.seq, b.reset, out.data(), b.size, msg.size()), msg);
+}
+
+TEST_F(CMTest, Compression_StreamOnlyOnOrderedSinglePath) {
+    Config cfg(true);
+    cfg.compression.stream = true;
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    (void)cid_b;
+    auto& im  = impl(*cm);
+    auto  rec = im.rcu_find(cid_a);
+    ASSERT_TRUE(rec->peer_core_meta.caps_mask & CORE_CAP_ZSTD_STREAM);
+
+    EXPECT_TRUE(im.stream_compression(*rec)) << "single tcp path";
+    add_ice_path(im, cid_a, 4242);
+    EXPECT_FALSE(im.stream_compression(*rec)) << "second path may reorder";
+    for (auto& tp : rec->transport_paths) tp.active = tp.scheme == "ice";
+    EXPECT_FALSE(im.stream_compression(*rec)) << "ICE alone is unordered";
+
+    cfg.compression.stream = false;
+    for (auto& tp : rec->transport_paths) tp.active = tp.scheme != "ice";
+    EXPECT_FALSE(im.stream_compression(*rec)) << "disabled by config";
+    cm->shutdown();
+}
+
+TEST_F(CMTest, Compression_StreamedSendsDecodeOnPeerAndResetOnRekey) {
+    Config cfg(true);
+    cfg.compression.stream = true;
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    auto rec_b = impl(*cm_b_).rcu_find(cid_b);
+
+    CapturingSink sink;
+    auto ops = make_capturing_connector(&sink);
+    g_cap_sink = &sink;
+    cm->register_connector("tcp", &ops);
+
+    auto send_and_decode = [&](uint32_t from, uint32_t n) {
+        size_t wire = 0, plain = 0;
+        for (uint32_t i = from; i < from + n; ++i) {
+            const auto msg = make_structured_msg(i);
+            EXPECT_TRUE(cm->send(cid_a, MSG_TYPE_CHAT, msg));
+            plain += msg.size();
+        }
+        std::lock_guard lk(sink.mu);
+        EXPECT_EQ(sink.frames.size(), n);
+        uint32_t i = from;
+        for (auto& f : sink.frames) {
+            header_t hdr{};
+            std::memcpy(&hdr, f.data.data(), sizeof(hdr));
+            wire += hdr.payload_len;
+            std::vector<uint8_t> out;
+            EXPECT_TRUE(rec_b->session->decrypt_into(out, f.data.data() + sizeof(header_t),
+                                                     hdr.payload_len, hdr.packet_id, nullptr,
+                                                     hdr.flags & GNET_FLAG_KEY_PHASE));
+            EXPECT_EQ(out, make_structured_msg(i++));
+        }
+        sink.frames.clear();
+        return std::pair{wire, plain};
+    };
+
+    auto [wire, plain] = send_and_decode(0, 64);
+    EXPECT_LT(wire * 2, plain);
+    EXPECT_EQ(rec_b->session->stream.rx_blocks(), 64u);
+
+    // Смена эпохи ключа сбрасывает историю: первый блок новой эпохи — reset.
+    // Приёмник без истории (ждёт reset) декодирует его без отказов
+    ASSERT_TRUE(cm->rekey_session(cid_a));
+    rec_b->session->stream.reset();
+    send_and_decode(64, 8);
+    EXPECT_EQ(rec_b->session->rx_epoch(), 1u);
+    EXPECT_EQ(rec_b->session->stream.rx_blocks(), 72u);
+    EXPECT_EQ(rec_b->session->stream.rx_rejected(), 0u);
+
+    g_cap_sink = nullptr;
+    cm->shutdown();
+}
+
+// ─── LZ4 codec ────────────────────────────────────────────────────────────────
+
+TEST_F(CMTest, Compression_Lz4NegotiatedPerConnection) {
+    Config cfg(true);
+    cfg.compression.codec = "lz4";
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    auto& im   = impl(*cm);
+    auto rec_a = im.rcu_find(cid_a);
+    auto rec_b = impl(*cm_b_).rcu_find(cid_b);
+    ASSERT_TRUE(rec_a->peer_core_meta.caps_mask & CORE_CAP_LZ4);
+    EXPECT_EQ(im.codec_for_peer(*rec_a), Codec::Lz4);
+
+    std::vector<uint8_t> text;
+    for (uint32_t i = 0; text.size() < 16 * 1024; ++i) {
+        auto m = make_structured_msg(i);
+        text.insert(text.end(), m.begin(), m.end());
+    }
+    auto decode = [&](const sdk::FrameBuffer& frame) {
+        header_t hdr{};
+        std::memcpy(&hdr, frame.data(), sizeof(hdr));
+        return std::pair{hdr.payload_len,
+                         rec_b->session->decrypt(frame.data() + sizeof(header_t),
+                                                 hdr.payload_len, hdr.packet_id)};
+    };
+
+    auto lz4_count = [&] {
+        const auto s = bus_.stats_snapshot();
+        return s.compression.contains(MSG_TYPE_CHAT)
+            ? s.compression.at(MSG_TYPE_CHAT).lz4_frames : 0;
+    };
+    const uint64_t lz4_before = lz4_count();
+    auto [lz4_len, lz4_plain] = decode(im.build_frame(cid_a, MSG_TYPE_CHAT, text));
+    EXPECT_EQ(lz4_plain, text);
+    EXPECT_LT(lz4_len, text.size() / 2);
+    EXPECT_EQ(lz4_count() - lz4_before, 1u);
+
+    // Пир без CORE_CAP_LZ4 получает zstd
+    rec_a->peer_core_meta.caps_mask &= ~CORE_CAP_LZ4;
+    EXPECT_EQ(im.codec_for_peer(*rec_a), Codec::Zstd);
+    auto [zstd_len, zstd_plain] = decode(im.build_frame(cid_a, MSG_TYPE_CHAT, text));
+    EXPECT_EQ(zstd_plain, text);
+    EXPECT_NE(zstd_len, lz4_len);
+    EXPECT_EQ(lz4_count() - lz4_before, 1u) << "zstd frame must not count as LZ4";
+    cm->shutdown();
+}
+
+TEST(SessionTest, Lz4RejectsMalformedBody) {
+    NoiseSession s;
+    std::vector<uint8_t> text(8192);
+    for (size_t i = 0; i < text.size(); ++i) text[i] = static_cast<uint8_t>("goodnet "[i % 8]);
+    std::vector<uint8_t> body(NoiseSession::max_wire_size(text.size(), true, 0));
+    body.resize(NoiseSession::encode_body(body.data(), body.size(), text.data(), text.size(),
+                                          true, 0, 1, nullptr, Codec::Lz4));
+    ASSERT_EQ(body[0], 0x04) << "FLAG_LZ4";
+    EXPECT_EQ(s.decode_body(body.data(), body.size()), text);
+
+    auto bad_size = body;
+    const uint32_t wrong = static_cast<uint32_t>(text.size() / 2);
+    std::memcpy(bad_size.data() + 1, &wrong, 4);
+    EXPECT_TRUE(s.decode_body(bad_size.data(), bad_size.size()).empty());
+    EXPECT_TRUE(s.decode_body(body.data(), 3).empty());
+}
+
+// ─── Cipher suite (CORE_CAP_AES256GCM) ────────────────────────────────────────
+
+TEST(SessionTest, Aes256GcmRoundTripAndRejectsCrossCipher) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    NoiseSession aes, chacha;
+    randombytes_buf(aes.send_key, sizeof(aes.send_key));
+    std::memcpy(aes.recv_key, aes.send_key, sizeof(aes.recv_key));
+    std::memcpy(chacha.send_key, aes.send_key, sizeof(chacha.send_key));
+    std::memcpy(chacha.recv_key, aes.send_key, sizeof(chacha.recv_key));
+    EXPECT_EQ(aes.cipher(), AeadCipher::ChaCha20Poly1305);
+
+    if (!aes.set_cipher(AeadCipher::Aes256Gcm)) {
+        EXPECT_EQ(aes.cipher(), AeadCipher::ChaCha20Poly1305);
+        GTEST_SKIP() << "no AES-NI on this host";
+    }
+    std::vector<uint8_t> plain(3000);
+    randombytes_buf(plain.data(), plain.size());
+    auto wire = aes.encrypt(plain.data(), plain.size(), 7, true, 512, 1);
+    ASSERT_EQ(wire.size(), plain.size() + 1 + crypto_aead_aes256gcm_ABYTES);
+    EXPECT_EQ(aes.decrypt(wire.data(), wire.size(), 7), plain);
+    EXPECT_TRUE(chacha.decrypt(wire.data(), wire.size(), 7).empty()) << "cipher mismatch";
+
+    auto tampered = aes.encrypt(plain.data(), plain.size(), 8, true, 512, 1);
+    tampered[5] ^= 0x01;
+    EXPECT_TRUE(aes.decrypt(tampered.data(), tampered.size(), 8).empty());
+
+    // Новый ключ без set_cipher() не подхватывается — key schedule кэширован
+    aes.send_key[0] ^= 0xFF;
+    aes.recv_key[0] ^= 0xFF;
+    ASSERT_TRUE(aes.set_cipher(aes.cipher()));
+    auto rekeyed = aes.encrypt(plain.data(), plain.size(), 9, true, 512, 1);
+    EXPECT_EQ(aes.decrypt(rekeyed.data(), rekeyed.size(), 9), plain);
+    EXPECT_TRUE(chacha.decrypt(rekeyed.data(), rekeyed.size(), 9).empty());
+}
+
+TEST_F(CMTest, Cipher_NegotiatedFromCoreMetaAndSurvivesRekey) {
+    const bool aes = aes256gcm_available();
+    const auto want = aes ? AeadCipher::Aes256Gcm : AeadCipher::ChaCha20Poly1305;
+    EXPECT_EQ(bool(impl(*cm_a_).local_core_meta().caps_mask & CORE_CAP_AES256GCM), aes);
+
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto rec_a = impl(*cm_a_).rcu_find(cid_a);
+    auto rec_b = impl(*cm_b_).rcu_find(cid_b);
+    ASSERT_TRUE(rec_a && rec_a->session && rec_b && rec_b->session);
+    EXPECT_EQ(rec_a->session->cipher(), want);
+    EXPECT_EQ(rec_b->session->cipher(), want);
+    EXPECT_NE(cm_a_->dump_connections().find(aead_name(want)), std::string::npos);
+
+    auto round_trip = [&](uint64_t pkt) {
+        const std::vector<uint8_t> plain(900, 0x5A);
+        auto wire = rec_a->session->encrypt(plain.data(), plain.size(), pkt, false, 512, 1);
+        std::vector<uint8_t> out;
+        return rec_b->session->decrypt_into(out, wire.data(), wire.size(), pkt, nullptr,
+                                            rec_a->session->tx_phase())
+            && out == plain;
+    };
+    EXPECT_TRUE(round_trip(100));
+    ASSERT_TRUE(impl(*cm_a_).rekey_session(cid_a));
+    EXPECT_EQ(rec_a->session->cipher(), want);
+    EXPECT_TRUE(round_trip(101));
+    EXPECT_EQ(rec_b->session->rx_epoch(), 1u);
+}
+
+TEST_F(CMTest, Cipher_ConfigChaChaOnlyFallsBackOnBothSides) {
+    // security.cipher = "chacha20" не объявляет AES — обе стороны падают на ChaCha
+    Config cfg(true);
+    cfg.security.cipher = "chacha20";
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    EXPECT_FALSE(impl(*cm).local_core_meta().caps_mask & CORE_CAP_AES256GCM);
+    auto [cid_c, cid_d] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    auto rec_c = impl(*cm).rcu_find(cid_c);
+    auto rec_d = impl(*cm_b_).rcu_find(cid_d);
+    ASSERT_TRUE(rec_c && rec_c->session && rec_d && rec_d->session);
+    EXPECT_EQ(rec_c->session->cipher(), AeadCipher::ChaCha20Poly1305);
+    EXPECT_EQ(rec_d->session->cipher(), AeadCipher::ChaCha20Poly1305);
+    cm->shutdown();
+}
+
+// ─── Receive path: decrypt into the handler's buffer ──────────────────────────
+
+TEST(SessionTest, DecryptIntoReusesBufferAndShiftsRawBody) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    NoiseSession s;
+    randombytes_buf(s.send_key, sizeof(s.send_key));
+    std::memcpy(s.recv_key, s.send_key, sizeof(s.recv_key));
+
+    std::vector<uint8_t> plain(1200), text(8192, 'g');
+    randombytes_buf(plain.data(), plain.size());
+    std::vector<uint8_t> out;
+    out.reserve(16 * 1024);
+    const auto* cap = out.data();
+
+    auto raw = s.encrypt(plain.data(), plain.size(), 1, false, 512, 1);
+    ASSERT_TRUE(s.decrypt_into(out, raw.data(), raw.size(), 1));
+    EXPECT_EQ(out, plain);
+    EXPECT_EQ(out.data(), cap) << "raw body decrypted in place, no reallocation";
+
+    auto zst = s.encrypt(text.data(), text.size(), 2, true, 512, 1);
+    ASSERT_LT(zst.size(), text.size());
+    ASSERT_TRUE(s.decrypt_into(out, zst.data(), zst.size(), 2));
+    EXPECT_EQ(out, text);
+
+    EXPECT_FALSE(s.decrypt_into(out, raw.data(), raw.size(), 1)) << "replay";
+    EXPECT_TRUE(out.empty());
+    raw = s.encrypt(plain.data(), plain.size(), 3, false, 512, 1);
+    raw.back() ^= 0x01;
+    EXPECT_FALSE(s.decrypt_into(out, raw.data(), raw.size(), 3));
+}
+
+TEST_F(CMTest, Dispatch_RawFramesAllocationFree) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    std::vector<uint8_t> msg(300);
+    randombytes_buf(msg.data(), msg.size());
+    constexpr int WARMUP = 32, N = 200;
+    std::vector<sdk::FrameBuffer> frames;
+    for (int i = 0; i < WARMUP + N; ++i)
+        frames.push_back(im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg));
+
+    size_t delivered = 0;
+    bool   intact    = true;
+    bus_.subscribe(MSG_TYPE_CHAT, "alloc_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData& d) {
+            ++delivered;
+            intact = intact && *d == msg;
+            return PROPAGATION_CONTINUE;
+        });
+
+    for (int i = 0; i < WARMUP; ++i)
+        im_b.handle_data(cid_b, frames[i].data(), frames[i].size());
+
+    t_allocs       = 0;
+    t_count_allocs = true;
+    for (int i = WARMUP; i < WARMUP + N; ++i)
+        im_b.handle_data(cid_b, frames[i].data(), frames[i].size());
+    t_count_allocs = false;
+
+    EXPECT_EQ(delivered, size_t{WARMUP + N});
+    EXPECT_TRUE(intact);
+    EXPECT_EQ(t_allocs, 0u) << "heap allocations for " << N << " received raw frames";
+}
+
+// ─── NonceWindow (lock-free, security.replay_window) ──────────────────────────
+
+TEST(NonceWindowTest, ReordersWithinConfiguredWindow) {
+    NonceWindow w;
+    EXPECT_EQ(w.window(), NonceWindow::WINDOW_SIZE);
+    w.configure(100);
+    EXPECT_EQ(w.window(), 128u) << "rounded up to whole blocks";
+    w.configure(1'000'000);
+    EXPECT_EQ(w.window(), NonceWindow::MAX_WINDOW);
+
+    std::vector<uint64_t> order(NonceWindow::MAX_WINDOW);
+    std::iota(order.begin(), order.end(), 1);
+    std::shuffle(order.begin(), order.end(), std::mt19937_64{17});
+    for (auto n : order) ASSERT_TRUE(w.accept(n)) << n;
+    for (auto n : order) ASSERT_FALSE(w.accept(n)) << "replay " << n;
+    EXPECT_FALSE(w.accept(0));
+
+    // Скачок вперёд: всё старше окна отвергается, внутри окна — ровно один раз
+    const uint64_t top = 50'000;
+    ASSERT_TRUE(w.accept(top));
+    EXPECT_EQ(w.highest(), top);
+    EXPECT_FALSE(w.accept(top - NonceWindow::MAX_WINDOW));
+    EXPECT_TRUE(w.accept(top - NonceWindow::MAX_WINDOW + 1));
+    EXPECT_FALSE(w.accept(top - NonceWindow::MAX_WINDOW + 1));
+    EXPECT_TRUE(w.accept(top - 1));
+
+    w.reset();
+    EXPECT_TRUE(w.accept(5));
+    EXPECT_TRUE(w.accept(3));
+    EXPECT_FALSE(w.accept(5));
+}
+
+TEST(NonceWindowTest, ConcurrentAcceptsEachNonceExactlyOnce) {
+    constexpr size_t N = 200'000, THREADS = 4;
+    NonceWindow w;
+    w.configure(2048);
+    const size_t chunk = w.window() / 4;
+
+    // Каждый поток проходит все nonce; внутри чанка порядок свой (как при
+    // multipath-переупорядочивании), поэтому потоки конкурируют за одни слова
+    std::vector<std::atomic<uint8_t>> hits(N + 1);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 rng{t};
+            std::vector<uint64_t> part(chunk);
+            for (uint64_t base = 1; base <= N; base += chunk) {
+                const size_t n = std::min<uint64_t>(chunk, N + 1 - base);
+                part.resize(n);
+                std::iota(part.begin(), part.end(), base);
+                std::shuffle(part.begin(), part.end(), rng);
+                for (auto nonce : part)
+                    if (w.accept(nonce)) hits[nonce].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    size_t once = 0;
+    for (size_t n = 1; n <= N; ++n) {
+        ASSERT_LE(hits[n].load(), 1u) << "nonce " << n << " accepted twice";
+        once += hits[n].load();
+    }
+    EXPECT_EQ(once, N);
+    EXPECT_EQ(w.highest(), N);
+}
+
+TEST(SessionTest, ForgedFrameDoesNotConsumeNonce) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    NoiseSession s;
+    randombytes_buf(s.send_key, sizeof(s.send_key));
+    std::memcpy(s.recv_key, s.send_key, sizeof(s.recv_key));
+
+    const std::vector<uint8_t> plain(64, 0x42);
+    auto wire   = s.encrypt(plain.data(), plain.size(), 5, false, 512, 1);
+    auto forged = wire;
+    forged[3] ^= 0x80;
+    EXPECT_TRUE(s.decrypt(forged.data(), forged.size(), 5).empty());
+    auto far = s.encrypt(plain.data(), plain.size(), 1'000'000, false, 512, 1);
+    far.back() ^= 0x01;
+    EXPECT_TRUE(s.decrypt(far.data(), far.size(), 1'000'000).empty());
+
+    EXPECT_EQ(s.decrypt(wire.data(), wire.size(), 5), plain)
+        << "MAC failure must neither mark nonce 5 nor advance the window";
+    EXPECT_TRUE(s.decrypt(wire.data(), wire.size(), 5).empty()) << "replay";
+}
+
+// ─── Key epochs (automatic rekey, GNET_FLAG_KEY_PHASE) ────────────────────────
+
+TEST(SessionTest, KeyPhaseRotationKeepsPreviousKeyForOverlap) {
+    if (sodium_init() < 0) GTEST_SKIP();
+    NoiseSession a, b;
+    randombytes_buf(a.send_key, sizeof(a.send_key));
+    std::memcpy(b.recv_key, a.send_key, sizeof(b.recv_key));
+
+    const std::vector<uint8_t> plain(200, 0x33);
+    auto seal = [&](uint64_t pkt) {
+        return std::pair{a.encrypt(plain.data(), plain.size(), pkt, false, 512, 1),
+                         a.tx_phase()};
+    };
+    auto open = [&](const auto& f, uint64_t pkt) {
+        std::vector<uint8_t> out;
+        return b.decrypt_into(out, f.first.data(), f.first.size(), pkt, nullptr, f.second)
+            && out == plain;
+    };
+
+    const auto old1 = seal(1), old2 = seal(2);
+    const uint64_t now = 1'000'000'000;
+    ASSERT_GT(a.rotate_tx(now), 0u);
+    EXPECT_EQ(a.tx_epoch(), 1u);
+    EXPECT_TRUE(a.tx_phase());
+    EXPECT_EQ(a.rotate_tx(now + 1), 0u) << "min interval between rotations";
+    EXPECT_EQ(a.rotate_tx(now + 3 * NoiseSession::REKEY_MIN_INTERVAL_NS), 0u)
+        << "no frame sent in epoch 1 yet";
+
+    // Forged frame of the next phase must not move the receiver's epoch
+    auto forged = seal(3);
+    forged.first[5] ^= 0x10;
+    EXPECT_FALSE(open(forged, 3));
+    EXPECT_EQ(b.rx_epoch(), 0u);
+
+    // New-epoch frame overtakes frames still in flight from the old one
+    EXPECT_TRUE(open(seal(4), 4));
+    EXPECT_EQ(b.rx_epoch(), 1u);
+    EXPECT_GT(b.last_rx_rekey_cost_ns(), 0u);
+    EXPECT_TRUE(open(old2, 2));
+    EXPECT_TRUE(open(old1, 1));
+    EXPECT_EQ(b.rx_prev_key_hits(), 2u);
+    EXPECT_FALSE(open(old1, 1)) << "replay across epochs";
+    EXPECT_TRUE(open(seal(5), 5));
+    EXPECT_EQ(a.tx_epoch(), b.rx_epoch());
+}
+
+TEST_F(CMTest, Rekey_AutoByPacketCountWithoutDrops) {
+    Config cfg(true);
+    cfg.security.rekey_after_packets = 50;
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    auto [cid_a, cid_b] = do_handshake(*cm, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm);
+    auto& im_b = impl(*cm_b_);
+    auto rec_a = im_a.rcu_find(cid_a);
+    auto rec_b = im_b.rcu_find(cid_b);
+    ASSERT_TRUE(rec_a->peer_core_meta.caps_mask & CORE_CAP_KEY_EPOCH);
+
+    size_t delivered = 0;
+    bus_.subscribe(MSG_TYPE_CHAT, "rekey_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++delivered;
+            return PROPAGATION_CONTINUE;
+        });
+
+    const auto before = bus_.stats_snapshot();
+    std::vector<uint8_t> msg(700, 0x21);
+    std::vector<sdk::FrameBuffer> frames;
+    size_t phase1 = 0;
+    for (int i = 0; i < 120; ++i) {
+        frames.push_back(im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg));
+        header_t hdr{};
+        std::memcpy(&hdr, frames.back().data(), sizeof(hdr));
+        phase1 += (hdr.flags & GNET_FLAG_KEY_PHASE) != 0;
+    }
+    EXPECT_EQ(rec_a->session->tx_epoch(), 1u) << "second rotation waits for min interval";
+    EXPECT_EQ(phase1, 70u);
+
+    // Последние кадры старой эпохи приходят после первых кадров новой
+    for (size_t i = 50; i < 60; ++i)
+        im_b.handle_data(cid_b, frames[i].data(), frames[i].size());
+    for (size_t i = 0; i < 50; ++i)
+        im_b.handle_data(cid_b, frames[i].data(), frames[i].size());
+    for (size_t i = 60; i < frames.size(); ++i)
+        im_b.handle_data(cid_b, frames[i].data(), frames[i].size());
+
+    const auto after = bus_.stats_snapshot();
+    EXPECT_EQ(delivered, frames.size());
+    EXPECT_EQ(after.drops[static_cast<size_t>(DropReason::DecryptFail)],
+              before.drops[static_cast<size_t>(DropReason::DecryptFail)]);
+    EXPECT_EQ(after.rekeys_tx - before.rekeys_tx, 1u);
+    EXPECT_EQ(after.rekeys_rx - before.rekeys_rx, 1u);
+    EXPECT_GT(after.rekey_ns, before.rekey_ns);
+    EXPECT_EQ(rec_b->session->rx_epoch(), 1u);
+    EXPECT_EQ(rec_b->session->rx_prev_key_hits(), 50u);
+    EXPECT_NE(cm->dump_connections().find("key_epoch"), std::string::npos);
+    cm->shutdown();
+}
+
+// ─── Resumption (Noise_IK, peer identity cache) ───────────────────────────────
+
+TEST_F(CMTest, Resume_ReconnectUsesNoiseIkAndSkipsVerification) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+    EXPECT_FALSE(im_a.rcu_find(cid_a)->resumed);
+    ASSERT_TRUE(im_a.rcu_find(cid_a)->peer_core_meta.caps_mask & CORE_CAP_RESUME);
+    ASSERT_TRUE(im_a.resume_target("10.0.0.2:9999").has_value());
+    EXPECT_FALSE(im_b.resume_target("10.0.0.1:9998").has_value()) << "inbound ports are not cached";
+
+    im_a.handle_disconnect(cid_a, 0);
+    im_b.handle_disconnect(cid_b, 0);
+
+    auto [cid_a2, cid_b2] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto rec_a = im_a.rcu_find(cid_a2);
+    auto rec_b = im_b.rcu_find(cid_b2);
+    ASSERT_TRUE(rec_a && rec_b);
+    EXPECT_EQ(rec_a->state, STATE_ESTABLISHED);
+    EXPECT_EQ(rec_b->state, STATE_ESTABLISHED);
+    EXPECT_TRUE(rec_a->resumed);
+    EXPECT_TRUE(rec_b->resumed);
+    EXPECT_EQ(std::memcmp(rec_b->peer_user_pubkey, id_a_.user_pubkey, GN_SIGN_PUBLICKEYBYTES), 0);
+    EXPECT_EQ(std::memcmp(rec_a->session->handshake_hash, rec_b->session->handshake_hash,
+                          noise::HASHLEN), 0);
+    EXPECT_NE(cm_a_->dump_connections().find("\"resumed\": true"), std::string::npos);
+
+    // Транспортные ключи IK-сессии согласованы в обе стороны
+    size_t delivered = 0;
+    bus_.subscribe(MSG_TYPE_CHAT, "resume_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            ++delivered;
+            return PROPAGATION_CONTINUE;
+        });
+    const std::vector<uint8_t> msg(100, 0x77);
+    auto ab = im_a.build_frame(cid_a2, MSG_TYPE_CHAT, msg);
+    auto ba = im_b.build_frame(cid_b2, MSG_TYPE_CHAT, msg);
+    im_b.handle_data(cid_b2, ab.data(), ab.size());
+    im_a.handle_data(cid_a2, ba.data(), ba.size());
+    EXPECT_EQ(delivered, 2u);
+}
+
+TEST_F(CMTest, Resume_RefusedByNewIdentityFallsBackToXX) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    impl(*cm_a_).handle_disconnect(cid_a, 0);
+
+    // На том же адресе теперь другой узел: IK msg1 ему не прочитать → отказ → XX
+    auto dir_c = tmp_dir("c");
+    auto id_c  = NodeIdentity::load_or_generate(dir_c);
+    auto cm_c  = std::make_unique<ConnectionManager>(bus_, id_c);
+    const auto fails = bus_.stats_snapshot().auth_fail;
+    auto [cid_a2, cid_c] = do_handshake(*cm_a_, id_a_, *cm_c, id_c, false);
+    auto rec_a = impl(*cm_a_).rcu_find(cid_a2);
+    ASSERT_TRUE(rec_a);
+    EXPECT_EQ(rec_a->state, STATE_ESTABLISHED);
+    EXPECT_FALSE(rec_a->resumed);
+    EXPECT_EQ(std::memcmp(rec_a->peer_user_pubkey, id_c.user_pubkey, GN_SIGN_PUBLICKEYBYTES), 0);
+    EXPECT_EQ(bus_.stats_snapshot().auth_fail, fails);
+
+    // Узел с выключенным resumption не объявляет CORE_CAP_RESUME
+    Config cfg(true);
+    cfg.security.resumption = false;
+    ConnectionManager off(bus_, id_c, &cfg);
+    EXPECT_FALSE(impl(off).local_core_meta().caps_mask & CORE_CAP_RESUME);
+
+    cm_c->shutdown();
+    off.shutdown();
+    fs::remove_all(dir_c);
+}
+
+TEST_F(CMTest, Resume_ReplayedMsg1DoesNotBindIdentity) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+    im_a.handle_disconnect(cid_a, 0);
+    im_b.handle_disconnect(cid_b, 0);
+
+    // Перехватываем NOISE_RESUME, который A шлёт при переподключении
+    CapturingSink sink;
+    auto cap = make_capturing_connector(&sink);
+    cm_a_->register_connector("tcp", &cap);
+    cm_b_->register_connector("tcp", &cap);
+    host_api_t api_a{}, api_b{};
+    cm_a_->fill_host_api(&api_a);
+    cm_b_->fill_host_api(&api_b);
+    auto take = [&](uint16_t type) {
+        std::lock_guard lk(sink.mu);
+        for (auto& f : sink.frames)
+            if (f.data.size() >= sizeof(header_t) &&
+                reinterpret_cast<const header_t*>(f.data.data())->payload_type == type)
+                return f.data;
+        return std::vector<uint8_t>{};
+    };
+
+    endpoint_t ep_ab{};
+    strncpy(ep_ab.address, "10.0.0.2", sizeof(ep_ab.address));
+    ep_ab.port  = 9999;
+    ep_ab.flags = EP_FLAG_OUTBOUND;
+    const conn_id_t cid_a2 = api_a.on_connect(api_a.ctx, &ep_ab);
+    const auto msg1 = take(MSG_TYPE_NOISE_RESUME);
+    ASSERT_FALSE(msg1.empty());
+    im_a.handle_disconnect(cid_a2, 0);
+    sink.clear();
+
+    // Атакующий переигрывает msg1 со своего адреса: B отвечает (msg1 валиден),
+    // но identity A к чужому соединению не привязывает
+    endpoint_t ep_x{};
+    strncpy(ep_x.address, "10.0.0.66", sizeof(ep_x.address));
+    ep_x.port = 4444;
+    const conn_id_t cid_x = api_b.on_connect(api_b.ctx, &ep_x);
+    api_b.on_data(api_b.ctx, cid_x, msg1.data(), msg1.size());
+    EXPECT_FALSE(take(MSG_TYPE_NOISE_RESUME_RESP).empty());
+    auto rec_x = im_b.rcu_find(cid_x);
+    ASSERT_TRUE(rec_x);
+    EXPECT_NE(rec_x->state, STATE_ESTABLISHED);
+    EXPECT_FALSE(rec_x->peer_authenticated);
+    EXPECT_FALSE(cm_b_->get_peer_pubkey(cid_x)) << "identity reported before key proof";
+    EXPECT_TRUE(cm_b_->get_peer_pubkey_hex(cid_x).empty());
+    EXPECT_EQ(cm_b_->find_conn_by_pubkey(id_a_.user_pubkey_hex().c_str()), CONN_ID_INVALID);
+
+    // Без ключей инициатора кадр не расшифровать — запись остаётся в хэндшейке
+    const auto fails = bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::DecryptFail)];
+    header_t h{};
+    h.magic        = GNET_MAGIC;
+    h.proto_ver    = GNET_PROTO_VER;
+    h.payload_type = MSG_TYPE_CHAT;
+    h.payload_len  = 32;
+    std::vector<uint8_t> forged(sizeof(h) + 32, 0x5A);
+    std::memcpy(forged.data(), &h, sizeof(h));
+    api_b.on_data(api_b.ctx, cid_x, forged.data(), forged.size());
+    EXPECT_EQ(bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::DecryptFail)],
+              fails + 1);
+    EXPECT_NE(im_b.rcu_find(cid_x)->state, STATE_ESTABLISHED);
+    EXPECT_EQ(cm_b_->find_conn_by_pubkey(id_a_.user_pubkey_hex().c_str()), CONN_ID_INVALID);
+    g_cap_sink = nullptr;
+
+    // Настоящий A по-прежнему возобновляет сессию — не «duplicate peer»
+    auto [cid_a3, cid_b3] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto rec_a = im_a.rcu_find(cid_a3);
+    auto rec_b = im_b.rcu_find(cid_b3);
+    ASSERT_TRUE(rec_a && rec_b);
+    EXPECT_EQ(rec_a->state, STATE_ESTABLISHED);
+    EXPECT_EQ(rec_b->state, STATE_ESTABLISHED);
+    EXPECT_TRUE(rec_b->resumed);
+    EXPECT_EQ(cm_b_->find_conn_by_pubkey(id_a_.user_pubkey_hex().c_str()), cid_b3);
+    EXPECT_EQ(cm_b_->get_peer_pubkey_hex(cid_b3), id_a_.user_pubkey_hex());
+
+    // Переигранное соединение отваливается — маршрут настоящего A остаётся
+    im_b.handle_disconnect(cid_x, 0);
+    EXPECT_EQ(cm_b_->find_conn_by_pubkey(id_a_.user_pubkey_hex().c_str()), cid_b3);
+}
+
+// pk_index_ снимается только своей записью: другое соединение того же пира
+// (дубликат) при отключении не убирает маршрут живого
+TEST_F(CMTest, Disconnect_KeepsPubkeyRouteOfOtherConnection) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_b = impl(*cm_b_);
+    const auto pk = id_a_.user_pubkey_hex();
+    ASSERT_EQ(cm_b_->find_conn_by_pubkey(pk.c_str()), cid_b);
+
+    const conn_id_t other = cid_b + 1000;
+    {
+        auto live = im_b.rcu_find(cid_b);
+        std::lock_guard wlk(im_b.records_write_mu_);
+        im_b.rcu_update([&](ConnectionManager::Impl::RecordMap& m) {
+            auto rec = std::make_shared<ConnectionRecord>();
+            rec->id                 = other;
+            rec->local_scheme       = "tcp";
+            rec->peer_authenticated = true;
+            std::memcpy(rec->peer_user_pubkey, live->peer_user_pubkey,
+                        sizeof(rec->peer_user_pubkey));
+            m[other] = std::move(rec);
+        });
+    }
+    im_b.handle_disconnect(other, 0);
+    EXPECT_FALSE(im_b.rcu_find(other));
+    EXPECT_EQ(cm_b_->find_conn_by_pubkey(pk.c_str()), cid_b);
+
+    im_b.handle_disconnect(cid_b, 0);
+    EXPECT_EQ(cm_b_->find_conn_by_pubkey(pk.c_str()), CONN_ID_INVALID);
+}
+
+TEST_F(CMTest, Resume_ReconnectStormResumesEveryPeer) {
+    // Рестарт relay: N переподключений одного пира. С кэшем каждое — Noise_IK,
+    // без кэша — полный Noise_XX.
+    constexpr int N = 16;
+    for (const bool resume : {false, true}) {
+        Config cfg(true);
+        cfg.security.resumption      = resume;
+        cfg.security.peer_cache_size = resume ? 4096 : 0;
+        cfg.core.handshake_rate_per_ip = 0;   // все N переподключений с одного адреса
+        ConnectionManager peer (bus_, id_a_, &cfg);
+        ConnectionManager relay(bus_, id_b_, &cfg);
+        auto [a0, b0] = do_handshake(peer, id_a_, relay, id_b_, false);
+        impl(peer).handle_disconnect(a0, 0);
+        impl(relay).handle_disconnect(b0, 0);
+
+        int resumed = 0;
+        for (int i = 0; i < N; ++i) {
+            auto [a, b] = do_handshake(peer, id_a_, relay, id_b_, false);
+            auto rec = impl(relay).rcu_find(b);
+            ASSERT_TRUE(rec);
+            EXPECT_EQ(rec->state, STATE_ESTABLISHED);
+            resumed += rec->resumed;
+            impl(peer).handle_disconnect(a, 0);
+            impl(relay).handle_disconnect(b, 0);
+        }
+        EXPECT_EQ(resumed, resume ? N : 0) << "resume=" << resume;
+        peer.shutdown();
+        relay.shutdown();
+    }
+}
+
+// ─── Handshake pool + admission control ───────────────────────────────────────
+
+TEST_F(CMTest, Admission_RefusesOverConnectionHandshakeAndPerIpLimits) {
+    Config cfg(true);
+    cfg.core.max_connections       = 6;
+    cfg.core.max_handshakes        = 4;
+    cfg.core.handshake_rate_per_ip = 2;
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    host_api_t api{};
+    cm->fill_host_api(&api);
+    cm->register_connector("tcp", &mock_ops_);
+    auto& im = impl(*cm);
+
+    auto connect = [&](const char* addr, uint16_t port, uint8_t flags = 0) {
+        endpoint_t ep{};
+        strncpy(ep.address, addr, sizeof(ep.address));
+        ep.port  = port;
+        ep.flags = flags;
+        return api.on_connect(api.ctx, &ep);
+    };
+    auto denied = [&] {
+        return bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::AdmissionDenied)];
+    };
+    const auto d0 = denied();
+
+    // Per-IP: burst = rate = 2, третий handshake с того же адреса отклонён
+    const conn_id_t in1 = connect("10.0.0.1", 1);
+    const conn_id_t in2 = connect("10.0.0.1", 2);
+    EXPECT_NE(in1, CONN_ID_INVALID);
+    EXPECT_NE(in2, CONN_ID_INVALID);
+    EXPECT_EQ(connect("10.0.0.1", 3), CONN_ID_INVALID);
+    // Loopback адресом не лимитируется
+    EXPECT_NE(connect("127.0.0.1", 4, EP_FLAG_TRUSTED), CONN_ID_INVALID);
+    EXPECT_NE(connect("10.0.0.2", 5), CONN_ID_INVALID);
+
+    // 4 handshake в процессе: входящие отклоняются, исходящие — нет
+    EXPECT_EQ(im.handshakes_active_.load(), 4u);
+    EXPECT_EQ(connect("10.0.0.3", 6), CONN_ID_INVALID);
+    const conn_id_t out1 = connect("10.0.0.4", 7, EP_FLAG_OUTBOUND);
+    EXPECT_NE(out1, CONN_ID_INVALID);
+    EXPECT_NE(connect("10.0.0.5", 8, EP_FLAG_OUTBOUND), CONN_ID_INVALID);
+
+    // max_connections — для обоих направлений
+    EXPECT_EQ(cm->connection_count(), 6u);
+    EXPECT_EQ(connect("10.0.0.6", 9, EP_FLAG_OUTBOUND), CONN_ID_INVALID);
+    EXPECT_EQ(denied() - d0, 3u);
+
+    // Закрытые handshake освобождают слоты
+    im.handle_disconnect(in1, 0);
+    im.handle_disconnect(in2, 0);
+    im.handle_disconnect(out1, 0);
+    EXPECT_EQ(im.handshakes_active_.load(), 3u);
+    EXPECT_NE(connect("10.0.0.7", 10), CONN_ID_INVALID);
+
+    // Простоявший секунду bucket полон — cleanup его удаляет
+    {
+        std::lock_guard lk(im.admission_mu_);
+        for (auto& [addr, b] : im.admission_buckets_) b.last -= std::chrono::seconds(2);
+    }
+    im.expire_admission_buckets();
+    EXPECT_TRUE(im.admission_buckets_.empty());
+    EXPECT_EQ(cfg.get_raw("core.handshake_rate_per_ip").value_or(""), "2");
+    cm->shutdown();
+}
+
+TEST_F(CMTest, Admission_StalledHandshakeTimesOut) {
+    Config cfg(true);
+    cfg.core.max_handshakes = 2;
+    auto cm = std::make_unique<ConnectionManager>(bus_, id_a_, &cfg);
+    static std::vector<conn_id_t> closed;
+    closed.clear();
+    auto ops = make_mock_connector_ops();
+    ops.close_now = [](void*, conn_id_t id) { closed.push_back(id); };
+    host_api_t api{};
+    cm->fill_host_api(&api);
+    cm->register_connector("tcp", &ops);
+    auto& im = impl(*cm);
+
+    auto connect = [&](const char* addr) {
+        endpoint_t ep{};
+        strncpy(ep.address, addr, sizeof(ep.address));
+        ep.port = 7000;
+        return api.on_connect(api.ctx, &ep);
+    };
+
+    // Два пира открыли соединение и замолчали — слоты заняты
+    const conn_id_t s1 = connect("10.0.0.1");
+    const conn_id_t s2 = connect("10.0.0.2");
+    ASSERT_NE(s1, CONN_ID_INVALID);
+    ASSERT_NE(s2, CONN_ID_INVALID);
+    EXPECT_EQ(connect("10.0.0.3"), CONN_ID_INVALID);
+
+    // До дедлайна cleanup их не трогает
+    cm->cleanup_stale_pending();
+    EXPECT_EQ(im.handshakes_active_.load(), 2u);
+    EXPECT_TRUE(closed.empty());
+
+    im.rcu_find(s1)->handshake_started -= ConnectionManager::Impl::HANDSHAKE_TIMEOUT
+                                        + std::chrono::seconds(1);
+    cm->cleanup_stale_pending();
+    EXPECT_EQ(closed, std::vector<conn_id_t>{s1});
+    EXPECT_FALSE(im.rcu_find(s1));
+    EXPECT_TRUE(im.rcu_find(s2));
+    EXPECT_EQ(im.handshakes_active_.load(), 1u);
+    EXPECT_NE(connect("10.0.0.4"), CONN_ID_INVALID);
+    cm->shutdown();
+}
+
+TEST_F(CMTest, HandshakePool_OffloadsCryptoAndQueuesFramesBehindIt) {
+    cm_b_->start_handshake_pool(2);
+
+    CapturingSink sink;
+    auto cap_ops = make_capturing_connector(&sink);
+    host_api_t api_a{}, api_b{};
+    cm_a_->fill_host_api(&api_a);
+    cm_b_->fill_host_api(&api_b);
+    cm_a_->register_connector("tcp", &cap_ops);
+    cm_b_->register_connector("tcp", &cap_ops);
+
+    endpoint_t ep_ab{};
+    strncpy(ep_ab.address, "10.0.0.2", sizeof(ep_ab.address));
+    ep_ab.port  = 9999;
+    ep_ab.flags = EP_FLAG_OUTBOUND;
+    endpoint_t ep_ba{};
+    strncpy(ep_ba.address, "10.0.0.1", sizeof(ep_ba.address));
+    ep_ba.port = 9998;
+
+    const conn_id_t cid_a = api_a.on_connect(api_a.ctx, &ep_ab);
+    const conn_id_t cid_b = api_b.on_connect(api_b.ctx, &ep_ba);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+    EXPECT_FALSE(im_a.rcu_find(cid_a)->hs_lane) << "no pool on A — inline";
+    ASSERT_TRUE(im_b.rcu_find(cid_b)->hs_lane);
+
+    // RESP пишет воркер пула, не вызывающий поток
+    auto wait_frame = [&](uint16_t type) {
+        for (int i = 0; i < 2000; ++i) {
+            if (auto f = sink.extract(type); !f.empty()) return f;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return std::vector<uint8_t>{};
+    };
+    auto init = wait_frame(MSG_TYPE_NOISE_INIT);
+    ASSERT_FALSE(init.empty());
+    api_b.on_data(api_b.ctx, cid_b, init.data(), init.size());
+    auto resp = wait_frame(MSG_TYPE_NOISE_RESP);
+    ASSERT_FALSE(resp.empty());
+    api_a.on_data(api_a.ctx, cid_a, resp.data(), resp.size());
+    auto fin = wait_frame(MSG_TYPE_NOISE_FIN);
+    ASSERT_FALSE(fin.empty());
+    ASSERT_EQ(im_a.rcu_find(cid_a)->state, STATE_ESTABLISHED);
+
+    // A шлёт данные сразу за FIN: на B они ждут finalize в lane, а не отбрасываются
+    std::atomic<int> delivered{0};
+    bus_.subscribe(MSG_TYPE_CHAT, "pool_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            delivered.fetch_add(1);
+            return PROPAGATION_CONTINUE;
+        });
+    const auto early = bus_.stats_snapshot().drops[
+        static_cast<size_t>(DropReason::StateNotEstablished)];
+    const std::vector<uint8_t> msg(64, 0x42);
+    auto d1 = im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg);
+    auto d2 = im_a.build_frame(cid_a, MSG_TYPE_CHAT, msg);
+    api_b.on_data(api_b.ctx, cid_b, fin.data(), fin.size());
+    api_b.on_data(api_b.ctx, cid_b, d1.data(), d1.size());
+    api_b.on_data(api_b.ctx, cid_b, d2.data(), d2.size());
+
+    for (int i = 0; i < 2000 && delivered.load() < 2; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(delivered.load(), 2);
+    EXPECT_EQ(im_b.rcu_find(cid_b)->state, STATE_ESTABLISHED);
+    EXPECT_EQ(im_b.rcu_find(cid_b)->hs_lane->pending.load(), 0u);
+    EXPECT_EQ(im_b.handshakes_active_.load(), 0u);
+    EXPECT_EQ(bus_.stats_snapshot().drops[static_cast<size_t>(DropReason::StateNotEstablished)],
+              early);
+
+    cm_a_->register_connector("tcp", &mock_ops_);
+    cm_b_->register_connector("tcp", &mock_ops_);
+    g_cap_sink = nullptr;
+}
+
+// Задачи lane, не успевшие стартовать до stop(), снимаются вместе с pending;
+// после stop() try_post отказывает и ничего не оставляет в lane
+TEST(WorkerPoolTest, StopCancelsUnstartedLaneTasks) {
+    WorkerPool pool(0, 16);   // без потоков: drain lane остаётся в очереди
+    auto lane = std::make_shared<WorkerPool::Lane>();
+    int ran = 0;
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(pool.try_post(lane, [&] { ++ran; }));
+    ASSERT_TRUE(pool.try_post([&] { ++ran; }));
+    EXPECT_EQ(lane->pending.load(), 3u);
+    EXPECT_EQ(pool.queued(), 4u);
+
+    pool.stop();
+    EXPECT_EQ(ran, 0);
+    EXPECT_EQ(lane->pending.load(), 0u);
+    EXPECT_EQ(pool.queued(), 0u);
+
+    EXPECT_FALSE(pool.try_post(lane, [&] { ++ran; }));
+    EXPECT_FALSE(pool.try_post([&] { ++ran; }));
+    EXPECT_EQ(lane->pending.load(), 0u);
+    EXPECT_EQ(pool.queued(), 0u);
+}
+
+// ─── Stream reassembly (random fragmentation) ─────────────────────────────────
+
+TEST(StreamReassemblerTest, RandomlyFragmentedStreamYieldsEveryFrame) {
+    std::vector<size_t> lens;
+    const auto stream = make_frame_stream(2000, 3000, 7, &lens);
+
+    for (size_t max_chunk : {1, 7, 64, 1500, 65536}) {
+        StreamReassembler rs;
+        size_t got = 0, zero_copy = 0;
+        size_t off = 0;
+        for (size_t n : random_cuts(stream.size(), max_chunk, max_chunk)) {
+            std::span<const uint8_t> in(stream.data() + off, n);
+            off += n;
+            StreamReassembler::View v;
+            while (rs.next(in, 1 << 20, v) == StreamReassembler::Status::Ready) {
+                ASSERT_EQ(v.hdr->packet_id, got);
+                ASSERT_EQ(v.payload.size(), lens[got]);
+                for (size_t k = 0; k < v.payload.size(); ++k)
+                    ASSERT_EQ(v.payload[k], static_cast<uint8_t>(got + k));
+                if (v.payload.data() >= stream.data()
+                    && v.payload.data() < stream.data() + stream.size()) ++zero_copy;
+                ++got;
+            }
+        }
+        EXPECT_EQ(got, lens.size()) << "max_chunk " << max_chunk;
+        EXPECT_EQ(rs.buffered(), 0u);
+        if (max_chunk == 65536) {
+            EXPECT_GT(zero_copy, got / 2) << "contiguous frames are views";
+        }
+    }
+}
+
+TEST(StreamReassemblerTest, RejectsBadHeaderAndOversizedFrameBeforeBuffering) {
+    header_t h{};
+    h.magic       = GNET_MAGIC;
+    h.proto_ver   = GNET_PROTO_VER;
+    h.payload_len = 4096;
+    const auto* hp = reinterpret_cast<const uint8_t*>(&h);
+
+    // Заголовок разрезан: проверка срабатывает, как только он дописан
+    StreamReassembler rs;
+    StreamReassembler::View v;
+    std::span<const uint8_t> in(hp, 9);
+    EXPECT_EQ(rs.next(in, 1024, v), StreamReassembler::Status::NeedMore);
+    in = std::span<const uint8_t>(hp + 9, sizeof(h) - 9);
+    EXPECT_EQ(rs.next(in, 1024, v), StreamReassembler::Status::TooLarge);
+    EXPECT_EQ(rs.rejected().payload_len, 4096u);
+    EXPECT_EQ(rs.buffered(), 0u);
+
+    h.proto_ver = GNET_PROTO_VER + 1;
+    in = std::span<const uint8_t>(hp, sizeof(h));
+    EXPECT_EQ(rs.next(in, 1 << 20, v), StreamReassembler::Status::BadProtoVer);
+
+    h.magic = 0xDEADBEEF;
+    in = std::span<const uint8_t>(hp, sizeof(h));
+    EXPECT_EQ(rs.next(in, 1 << 20, v), StreamReassembler::Status::BadMagic);
+    EXPECT_EQ(rs.rejected().magic, 0xDEADBEEFu);
+}
+
+TEST_F(CMTest, HandleData_RandomlyFragmentedStreamDeliversEveryFrame) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    std::mt19937_64 rng{11};
+    std::vector<std::vector<uint8_t>> msgs;
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 300; ++i) {
+        std::vector<uint8_t> m(1 + rng() % 2000);
+        randombytes_buf(m.data(), m.size());
+        auto f = im_a.build_frame(cid_a, MSG_TYPE_CHAT, m);
+        stream.insert(stream.end(), f.data(), f.data() + f.size());
+        msgs.push_back(std::move(m));
+    }
+
+    size_t delivered = 0;
+    bool   in_order  = true;
+    bus_.subscribe(MSG_TYPE_CHAT, "frag_sink",
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData& d) {
+            in_order = in_order && delivered < msgs.size() && *d == msgs[delivered];
+            ++delivered;
+            return PROPAGATION_CONTINUE;
+        });
+
+    size_t off = 0;
+    for (size_t n : random_cuts(stream.size(), 900, 3)) {
+        im_b.handle_data(cid_b, stream.data() + off, n);
+        off += n;
+    }
+    EXPECT_EQ(delivered, msgs.size());
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(impl(*cm_b_).rcu_find(cid_b)->rx_stream.buffered(), 0u);
+}
+
+// ─── Pooled PacketData ────────────────────────────────────────────────────────
+
+TEST(PacketDataTest, RecyclesBlockOnlyAfterLastReference) {
+    header_t h{};
+    h.payload_type = MSG_TYPE_CHAT;
+    h.packet_id    = 42;
+    const std::vector<uint8_t> bytes{1, 2, 3, 4};
+
+    auto a = PacketData::copy_of(h, bytes);
+    EXPECT_EQ(a.header().packet_id, 42u);
+    EXPECT_EQ(*a, bytes);
+
+    auto kept = a;                       // хэндлер оставил пакет себе
+    EXPECT_EQ(a.use_count(), 2u);
+    const auto* block_bytes = kept->data();
+    a.reset();
+
+    auto b = PacketData::copy_of(h, std::vector<uint8_t>{9, 9});
+    EXPECT_NE(b->data(), block_bytes) << "held packet is not reused";
+    EXPECT_EQ(*kept, bytes);
+
+    kept.reset();
+    b.reset();
+    auto c = PacketData::acquire();
+    EXPECT_EQ(c.header().packet_id, 0u) << "recycled packet starts clean";
+    EXPECT_TRUE(c->empty());
+    EXPECT_GE(c->capacity(), 2u) << "payload capacity survives recycling";
+}
+
+TEST(PacketDataTest, BlocksReleasedOnWorkerReturnToAcquiringThread) {
+    // IO-поток берёт пакеты, воркер их отпускает: после прогрева IO-поток
+    // получает блоки обратно через общий список и не трогает кучу
+    constexpr size_t BATCH = 256;
+    constexpr int    ROUNDS = 6;
+    std::mutex              mu;
+    std::condition_variable cv;
+    std::vector<PacketData> handoff;
+    handoff.reserve(BATCH);
+    int  released = 0;
+    bool done     = false;
+    std::thread worker([&] {
+        std::vector<PacketData> mine;
+        mine.reserve(BATCH);
+        for (;;) {
+            std::unique_lock lk(mu);
+            cv.wait(lk, [&] { return done || !handoff.empty(); });
+            if (handoff.empty()) return;
+            mine.swap(handoff);
+            lk.unlock();
+            mine.clear();
+            lk.lock();
+            ++released;
+            cv.notify_all();
+        }
+    });
+
+    std::vector<PacketData> batch;
+    batch.reserve(BATCH);
+    std::vector<size_t> allocs;
+    for (int r = 0; r < ROUNDS; ++r) {
+        t_allocs       = 0;
+        t_count_allocs = true;
+        for (size_t i = 0; i < BATCH; ++i) batch.push_back(PacketData::acquire());
+        t_count_allocs = false;
+        allocs.push_back(t_allocs);
+
+        std::unique_lock lk(mu);
+        handoff.swap(batch);
+        cv.notify_all();
+        cv.wait(lk, [&] { return released == r + 1; });
+    }
+    {
+        std::lock_guard lk(mu);
+        done = true;
+    }
+    cv.notify_all();
+    worker.join();
+
+    EXPECT_EQ(allocs.back(), 0u) << "allocations per round: first " << allocs.front();
+}
+
+TEST(PacketDataTest, ReleaseAfterThreadCacheDestroyedGoesCentral) {
+    auto& pool = sdk::detail::PacketPool::instance();
+    size_t before = 0;
+    std::thread([&] {
+        // Создан раньше кэша потока → разрушается после него
+        struct Late { PacketData p; };
+        thread_local Late late;
+        Late& l = late;
+        l.p = PacketData::acquire();   // блок мог прийти из общего списка
+        before = pool.central_size();
+    }).join();
+    EXPECT_EQ(pool.central_size(),
+              std::min(before + 1, sdk::detail::PacketPool::CENTRAL_MAX));
+}
+
+TEST_F(CMTest, Dispatch_HandlerMayKeepPacketPastReturn) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    std::vector<PacketData>           kept;
+    std::vector<std::vector<uint8_t>> sent;
+    bus_.subscribe(MSG_TYPE_CHAT, "keeper",
+        [&](std::string_view, const header_t& h, const endpoint_t*, const PacketData& d) {
+            EXPECT_EQ(&h, &d.header());
+            if (h.packet_id % 2) kept.push_back(d);
+            return PROPAGATION_CONTINUE;
+        });
+
+    for (int i = 0; i < 64; ++i) {
+        std::vector<uint8_t> m(100 + i);
+        randombytes_buf(m.data(), m.size());
+        auto f = im_a.build_frame(cid_a, MSG_TYPE_CHAT, m);
+        im_b.handle_data(cid_b, f.data(), f.size());
+        sent.push_back(std::move(m));
+    }
+
+    ASSERT_FALSE(kept.empty());
+    for (const auto& p : kept) {
+        const auto i = static_cast<size_t>(p->size() - 100);
+        ASSERT_LT(i, sent.size());
+        EXPECT_EQ(*p, sent[i]) << "kept packet overwritten by a later frame";
+        EXPECT_EQ(p.header().payload_type, MSG_TYPE_CHAT);
+    }
+}
+
+TEST_F(CMTest, Dispatch_PooledPacketAllocationFree) {
+    constexpr int HANDLERS = 4, WARMUP = 32, N = 1000;
+    std::vector<uint8_t> payload(64, 0x5A);
+    header_t h{};
+    h.magic        = GNET_MAGIC;
+    h.proto_ver    = GNET_PROTO_VER;
+    h.payload_type = MSG_TYPE_CHAT;
+    h.payload_len  = static_cast<uint32_t>(payload.size());
+
+    size_t seen = 0;
+    for (int k = 0; k < HANDLERS; ++k)
+        bus_.subscribe(MSG_TYPE_CHAT, "pooled_" + std::to_string(k),
+            [&](std::string_view, const header_t& hp, const endpoint_t*, const PacketData& d) {
+                seen += d->size() + hp.payload_len;
+                return PROPAGATION_CONTINUE;
+            });
+
+    for (int i = 0; i < WARMUP; ++i)   // прогрев free list
+        bus_.dispatch_packet(MSG_TYPE_CHAT, nullptr, PacketData::copy_of(h, payload));
+    t_allocs       = 0;
+    t_count_allocs = true;
+    for (int i = 0; i < N; ++i)
+        bus_.dispatch_packet(MSG_TYPE_CHAT, nullptr, PacketData::copy_of(h, payload));
+    t_count_allocs = false;
+
+    EXPECT_EQ(t_allocs, 0u) << "heap allocations for " << N << " dispatched packets";
+    EXPECT_EQ(seen, size_t{WARMUP + N} * HANDLERS * 2 * payload.size());
+}
+
+// ─── Batch dispatch (handler_t::handle_batch) ─────────────────────────────────
+
+namespace {
+struct BatchLog {
+    std::vector<std::pair<uint32_t, size_t>> calls;   ///< (type, count)
+    size_t packets = 0;
+    bool   intact  = true;
+};
+} // namespace
+
+TEST_F(CMTest, HandleBatch_OneCallPerTypeRunOfARead) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    BatchLog log;
+    handler_t h{};
+    h.name = "batcher";
+    static uint32_t types[] = { MSG_TYPE_CHAT, MSG_TYPE_FILE };
+    h.supported_types     = types;
+    h.num_supported_types = 2;
+    h.user_data           = &log;
+    h.handle_message = [](void*, const header_t*, const endpoint_t*, const void*, size_t) {
+        ADD_FAILURE() << "handle_message must not be used when handle_batch is set";
+    };
+    h.handle_batch = [](void* ud, const endpoint_t* ep, const handler_packet_t* p,
+                        size_t n) -> propagation_t {
+        auto& l = *static_cast<BatchLog*>(ud);
+        l.calls.emplace_back(p[0].header->payload_type, n);
+        for (size_t i = 0; i < n; ++i) {
+            l.intact = l.intact && p[i].payload_size == 64
+                    && static_cast<const uint8_t*>(p[i].payload)[0] == uint8_t(l.packets);
+            ++l.packets;
+        }
+        EXPECT_NE(ep->peer_id, CONN_ID_INVALID);
+        return PROPAGATION_CONSUMED;
+    };
+    cm_b_->register_handler(&h);
+
+    // Одно чтение: 10 CHAT, 3 FILE, 70 CHAT → 10 | 3 | 64 + 6
+    std::vector<uint8_t> chunk;
+    int seq = 0;
+    auto add = [&](uint32_t type, int n) {
+        for (int i = 0; i < n; ++i) {
+            std::vector<uint8_t> m(64, uint8_t(seq++));
+            auto f = im_a.build_frame(cid_a, type, m);
+            chunk.insert(chunk.end(), f.data(), f.data() + f.size());
+        }
+    };
+    add(MSG_TYPE_CHAT, 10);
+    add(MSG_TYPE_FILE, 3);
+    add(MSG_TYPE_CHAT, 70);
+    im_b.handle_data(cid_b, chunk.data(), chunk.size());
+
+    using C = std::pair<uint32_t, size_t>;
+    EXPECT_EQ(log.calls, (std::vector<C>{{MSG_TYPE_CHAT, 10}, {MSG_TYPE_FILE, 3},
+                                         {MSG_TYPE_CHAT, 64}, {MSG_TYPE_CHAT, 6}}));
+    EXPECT_EQ(log.packets, 83u);
+    EXPECT_TRUE(log.intact) << "packets delivered in arrival order";
+    EXPECT_EQ(im_b.rcu_find(cid_b)->affinity_handler.load(), intern_handler("batcher"));
+
+    // Отдельные чтения — отдельные пачки (пакет не ждёт следующего чтения)
+    log.calls.clear();
+    chunk.clear();
+    add(MSG_TYPE_CHAT, 1);
+    im_b.handle_data(cid_b, chunk.data(), chunk.size());
+    EXPECT_EQ(log.calls, (std::vector<C>{{MSG_TYPE_CHAT, 1}}));
+}
+
+// Хэндлер коннектора может быть собран с заголовками ABI 1 — handle_batch не читается
+TEST_F(CMTest, HandleBatch_IgnoredForConnectorRegisteredHandler) {
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+
+    size_t got = 0;
+    handler_t h{};
+    h.name = "conn_batch";
+    static uint32_t types[] = { MSG_TYPE_CHAT };
+    h.supported_types     = types;
+    h.num_supported_types = 1;
+    h.user_data           = &got;
+    h.handle_message = [](void* ud, const header_t*, const endpoint_t*, const void*, size_t) {
+        ++*static_cast<size_t*>(ud);
+    };
+    h.handle_batch = [](void*, const endpoint_t*, const handler_packet_t*,
+                        size_t) -> propagation_t {
+        ADD_FAILURE() << "handle_batch of a connector-registered handler must not be called";
+        return PROPAGATION_CONSUMED;
+    };
+    im_b.register_handler_from_connector(&h);
+
+    std::vector<uint8_t> chunk;
+    for (int i = 0; i < 3; ++i) {
+        std::vector<uint8_t> m(16, uint8_t(i));
+        auto f = im_a.build_frame(cid_a, MSG_TYPE_CHAT, m);
+        chunk.insert(chunk.end(), f.data(), f.data() + f.size());
+    }
+    im_b.handle_data(cid_b, chunk.data(), chunk.size());
+    EXPECT_EQ(got, 3u);
+}
+
+// ─── Session affinity by handler ID ───────────────────────────────────────────
+
+TEST_F(CMTest, Affinity_FirstConsumePinsInPlaceWithoutAllocation) {
+    bus_.subscribe(MSG_TYPE_CHAT, "pinner",
+        [](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            return PROPAGATION_CONSUMED;
+        });
+    const handler_id_t pinner = intern_handler("pinner");
+
+    auto [cid_a, cid_b] = do_handshake(*cm_a_, id_a_, *cm_b_, id_b_, false);
+    auto& im_a = impl(*cm_a_);
+    auto& im_b = impl(*cm_b_);
+    std::vector<uint8_t> payload(64, 0x11);
+
+    // Прогрев пулов кадрами без подписчиков (цепочка не останавливается)
+    for (int i = 0; i < 100; ++i) {
+        auto f = im_a.build_frame(cid_a, MSG_TYPE_FILE, payload);
+        im_b.handle_data(cid_b, f.data(), f.size());
+    }
+    EXPECT_EQ(im_b.rcu_find(cid_b)->affinity_handler.load(), HANDLER_ID_NONE);
+
+    auto first  = im_a.build_frame(cid_a, MSG_TYPE_CHAT, payload);
+    auto second = im_a.build_frame(cid_a, MSG_TYPE_CHAT, payload);
+    const auto map_before = im_b.records_rcu_.load();
+
+    t_allocs       = 0;
+    t_count_allocs = true;
+    im_b.handle_data(cid_b, first.data(), first.size());
+    t_count_allocs = false;
+
+    EXPECT_EQ(t_allocs, 0u) << "first CONSUMED must not allocate";
+    EXPECT_EQ(im_b.records_rcu_.load(), map_before) << "affinity pinned without RCU map copy";
+    EXPECT_EQ(im_b.rcu_find(cid_b)->affinity_handler.load(), pinner);
+    EXPECT_EQ(handler_name(pinner), "pinner");
+
+    im_b.handle_data(cid_b, second.data(), second.size());
+    EXPECT_EQ(bus_.stats_snapshot().consumed, 1u) << "Consumed counted once, at pin time";
+}
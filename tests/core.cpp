@@ -360,8 +360,8 @@ TEST(CoreTest, Subscribe_Unsubscribe) {
     config.plugins.auto_load = false;
 
     gn::Core core(&config);
-    auto cb = [](std::string_view, std::shared_ptr<header_t>,
-                 const endpoint_t*, gn::PacketData) -> propagation_t {
+    auto cb = [](std::string_view, const header_t&,
+                 const endpoint_t*, const gn::PacketData&) -> propagation_t {
         return PROPAGATION_CONTINUE;
     };
 
@@ -581,8 +581,8 @@ TEST(CoreTest, SubscribeWildcard_NoCrash) {
     config.plugins.auto_load = false;
 
     gn::Core core(&config);
-    auto cb = [](std::string_view, std::shared_ptr<header_t>,
-                 const endpoint_t*, gn::PacketData) -> propagation_t {
+    auto cb = [](std::string_view, const header_t&,
+                 const endpoint_t*, const gn::PacketData&) -> propagation_t {
         return PROPAGATION_CONTINUE;
     };
     EXPECT_NO_THROW(core.subscribe_wildcard("test_wild", cb));
@@ -0,0 +1,47 @@
+/// @file tests/mock_connector_v1.cpp
+/// @brief ABI 1 connector plugin for PluginManager unit tests.
+/// Scheme: "mockv1". Name: "MockConnectorV1".
+/// Compiled as libmock_connector_v1.so.
+///
+/// Exports a bare connector_init() without plugin_abi_version(), as a plugin
+/// built against ABI 1 headers would.  The ops struct is the current layout
+/// with garbage in the fields appended after ABI 1 — stands in for whatever
+/// memory follows a real ABI 1 struct.  The core must never see those bytes.
+#include <connector.h>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+int  v1_send(void*, conn_id_t, const void*, size_t)       { return 0; }
+int  v1_connect(void*, const char*)                       { return -1; }
+int  v1_listen(void*, const char*, uint16_t)              { return 0; }
+void v1_close(void*, conn_id_t)                           {}
+void v1_shutdown(void*)                                   {}
+
+void v1_scheme(void*, char* buf, size_t n) { std::strncpy(buf, "mockv1", n - 1); }
+void v1_name(void*, char* buf, size_t n)   { std::strncpy(buf, "MockConnectorV1", n - 1); }
+
+connector_ops_t g_ops = [] {
+    connector_ops_t o{};
+    o.connect    = v1_connect;
+    o.listen     = v1_listen;
+    o.send_to    = v1_send;
+    o.close      = v1_close;
+    o.close_now  = v1_close;
+    o.get_scheme = v1_scheme;
+    o.get_name   = v1_name;
+    o.shutdown   = v1_shutdown;
+    // Мусор за пределами ABI 1
+    o.send_owned = reinterpret_cast<decltype(o.send_owned)>(uintptr_t{0xDEADBEEF});
+    o.flags      = CONNECTOR_FLAG_REPORTS_SENT;
+    return o;
+}();
+
+} // namespace
+
+extern "C" GN_EXPORT
+int connector_init(host_api_t* /*api*/, connector_ops_t** out) {
+    *out = &g_ops;
+    return 0;
+}
@@ -0,0 +1,35 @@
+/// @file tests/mock_handler_v1.cpp
+/// @brief ABI 1 handler plugin for PluginManager unit tests.
+/// Name: "mock_handler_v1".  Compiled as libmock_handler_v1.so.
+///
+/// Exports a bare handler_init() without plugin_abi_version(), as a plugin
+/// built against ABI 1 headers would.  The handler_t is the current layout
+/// with garbage in `handle_batch` — stands in for whatever memory follows a
+/// real ABI 1 struct.  The core must never call it.
+#include <handler.h>
+#include <cstdint>
+
+namespace {
+
+const uint32_t g_types[] = { MSG_TYPE_CHAT };
+
+void v1_handle(void*, const header_t*, const endpoint_t*, const void*, size_t) {}
+
+handler_t g_handler = [] {
+    handler_t h{};
+    h.name                = "mock_handler_v1";
+    h.handle_message      = v1_handle;
+    h.supported_types     = g_types;
+    h.num_supported_types = 1;
+    // Мусор за пределами ABI 1
+    h.handle_batch = reinterpret_cast<decltype(h.handle_batch)>(uintptr_t{0xDEADBEEF});
+    return h;
+}();
+
+} // namespace
+
+extern "C" GN_EXPORT
+int handler_init(host_api_t* /*api*/, handler_t** out) {
+    *out = &g_handler;
+    return 0;
+}
@@ -19,6 +19,12 @@ namespace fs = std::filesystem;
 #ifndef MOCK_CONNECTOR_PATH
 #  error "Define MOCK_CONNECTOR_PATH in CMakeLists.txt"
 #endif
+#ifndef MOCK_HANDLER_V1_PATH
+#  error "Define MOCK_HANDLER_V1_PATH in CMakeLists.txt"
+#endif
+#ifndef MOCK_CONNECTOR_V1_PATH
+#  error "Define MOCK_CONNECTOR_V1_PATH in CMakeLists.txt"
+#endif
 
 // ─── Helpers ──────────────────────────────────────────────────────────────────
 
@@ -85,6 +91,8 @@ protected:
 
     fs::path handler_path()   { fs::path p(MOCK_HANDLER_PATH);   write_manifest(p); return p; }
     fs::path connector_path() { fs::path p(MOCK_CONNECTOR_PATH); write_manifest(p); return p; }
+    fs::path handler_v1_path()   { fs::path p(MOCK_HANDLER_V1_PATH);   write_manifest(p); return p; }
+    fs::path connector_v1_path() { fs::path p(MOCK_CONNECTOR_V1_PATH); write_manifest(p); return p; }
 };
 
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -395,6 +403,38 @@ TEST_F(PMTest, GetActiveConnectors) {
     EXPECT_NE(connectors[0], nullptr);
 }
 
+// ABI 1 плагин не экспортирует plugin_abi_version — поля после connector_ctx
+// не должны дойти до ядра, даже если за его структурой лежит мусор.
+TEST_F(PMTest, ConnectorAbi1_AppendedFieldsIgnored) {
+    auto result = pm_.load_plugin(connector_v1_path());
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    auto ops = pm_.find_connector_by_scheme("mockv1");
+    ASSERT_TRUE(ops.has_value());
+    EXPECT_EQ((*ops)->send_owned, nullptr);
+    EXPECT_EQ((*ops)->flags, 0u);  // мусорный REPORTS_SENT остановил бы отправку
+    EXPECT_NE((*ops)->send_to, nullptr);
+    EXPECT_EQ((*ops)->send_to((*ops)->connector_ctx, 1, "x", 1), 0);
+}
+
+TEST_F(PMTest, HandlerAbi1_HandleBatchIgnored) {
+    auto result = pm_.load_plugin(handler_v1_path());
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    auto h = pm_.find_handler_by_name("mock_handler_v1");
+    ASSERT_TRUE(h.has_value());
+    EXPECT_EQ((*h)->handle_batch, nullptr);
+    EXPECT_NE((*h)->handle_message, nullptr);
+    EXPECT_EQ((*h)->num_supported_types, 1u);
+}
+
+TEST_F(PMTest, ConnectorAbi2_KeepsPluginOps) {
+    pm_.load_plugin(connector_path());
+    auto ops = pm_.find_connector_by_scheme("mock");
+    ASSERT_TRUE(ops.has_value());
+    EXPECT_NE((*ops)->send_owned, nullptr);
+}
+
 TEST_F(PMTest, GetEnabledHandlerNames) {
     pm_.load_plugin(handler_path());
     auto names = pm_.get_enabled_handler_names();
@@ -3,6 +3,9 @@
 
 #include <gtest/gtest.h>
 #include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <thread>
 #include <vector>
 #include <numeric>
@@ -179,3 +182,246 @@ TEST(PerConnQueueTest, DrainBatch_PartialDrain) {
     EXPECT_EQ(rest.size(), 3u);
     EXPECT_EQ(q.pending_bytes.load(), 0u);
 }
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SECTION 2: MPSC ring — single drainer, ordering, slot limit
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST(PerConnQueueTest, DrainBatch_WhileDraining_ReturnsEmpty) {
+    PerConnQueue q;
+    q.try_push(std::vector<uint8_t>(10, 1));
+    ASSERT_TRUE(q.try_begin_drain());
+    EXPECT_TRUE(q.drain_batch(64).empty());     // токен занят
+    EXPECT_FALSE(q.try_begin_drain());
+    auto batch = q.pop_batch(64);
+    EXPECT_EQ(batch.size(), 1u);
+    EXPECT_FALSE(q.end_drain());
+    EXPECT_FALSE(q.draining.load());
+}
+
+TEST(PerConnQueueTest, SlotLimit_RejectsAndRollsBackBytes) {
+    PerConnQueue q;
+    for (size_t i = 0; i < PerConnQueue::MAX_FRAMES; ++i)
+        ASSERT_TRUE(q.try_push(std::vector<uint8_t>(8, 0x11))) << i;
+    EXPECT_FALSE(q.try_push(std::vector<uint8_t>(8, 0x22)));
+    EXPECT_EQ(q.pending_bytes.load(), PerConnQueue::MAX_FRAMES * 8);
+
+    auto batch = q.drain_batch(PerConnQueue::MAX_FRAMES);
+    EXPECT_EQ(batch.size(), PerConnQueue::MAX_FRAMES);
+    EXPECT_TRUE(q.try_push(std::vector<uint8_t>(8, 0x33)));  // слоты вернулись
+}
+
+TEST(PerConnQueueTest, FifoOrderPerProducer) {
+    PerConnQueue q;
+    constexpr int NUM_PUSHERS = 4;
+    constexpr uint32_t FRAMES_PER_PUSHER = 5000;
+
+    std::vector<std::thread> pushers;
+    for (int t = 0; t < NUM_PUSHERS; ++t) {
+        pushers.emplace_back([&, t] {
+            for (uint32_t i = 0; i < FRAMES_PER_PUSHER; ++i) {
+                uint8_t rec[5];
+                rec[0] = static_cast<uint8_t>(t);
+                std::memcpy(rec + 1, &i, 4);
+                while (!q.try_push(std::span<const uint8_t>(rec, sizeof(rec))))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<uint32_t> next(NUM_PUSHERS, 0);
+    uint32_t total = 0;
+    bool ordered = true;
+    while (total < NUM_PUSHERS * FRAMES_PER_PUSHER) {
+        for (auto& f : q.drain_batch(128)) {
+            uint32_t seq = 0;
+            std::memcpy(&seq, f.data() + 1, 4);
+            if (seq != next[f.data()[0]]++) ordered = false;
+            ++total;
+        }
+    }
+    for (auto& t : pushers) t.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(q.pending_bytes.load(), 0u);
+}
+
+TEST(PerConnQueueTest, CompetingDrainers_ExactlyOnce_SingleConsumer) {
+    PerConnQueue q;
+    constexpr int NUM_PUSHERS  = 4;
+    constexpr int NUM_DRAINERS = 4;
+    constexpr int FRAMES_PER_PUSHER = 4000;
+
+    std::atomic<int>  inside{0};
+    std::atomic<bool> overlap{false};
+    std::atomic<int>  drained{0};
+    std::atomic<bool> done{false};
+
+    // Повторяет схему flush_queue(): try_begin_drain / pop_batch / end_drain.
+    auto drainer = [&] {
+        while (!done.load() || q.pending_bytes.load() > 0) {
+            bool more = false;
+            do {
+                if (!q.try_begin_drain()) break;
+                if (inside.fetch_add(1) != 0) overlap = true;
+                for (;;) {
+                    auto batch = q.pop_batch(32);
+                    if (batch.empty()) break;
+                    drained.fetch_add(static_cast<int>(batch.size()));
+                }
+                inside.fetch_sub(1);
+                more = q.end_drain();
+            } while (more);
+            std::this_thread::yield();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int d = 0; d < NUM_DRAINERS; ++d) threads.emplace_back(drainer);
+    std::vector<std::thread> pushers;
+    for (int t = 0; t < NUM_PUSHERS; ++t) {
+        pushers.emplace_back([&] {
+            std::vector<uint8_t> frame(96, 0xAB);
+            for (int i = 0; i < FRAMES_PER_PUSHER; ++i)
+                while (!q.try_push(frame)) std::this_thread::yield();
+        });
+    }
+    for (auto& t : pushers) t.join();
+    done = true;
+    for (auto& t : threads) t.join();
+
+    EXPECT_FALSE(overlap.load());
+    EXPECT_EQ(drained.load(), NUM_PUSHERS * FRAMES_PER_PUSHER);
+    EXPECT_EQ(q.pending_bytes.load(), 0u);
+}
+
+TEST(PerConnQueueTest, MixedSizes_NeverExceedsBudget) {
+    PerConnQueue q;
+    std::atomic<bool> done{false};
+    std::atomic<bool> exceeded{false};
+
+    std::thread watcher([&] {
+        while (!done.load())
+            if (q.pending_bytes.load() > PerConnQueue::MAX_BYTES) exceeded = true;
+    });
+
+    std::vector<std::thread> pushers;
+    for (int t = 0; t < 6; ++t) {
+        pushers.emplace_back([&, t] {
+            for (int i = 0; i < 300; ++i) {
+                const size_t sz = (t % 2) ? 64 : 256 * 1024;
+                q.try_push(std::vector<uint8_t>(sz, 0x01));
+                if (i % 16 == 0) q.drain_batch(8);
+            }
+        });
+    }
+    for (auto& t : pushers) t.join();
+    done = true;
+    watcher.join();
+    EXPECT_FALSE(exceeded.load());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SECTION 2b: QoS send classes — strict Control, weighted Interactive/Bulk/Relay
+// ═══════════════════════════════════════════════════════════════════════════════
+
+static sdk::FrameBuffer tagged_frame(uint8_t tag, size_t size = 16) {
+    return sdk::FrameBuffer::copy_of(std::vector<uint8_t>(size, tag));
+}
+
+TEST(PerConnQueueTest, Qos_ControlJumpsBulkBacklog) {
+    PerConnQueue q;
+    for (int i = 0; i < 500; ++i)
+        ASSERT_TRUE(q.try_push(tagged_frame(2), SendClass::Bulk));
+    ASSERT_TRUE(q.try_push(tagged_frame(0), SendClass::Control));
+
+    ASSERT_TRUE(q.try_begin_drain());
+    auto batch = q.pop_batch(64);
+    ASSERT_FALSE(batch.empty());
+    EXPECT_EQ(batch.front().data()[0], 0) << "heartbeat must not wait behind bulk";
+    // Control, опубликованный посреди drain, уходит в следующем раунде
+    ASSERT_TRUE(q.try_push(tagged_frame(0), SendClass::Control));
+    batch = q.pop_batch(4);
+    EXPECT_EQ(batch.front().data()[0], 0);
+    q.pop_batch(PerConnQueue::MAX_FRAMES);
+    q.end_drain();
+    EXPECT_EQ(q.pending_bytes.load(), 0u);
+}
+
+TEST(PerConnQueueTest, Qos_WeightedRoundRobin) {
+    PerConnQueue q;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(q.try_push(tagged_frame(1), SendClass::Interactive));
+        ASSERT_TRUE(q.try_push(tagged_frame(2), SendClass::Bulk));
+        ASSERT_TRUE(q.try_push(tagged_frame(3), SendClass::Relay));
+    }
+    const auto w = PerConnQueue::DRAIN_WEIGHT;
+    const size_t round = w[1] + w[2] + w[3];
+
+    ASSERT_TRUE(q.try_begin_drain());
+    auto batch = q.pop_batch(round * 4);
+    q.end_drain();
+    ASSERT_EQ(batch.size(), round * 4);
+
+    size_t seen[4]{};
+    for (auto& f : batch) ++seen[f.data()[0]];
+    EXPECT_EQ(seen[1], w[1] * 4u);
+    EXPECT_EQ(seen[2], w[2] * 4u) << "bulk is throttled, not starved";
+    EXPECT_EQ(seen[3], w[3] * 4u);
+}
+
+TEST(PerConnQueueTest, Qos_IdleClassesDoNotWasteBatch) {
+    PerConnQueue q;
+    for (int i = 0; i < 100; ++i)
+        ASSERT_TRUE(q.try_push(tagged_frame(2), SendClass::Bulk));
+    auto batch = q.drain_batch(64);
+    EXPECT_EQ(batch.size(), 64u);
+}
+
+TEST(PerConnQueueTest, Qos_ControlBypassesByteWindow) {
+    PerConnQueue q;
+    const size_t mb = 1024 * 1024;
+    for (size_t i = 0; i < PerConnQueue::MAX_BYTES / mb; ++i)
+        ASSERT_TRUE(q.try_push(tagged_frame(2, mb), SendClass::Bulk));
+    EXPECT_EQ(q.window(), 0u);
+
+    EXPECT_FALSE(q.try_push(tagged_frame(1), SendClass::Interactive));
+    EXPECT_TRUE (q.try_push(tagged_frame(0), SendClass::Control));
+    EXPECT_EQ(q.depth(SendClass::Control), 1u);
+    EXPECT_EQ(q.depth(SendClass::Bulk), PerConnQueue::MAX_BYTES / mb);
+}
+
+TEST(PerConnQueueTest, Qos_SlotsArePerClass) {
+    PerConnQueue q;
+    for (size_t i = 0; i < PerConnQueue::MAX_FRAMES; ++i)
+        ASSERT_TRUE(q.try_push(tagged_frame(2, 8), SendClass::Bulk));
+    EXPECT_FALSE(q.try_push(tagged_frame(2, 8), SendClass::Bulk));
+    EXPECT_TRUE (q.try_push(tagged_frame(1, 8), SendClass::Interactive));
+}
+
+// Heartbeat behind a full bulk backlog: frames the connector must write
+// before the heartbeat leaves (FIFO = whole backlog, QoS = 0).
+TEST(PerConnQueueTest, Qos_HeartbeatNotBehindBulk) {
+    constexpr size_t BACKLOG = 1000;
+    constexpr size_t FRAME   = 4096;
+    PerConnQueue q;
+    for (size_t i = 0; i < BACKLOG; ++i)
+        ASSERT_TRUE(q.try_push(tagged_frame(2, FRAME), SendClass::Bulk));
+    ASSERT_TRUE(q.try_push(tagged_frame(0, 64), SendClass::Control));
+
+    size_t ahead = 0;
+    bool   found = false;
+    ASSERT_TRUE(q.try_begin_drain());
+    while (!found) {
+        auto batch = q.pop_batch(64);
+        ASSERT_FALSE(batch.empty());
+        for (auto& f : batch) {
+            if (f.data()[0] == 0) { found = true; break; }
+            ++ahead;
+        }
+    }
+    q.pop_batch(BACKLOG);
+    q.end_drain();
+
+    EXPECT_EQ(ahead, 0u);
+}
@@ -30,39 +30,37 @@ protected:
 TEST_F(SignalBusTest, SubscribeDispatch_TypeSpecific) {
     std::atomic<int> called{0};
     bus_->subscribe(MSG_TYPE_CHAT, "h1",
-        [&](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
             called.fetch_add(1);
             return PROPAGATION_CONTINUE;
         });
 
-    auto hdr = std::make_shared<header_t>();
-    hdr->payload_type = MSG_TYPE_CHAT;
-    auto data = std::make_shared<sdk::RawBuffer>();
-    bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    auto data = PacketData::acquire();
+    data.header().payload_type = MSG_TYPE_CHAT;
+    bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
     EXPECT_EQ(called.load(), 1);
 }
 
 TEST_F(SignalBusTest, SubscribeDispatch_Wildcard) {
     std::atomic<int> called{0};
     bus_->subscribe_wildcard("wild",
-        [&](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
             called.fetch_add(1);
             return PROPAGATION_CONTINUE;
         });
 
-    auto hdr = std::make_shared<header_t>();
-    auto data = std::make_shared<sdk::RawBuffer>();
+    auto data = PacketData::acquire();
 
-    bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
-    bus_->dispatch_packet(MSG_TYPE_HEARTBEAT, hdr, nullptr, data);
+    bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
+    bus_->dispatch_packet(MSG_TYPE_HEARTBEAT, nullptr, data);
     EXPECT_EQ(called.load(), 2);
 }
 
 TEST_F(SignalBusTest, PriorityOrdering) {
     std::vector<int> order;
     auto make_cb = [&](int id) {
-        return [&order, id](std::string_view, std::shared_ptr<header_t>,
-                            const endpoint_t*, PacketData) -> propagation_t {
+        return [&order, id](std::string_view, const header_t&,
+                            const endpoint_t*, const PacketData&) -> propagation_t {
             order.push_back(id);
             return PROPAGATION_CONTINUE;
         };
@@ -72,9 +70,8 @@ TEST_F(SignalBusTest, PriorityOrdering) {
     bus_->subscribe(MSG_TYPE_CHAT, "mid", make_cb(128), 128);
     bus_->subscribe(MSG_TYPE_CHAT, "hi",  make_cb(255), 255);
 
-    auto hdr = std::make_shared<header_t>();
-    auto data = std::make_shared<sdk::RawBuffer>();
-    bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    auto data = PacketData::acquire();
+    bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
 
     ASSERT_EQ(order.size(), 3u);
     EXPECT_EQ(order[0], 255);
@@ -85,33 +82,31 @@ TEST_F(SignalBusTest, PriorityOrdering) {
 TEST_F(SignalBusTest, PropagationConsumed_StopsChain) {
     std::atomic<int> second_called{0};
     bus_->subscribe(MSG_TYPE_CHAT, "first",
-        [](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+        [](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
             return PROPAGATION_CONSUMED;
         }, 255);
     bus_->subscribe(MSG_TYPE_CHAT, "second",
-        [&](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
             second_called.fetch_add(1);
             return PROPAGATION_CONTINUE;
         }, 0);
 
-    auto hdr = std::make_shared<header_t>();
-    auto data = std::make_shared<sdk::RawBuffer>();
-    auto r = bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    auto data = PacketData::acquire();
+    auto r = bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
 
     EXPECT_EQ(r.result, PROPAGATION_CONSUMED);
-    EXPECT_EQ(r.consumed_by, "first");
+    EXPECT_EQ(handler_name(r.consumed_by), "first");
     EXPECT_EQ(second_called.load(), 0);
 }
 
 TEST_F(SignalBusTest, PropagationReject) {
     bus_->subscribe(MSG_TYPE_CHAT, "rejector",
-        [](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+        [](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
             return PROPAGATION_REJECT;
         });
 
-    auto hdr = std::make_shared<header_t>();
-    auto data = std::make_shared<sdk::RawBuffer>();
-    auto r = bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    auto data = PacketData::acquire();
+    auto r = bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
 
     EXPECT_EQ(r.result, PROPAGATION_REJECT);
 }
@@ -119,25 +114,24 @@ TEST_F(SignalBusTest, PropagationReject) {
 TEST_F(SignalBusTest, Unsubscribe_Removes) {
     std::atomic<int> called{0};
     uint64_t sub = bus_->subscribe(MSG_TYPE_CHAT, "removable",
-        [&](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+        [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
             called.fetch_add(1);
             return PROPAGATION_CONTINUE;
         });
 
-    auto hdr = std::make_shared<header_t>();
-    auto data = std::make_shared<sdk::RawBuffer>();
+    auto data = PacketData::acquire();
 
-    bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
     EXPECT_EQ(called.load(), 1);
 
     bus_->unsubscribe(sub);
-    bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
     EXPECT_EQ(called.load(), 1);  // still 1 — unsubscribed
 }
 
 TEST_F(SignalBusTest, MultipleSubscribers_SameType) {
     std::atomic<int> count{0};
-    auto cb = [&](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+    auto cb = [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
         count.fetch_add(1);
         return PROPAGATION_CONTINUE;
     };
@@ -145,9 +139,8 @@ TEST_F(SignalBusTest, MultipleSubscribers_SameType) {
     bus_->subscribe(MSG_TYPE_CHAT, "a", cb);
     bus_->subscribe(MSG_TYPE_CHAT, "b", cb);
 
-    auto hdr = std::make_shared<header_t>();
-    auto data = std::make_shared<sdk::RawBuffer>();
-    bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+    auto data = PacketData::acquire();
+    bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
 
     EXPECT_EQ(count.load(), 2);
 }
@@ -235,7 +228,7 @@ TEST_F(SignalBusTest, StatsSnapshot_InitiallyZero) {
 
 TEST_F(SignalBusTest, ConcurrentSubscribeDispatch) {
     std::atomic<int> total{0};
-    auto cb = [&](std::string_view, std::shared_ptr<header_t>, const endpoint_t*, PacketData) {
+    auto cb = [&](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
         total.fetch_add(1);
         return PROPAGATION_CONTINUE;
     };
@@ -249,9 +242,8 @@ TEST_F(SignalBusTest, ConcurrentSubscribeDispatch) {
     for (int t = 0; t < N_THREADS; ++t) {
         threads.emplace_back([&, t] {
             for (int i = 0; i < N_ITERS; ++i) {
-                auto hdr = std::make_shared<header_t>();
-                auto data = std::make_shared<sdk::RawBuffer>();
-                bus_->dispatch_packet(MSG_TYPE_CHAT, hdr, nullptr, data);
+                auto data = PacketData::acquire();
+                bus_->dispatch_packet(MSG_TYPE_CHAT, nullptr, data);
             }
         });
     }
@@ -259,3 +251,87 @@ TEST_F(SignalBusTest, ConcurrentSubscribeDispatch) {
     for (auto& t : threads) t.join();
     EXPECT_GE(total.load(), N_THREADS * N_ITERS);
 }
+
+TEST_F(SignalBusTest, DispatchBatch_StoppedPacketsSkipLaterHandlers) {
+    std::vector<size_t> batch_sizes, wild_sizes;
+    size_t per_packet_calls = 0;
+    bus_->subscribe(MSG_TYPE_CHAT, "batch_hi",
+        [](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            return PROPAGATION_CONTINUE;
+        }, 255,
+        [&](std::string_view, const endpoint_t*, std::span<const PacketData> b) {
+            batch_sizes.push_back(b.size());
+            return PROPAGATION_CONTINUE;
+        });
+    // Нечётные packet_id забирает обычный хэндлер, id 4 отвергается
+    bus_->subscribe(MSG_TYPE_CHAT, "odd",
+        [&](std::string_view, const header_t& h, const endpoint_t*, const PacketData&) {
+            ++per_packet_calls;
+            if (h.packet_id == 4) return PROPAGATION_REJECT;
+            return h.packet_id % 2 ? PROPAGATION_CONSUMED : PROPAGATION_CONTINUE;
+        }, 128);
+    bus_->subscribe(MSG_TYPE_CHAT, "batch_lo",
+        [](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            return PROPAGATION_CONTINUE;
+        }, 0,
+        [&](std::string_view, const endpoint_t*, std::span<const PacketData> b) {
+            batch_sizes.push_back(b.size());
+            for (auto& p : b) EXPECT_EQ(p.header().packet_id % 2, 0u);
+            return PROPAGATION_CONTINUE;
+        });
+    bus_->subscribe_wildcard("wild",
+        [](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+            return PROPAGATION_CONTINUE;
+        }, 128,
+        [&](std::string_view, const endpoint_t*, std::span<const PacketData> b) {
+            wild_sizes.push_back(b.size());
+            return PROPAGATION_CONSUMED;
+        });
+
+    std::vector<PacketData> pkts;
+    for (uint64_t i = 0; i < 10; ++i) {
+        pkts.push_back(PacketData::acquire());
+        pkts.back().header().packet_id = i;
+    }
+    auto r = bus_->dispatch_batch(MSG_TYPE_CHAT, nullptr, pkts);
+
+    EXPECT_EQ(batch_sizes, (std::vector<size_t>{10, 4}));
+    EXPECT_EQ(per_packet_calls, 10u);
+    EXPECT_EQ(wild_sizes, (std::vector<size_t>{4}));
+    EXPECT_EQ(r.rejected, 1u);
+    EXPECT_EQ(handler_name(r.rejected_by), "odd");
+    EXPECT_EQ(r.consumed, 9u);
+    EXPECT_EQ(handler_name(r.consumed_by), "odd");
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Flat channel table
+// ═══════════════════════════════════════════════════════════════════════════════
+
+TEST_F(SignalBusTest, ChannelTable_PagesAndWideTypes) {
+    std::vector<uint32_t> seen;
+    auto sub = [&](uint32_t type) {
+        return bus_->subscribe(type, "t",
+            [&seen, type](std::string_view, const header_t&, const endpoint_t*, const PacketData&) {
+                seen.push_back(type);
+                return PROPAGATION_CONSUMED;
+            });
+    };
+    // Первый/последний слот страницы, соседние страницы, конец таблицы, > 16 бит
+    const uint32_t types[] = { 0u, 0xFFu, 0x100u, 0x1234u, 0xFFFFu, 0x10000u };
+    std::vector<uint64_t> ids;
+    for (auto t : types) ids.push_back(sub(t));
+
+    auto pkt = PacketData::acquire();
+    for (auto t : types)
+        EXPECT_EQ(bus_->dispatch_packet(t, nullptr, pkt).result, PROPAGATION_CONSUMED);
+    EXPECT_EQ(seen, std::vector<uint32_t>(std::begin(types), std::end(types)));
+
+    // Соседний тип на той же странице не подписан
+    EXPECT_EQ(bus_->dispatch_packet(0x1235u, nullptr, pkt).result, PROPAGATION_CONTINUE);
+    bus_->unsubscribe(ids[3]);
+    EXPECT_EQ(bus_->dispatch_packet(0x1234u, nullptr, pkt).result, PROPAGATION_CONTINUE);
+    bus_->unsubscribe(ids[5]);   // > 16 бит: канал из wide_channels_ под mu_
+    EXPECT_EQ(bus_->dispatch_packet(0x10000u, nullptr, pkt).result, PROPAGATION_CONTINUE);
+    EXPECT_EQ(seen.size(), std::size(types));
+}
@@ -1,12 +1,15 @@
 #pragma once
 /// @file tests/test_helpers.hpp
-/// Общие утилиты для тестов: tmp_dir, mock connectors, SSH key helpers.
+/// Общие утилиты для тестов: tmp_dir, mock connectors, frame streams,
+/// allocation counter, SSH key helpers.
 
+#include <algorithm>
 #include <cstring>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <mutex>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -120,6 +123,109 @@ inline connector_ops_t make_capturing_connector(CapturingSink* sink) {
     return ops;
 }
 
+// ─── send_owned mock connector ───────────────────────────────────────────────
+
+/// Коннектор-приёмник: держит переданные ядром буферы до конца теста
+/// (как TCP держит их до завершения async_write) либо копирует iovec.
+struct OwnedSink {
+    std::vector<owned_buf_t> held;
+    size_t buffers  = 0;
+    size_t bytes    = 0;
+    size_t copied   = 0;
+    size_t calls    = 0;        ///< send_gather / send_owned invocations
+    int    rc       = 0;
+    std::vector<uint8_t> scratch;
+
+    void release_all() {
+        for (auto& b : held) b.release(b.release_ctx);
+        held.clear();
+    }
+};
+
+inline connector_ops_t make_owned_ops(OwnedSink* sink) {
+    connector_ops_t ops = make_mock_connector_ops();
+    ops.connector_ctx = sink;
+    ops.send_owned = [](void* ctx, conn_id_t, const owned_buf_t* bufs, int count) -> int {
+        auto* s = static_cast<OwnedSink*>(ctx);
+        s->calls++;
+        for (int i = 0; i < count; ++i) {
+            s->buffers++;
+            s->bytes += bufs[i].size;
+            if (s->rc < 0) bufs[i].release(bufs[i].release_ctx);
+            else           s->held.push_back(bufs[i]);
+        }
+        return s->rc;
+    };
+    return ops;
+}
+
+/// Поведение до v2: коннектор обязан скопировать iovec до возврата.
+inline connector_ops_t make_copying_gather_ops(OwnedSink* sink) {
+    connector_ops_t ops = make_mock_connector_ops();
+    ops.connector_ctx = sink;
+    ops.send_to = [](void* ctx, conn_id_t, const void* data, size_t size) -> int {
+        auto* s = static_cast<OwnedSink*>(ctx);
+        s->scratch.assign(static_cast<const uint8_t*>(data),
+                          static_cast<const uint8_t*>(data) + size);
+        s->buffers++; s->bytes += size; s->copied += size;
+        return 0;
+    };
+    ops.send_gather = [](void* ctx, conn_id_t, const struct iovec* iov, int n) -> int {
+        auto* s = static_cast<OwnedSink*>(ctx);
+        s->calls++;
+        for (int i = 0; i < n; ++i) {
+            auto* p = static_cast<const uint8_t*>(iov[i].iov_base);
+            s->scratch.assign(p, p + iov[i].iov_len);
+            s->buffers++; s->bytes += iov[i].iov_len; s->copied += iov[i].iov_len;
+        }
+        return 0;
+    };
+    return ops;
+}
+
+// ─── Randomly fragmented frame stream ────────────────────────────────────────
+
+/// Поток из @p n кадров со случайной длиной payload (0..max_payload).
+inline std::vector<uint8_t> make_frame_stream(size_t n, size_t max_payload, uint64_t seed,
+                                              std::vector<size_t>* lens = nullptr) {
+    std::mt19937_64 rng{seed};
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < n; ++i) {
+        header_t h{};
+        h.magic        = GNET_MAGIC;
+        h.proto_ver    = GNET_PROTO_VER;
+        h.payload_type = MSG_TYPE_CHAT;
+        h.payload_len  = static_cast<uint32_t>(rng() % (max_payload + 1));
+        h.packet_id    = i;
+        const auto* hp = reinterpret_cast<const uint8_t*>(&h);
+        out.insert(out.end(), hp, hp + sizeof(h));
+        for (uint32_t k = 0; k < h.payload_len; ++k)
+            out.push_back(static_cast<uint8_t>(i + k));
+        if (lens) lens->push_back(h.payload_len);
+    }
+    return out;
+}
+
+/// Длины чанков, какими поток мог бы прийти из recv() (1..max_chunk).
+inline std::vector<size_t> random_cuts(size_t total, size_t max_chunk, uint64_t seed) {
+    std::mt19937_64 rng{seed};
+    std::vector<size_t> cuts;
+    for (size_t off = 0; off < total;) {
+        const size_t n = std::min(total - off, 1 + rng() % max_chunk);
+        cuts.push_back(n);
+        off += n;
+    }
+    return cuts;
+}
+
+// ─── Heap allocation counter ─────────────────────────────────────────────────
+
+// Счётчик аллокаций только для потока, который его включил: IO-потоки и
+// таймеры других тестов не влияют на результат.  operator new/delete заменены
+// в tests/alloc_counter.cpp — он линкуется только в unit_tests.
+extern thread_local bool   t_count_allocs;
+extern thread_local size_t t_allocs;
+
 // ─── OpenSSH Ed25519 key helpers ─────────────────────────────────────────────
 
 inline std::string make_openssh_pem(const uint8_t pub[32], const uint8_t sec[64]) {